@@ -2,6 +2,14 @@
 template<typename Archive>
 void serialize(Archive& ar, const unsigned int version);
 
+//! Get the elements from an archive which can give them in place (see
+//! mlpack::data::MappedIArchive), or NULL if it cannot.
+template<typename Archive>
+static eT* serialize_mapped(Archive& ar, const uword count,
+                            typename Archive::maps_arrays*);
+template<typename Archive>
+static eT* serialize_mapped(Archive& ar, const uword count, ...);
+
 /*
  * Add row_col_iterator and row_col_const_iterator to arma::Mat.
  */
@@ -26,6 +26,16 @@ void Mat<eT>::serialize(Archive& ar, const unsigned int /* version */)
 
     access::rw(mem_state) = 0;
 
+    // If the archive gives the elements in place, use them as auxiliary
+    // memory instead of copying them.
+    eT* mapped = serialize_mapped(ar, n_elem, 0);
+    if (mapped != NULL)
+    {
+      access::rw(mem) = mapped;
+      access::rw(mem_state) = 1;
+      return;
+    }
+
     // We also need to allocate the memory we're using.
     init_cold();
   }
@@ -33,6 +43,24 @@ void Mat<eT>::serialize(Archive& ar, const unsigned int /* version */)
   ar & make_array(access::rwp(mem), n_elem);
 }
 
+template<typename eT>
+template<typename Archive>
+eT* Mat<eT>::serialize_mapped(Archive& ar,
+                              const uword count,
+                              typename Archive::maps_arrays*)
+{
+  return ar.template map_array<eT>(count);
+}
+
+template<typename eT>
+template<typename Archive>
+eT* Mat<eT>::serialize_mapped(Archive& /* ar */,
+                              const uword /* count */,
+                              ...)
+{
+  return NULL;
+}
+
 #if ARMA_VERSION_MAJOR < 4 || \
     (ARMA_VERSION_MAJOR == 4 && ARMA_VERSION_MINOR < 349)
 ///////////////////////////////////////////////////////////////////////////////
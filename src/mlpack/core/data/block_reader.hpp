@@ -0,0 +1,173 @@
+/**
+ * @file block_reader.hpp
+ *
+ * A reader which streams the points of a dataset in blocks of columns, for
+ * algorithms which do not need the whole dataset in memory at once.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_BLOCK_READER_HPP
+#define __MLPACK_CORE_DATA_BLOCK_READER_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <future>
+#include "mapped_file.hpp"
+#include "hdf5_io.hpp"
+
+namespace mlpack {
+namespace data {
+
+/**
+ * A BlockReader gives the points of a dataset file in blocks of a fixed number
+ * of columns (the last block may be smaller), in the orientation of
+ * data::Load() with transpose = true: each point is a column.  Only the current
+ * block (and the next one, while it is prefetched) is in memory, so files
+ * larger than memory can be processed, one pass at a time.
+ *
+ * The file is memory-mapped (HDF5 files are read through the HDF5 library
+ * instead) and read sequentially.  With prefetching, the next block is read on
+ * a separate thread while the current one is used, so that reading overlaps
+ * with computation.  Blocks are read into a buffer that is
+ * swapped with the matrix given to Next(), so after the first two blocks no
+ * memory is allocated.
+ *
+ * The format is given by the extension of the file:
+ *
+ *  - .csv: comma-separated values, one point per line;
+ *  - .tsv, .txt: values separated by spaces or tabs, one point per line;
+ *  - .bin: Armadillo binary (as written by data::Save()), or, if the file has
+ *    no Armadillo header, raw binary elements of type eT with the points
+ *    stored one after another (the dimensionality must then be given);
+ *  - .mmat: mapped matrix (as written by data::Save());
+ *  - .h5, .hdf5, .hdf, .he5: HDF5 (see LoadHDF5()), if Armadillo has HDF5
+ *    support; each block is read with one hyperslab read.  Unless the HDF5
+ *    library is thread-safe, HDF5 files must not be used elsewhere in the
+ *    program while blocks are prefetched.
+ *
+ * The binary formats must hold elements of type eT.  In text files, fields
+ * which are not numbers are read as 0, and short lines are padded with 0.
+ *
+ * For example, to compute the mean of a dataset:
+ *
+ * @code
+ * data::BlockReader<> reader("dataset.csv", 10000);
+ * arma::vec sum(reader.Dimensionality(), arma::fill::zeros);
+ * size_t points = 0;
+ * arma::mat block;
+ * while (reader.Next(block))
+ * {
+ *   sum += arma::sum(block, 1);
+ *   points += block.n_cols;
+ * }
+ * @endcode
+ *
+ * @tparam eT Type of the elements of the blocks.
+ */
+template<typename eT = double>
+class BlockReader
+{
+ public:
+  /**
+   * Open a dataset file.  A std::runtime_error is thrown if the file cannot be
+   * opened or its format is not supported.
+   *
+   * @param filename Name of the file.
+   * @param blockSize Number of points in each block.
+   * @param prefetch Whether to read the next block on a separate thread.
+   * @param dimensionality Dimensionality of the points, for raw binary files
+   *     (ignored for other formats, which store it).
+   */
+  BlockReader(const std::string& filename,
+              const size_t blockSize,
+              const bool prefetch = true,
+              const size_t dimensionality = 0);
+
+  //! Wait for the block being prefetched, if any.
+  ~BlockReader();
+
+  /**
+   * Get the next block of points.  The matrix is resized to Dimensionality()
+   * rows and up to BlockSize() columns.  A std::runtime_error is thrown if the
+   * file has an error.
+   *
+   * @param block Matrix to hold the block.
+   * @return false (and block is unchanged) if there are no more points.
+   */
+  bool Next(arma::Mat<eT>& block);
+
+  //! Go back to the first block, to make another pass over the dataset.
+  void Reset();
+
+  //! Get the dimensionality of the points.
+  size_t Dimensionality() const { return dimensionality; }
+  //! Get the number of points in each block.
+  size_t BlockSize() const { return blockSize; }
+
+ private:
+  //! The formats of files.
+  enum Format
+  {
+    TEXT,
+    ARMA_BINARY,
+    RAW_BINARY,
+    MAPPED_MATRIX,
+    HDF5
+  };
+
+  //! Name of the file.
+  std::string filename;
+  //! Number of points in each block.
+  size_t blockSize;
+  //! Whether to prefetch the next block.
+  bool prefetch;
+  //! The mapped file.
+  MappedFile file;
+  //! The format of the file.
+  Format format;
+  //! Separator of text files (' ' for any blanks).
+  char separator;
+  //! Dimensionality of the points.
+  size_t dimensionality;
+  //! Number of points in binary files.
+  size_t points;
+  //! The first element (or character, for text files) of the data.
+  const char* begin;
+  //! The next character to read in text files.
+  const char* position;
+  //! The number of points read so far.
+  size_t point;
+  //! Number of fields of text files that were not numbers.
+  size_t nonNumeric;
+  //! Number of lines of text files with fewer fields than the dimensionality.
+  size_t shortLines;
+  //! The block being read.
+  arma::Mat<eT> buffer;
+  //! The number of points of the block being prefetched.
+  std::future<size_t> pending;
+
+  //! Read the next block into buffer, and return its number of points.
+  size_t Fill();
+  //! Read the next block of a text file.
+  size_t FillText();
+  //! Read the next block of a binary (or HDF5) file.
+  size_t FillBinary();
+  //! Warn about non-numeric fields and short lines read so far, if any.
+  void WarnText();
+
+  //! The reader cannot be copied, since it owns its mapping and thread.
+  BlockReader(const BlockReader& other);
+  BlockReader& operator=(const BlockReader& other);
+};
+
+} // namespace data
+} // namespace mlpack
+
+// Include implementation.
+#include "block_reader_impl.hpp"
+
+#endif
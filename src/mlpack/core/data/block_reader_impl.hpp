@@ -0,0 +1,318 @@
+/**
+ * @file block_reader_impl.hpp
+ *
+ * Implementation of BlockReader.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_BLOCK_READER_IMPL_HPP
+#define __MLPACK_CORE_DATA_BLOCK_READER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "block_reader.hpp"
+#include "extension.hpp"
+#include "load_text.hpp"
+#include "mapped_matrix.hpp"
+
+#include <mlpack/core/util/log.hpp>
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace mlpack {
+namespace data {
+
+template<typename eT>
+BlockReader<eT>::BlockReader(const std::string& filename,
+                             const size_t blockSize,
+                             const bool prefetch,
+                             const size_t dimensionality) :
+    filename(filename),
+    blockSize(blockSize),
+    prefetch(prefetch),
+    file(filename),
+    format(TEXT),
+    separator(' '),
+    dimensionality(dimensionality),
+    points(0),
+    begin(file.Data()),
+    position(file.Data()),
+    point(0),
+    nonNumeric(0),
+    shortLines(0)
+{
+  const std::string error = "data::BlockReader: cannot read '" + filename +
+      "': ";
+  if (blockSize == 0)
+    throw std::runtime_error(error + "the block size must be positive");
+
+  const std::string extension = Extension(filename);
+  const char* end = file.Data() + file.Size();
+  if (extension == "csv" || extension == "tsv" || extension == "txt")
+  {
+    // The dimensionality is the number of fields of the first non-blank line.
+    format = TEXT;
+    separator = (extension == "csv") ? ',' : ' ';
+    this->dimensionality = 0;
+    for (const char* p = begin; p != end && this->dimensionality == 0; )
+    {
+      const char* next;
+      const char* lineEnd = text::LineEnd(p, end, next);
+      text::Field field;
+      for (const char* fieldStart = p;
+           text::NextField(fieldStart, lineEnd, separator, field); )
+        ++this->dimensionality;
+      if (text::IsBlankLine(p, lineEnd))
+        this->dimensionality = 0;
+      p = next;
+    }
+  }
+  else if (extension == "bin" && file.Size() >= 13 &&
+           std::memcmp(begin, "ARMA_MAT_BIN_", 13) == 0)
+  {
+    // The header is "ARMA_MAT_BIN_<type>\n<rows> <cols>\n".  data::Save()
+    // stores the transpose, so each row is a point.
+    format = ARMA_BINARY;
+    const char* typeEnd = (const char*) std::memchr(begin, '\n', end - begin);
+    const char* sizeEnd = (typeEnd == NULL) ? NULL :
+        (const char*) std::memchr(typeEnd + 1, '\n', end - typeEnd - 1);
+    if (sizeEnd == NULL)
+      throw std::runtime_error(error + "invalid Armadillo header");
+
+    if (std::string(begin, typeEnd) !=
+        arma::diskio::gen_bin_header(arma::Mat<eT>()))
+      throw std::runtime_error(error + "the elements have a different type");
+
+    std::istringstream size(std::string(typeEnd + 1, sizeEnd));
+    size >> points >> this->dimensionality;
+    begin = sizeEnd + 1;
+    if (size.fail() || (this->dimensionality != 0 && points > (size_t) (end -
+        begin) / sizeof(eT) / this->dimensionality))
+      throw std::runtime_error(error + "invalid Armadillo header");
+  }
+  else if (extension == "bin")
+  {
+    format = RAW_BINARY;
+    if (dimensionality == 0)
+      throw std::runtime_error(error + "the dimensionality of raw binary data "
+          "must be given");
+    if (file.Size() % (dimensionality * sizeof(eT)) != 0)
+      throw std::runtime_error(error + "the size of the file is not a multiple "
+          "of the size of a point");
+    points = file.Size() / (dimensionality * sizeof(eT));
+  }
+  else if (extension == "mmat")
+  {
+    format = MAPPED_MATRIX;
+    mapped::Header header;
+    mapped::ReadHeader(file, filename, header);
+    if (header.elementKind != mapped::Kind<eT>() ||
+        header.elementSize != sizeof(eT))
+      throw std::runtime_error(error + "the elements have a different type");
+
+    this->dimensionality = (size_t) header.rows;
+    points = (size_t) header.cols;
+    begin = file.Data() + header.offset;
+  }
+  else if (extension == "h5" || extension == "hdf5" || extension == "hdf" ||
+           extension == "he5")
+  {
+#ifdef ARMA_USE_HDF5
+    format = HDF5;
+    HDF5Size(filename, this->dimensionality, points);
+#else
+    throw std::runtime_error(error + "Armadillo was compiled without HDF5 "
+        "support");
+#endif
+  }
+  else
+  {
+    throw std::runtime_error(error + "unsupported format");
+  }
+
+  position = begin;
+}
+
+template<typename eT>
+BlockReader<eT>::~BlockReader()
+{
+  // Errors of a block that was never used are not reported.
+  if (pending.valid())
+  {
+    try
+    {
+      pending.get();
+    }
+    catch (std::exception& /* e */) { }
+  }
+}
+
+template<typename eT>
+bool BlockReader<eT>::Next(arma::Mat<eT>& block)
+{
+  const size_t n = pending.valid() ? pending.get() : Fill();
+  if (n == 0)
+  {
+    WarnText();
+    return false;
+  }
+
+  // The caller gets the block, and its old memory is used for the next one.
+  block.swap(buffer);
+  if (prefetch)
+    pending = std::async(std::launch::async, [this]() { return Fill(); });
+
+  return true;
+}
+
+template<typename eT>
+void BlockReader<eT>::Reset()
+{
+  if (pending.valid())
+  {
+    try
+    {
+      pending.get();
+    }
+    catch (std::exception& /* e */) { }
+  }
+
+  position = begin;
+  point = 0;
+  nonNumeric = 0;
+  shortLines = 0;
+}
+
+template<typename eT>
+size_t BlockReader<eT>::Fill()
+{
+  return (format == TEXT) ? FillText() : FillBinary();
+}
+
+template<typename eT>
+size_t BlockReader<eT>::FillText()
+{
+  const char* end = file.Data() + file.Size();
+  buffer.set_size(dimensionality, blockSize);
+
+  size_t n = 0;
+  while (n < blockSize && position != end)
+  {
+    const char* next;
+    const char* lineEnd = text::LineEnd(position, end, next);
+    if (text::IsBlankLine(position, lineEnd))
+    {
+      position = next;
+      continue;
+    }
+
+    eT* column = buffer.colptr(n);
+    size_t f = 0;
+    text::Field field;
+    for (const char* p = position;
+         text::NextField(p, lineEnd, separator, field); ++f)
+    {
+      if (f == dimensionality)
+      {
+        std::ostringstream error;
+        error << "data::BlockReader: line " << (point + n + 1) << " of '"
+            << filename << "' (not counting blank lines) has more than "
+            << dimensionality << " fields";
+        throw std::runtime_error(error.str());
+      }
+
+      double value;
+      if (text::ParseNumber(field.begin, field.end, value))
+      {
+        column[f] = text::ToElement<eT>(value,
+            typename std::is_floating_point<eT>::type());
+      }
+      else
+      {
+        column[f] = eT(0);
+        ++nonNumeric;
+      }
+    }
+
+    if (f < dimensionality)
+    {
+      ++shortLines;
+      for (; f < dimensionality; ++f)
+        column[f] = eT(0);
+    }
+
+    ++n;
+    position = next;
+  }
+
+  // Only the last block is smaller.
+  if (n != 0 && n < blockSize)
+    buffer.resize(dimensionality, n);
+
+  point += n;
+  return n;
+}
+
+template<typename eT>
+size_t BlockReader<eT>::FillBinary()
+{
+  const size_t n = std::min(blockSize, points - point);
+  if (n == 0)
+    return 0;
+
+#ifdef ARMA_USE_HDF5
+  if (format == HDF5)
+  {
+    LoadHDF5(filename, buffer, true, point, n);
+    point += n;
+    return n;
+  }
+#endif
+
+  buffer.set_size(dimensionality, n);
+  if (format == ARMA_BINARY)
+  {
+    // Dimension d of all the points is column d of the file, which may not be
+    // aligned.
+    for (size_t d = 0; d < dimensionality; ++d)
+    {
+      const char* source = begin + (d * points + point) * sizeof(eT);
+      for (size_t i = 0; i < n; ++i)
+        std::memcpy(&buffer(d, i), source + i * sizeof(eT), sizeof(eT));
+    }
+  }
+  else
+  {
+    std::memcpy(buffer.memptr(), begin + point * dimensionality * sizeof(eT),
+        n * dimensionality * sizeof(eT));
+  }
+
+  point += n;
+  return n;
+}
+
+template<typename eT>
+void BlockReader<eT>::WarnText()
+{
+  if (shortLines > 0)
+    Log::Warn << "'" << filename << "': " << shortLines << " lines have "
+        << "fewer than " << dimensionality << " fields; the missing fields are "
+        << "0." << std::endl;
+  if (nonNumeric > 0)
+    Log::Warn << "'" << filename << "': " << nonNumeric << " fields are not "
+        << "numbers and were read as 0." << std::endl;
+
+  shortLines = 0;
+  nonNumeric = 0;
+}
+
+} // namespace data
+} // namespace mlpack
+
+#endif
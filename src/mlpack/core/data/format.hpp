@@ -24,7 +24,8 @@ enum format
   autodetect,
   text,
   xml,
-  binary
+  binary,
+  mapped
 };
 
 } // namespace data
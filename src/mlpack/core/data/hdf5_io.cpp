@@ -0,0 +1,170 @@
+/**
+ * @file hdf5_io.cpp
+ *
+ * Implementation of the non-templated parts of HDF5 loading and saving.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "hdf5_io.hpp"
+
+#ifdef ARMA_USE_HDF5
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+namespace {
+
+//! The size of the blocks that are read or written at once, and of chunks.
+const size_t blockBytes = 1 << 20;
+
+//! Called for each link of a group by H5Literate(); stops at the first dataset
+//! and keeps it in the hid_t pointed to by data.
+herr_t FindDataset(hid_t group,
+                   const char* name,
+                   const H5L_info_t* /* info */,
+                   void* data)
+{
+  const hid_t dataset = H5Dopen2(group, name, H5P_DEFAULT);
+  if (dataset < 0)
+    return 0;
+
+  *((hid_t*) data) = dataset;
+  return 1;
+}
+
+} // anonymous namespace
+
+hdf5::Handle::Handle(const hid_t id,
+                     herr_t (*close)(hid_t),
+                     const std::string& error) :
+    id(id),
+    close(close)
+{
+  if (id < 0)
+    throw std::runtime_error(error);
+}
+
+hdf5::Handle::~Handle()
+{
+  close(id);
+}
+
+hdf5::ErrorGuard::ErrorGuard() :
+    function(NULL),
+    data(NULL)
+{
+  H5Eget_auto2(H5E_DEFAULT, &function, &data);
+  H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+}
+
+hdf5::ErrorGuard::~ErrorGuard()
+{
+  H5Eset_auto2(H5E_DEFAULT, function, data);
+}
+
+hid_t hdf5::OpenDataset(const hid_t file,
+                        const std::string& filename,
+                        const std::string& name,
+                        size_t& dimensionality,
+                        size_t& points)
+{
+  hid_t dataset = -1;
+  if (!name.empty())
+    dataset = H5Dopen2(file, name.c_str(), H5P_DEFAULT);
+  else if (H5Lexists(file, "dataset", H5P_DEFAULT) > 0)
+    dataset = H5Dopen2(file, "dataset", H5P_DEFAULT);
+  else
+    H5Literate(file, H5_INDEX_NAME, H5_ITER_NATIVE, NULL, FindDataset,
+        &dataset);
+
+  if (dataset < 0)
+    throw std::runtime_error("no dataset " + (name.empty() ? std::string() :
+        "'" + name + "' ") + "in '" + filename + "'");
+
+  hid_t space = H5Dget_space(dataset);
+  const int rank = (space < 0) ? -1 : H5Sget_simple_extent_ndims(space);
+  hsize_t size[2] = { 1, 0 };
+  if (rank == 1 || rank == 2)
+    H5Sget_simple_extent_dims(space, size + (2 - rank), NULL);
+  if (space >= 0)
+    H5Sclose(space);
+
+  if (rank != 1 && rank != 2)
+  {
+    H5Dclose(dataset);
+    throw std::runtime_error("dataset of '" + filename + "' does not have one "
+        "or two dimensions");
+  }
+
+  dimensionality = (size_t) size[0];
+  points = (size_t) size[1];
+  return dataset;
+}
+
+size_t hdf5::BlockPoints(const hid_t dataset,
+                         const size_t dimensionality,
+                         const size_t elementSize)
+{
+  size_t block = std::max((size_t) 1, blockBytes /
+      std::max((size_t) 1, dimensionality * elementSize));
+
+  const Handle properties(H5Dget_create_plist(dataset), H5Pclose,
+      "cannot get dataset properties");
+  if (H5Pget_layout(properties.Id()) == H5D_CHUNKED)
+  {
+    hsize_t chunk[2] = { 1, 1 };
+    const int rank = H5Pget_chunk(properties.Id(), 2, chunk);
+    const size_t chunkPoints = (rank == 1) ? chunk[0] : chunk[1];
+    if (rank >= 1 && chunkPoints > 0)
+      block = std::max((size_t) 1, block / chunkPoints) * chunkPoints;
+  }
+
+  return block;
+}
+
+hid_t hdf5::DatasetProperties(const size_t dimensionality,
+                              const size_t points,
+                              const size_t elementSize,
+                              const int compression,
+                              const size_t chunkPoints)
+{
+  const hid_t properties = H5Pcreate(H5P_DATASET_CREATE);
+  if (properties < 0 || dimensionality == 0 || points == 0)
+    return properties;
+
+  // Each chunk holds all the dimensions of some points.
+  const size_t chunk = (chunkPoints != 0) ? std::min(chunkPoints, points) :
+      std::min(points, std::max((size_t) 1, blockBytes /
+      (dimensionality * elementSize)));
+  const hsize_t chunkSize[2] = { dimensionality, chunk };
+  H5Pset_chunk(properties, 2, chunkSize);
+
+  // Shuffling the bytes of the elements makes them compress much better.
+  if (compression > 0 && H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0)
+  {
+    H5Pset_shuffle(properties);
+    H5Pset_deflate(properties, std::min(compression, 9));
+  }
+
+  return properties;
+}
+
+void data::HDF5Size(const std::string& filename,
+                    size_t& dimensionality,
+                    size_t& points,
+                    const std::string& dataset)
+{
+  hdf5::ErrorGuard guard;
+  const hdf5::Handle file(H5Fopen(filename.c_str(), H5F_ACC_RDONLY,
+      H5P_DEFAULT), H5Fclose, "cannot open file '" + filename + "'");
+  const hdf5::Handle data(hdf5::OpenDataset(file.Id(), filename, dataset,
+      dimensionality, points), H5Dclose, "cannot open dataset of '" +
+      filename + "'");
+}
+
+#endif
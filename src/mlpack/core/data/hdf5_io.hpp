@@ -0,0 +1,193 @@
+/**
+ * @file hdf5_io.hpp
+ *
+ * Loading and saving of matrices as chunked, compressed HDF5 datasets, with
+ * loads of ranges of points.  Used by data::Load() and data::Save() for HDF5
+ * files when Armadillo is compiled with HDF5 support.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_HDF5_IO_HPP
+#define __MLPACK_CORE_DATA_HDF5_IO_HPP
+
+#include <mlpack/prereqs.hpp>
+
+// Armadillo includes the HDF5 headers when it uses HDF5.
+#ifdef ARMA_USE_HDF5
+
+#include <limits>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Load some or all of the points of an HDF5 dataset.  The dataset has the
+ * layout of Armadillo's hdf5_binary format for the transpose of the matrix (as
+ * saved by data::Save()): it is two-dimensional, with one row per dimension and
+ * one column per point (a one-dimensional dataset has one dimension).
+ *
+ * Only the selected points are read from the file, with one hyperslab read per
+ * block of chunks, so that several processes can each load their own slice of
+ * a shared file, and each chunk is decompressed only once.  The dataset may
+ * have any numeric type; it is converted to eT by the HDF5 library.
+ *
+ * A std::runtime_error is thrown upon failure.
+ *
+ * @param filename Name of the file to load.
+ * @param matrix Matrix to load into.  If transpose is true, each point is a
+ *     column; otherwise each point is a row.
+ * @param transpose Whether to transpose the matrix (see above).
+ * @param first Index of the first point to load.
+ * @param count Number of points to load (all the remaining points, by
+ *     default).
+ * @param dataset Name of the dataset; by default, "dataset" (as written by
+ *     Armadillo and data::Save()) if it exists, or else the first dataset in
+ *     the file.
+ * @return The number of bytes loaded.
+ */
+template<typename eT>
+size_t LoadHDF5(const std::string& filename,
+                arma::Mat<eT>& matrix,
+                const bool transpose = true,
+                const size_t first = 0,
+                const size_t count = std::numeric_limits<size_t>::max(),
+                const std::string& dataset = "");
+
+/**
+ * Save a matrix as an HDF5 dataset named "dataset", in the layout of
+ * Armadillo's hdf5_binary format for the transpose of the matrix (see
+ * LoadHDF5()).  The dataset is stored in chunks of whole points and, if the
+ * HDF5 library has the deflate filter, compressed with shuffling and deflate.
+ *
+ * A std::runtime_error is thrown upon failure.
+ *
+ * @param filename Name of the file to save to.
+ * @param matrix Matrix to save.
+ * @param transpose If true, each column of the matrix is a point; otherwise
+ *     each row is a point.
+ * @param compression Deflate level, from 0 (no compression) to 9.
+ * @param chunkPoints Number of points in each chunk; by default, enough for
+ *     chunks of about a megabyte.
+ * @return The number of bytes saved (before compression).
+ */
+template<typename eT>
+size_t SaveHDF5(const std::string& filename,
+                const arma::Mat<eT>& matrix,
+                const bool transpose = true,
+                const int compression = 1,
+                const size_t chunkPoints = 0);
+
+/**
+ * Get the size of an HDF5 dataset (see LoadHDF5()) without loading it, for
+ * example to split its points between processes.  A std::runtime_error is
+ * thrown upon failure.
+ *
+ * @param filename Name of the file.
+ * @param dimensionality Set to the dimensionality of the points.
+ * @param points Set to the number of points.
+ * @param dataset Name of the dataset (see LoadHDF5()).
+ */
+void HDF5Size(const std::string& filename,
+              size_t& dimensionality,
+              size_t& points,
+              const std::string& dataset = "");
+
+namespace hdf5 {
+
+/**
+ * An HDF5 identifier, which is closed when the Handle is destroyed.  A
+ * std::runtime_error with the given message is thrown if the identifier is not
+ * valid.
+ */
+class Handle
+{
+ public:
+  //! Take ownership of the identifier, which is closed with close().
+  Handle(const hid_t id, herr_t (*close)(hid_t), const std::string& error);
+  //! Close the identifier.
+  ~Handle();
+
+  //! Get the identifier.
+  hid_t Id() const { return id; }
+
+ private:
+  //! The identifier.
+  hid_t id;
+  //! The function that closes the identifier.
+  herr_t (*close)(hid_t);
+
+  //! The handle cannot be copied, since it owns the identifier.
+  Handle(const Handle& other);
+  Handle& operator=(const Handle& other);
+};
+
+/**
+ * While an ErrorGuard exists, the HDF5 library does not print its errors;
+ * they are reported with exceptions instead.
+ */
+class ErrorGuard
+{
+ public:
+  //! Stop printing errors.
+  ErrorGuard();
+  //! Restore the previous error handler.
+  ~ErrorGuard();
+
+ private:
+  //! The previous error handler.
+  H5E_auto2_t function;
+  //! The data of the previous error handler.
+  void* data;
+};
+
+/**
+ * Open a dataset of the file (see LoadHDF5() for the name), and get its size.
+ * A std::runtime_error is thrown if there is no such dataset, or it does not
+ * have one or two dimensions.
+ */
+hid_t OpenDataset(const hid_t file,
+                  const std::string& filename,
+                  const std::string& name,
+                  size_t& dimensionality,
+                  size_t& points);
+
+/**
+ * Get the number of points to read or write at once, a multiple of the number
+ * of points in each chunk (if the dataset is chunked).
+ */
+size_t BlockPoints(const hid_t dataset,
+                   const size_t dimensionality,
+                   const size_t elementSize);
+
+/**
+ * Make the creation properties of a dataset with the given size: chunks of the
+ * given number of points (or about a megabyte, if 0), compressed with the
+ * given deflate level.
+ */
+hid_t DatasetProperties(const size_t dimensionality,
+                        const size_t points,
+                        const size_t elementSize,
+                        const int compression,
+                        const size_t chunkPoints);
+
+//! Get the HDF5 type of elements of type eT.  A std::runtime_error is thrown
+//! if there is none.
+template<typename eT>
+hid_t NativeType();
+
+} // namespace hdf5
+
+} // namespace data
+} // namespace mlpack
+
+// Include implementation.
+#include "hdf5_io_impl.hpp"
+
+#endif
+
+#endif
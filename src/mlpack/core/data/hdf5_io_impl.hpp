@@ -0,0 +1,195 @@
+/**
+ * @file hdf5_io_impl.hpp
+ *
+ * Implementation of LoadHDF5() and SaveHDF5().
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_HDF5_IO_IMPL_HPP
+#define __MLPACK_CORE_DATA_HDF5_IO_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "hdf5_io.hpp"
+
+#include <stdexcept>
+#include <type_traits>
+
+namespace mlpack {
+namespace data {
+namespace hdf5 {
+
+template<typename eT>
+hid_t NativeType()
+{
+  if (std::is_floating_point<eT>::value && sizeof(eT) == 4)
+    return H5T_NATIVE_FLOAT;
+  else if (std::is_floating_point<eT>::value && sizeof(eT) == 8)
+    return H5T_NATIVE_DOUBLE;
+  else if (std::is_integral<eT>::value && std::is_signed<eT>::value)
+  {
+    switch (sizeof(eT))
+    {
+      case 1: return H5T_NATIVE_INT8;
+      case 2: return H5T_NATIVE_INT16;
+      case 4: return H5T_NATIVE_INT32;
+      case 8: return H5T_NATIVE_INT64;
+    }
+  }
+  else if (std::is_integral<eT>::value)
+  {
+    switch (sizeof(eT))
+    {
+      case 1: return H5T_NATIVE_UINT8;
+      case 2: return H5T_NATIVE_UINT16;
+      case 4: return H5T_NATIVE_UINT32;
+      case 8: return H5T_NATIVE_UINT64;
+    }
+  }
+
+  throw std::runtime_error("HDF5 does not support the element type");
+}
+
+/**
+ * Select the points [first, first + count) of the dataset, whose dataspace has
+ * the given rank (one or two).
+ */
+inline void SelectPoints(const hid_t space,
+                         const int rank,
+                         const size_t dimensionality,
+                         const size_t first,
+                         const size_t count)
+{
+  hsize_t start[2] = { 0, first };
+  hsize_t size[2] = { dimensionality, count };
+  if (H5Sselect_hyperslab(space, H5S_SELECT_SET, start + (2 - rank), NULL,
+      size + (2 - rank), NULL) < 0)
+    throw std::runtime_error("cannot select points of HDF5 dataset");
+}
+
+} // namespace hdf5
+
+template<typename eT>
+size_t LoadHDF5(const std::string& filename,
+                arma::Mat<eT>& matrix,
+                const bool transpose,
+                const size_t first,
+                const size_t count,
+                const std::string& dataset)
+{
+  hdf5::ErrorGuard guard;
+  const hdf5::Handle file(H5Fopen(filename.c_str(), H5F_ACC_RDONLY,
+      H5P_DEFAULT), H5Fclose, "cannot open file '" + filename + "'");
+
+  size_t dimensionality, points;
+  const hdf5::Handle data(hdf5::OpenDataset(file.Id(), filename, dataset,
+      dimensionality, points), H5Dclose, "cannot open dataset of '" +
+      filename + "'");
+  if (first > points)
+    throw std::runtime_error("'" + filename + "' has fewer points than the "
+        "first point to load");
+
+  const size_t n = std::min(count, points - first);
+  if (transpose)
+    matrix.set_size(dimensionality, n);
+  else
+    matrix.set_size(n, dimensionality);
+  if (matrix.n_elem == 0)
+    return 0;
+
+  const hdf5::Handle space(H5Dget_space(data.Id()), H5Sclose,
+      "cannot get dataspace of '" + filename + "'");
+  const int rank = H5Sget_simple_extent_ndims(space.Id());
+  const hid_t type = hdf5::NativeType<eT>();
+
+  // Read blocks that start and end at chunk boundaries (except at the ends of
+  // the range), so that each chunk is read and decompressed once.  Each block
+  // is read as one dimension after another, which is the transpose of the
+  // block of points.
+  const size_t block = hdf5::BlockPoints(data.Id(), dimensionality,
+      sizeof(eT));
+  arma::Mat<eT> buffer;
+  for (size_t point = first; point < first + n; )
+  {
+    const size_t end = std::min(first + n, (point / block + 1) * block);
+    buffer.set_size(end - point, dimensionality);
+
+    hdf5::SelectPoints(space.Id(), rank, dimensionality, point, end - point);
+    const hsize_t elements = buffer.n_elem;
+    const hdf5::Handle memory(H5Screate_simple(1, &elements, NULL), H5Sclose,
+        "cannot create dataspace");
+    if (H5Dread(data.Id(), type, memory.Id(), space.Id(), H5P_DEFAULT,
+        buffer.memptr()) < 0)
+      throw std::runtime_error("cannot read from '" + filename + "'");
+
+    if (transpose)
+      matrix.cols(point - first, end - first - 1) = trans(buffer);
+    else
+      matrix.rows(point - first, end - first - 1) = buffer;
+
+    point = end;
+  }
+
+  return matrix.n_elem * sizeof(eT);
+}
+
+template<typename eT>
+size_t SaveHDF5(const std::string& filename,
+                const arma::Mat<eT>& matrix,
+                const bool transpose,
+                const int compression,
+                const size_t chunkPoints)
+{
+  const size_t dimensionality = transpose ? matrix.n_rows : matrix.n_cols;
+  const size_t points = transpose ? matrix.n_cols : matrix.n_rows;
+  const hid_t type = hdf5::NativeType<eT>();
+
+  hdf5::ErrorGuard guard;
+  const hdf5::Handle file(H5Fcreate(filename.c_str(), H5F_ACC_TRUNC,
+      H5P_DEFAULT, H5P_DEFAULT), H5Fclose, "cannot open file '" + filename +
+      "' for writing");
+
+  const hsize_t size[2] = { dimensionality, points };
+  const hdf5::Handle space(H5Screate_simple(2, size, NULL), H5Sclose,
+      "cannot create dataspace");
+  const hdf5::Handle properties(hdf5::DatasetProperties(dimensionality, points,
+      sizeof(eT), compression, chunkPoints), H5Pclose,
+      "cannot create dataset properties");
+  const hdf5::Handle data(H5Dcreate2(file.Id(), "dataset", type, space.Id(),
+      H5P_DEFAULT, properties.Id(), H5P_DEFAULT), H5Dclose,
+      "cannot create dataset in '" + filename + "'");
+  if (matrix.n_elem == 0)
+    return 0;
+
+  // Write whole chunks at once, one dimension after another.
+  const size_t block = hdf5::BlockPoints(data.Id(), dimensionality,
+      sizeof(eT));
+  arma::Mat<eT> buffer;
+  for (size_t point = 0; point < points; point += block)
+  {
+    const size_t end = std::min(points, point + block);
+    if (transpose)
+      buffer = trans(matrix.cols(point, end - 1));
+    else
+      buffer = matrix.rows(point, end - 1);
+
+    hdf5::SelectPoints(space.Id(), 2, dimensionality, point, end - point);
+    const hsize_t elements = buffer.n_elem;
+    const hdf5::Handle memory(H5Screate_simple(1, &elements, NULL), H5Sclose,
+        "cannot create dataspace");
+    if (H5Dwrite(data.Id(), type, memory.Id(), space.Id(), H5P_DEFAULT,
+        buffer.memptr()) < 0)
+      throw std::runtime_error("cannot write to '" + filename + "'");
+  }
+
+  return matrix.n_elem * sizeof(eT);
+}
+
+} // namespace data
+} // namespace mlpack
+
+#endif
@@ -43,6 +43,15 @@ namespace data /** Functions to load and save matrices and models. */ {
  *  - Armadillo binary (arma_binary), denoted by .bin
  *  - HDF5, denoted by .hdf, .hdf5, .h5, or .he5
  *
+ * HDF5 datasets are read by LoadHDF5(), which can also load a range of the
+ * points only.
+ *
+ * In addition, matrices saved by data::Save() as mapped matrices (denoted by
+ * .mmat) are memory-mapped rather than read, so that they load in constant
+ * time without copying the data; see LoadMapped() for details.  The mapping is
+ * not released when the matrix is destroyed: call UnmapMatrix() when the
+ * matrix is no longer needed.
+ *
  * If the file extension is not one of those types, an error will be given.
  * This is preferable to Armadillo's default behavior of loading an unknown
  * filetype as raw_binary, which can have very confusing effects.
@@ -111,14 +120,22 @@ bool Load(const std::string& filename,
  * is used and the filetype cannot be determined, an error will be given.
  *
  * The supported types of files are the same as what is supported by the
- * boost::serialization library:
+ * boost::serialization library, and mlpack's own mapped binary archive:
  *
  *  - text, denoted by .txt
  *  - xml, denoted by .xml
  *  - binary, denoted by .bin
+ *  - mapped binary, denoted by .mbin
+ *
+ * Loading a mapped binary file takes little time even for large models: the
+ * file is memory-mapped and large matrices of the model use the mapping
+ * instead of being copied (see MappedIArchive).  As for .mmat matrices, the
+ * mapping is not released when the model is destroyed; call UnmapMatrix() on
+ * those matrices to release it before the program exits.
  *
  * The format parameter can take any of the values in the 'format' enum:
- * 'format::autodetect', 'format::text', 'format::xml', and 'format::binary'.
+ * 'format::autodetect', 'format::text', 'format::xml', 'format::binary', and
+ * 'format::mapped'.
  * The autodetect functionality operates on the file extension (so, "file.txt"
  * would be autodetected as text).
  *
@@ -44,15 +44,22 @@ void LoadARFF(const std::string& filename, arma::Mat<eT>& matrix);
  * loading the training set is not used, then the test set may be loaded with
  * different mappings---which can cause horrible problems!
  *
+ * The points are written directly into their place in the matrix, so loading
+ * with either orientation needs no transpose.
+ *
  * @param filename Name of ARFF file to load.
  * @param matrix Matrix to load data into.
  * @param info DatasetInfo object; can be default-constructed or pre-existing
  *     from another call to LoadARFF().
+ * @param transpose If true (the default), each point is a column of the
+ *     matrix; otherwise each point is a row.
+ * @return The number of bytes in the file.
  */
 template<typename eT>
-void LoadARFF(const std::string& filename,
-              arma::Mat<eT>& matrix,
-              DatasetInfo& info);
+size_t LoadARFF(const std::string& filename,
+                arma::Mat<eT>& matrix,
+                DatasetInfo& info,
+                const bool transpose = true);
 
 } // namespace data
 } // namespace mlpack
@@ -16,6 +16,8 @@
 
 // In case it hasn't been included yet.
 #include "load_arff.hpp"
+#include "load_text.hpp"
+#include "mapped_file.hpp"
 
 #include <boost/algorithm/string.hpp>
 
@@ -23,9 +25,10 @@ namespace mlpack {
 namespace data {
 
 template<typename eT>
-void LoadARFF(const std::string& filename,
-              arma::Mat<eT>& matrix,
-              DatasetInfo& info)
+size_t LoadARFF(const std::string& filename,
+                arma::Mat<eT>& matrix,
+                DatasetInfo& info,
+                const bool transpose)
 {
   // First, open the file.
   std::ifstream ifs;
@@ -124,100 +127,111 @@ void LoadARFF(const std::string& filename,
       info.Type(i) = Datatype::numeric;
   }
 
-  // We need to find out how many lines of data are in the file.
-  std::streampos pos = ifs.tellg();
-  size_t row = 0;
-  while (!ifs.eof())
-  {
-    std::getline(ifs, line, '\n');
-    ++row;
-  }
-  // Uncount the EOF row.
-  --row;
+  // The @data section is read from a mapping of the file, in two passes: the
+  // first counts the points, and the second parses them directly into their
+  // place in the matrix, so that no transpose or other copy is needed.
+  const std::streamoff dataStart = ifs.tellg();
+  ifs.close();
 
-  // Since we've hit the EOF, we have to call clear() so we can seek again.
-  ifs.clear();
-  ifs.seekg(pos);
+  MappedFile file(filename);
+  const char* begin = file.Data() + dataStart;
+  const char* end = file.Data() + file.Size();
 
-  // Now, set the size of the matrix.
-  matrix.set_size(dimensionality, row);
+  size_t points = 0;
+  for (const char* line = begin; line != end; )
+  {
+    const char* next;
+    const char* lineEnd = text::CommentStart(line, text::LineEnd(line, end,
+        next));
+    if (!text::IsBlankLine(line, lineEnd))
+      ++points;
+    line = next;
+  }
 
-  // Now we are looking at the @data section.
-  row = 0;
-  while (!ifs.eof())
+  if (transpose)
+    matrix.set_size(dimensionality, points);
+  else
+    matrix.set_size(points, dimensionality);
+
+  // Each line of the @data section must be a CSV (except sparse data, which we
+  // will handle later).  The '?' representing a missing value is not allowed,
+  // so if that occurs we throw an exception.  We also throw an exception if
+  // any piece of data does not match its type (categorical or numeric).
+  size_t point = 0;
+  size_t lineNumber = headerLines;
+  for (const char* line = begin; line != end; )
   {
-    std::getline(ifs, line, '\n');
-    boost::trim(line);
-    // Each line of the @data section must be a CSV (except sparse data, which
-    // we will handle later).  So now we can tokenize the
-    // CSV and parse it.  The '?' representing a missing value is not allowed,
-    // so if that occurs we throw an exception.  We also throw an exception if
-    // any piece of data does not match its type (categorical or numeric).
+    const char* next;
+    const char* lineEnd = text::CommentStart(line, text::LineEnd(line, end,
+        next));
+    ++lineNumber;
+    if (text::IsBlankLine(line, lineEnd))
+    {
+      line = next;
+      continue;
+    }
 
     // If the first character is {, it is sparse data, and we can just say this
     // is not handled for now...
-    if (line[0] == '{')
+    while (text::IsBlank(*line))
+      ++line;
+    if (*line == '{')
       throw std::runtime_error("cannot yet parse sparse ARFF data");
 
-    // Tokenize the line.
-    typedef boost::tokenizer<boost::escaped_list_separator<char>> Tokenizer;
-    boost::escaped_list_separator<char> sep("\\", ",", "\"");
-    Tokenizer tok(line, sep);
-
     size_t col = 0;
-    std::stringstream token;
-    for (Tokenizer::iterator it = tok.begin(); it != tok.end(); ++it)
+    text::Field field;
+    for (const char* position = line;
+         text::NextField(position, lineEnd, ',', field); ++col)
     {
       // Check that we are not too many columns in.
-      if (col >= matrix.n_rows)
+      if (col >= dimensionality)
       {
         std::stringstream error;
-        error << "Too many columns in line " << (headerLines + row) << ".";
+        error << "Too many columns in line " << lineNumber << ".";
         throw std::runtime_error(error.str());
       }
 
+      eT& element = transpose ? matrix(col, point) : matrix(point, col);
+
       // What should this token be?
       if (info.Type(col) == Datatype::categorical)
       {
-        matrix(col, row) = info.MapString(*it, col); // We load transposed.
+        element = info.MapString(text::FieldString(field), col);
+        continue;
       }
-      else if (info.Type(col) == Datatype::numeric)
-      {
-        // Attempt to read as numeric.
-        token.clear();
-        token.str(*it);
-
-        eT val = eT(0);
-        token >> val;
 
-        if (token.fail())
-        {
-          // Check for NaN or inf.
-          if (!arma::diskio::convert_naninf(val, token.str()))
-          {
-            // Okay, it's not NaN or inf.  If it's '?', we issue a specific
-            // error, otherwise we issue a general error.
-            std::stringstream error;
-            std::string tokenStr = token.str();
-            boost::trim(tokenStr);
-            if (tokenStr == "?")
-              error << "Missing values ('?') not supported, ";
-            else
-              error << "Parse error ";
-            error << "at line " << (headerLines + row) << " token " << col
-                << ": \"" << tokenStr << "\".";
-            throw std::runtime_error(error.str());
-          }
-        }
-
-        // If we made it to here, we have a value.
-        matrix(col, row) = val; // We load transposed.
+      double value;
+      if (!text::ParseNumber(field.begin, field.end, value))
+      {
+        // If it's '?', we issue a specific error, otherwise we issue a general
+        // error.
+        std::stringstream error;
+        const std::string token = text::FieldString(field);
+        if (token == "?")
+          error << "Missing values ('?') not supported, ";
+        else
+          error << "Parse error ";
+        error << "at line " << lineNumber << " token " << col << ": \""
+            << token << "\".";
+        throw std::runtime_error(error.str());
       }
 
-      ++col;
+      element = text::ToElement<eT>(value,
+          std::integral_constant<bool, std::is_floating_point<eT>::value>());
+    }
+
+    if (col < dimensionality)
+    {
+      std::stringstream error;
+      error << "Too few columns in line " << lineNumber << ".";
+      throw std::runtime_error(error.str());
     }
-    ++row;
+
+    ++point;
+    line = next;
   }
+
+  return file.Size();
 }
 
 } // namespace data
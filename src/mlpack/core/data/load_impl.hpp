@@ -32,6 +32,10 @@
 #include "serialization_shim.hpp"
 
 #include "load_arff.hpp"
+#include "load_text.hpp"
+#include "mapped_matrix.hpp"
+#include "mapped_archive.hpp"
+#include "hdf5_io.hpp"
 
 namespace mlpack {
 namespace data {
@@ -89,6 +93,66 @@ bool Load(const std::string& filename,
     return false;
   }
 
+  // Mapped matrices are not read through the stream, but mapped directly.
+  if (extension == "mmat")
+  {
+    stream.close();
+    Log::Info << "Loading '" << filename << "' as mapped matrix data.  "
+        << std::flush;
+    try
+    {
+      const size_t bytes = LoadMapped(filename, matrix, transpose);
+      Timer::AddBytes("loading_data", bytes);
+    }
+    catch (std::exception& e)
+    {
+      Log::Info << std::endl;
+      Timer::Stop("loading_data");
+      if (fatal)
+        Log::Fatal << e.what() << std::endl;
+      else
+        Log::Warn << e.what() << std::endl;
+
+      return false;
+    }
+
+    Log::Info << "Size is " << (transpose ? matrix.n_cols : matrix.n_rows)
+        << " x " << (transpose ? matrix.n_rows : matrix.n_cols) << ".\n";
+    Timer::Stop("loading_data");
+    return true;
+  }
+
+#ifdef ARMA_USE_HDF5
+  // HDF5 datasets are read a block of chunks at a time by LoadHDF5().
+  if (extension == "h5" || extension == "hdf5" || extension == "hdf" ||
+      extension == "he5")
+  {
+    stream.close();
+    Log::Info << "Loading '" << filename << "' as HDF5 data.  " << std::flush;
+    try
+    {
+      const size_t bytes = LoadHDF5(filename, matrix, transpose);
+      Timer::AddBytes("loading_data", bytes);
+    }
+    catch (std::exception& e)
+    {
+      Log::Info << std::endl;
+      Timer::Stop("loading_data");
+      if (fatal)
+        Log::Fatal << e.what() << std::endl;
+      else
+        Log::Warn << e.what() << std::endl;
+
+      return false;
+    }
+
+    Log::Info << "Size is " << (transpose ? matrix.n_cols : matrix.n_rows)
+        << " x " << (transpose ? matrix.n_rows : matrix.n_cols) << ".\n";
+    Timer::Stop("loading_data");
+    return true;
+  }
+#endif
+
   bool unknownType = false;
   arma::file_type loadType;
   std::string stringType;
@@ -206,26 +270,7 @@ bool Load(const std::string& filename,
   else if (extension == "h5" || extension == "hdf5" || extension == "hdf" ||
            extension == "he5")
   {
-#ifdef ARMA_USE_HDF5
-    loadType = arma::hdf5_binary;
-    stringType = "HDF5 data";
-  #if ARMA_VERSION_MAJOR == 4 && \
-      (ARMA_VERSION_MINOR >= 300 && ARMA_VERSION_MINOR <= 400)
-    Timer::Stop("loading_data");
-    if (fatal)
-      Log::Fatal << "Attempted to load '" << filename << "' as HDF5 data, but "
-          << "Armadillo 4.300.0 through Armadillo 4.400.1 are known to have "
-          << "bugs and one of these versions is in use.  Load failed."
-          << std::endl;
-    else
-      Log::Warn << "Attempted to load '" << filename << "' as HDF5 data, but "
-          << "Armadillo 4.300.0 through Armadillo 4.400.1 are known to have "
-          << "bugs and one of these versions is in use.  Load failed."
-          << std::endl;
-
-    return false;
-  #endif
-#else
+    // With HDF5 support, these were loaded above.
     Timer::Stop("loading_data");
     if (fatal)
       Log::Fatal << "Attempted to load '" << filename << "' as HDF5 data, but "
@@ -237,7 +282,6 @@ bool Load(const std::string& filename,
           << std::endl;
 
     return false;
-#endif
   }
   else // Unknown extension...
   {
@@ -268,6 +312,36 @@ bool Load(const std::string& filename,
     Log::Info << "Loading '" << filename << "' as " << stringType << ".  "
         << std::flush;
 
+  // Delimited text is parsed in parallel by LoadText(), directly into the
+  // (transposed, if requested) matrix.
+  if ((loadType == arma::csv_ascii || loadType == arma::raw_ascii) &&
+      std::is_arithmetic<eT>::value)
+  {
+    stream.close();
+    try
+    {
+      const size_t bytes = LoadText(filename, matrix,
+          (loadType == arma::csv_ascii) ? ',' : ' ', transpose);
+      Timer::AddBytes("loading_data", bytes);
+    }
+    catch (std::exception& e)
+    {
+      Log::Info << std::endl;
+      Timer::Stop("loading_data");
+      if (fatal)
+        Log::Fatal << e.what() << std::endl;
+      else
+        Log::Warn << e.what() << std::endl;
+
+      return false;
+    }
+
+    Log::Info << "Size is " << (transpose ? matrix.n_cols : matrix.n_rows)
+        << " x " << (transpose ? matrix.n_rows : matrix.n_cols) << ".\n";
+    Timer::Stop("loading_data");
+    return true;
+  }
+
   const bool success = matrix.load(stream, loadType);
 
   if (!success)
@@ -329,139 +403,29 @@ bool Load(const std::string& filename,
 
   if (extension == "csv" || extension == "tsv" || extension == "txt")
   {
-    // True if we're looking for commas; if false, we're looking for spaces.
-    bool commas = (extension == "csv");
-
-    std::string type;
-    if (extension == "csv")
-      type = "CSV data";
-    else
-      type = "raw ASCII-formatted data";
-
+    // Parse the file in parallel with LoadText().
+    const std::string type = (extension == "csv") ? "CSV data" :
+        "raw ASCII-formatted data";
     Log::Info << "Loading '" << filename << "' as " << type << ".  "
         << std::flush;
-    std::string separators;
-    if (commas)
-      separators = ",";
-    else
-      separators = " \t";
-
-    // We'll load this as CSV (or CSV with spaces or tabs) according to
-    // RFC4180.  So the first thing to do is determine the size of the matrix.
-    std::string buffer;
-    size_t cols = 0;
-
-    std::getline(stream, buffer, '\n');
-    // Count commas and whitespace in the line, ignoring anything inside
-    // quotes.
-    typedef boost::tokenizer<boost::escaped_list_separator<char>> Tokenizer;
-    boost::escaped_list_separator<char> sep("\\", separators, "\"");
-    Tokenizer tok(buffer, sep);
-    for (Tokenizer::iterator i = tok.begin(); i != tok.end(); ++i)
-      ++cols;
-
-    // Now count the number of lines in the file.  We've already counted the
-    // first one.
-    size_t rows = 1;
-    while (!stream.eof() && !stream.bad() && !stream.fail())
-    {
-      std::getline(stream, buffer, '\n');
-      if (!stream.fail())
-        ++rows;
-    }
 
-    // Now we have the size.  So resize our matrix.
-    if (transpose)
-    {
-      matrix.set_size(cols, rows);
-      info = DatasetInfo(cols);
-    }
-    else
+    stream.close();
+    try
     {
-      matrix.set_size(rows, cols);
-      info = DatasetInfo(rows);
+      const size_t bytes = LoadText(filename, matrix,
+          (extension == "csv") ? ',' : ' ', transpose, &info);
+      Timer::AddBytes("loading_data", bytes);
     }
-
-    stream.close();
-    stream.open(filename, std::fstream::in);
-
-    // Extract line by line.
-    std::stringstream token;
-    size_t row = 0;
-    while (!stream.bad() && !stream.fail() && !stream.eof())
+    catch (std::exception& e)
     {
-      std::getline(stream, buffer, '\n');
-
-      // Look at each token.  Unfortunately we have to do this character by
-      // character, because things may be escaped in quotes.
-      Tokenizer lineTok(buffer, sep);
-      size_t col = 0;
-      for (Tokenizer::iterator it = lineTok.begin(); it != lineTok.end(); ++it)
-      {
-        // Attempt to extract as type eT.  If that fails, we'll assume it's a
-        // string and map it (which may involve retroactively mapping everything
-        // we've seen so far).
-        token.clear();
-        token.str(*it);
-
-        eT val = eT(0);
-        token >> val;
-
-        if (token.fail())
-        {
-          // Conversion failed; but it may be a NaN or inf.  Armadillo has
-          // convenient functions to check.
-          if (!arma::diskio::convert_naninf(val, token.str()))
-          {
-            // We need to perform a mapping.
-            const size_t dim = (transpose) ? col : row;
-            if (info.Type(dim) == Datatype::numeric)
-            {
-              // We must map everything we have seen up to this point and change
-              // the values in the matrix.
-              if (transpose)
-              {
-                // Whatever we've seen so far has successfully mapped to an eT.
-                // So we need to print it back to a string.  We'll use
-                // Armadillo's functionality for that.
-                for (size_t i = 0; i < row; ++i)
-                {
-                  std::stringstream sstr;
-                  arma::arma_ostream::print_elem(sstr, matrix.at(i, col),
-                      false);
-                  eT newVal = info.MapString(sstr.str(), col);
-                  matrix.at(i, col) = newVal;
-                }
-              }
-              else
-              {
-                for (size_t i = 0; i < col; ++i)
-                {
-                  std::stringstream sstr;
-                  arma::arma_ostream::print_elem(sstr, matrix.at(row, i),
-                      false);
-                  eT newVal = info.MapString(sstr.str(), row);
-                  matrix.at(row, i) = newVal;
-                }
-              }
-            }
-
-            // Strip whitespace from either side of the string.
-            std::string trimmedToken(token.str());
-            boost::trim(trimmedToken);
-            val = info.MapString(trimmedToken, dim);
-          }
-        }
-
-        if (transpose)
-          matrix(col, row) = val;
-        else
-          matrix(row, col) = val;
-
-        ++col;
-      }
+      Log::Info << std::endl;
+      Timer::Stop("loading_data");
+      if (fatal)
+        Log::Fatal << e.what() << std::endl;
+      else
+        Log::Warn << e.what() << std::endl;
 
-      ++row;
+      return false;
     }
   }
   else if (extension == "arff")
@@ -470,18 +434,19 @@ bool Load(const std::string& filename,
         << std::flush;
     try
     {
-      LoadARFF(filename, matrix, info);
-
-      // We transpose by default.  So, un-transpose if necessary...
-      if (!transpose)
-        inplace_transpose(matrix);
+      const size_t bytes = LoadARFF(filename, matrix, info, transpose);
+      Timer::AddBytes("loading_data", bytes);
     }
     catch (std::exception& e)
     {
+      Log::Info << std::endl;
+      Timer::Stop("loading_data");
       if (fatal)
         Log::Fatal << e.what() << std::endl;
       else
         Log::Warn << e.what() << std::endl;
+
+      return false;
     }
   }
   else
@@ -524,6 +489,8 @@ bool Load(const std::string& filename,
       f = format::binary;
     else if (extension == "txt")
       f = format::text;
+    else if (extension == "mbin")
+      f = format::mapped;
     else
     {
       if (fatal)
@@ -540,7 +507,7 @@ bool Load(const std::string& filename,
   // Now load the given format.
   std::ifstream ifs;
 #ifdef _WIN32 // Open non-text in binary mode on Windows.
-  if (f == format::binary)
+  if (f == format::binary || f == format::mapped)
     ifs.open(filename, std::ifstream::in | std::ifstream::binary);
   else
     ifs.open(filename, std::ifstream::in);
@@ -577,10 +544,16 @@ bool Load(const std::string& filename,
       boost::archive::binary_iarchive ar(ifs);
       ar >> CreateNVP(t, name);
     }
+    else if (f == format::mapped)
+    {
+      // The archive maps the file itself.
+      MappedIArchive ar(filename);
+      ar >> CreateNVP(t, name);
+    }
 
     return true;
   }
-  catch (boost::archive::archive_exception& e)
+  catch (std::exception& e)
   {
     if (fatal)
       Log::Fatal << e.what() << std::endl;
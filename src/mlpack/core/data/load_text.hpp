@@ -0,0 +1,68 @@
+/**
+ * @file load_text.hpp
+ *
+ * A parallel parser for delimited text files (CSV, TSV, and whitespace
+ * separated values), used by data::Load().
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_LOAD_TEXT_HPP
+#define __MLPACK_CORE_DATA_LOAD_TEXT_HPP
+
+#include <mlpack/prereqs.hpp>
+#include "dataset_info.hpp"
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Load a delimited text file, in which each non-blank line holds one point,
+ * into a matrix.  The file is memory-mapped and split into chunks at line
+ * boundaries, and the chunks are parsed in parallel (on the shared
+ * util::ThreadPool) and written directly into their place in the matrix, so
+ * the file is never copied and no transpose is needed.
+ *
+ * The number of fields is that of the longest line, and shorter lines are
+ * padded with zeros, as Armadillo does.  (It is first taken from the first
+ * non-blank line, and the file is parsed again if a later line is longer.)
+ * Fields may be quoted with '"' (with '\' as escape character), but may not
+ * contain newlines.  Numbers are parsed with a fast path for decimal numbers
+ * with at most 19 significant digits, which is exact; other numbers (and nan
+ * and inf) are parsed with std::strtod().  Fields which are not numbers are read as 0, unless info is
+ * given, in which case every field of a dimension that has a non-numeric field
+ * is mapped to a category with info.MapString(), in the order of the file.
+ * The categories are collected by each chunk while it is parsed, and merged in
+ * the order of the chunks.
+ *
+ * A std::runtime_error is thrown upon failure.
+ *
+ * @param filename Name of the file to load.
+ * @param matrix Matrix to load into.  If transpose is true, each line is a
+ *     column of the matrix; otherwise each line is a row.
+ * @param separator ',' or '\t' for fields separated by that character, or ' '
+ *     for fields separated by any amount of spaces and tabs.
+ * @param transpose Whether to transpose the matrix (see above).
+ * @param info If not NULL, map non-numeric dimensions to categories (the
+ *     dimensions are the fields if transpose is true, and the lines otherwise).
+ *     info is reset to the dimensionality of the data.
+ * @return The number of bytes parsed.
+ */
+template<typename eT>
+size_t LoadText(const std::string& filename,
+                arma::Mat<eT>& matrix,
+                const char separator,
+                const bool transpose,
+                DatasetInfo* info = NULL);
+
+} // namespace data
+} // namespace mlpack
+
+// Include implementation.
+#include "load_text_impl.hpp"
+
+#endif
@@ -0,0 +1,720 @@
+/**
+ * @file load_text_impl.hpp
+ *
+ * Implementation of LoadText().
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_LOAD_TEXT_IMPL_HPP
+#define __MLPACK_CORE_DATA_LOAD_TEXT_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "load_text.hpp"
+#include "mapped_file.hpp"
+
+#include <mlpack/core/util/log.hpp>
+#include <mlpack/core/util/thread_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+namespace text {
+
+//! A field of a line: [begin, end), without the blanks and quotes around it.
+struct Field
+{
+  const char* begin;
+  const char* end;
+  bool quoted;
+};
+
+//! Return whether the character is a space or a tab.
+inline bool IsBlank(const char c)
+{
+  return (c == ' ' || c == '\t');
+}
+
+//! Return whether the character separates fields (' ' means any blank).
+inline bool IsSeparator(const char c, const char separator)
+{
+  return (separator == ' ') ? IsBlank(c) : (c == separator);
+}
+
+/**
+ * Find the end of the line that starts at begin (before the "\n" or "\r\n"),
+ * and the start of the next line.
+ */
+inline const char* LineEnd(const char* begin,
+                           const char* end,
+                           const char*& next)
+{
+  const char* newline = (const char*) std::memchr(begin, '\n', end - begin);
+  next = (newline == NULL) ? end : newline + 1;
+
+  const char* lineEnd = (newline == NULL) ? end : newline;
+  if (lineEnd != begin && lineEnd[-1] == '\r')
+    --lineEnd;
+  return lineEnd;
+}
+
+//! Return whether the line [begin, end) has only blanks.
+inline bool IsBlankLine(const char* begin, const char* end)
+{
+  while (begin != end && IsBlank(*begin))
+    ++begin;
+  return (begin == end);
+}
+
+/**
+ * Find the start of the comment ('%', outside of quotes) in the line
+ * [begin, end), as used in ARFF files, or end if there is none.
+ */
+inline const char* CommentStart(const char* begin, const char* end)
+{
+  bool quoted = false;
+  for (const char* p = begin; p != end; ++p)
+  {
+    if (quoted && *p == '\\' && p + 1 != end)
+      ++p;
+    else if (*p == '"')
+      quoted = !quoted;
+    else if (!quoted && *p == '%')
+      return p;
+  }
+
+  return end;
+}
+
+/**
+ * Get the next field of a line.  position is the start of the field; it is
+ * moved past the separator after the field, or set to NULL after the last
+ * field.
+ *
+ * @return false if there are no more fields.
+ */
+inline bool NextField(const char*& position,
+                      const char* lineEnd,
+                      const char separator,
+                      Field& field)
+{
+  const char* p = position;
+  if (p == NULL)
+    return false;
+
+  // Skip the blanks before the field (unless they separate fields).
+  while (p != lineEnd && IsBlank(*p) && (separator == ' ' || *p != separator))
+    ++p;
+  if (separator == ' ' && p == lineEnd)
+  {
+    position = NULL;
+    return false;
+  }
+
+  field.quoted = (p != lineEnd && *p == '"');
+  if (field.quoted)
+  {
+    field.begin = ++p;
+    while (p != lineEnd && *p != '"')
+      p += (*p == '\\' && p + 1 != lineEnd) ? 2 : 1;
+    field.end = p;
+
+    while (p != lineEnd && !IsSeparator(*p, separator))
+      ++p;
+  }
+  else
+  {
+    field.begin = p;
+    while (p != lineEnd && !IsSeparator(*p, separator))
+      ++p;
+
+    field.end = p;
+    while (field.end != field.begin && IsBlank(field.end[-1]))
+      --field.end;
+  }
+
+  position = (p == lineEnd) ? NULL : p + 1;
+  return true;
+}
+
+//! Get the contents of a field, without escape characters.
+inline std::string FieldString(const Field& field)
+{
+  if (!field.quoted)
+    return std::string(field.begin, field.end);
+
+  std::string result;
+  result.reserve(field.end - field.begin);
+  for (const char* p = field.begin; p != field.end; ++p)
+  {
+    if (*p == '\\' && p + 1 != field.end)
+    {
+      ++p;
+      result.push_back((*p == 'n') ? '\n' : *p);
+    }
+    else
+    {
+      result.push_back(*p);
+    }
+  }
+
+  return result;
+}
+
+//! Parse [begin, end) with std::strtod().  Return false if it is not entirely
+//! a number.
+inline bool ParseNumberSlow(const char* begin, const char* end, double& value)
+{
+  // std::strtod() needs a null-terminated string.
+  const std::string token(begin, end);
+  if (token.empty())
+    return false;
+
+  char* tokenEnd;
+  value = std::strtod(token.c_str(), &tokenEnd);
+  return (tokenEnd == token.c_str() + token.size());
+}
+
+/**
+ * Parse [begin, end) as a number.  Decimal numbers with at most 19 significant
+ * digits and a decimal exponent of at most 22 (after moving the decimal point
+ * to the end of the digits) are parsed exactly with one multiplication or
+ * division, since both operands are exact doubles; everything else is left to
+ * std::strtod().
+ *
+ * @return false if the field is not entirely a number.
+ */
+inline bool ParseNumber(const char* begin, const char* end, double& value)
+{
+  static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+      1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+      1e20, 1e21, 1e22 };
+
+  const char* p = begin;
+  const bool negative = (p != end && *p == '-');
+  if (p != end && (*p == '-' || *p == '+'))
+    ++p;
+
+  uint64_t mantissa = 0;
+  int digits = 0; // Significant digits in the mantissa.
+  int exponent = 0;
+  bool any = false;
+  for (; p != end && (unsigned int) (*p - '0') < 10; ++p)
+  {
+    if (digits == 19)
+      return ParseNumberSlow(begin, end, value);
+    mantissa = 10 * mantissa + (uint64_t) (*p - '0');
+    if (mantissa != 0)
+      ++digits;
+    any = true;
+  }
+
+  if (p != end && *p == '.')
+  {
+    for (++p; p != end && (unsigned int) (*p - '0') < 10; ++p)
+    {
+      if (digits == 19)
+        return ParseNumberSlow(begin, end, value);
+      mantissa = 10 * mantissa + (uint64_t) (*p - '0');
+      if (mantissa != 0)
+        ++digits;
+      --exponent;
+      any = true;
+    }
+  }
+
+  // This may be nan or inf.
+  if (!any)
+    return ParseNumberSlow(begin, end, value);
+
+  if (p != end && (*p == 'e' || *p == 'E'))
+  {
+    ++p;
+    const bool negativeExponent = (p != end && *p == '-');
+    if (p != end && (*p == '-' || *p == '+'))
+      ++p;
+    if (p == end || (unsigned int) (*p - '0') >= 10)
+      return false;
+
+    int e = 0;
+    for (; p != end && (unsigned int) (*p - '0') < 10; ++p)
+      if (e < 100000)
+        e = 10 * e + (*p - '0');
+    exponent += negativeExponent ? -e : e;
+  }
+
+  if (p != end)
+    return false;
+
+  if (mantissa > (((uint64_t) 1) << 53) || exponent < -22 || exponent > 22)
+    return ParseNumberSlow(begin, end, value);
+
+  value = (exponent < 0) ? (double) mantissa / powers[-exponent] :
+      (double) mantissa * powers[exponent];
+  if (negative)
+    value = -value;
+  return true;
+}
+
+//! Convert a parsed number to a floating-point element.
+template<typename eT>
+inline eT ToElement(const double value, const std::true_type /* floating */)
+{
+  return (eT) value;
+}
+
+//! Convert a parsed number to an integer element (truncating it, and wrapping
+//! negative numbers for unsigned types).
+template<typename eT>
+inline eT ToElement(const double value, const std::false_type /* floating */)
+{
+  // Conversions of numbers out of range are undefined.
+  if (!std::isfinite(value))
+    return eT(0);
+  if (value < 0.0)
+    return (value <= -9.2e18) ? eT(std::numeric_limits<int64_t>::min()) :
+        eT((int64_t) value);
+  return (value >= 1.8e19) ? std::numeric_limits<eT>::max() :
+      eT((uint64_t) value);
+}
+
+/**
+ * Split [begin, end) into chunks of about the same size which start at the
+ * beginning of a line, to be processed in parallel.  The non-blank lines of
+ * each chunk are counted in parallel, on the global util::ThreadPool.
+ *
+ * @param begin Start of the text.
+ * @param end End of the text.
+ * @param chunks Number of chunks (at least one).
+ * @param starts Set to the start of each chunk, followed by end.
+ * @param firstLines Set to the number of non-blank lines before each chunk,
+ *     followed by the total number of non-blank lines.
+ */
+inline void SplitLines(const char* begin,
+                       const char* end,
+                       const size_t chunks,
+                       std::vector<const char*>& starts,
+                       std::vector<size_t>& firstLines)
+{
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  const size_t size = end - begin;
+  starts.assign(chunks + 1, begin);
+  starts[chunks] = end;
+  for (size_t c = 1; c < chunks; ++c)
+  {
+    const char* p = std::max(starts[c - 1], begin + c * (size / chunks));
+    const char* newline = (const char*) std::memchr(p, '\n', end - p);
+    starts[c] = (newline == NULL) ? end : newline + 1;
+  }
+
+  firstLines.assign(chunks + 1, 0);
+  pool.ParallelFor(0, chunks, 1, [&](const size_t chunkBegin,
+                                     const size_t chunkEnd)
+  {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c)
+    {
+      size_t lines = 0;
+      for (const char* p = starts[c]; p != starts[c + 1]; )
+      {
+        const char* next;
+        const char* lineEnd = LineEnd(p, starts[c + 1], next);
+        if (!IsBlankLine(p, lineEnd))
+          ++lines;
+        p = next;
+      }
+      firstLines[c + 1] = lines;
+    }
+  });
+  for (size_t c = 0; c < chunks; ++c)
+    firstLines[c + 1] += firstLines[c];
+}
+
+/**
+ * The categories of one dimension found in one chunk, numbered in the order
+ * in which they first appear in the chunk.
+ */
+struct ChunkCategories
+{
+  //! The number of each category.
+  std::unordered_map<std::string, size_t> ids;
+  //! The categories, in order.
+  std::vector<std::string> strings;
+
+  //! Get the number of the given category, adding it if it is new.
+  size_t Map(const std::string& string)
+  {
+    const std::pair<std::unordered_map<std::string, size_t>::iterator, bool>
+        result = ids.insert(std::make_pair(string, strings.size()));
+    if (result.second)
+      strings.push_back(string);
+    return result.first->second;
+  }
+};
+
+/**
+ * What LoadText() finds when it parses one chunk.  The categorical dimensions
+ * of a chunk are numbered in the order they are found (their "slots"), and the
+ * fields of a categorical dimension are stored in the matrix as the numbers of
+ * their categories in the chunk, until the categories of all the chunks are
+ * merged.
+ */
+struct ChunkResult
+{
+  ChunkResult() : nonNumeric(0), maxFields(0) { }
+
+  //! The dimension of each slot.
+  std::vector<size_t> dimensions;
+  //! The first line of each slot which was mapped while the chunk was parsed.
+  std::vector<size_t> from;
+  //! The categories of the lines from 'from' on.
+  std::vector<ChunkCategories> after;
+  //! The categories of the lines before 'from' (which were parsed before the
+  //! dimension was known to be categorical).
+  std::vector<ChunkCategories> before;
+  //! The slot of each field (if the dimensions are the fields), or size_t(-1).
+  std::vector<size_t> slots;
+
+  //! The lines with fewer fields than the matrix, and their number of fields.
+  std::vector<std::pair<size_t, size_t> > shortLines;
+  //! The number of fields which are not numbers (without a DatasetInfo).
+  size_t nonNumeric;
+  //! The largest number of fields of a line.
+  size_t maxFields;
+
+  //! Add a slot for the given dimension, mapped from the given line on.
+  size_t AddSlot(const size_t dimension, const size_t line)
+  {
+    dimensions.push_back(dimension);
+    from.push_back(line);
+    after.push_back(ChunkCategories());
+    before.push_back(ChunkCategories());
+    return dimensions.size() - 1;
+  }
+
+  //! Get the number of fields of the given line.
+  size_t LineFields(const size_t line, const size_t fields) const
+  {
+    std::vector<std::pair<size_t, size_t> >::const_iterator it =
+        std::lower_bound(shortLines.begin(), shortLines.end(),
+        std::make_pair(line, (size_t) 0));
+    return (it != shortLines.end() && it->first == line) ? it->second :
+        fields;
+  }
+};
+
+} // namespace text
+
+template<typename eT>
+size_t LoadText(const std::string& filename,
+                arma::Mat<eT>& matrix,
+                const char separator,
+                const bool transpose,
+                DatasetInfo* info)
+{
+  const MappedFile file(filename);
+  const char* begin = file.Data();
+  const char* end = begin + file.Size();
+
+  // Start with the number of fields of the first non-blank line.  If a later
+  // line has more, the file is parsed again with that number.
+  size_t fields = 0;
+  for (const char* p = begin; p != end && fields == 0; )
+  {
+    const char* next;
+    const char* lineEnd = text::LineEnd(p, end, next);
+    text::Field field;
+    for (const char* position = p;
+         text::NextField(position, lineEnd, separator, field); )
+      ++fields;
+    if (text::IsBlankLine(p, lineEnd))
+      fields = 0;
+    p = next;
+  }
+
+  // Split the file into chunks, and find where each chunk goes in the matrix.
+  // There are a few chunks per thread, so that uneven chunks are balanced, but
+  // no chunks smaller than a megabyte.
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  const size_t chunks = std::max((size_t) 1, std::min(file.Size() >> 20,
+      4 * pool.Threads()));
+  std::vector<const char*> starts;
+  std::vector<size_t> firstLines;
+  text::SplitLines(begin, end, chunks, starts, firstLines);
+  const size_t lines = firstLines[chunks];
+
+  // Element f of line i is at point(i)[f * stride].
+  const size_t stride = transpose ? 1 : lines;
+
+  // Parse the chunks.  Without a DatasetInfo, non-numeric fields are set to 0.
+  // With one, each chunk maps the fields of the dimensions it finds to be
+  // categorical to categories of its own, which are merged below.
+  std::vector<text::ChunkResult> results;
+  while (true)
+  {
+    if (transpose)
+      matrix.set_size(fields, lines);
+    else
+      matrix.set_size(lines, fields);
+
+    results.assign(chunks, text::ChunkResult());
+    pool.ParallelFor(0, chunks, 1, [&](const size_t chunkBegin,
+                                       const size_t chunkEnd)
+    {
+      for (size_t c = chunkBegin; c < chunkEnd; ++c)
+      {
+        text::ChunkResult& result = results[c];
+        if (info != NULL && transpose)
+          result.slots.assign(fields, size_t(-1));
+
+        size_t line = firstLines[c];
+        for (const char* p = starts[c]; p != starts[c + 1]; )
+        {
+          const char* next;
+          const char* lineEnd = text::LineEnd(p, starts[c + 1], next);
+          if (text::IsBlankLine(p, lineEnd))
+          {
+            p = next;
+            continue;
+          }
+
+          eT* point = transpose ? matrix.colptr(line) : matrix.memptr() + line;
+          bool lineCategorical = false;
+          size_t f = 0;
+          text::Field field;
+          for (const char* position = p;
+               text::NextField(position, lineEnd, separator, field); ++f)
+          {
+            // Only count the fields of a line that is too long.
+            if (f >= fields)
+              continue;
+
+            if (info != NULL && transpose && result.slots[f] != size_t(-1))
+            {
+              point[f * stride] = (eT) result.after[result.slots[f]].Map(
+                  text::FieldString(field));
+              continue;
+            }
+
+            double value;
+            if (text::ParseNumber(field.begin, field.end, value))
+            {
+              point[f * stride] = text::ToElement<eT>(value,
+                  typename std::is_floating_point<eT>::type());
+              continue;
+            }
+
+            point[f * stride] = eT(0);
+            if (info == NULL)
+            {
+              ++result.nonNumeric;
+            }
+            else if (!transpose)
+            {
+              lineCategorical = true;
+            }
+            else
+            {
+              result.slots[f] = result.AddSlot(f, line);
+              point[f * stride] = (eT) result.after[result.slots[f]].Map(
+                  text::FieldString(field));
+            }
+          }
+
+          // The whole line is one dimension, so it is mapped again now that
+          // it is known to be categorical.
+          if (lineCategorical)
+          {
+            text::ChunkCategories& categories =
+                result.after[result.AddSlot(line, line)];
+            size_t mapped = 0;
+            for (const char* position = p; mapped < fields &&
+                 text::NextField(position, lineEnd, separator, field); ++mapped)
+              point[mapped * stride] = (eT) categories.Map(
+                  text::FieldString(field));
+          }
+
+          result.maxFields = std::max(result.maxFields, f);
+          if (f < fields)
+          {
+            result.shortLines.push_back(std::make_pair(line, f));
+            for (; f < fields; ++f)
+              point[f * stride] = eT(0);
+          }
+
+          ++line;
+          p = next;
+        }
+      }
+    });
+
+    size_t maxFields = fields;
+    for (size_t c = 0; c < chunks; ++c)
+      maxFields = std::max(maxFields, results[c].maxFields);
+    if (maxFields == fields)
+      break;
+
+    // Armadillo pads the shorter lines of a file with zeros, so do the same.
+    Log::Info << "'" << filename << "': some lines have more than " << fields
+        << " fields; loading again with " << maxFields << " fields."
+        << std::endl;
+    fields = maxFields;
+  }
+
+  if (info != NULL)
+    *info = DatasetInfo(transpose ? fields : lines);
+
+  size_t totalShortLines = 0;
+  size_t totalNonNumeric = 0;
+  for (size_t c = 0; c < chunks; ++c)
+  {
+    totalShortLines += results[c].shortLines.size();
+    totalNonNumeric += results[c].nonNumeric;
+  }
+  if (totalShortLines > 0)
+    Log::Warn << "'" << filename << "': " << totalShortLines << " lines have "
+        << "fewer than " << fields << " fields; the missing fields are 0."
+        << std::endl;
+  if (totalNonNumeric > 0)
+    Log::Warn << "'" << filename << "': " << totalNonNumeric << " fields are "
+        << "not numbers and were read as 0." << std::endl;
+
+  if (info == NULL)
+    return file.Size();
+
+  bool anyCategorical = false;
+  for (size_t c = 0; c < chunks; ++c)
+    anyCategorical |= !results[c].dimensions.empty();
+  if (!anyCategorical)
+    return file.Size();
+
+  // When the fields are the dimensions, a chunk may have parsed some fields of
+  // a categorical dimension as numbers: the lines before it found the first
+  // non-numeric field, or all its lines if another chunk found it.  Only those
+  // lines are parsed again, in parallel.
+  if (transpose)
+  {
+    std::vector<char> isCategorical(fields, 0);
+    for (size_t c = 0; c < chunks; ++c)
+      for (size_t s = 0; s < results[c].dimensions.size(); ++s)
+        isCategorical[results[c].dimensions[s]] = 1;
+
+    pool.ParallelFor(0, chunks, 1, [&](const size_t chunkBegin,
+                                       const size_t chunkEnd)
+    {
+      for (size_t c = chunkBegin; c < chunkEnd; ++c)
+      {
+        text::ChunkResult& result = results[c];
+        for (size_t f = 0; f < fields; ++f)
+          if (isCategorical[f] && result.slots[f] == size_t(-1))
+            result.slots[f] = result.AddSlot(f, firstLines[c + 1]);
+
+        size_t lastLine = firstLines[c];
+        for (size_t s = 0; s < result.dimensions.size(); ++s)
+          lastLine = std::max(lastLine, result.from[s]);
+
+        size_t line = firstLines[c];
+        for (const char* p = starts[c]; p != starts[c + 1] && line < lastLine; )
+        {
+          const char* next;
+          const char* lineEnd = text::LineEnd(p, starts[c + 1], next);
+          if (text::IsBlankLine(p, lineEnd))
+          {
+            p = next;
+            continue;
+          }
+
+          eT* point = matrix.colptr(line);
+          size_t f = 0;
+          text::Field field;
+          for (const char* position = p; f < fields &&
+               text::NextField(position, lineEnd, separator, field); ++f)
+          {
+            const size_t slot = result.slots[f];
+            if (slot != size_t(-1) && line < result.from[slot])
+              point[f] = (eT) result.before[slot].Map(text::FieldString(field));
+          }
+
+          ++line;
+          p = next;
+        }
+      }
+    });
+  }
+
+  // Map the categories of each chunk, in the order of the chunks, so that
+  // the numbers of the categories are those of the order of the file.
+  // Only the distinct categories of each chunk are mapped here.
+  std::vector<std::vector<std::vector<size_t> > > beforeIds(chunks);
+  std::vector<std::vector<std::vector<size_t> > > afterIds(chunks);
+  for (size_t c = 0; c < chunks; ++c)
+  {
+    const text::ChunkResult& result = results[c];
+    beforeIds[c].resize(result.dimensions.size());
+    afterIds[c].resize(result.dimensions.size());
+    for (size_t s = 0; s < result.dimensions.size(); ++s)
+    {
+      const size_t dimension = result.dimensions[s];
+      for (size_t i = 0; i < result.before[s].strings.size(); ++i)
+        beforeIds[c][s].push_back(info->MapString(result.before[s].strings[i],
+            dimension));
+      for (size_t i = 0; i < result.after[s].strings.size(); ++i)
+        afterIds[c][s].push_back(info->MapString(result.after[s].strings[i],
+            dimension));
+    }
+  }
+
+  // Replace the numbers of the categories in the chunks by the final ones.
+  pool.ParallelFor(0, chunks, 1, [&](const size_t chunkBegin,
+                                     const size_t chunkEnd)
+  {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c)
+    {
+      const text::ChunkResult& result = results[c];
+      for (size_t s = 0; s < result.dimensions.size(); ++s)
+      {
+        // Without transpose, the dimension is a line of this chunk.
+        const size_t dimension = result.dimensions[s];
+        if (!transpose)
+        {
+          const size_t lineFields = result.LineFields(dimension, fields);
+          for (size_t f = 0; f < lineFields; ++f)
+          {
+            eT& element = matrix(dimension, f);
+            element = (eT) afterIds[c][s][(size_t) element];
+          }
+          continue;
+        }
+
+        for (size_t line = firstLines[c]; line < firstLines[c + 1]; ++line)
+        {
+          if (dimension >= result.LineFields(line, fields))
+            continue;
+          eT& element = matrix(dimension, line);
+          element = (eT) ((line < result.from[s]) ? beforeIds[c][s] :
+              afterIds[c][s])[(size_t) element];
+        }
+      }
+    }
+  });
+
+  return file.Size();
+}
+
+} // namespace data
+} // namespace mlpack
+
+#endif
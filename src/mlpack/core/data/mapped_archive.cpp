@@ -0,0 +1,132 @@
+/**
+ * @file mapped_archive.cpp
+ *
+ * Implementation of the non-templated parts of MappedOArchive and
+ * MappedIArchive, and instantiation of the Boost archive templates for them.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "mapped_archive.hpp"
+
+#include <boost/archive/impl/archive_serializer_map.ipp>
+#include <boost/archive/impl/basic_binary_oprimitive.ipp>
+#include <boost/archive/impl/basic_binary_oarchive.ipp>
+#include <boost/archive/impl/basic_binary_iprimitive.ipp>
+#include <boost/archive/impl/basic_binary_iarchive.ipp>
+
+#include <cstring>
+#include <stdint.h>
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+namespace {
+
+//! The magic string at the start of each archive.
+const char magic[8] = { 'M', 'L', 'P', 'K', 'M', 'B', 'I', 'N' };
+//! The current version of the format.
+const uint32_t version = 1;
+//! The byte order marker.
+const uint32_t byteOrder = 0x01020304;
+
+} // anonymous namespace
+
+void mapped::WriteArchiveHeader(std::ostream& stream)
+{
+  char header[archiveHeaderSize];
+  std::memcpy(header, magic, sizeof(magic));
+  std::memcpy(header + 8, &version, sizeof(version));
+  std::memcpy(header + 12, &byteOrder, sizeof(byteOrder));
+  if (!stream.write(header, archiveHeaderSize))
+    throw boost::archive::archive_exception(
+        boost::archive::archive_exception::output_stream_error);
+}
+
+void mapped::CheckArchiveHeader(const char* data, const size_t size)
+{
+  if (size < archiveHeaderSize || std::memcmp(data, magic, sizeof(magic)) != 0)
+    throw boost::archive::archive_exception(
+        boost::archive::archive_exception::invalid_signature);
+
+  uint32_t fileVersion, fileByteOrder;
+  std::memcpy(&fileVersion, data + 8, sizeof(fileVersion));
+  std::memcpy(&fileByteOrder, data + 12, sizeof(fileByteOrder));
+  if (fileVersion != version)
+    throw boost::archive::archive_exception(
+        boost::archive::archive_exception::unsupported_version);
+  if (fileByteOrder != byteOrder)
+    throw boost::archive::archive_exception(
+        boost::archive::archive_exception::incompatible_native_format,
+        "byte order");
+}
+
+mapped::ArchiveBuffer::ArchiveBuffer(const std::string& filename) :
+    file(new MappedFile(filename, true))
+{
+  char* data = file->MutableData();
+  setg(data, data, data + file->Size());
+}
+
+char* mapped::ArchiveBuffer::Take(const size_t bytes)
+{
+  char* position = gptr();
+  setg(eback(), position + bytes, egptr());
+  return position;
+}
+
+MappedOArchive::MappedOArchive(std::ostream& stream,
+                               const unsigned int flags) :
+    Base(stream, flags | boost::archive::no_header),
+    stream(stream)
+{
+  // Our header comes before the header of the binary archive.
+  mapped::WriteArchiveHeader(stream);
+  init(flags);
+}
+
+MappedIArchive::MappedIArchive(const std::string& filename,
+                               const unsigned int flags) :
+    mapped::ArchiveBuffer(filename),
+    Base(static_cast<mapped::ArchiveBuffer&>(*this),
+        flags | boost::archive::no_header)
+{
+  mapped::CheckArchiveHeader(eback(), Remaining());
+  Take(mapped::archiveHeaderSize);
+  init(flags);
+}
+
+void MappedIArchive::SkipPadding(const size_t bytes)
+{
+  const size_t padding = mapped::ArrayPadding(Offset(), bytes);
+  if (padding > Remaining())
+    throw boost::archive::archive_exception(
+        boost::archive::archive_exception::input_stream_error);
+
+  Take(padding);
+}
+
+// Instantiate the parts of the Boost archives that are not in headers.
+namespace boost {
+namespace archive {
+
+template class detail::archive_serializer_map<MappedOArchive>;
+template class basic_binary_oprimitive<MappedOArchive,
+    std::ostream::char_type, std::ostream::traits_type>;
+template class basic_binary_oarchive<MappedOArchive>;
+template class binary_oarchive_impl<MappedOArchive,
+    std::ostream::char_type, std::ostream::traits_type>;
+
+template class detail::archive_serializer_map<MappedIArchive>;
+template class basic_binary_iprimitive<MappedIArchive,
+    std::istream::char_type, std::istream::traits_type>;
+template class basic_binary_iarchive<MappedIArchive>;
+template class binary_iarchive_impl<MappedIArchive,
+    std::istream::char_type, std::istream::traits_type>;
+
+} // namespace archive
+} // namespace boost
@@ -0,0 +1,205 @@
+/**
+ * @file mapped_archive.hpp
+ *
+ * A compact binary archive for boost::serialization, in which arrays (such as
+ * the elements of Armadillo matrices) are stored as aligned blocks, so that
+ * matrices can use the memory-mapped file when the archive is loaded.  Used by
+ * data::Load() and data::Save() for models in .mbin files.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_ARCHIVE_HPP
+#define __MLPACK_CORE_DATA_MAPPED_ARCHIVE_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <boost/archive/binary_oarchive_impl.hpp>
+#include <boost/archive/binary_iarchive_impl.hpp>
+#include <boost/archive/archive_exception.hpp>
+#include <boost/archive/detail/register_archive.hpp>
+#include <boost/serialization/array.hpp>
+#include <memory>
+#include <streambuf>
+#include "mapped_file.hpp"
+
+namespace mlpack {
+namespace data {
+
+namespace mapped {
+
+//! Arrays of at least this many bytes are aligned, and are mapped on load.
+const size_t arrayMapBytes = 4096;
+//! The alignment of these arrays in the file, in bytes.
+const size_t arrayAlignment = 64;
+
+//! Get the number of bytes of padding before an array of the given size that
+//! starts at the given offset of the file.
+inline size_t ArrayPadding(const size_t offset, const size_t bytes)
+{
+  return (bytes < arrayMapBytes) ? 0 :
+      (arrayAlignment - offset % arrayAlignment) % arrayAlignment;
+}
+
+//! The header of archives: "MLPKMBIN", the version of the format, and the
+//! byte order marker.
+const size_t archiveHeaderSize = 16;
+
+//! Write the archive header to the stream.
+void WriteArchiveHeader(std::ostream& stream);
+
+//! Check the archive header at the start of the data; a
+//! boost::archive::archive_exception is thrown if it is not valid.
+void CheckArchiveHeader(const char* data, const size_t size);
+
+/**
+ * A stream buffer that reads a mapped file, and can give the position of the
+ * next byte in the file (so that arrays can be used in place).
+ */
+class ArchiveBuffer : public std::streambuf
+{
+ public:
+  //! Map the file (a std::runtime_error is thrown if it cannot be opened).
+  ArchiveBuffer(const std::string& filename);
+
+  //! Get the mapped file.
+  const std::shared_ptr<MappedFile>& File() const { return file; }
+  //! Get the offset of the next byte to read from the start of the file.
+  size_t Offset() const { return gptr() - eback(); }
+  //! Get the number of bytes left to read.
+  size_t Remaining() const { return egptr() - gptr(); }
+  //! Get a pointer to the next byte, and skip the given number of bytes (which
+  //! must not be more than Remaining()).
+  char* Take(const size_t bytes);
+
+ private:
+  //! The mapped file.
+  std::shared_ptr<MappedFile> file;
+};
+
+} // namespace mapped
+
+/**
+ * An output archive which writes models in a compact binary format that can be
+ * loaded with MappedIArchive.  It is boost::archive::binary_oarchive, with a
+ * header giving the version of the format and the byte order (binary archives
+ * cannot be moved between machines with different byte orders or type sizes),
+ * and with large arrays aligned in the file.
+ *
+ * The stream must be opened in binary mode, and be at its start (the alignment
+ * is relative to the start of the stream).
+ */
+class MappedOArchive : public boost::archive::binary_oarchive_impl<
+    MappedOArchive, std::ostream::char_type, std::ostream::traits_type>
+{
+ public:
+  /**
+   * Start an archive on the given stream.
+   *
+   * @param stream Stream to write to.
+   * @param flags Flags of the archive (see boost::archive::archive_flags).
+   */
+  MappedOArchive(std::ostream& stream, const unsigned int flags = 0);
+
+  //! Write an array of elements, aligned if it is large.
+  template<typename Array>
+  void save_array(const Array& array, const unsigned int version);
+
+ private:
+  //! The base archive type.
+  typedef boost::archive::binary_oarchive_impl<MappedOArchive,
+      std::ostream::char_type, std::ostream::traits_type> Base;
+
+  //! The stream being written.
+  std::ostream& stream;
+
+  // The base classes of the archive need access to its internals.
+  friend class boost::archive::detail::interface_oarchive<MappedOArchive>;
+  friend class boost::archive::basic_binary_oarchive<MappedOArchive>;
+  friend class boost::archive::basic_binary_oprimitive<MappedOArchive,
+      std::ostream::char_type, std::ostream::traits_type>;
+  friend class boost::archive::save_access;
+};
+
+/**
+ * An input archive which reads models written by MappedOArchive.  The file is
+ * memory-mapped, and Armadillo matrices whose elements are large enough to be
+ * aligned in the file use the mapping as their memory, so they are not read or
+ * copied: a model can be used as soon as its structure is loaded, its matrices
+ * are only paged in as they are used, and they are shared (through the page
+ * cache) between all processes that load the same file.
+ *
+ * The mapping is private, so the matrices may be modified without changing the
+ * file.  It is kept until UnmapMatrix() has been called on all the matrices
+ * using it, or the program exits.  A matrix which is resized allocates new
+ * memory as usual.
+ *
+ * Other arrays are copied, as by boost::archive::binary_iarchive.
+ */
+class MappedIArchive :
+    private mapped::ArchiveBuffer,
+    public boost::archive::binary_iarchive_impl<MappedIArchive,
+        std::istream::char_type, std::istream::traits_type>
+{
+ public:
+  //! Armadillo matrices can use arrays of the archive in place (see
+  //! map_array()).
+  typedef void maps_arrays;
+
+  /**
+   * Open an archive.  A std::runtime_error is thrown if the file cannot be
+   * opened, and a boost::archive::archive_exception if it is not an archive
+   * written by MappedOArchive.
+   *
+   * @param filename Name of the file.
+   * @param flags Flags of the archive (see boost::archive::archive_flags).
+   */
+  MappedIArchive(const std::string& filename, const unsigned int flags = 0);
+
+  //! Read an array of elements.
+  template<typename Array>
+  void load_array(Array& array, const unsigned int version);
+
+  /**
+   * Get a pointer to the next array of elements in the file, if it is large
+   * enough to be aligned, and skip it; otherwise return NULL, and the array
+   * must be loaded with load_array().  The file stays mapped until the pointer
+   * is released with mapped::Release() (as by UnmapMatrix()).
+   *
+   * @param count Number of elements of the array.
+   */
+  template<typename eT>
+  eT* map_array(const size_t count);
+
+ private:
+  //! The base archive type.
+  typedef boost::archive::binary_iarchive_impl<MappedIArchive,
+      std::istream::char_type, std::istream::traits_type> Base;
+
+  //! Skip the padding before an array of the given size.
+  void SkipPadding(const size_t bytes);
+
+  // The base classes of the archive need access to its internals.
+  friend class boost::archive::detail::interface_iarchive<MappedIArchive>;
+  friend class boost::archive::basic_binary_iarchive<MappedIArchive>;
+  friend class boost::archive::basic_binary_iprimitive<MappedIArchive,
+      std::istream::char_type, std::istream::traits_type>;
+  friend class boost::archive::load_access;
+};
+
+} // namespace data
+} // namespace mlpack
+
+// The archives are binary, so arrays of primitive types are written at once.
+BOOST_SERIALIZATION_REGISTER_ARCHIVE(mlpack::data::MappedOArchive)
+BOOST_SERIALIZATION_USE_ARRAY_OPTIMIZATION(mlpack::data::MappedOArchive)
+BOOST_SERIALIZATION_REGISTER_ARCHIVE(mlpack::data::MappedIArchive)
+BOOST_SERIALIZATION_USE_ARRAY_OPTIMIZATION(mlpack::data::MappedIArchive)
+
+// Include implementation.
+#include "mapped_archive_impl.hpp"
+
+#endif
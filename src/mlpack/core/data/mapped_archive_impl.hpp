@@ -0,0 +1,75 @@
+/**
+ * @file mapped_archive_impl.hpp
+ *
+ * Implementation of the templated parts of MappedOArchive and MappedIArchive.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_ARCHIVE_IMPL_HPP
+#define __MLPACK_CORE_DATA_MAPPED_ARCHIVE_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mapped_archive.hpp"
+#include "mapped_matrix.hpp"
+
+namespace mlpack {
+namespace data {
+
+template<typename Array>
+void MappedOArchive::save_array(const Array& array,
+                                const unsigned int /* version */)
+{
+  const size_t bytes = array.count() * sizeof(*array.address());
+  if (bytes >= mapped::arrayMapBytes)
+  {
+    const std::streamoff offset = stream.rdbuf()->pubseekoff(0,
+        std::ios_base::cur, std::ios_base::out);
+    if (offset < 0)
+      throw boost::archive::archive_exception(
+          boost::archive::archive_exception::output_stream_error);
+
+    static const char zeros[mapped::arrayAlignment] = { 0 };
+    this->save_binary(zeros, mapped::ArrayPadding((size_t) offset, bytes));
+  }
+
+  this->save_binary(array.address(), bytes);
+}
+
+template<typename Array>
+void MappedIArchive::load_array(Array& array, const unsigned int /* version */)
+{
+  const size_t bytes = array.count() * sizeof(*array.address());
+  SkipPadding(bytes);
+  this->load_binary(array.address(), bytes);
+}
+
+template<typename eT>
+eT* MappedIArchive::map_array(const size_t count)
+{
+  if (count > Remaining() / sizeof(eT))
+    throw boost::archive::archive_exception(
+        boost::archive::archive_exception::input_stream_error);
+
+  const size_t bytes = count * sizeof(eT);
+  if (bytes < mapped::arrayMapBytes)
+    return NULL;
+
+  SkipPadding(bytes);
+  if (bytes > Remaining())
+    throw boost::archive::archive_exception(
+        boost::archive::archive_exception::input_stream_error);
+
+  eT* elements = (eT*) Take(bytes);
+  mapped::Keep(File(), elements);
+  return elements;
+}
+
+} // namespace data
+} // namespace mlpack
+
+#endif
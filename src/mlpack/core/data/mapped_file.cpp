@@ -0,0 +1,86 @@
+/**
+ * @file mapped_file.cpp
+ *
+ * Implementation of MappedFile.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+MappedFile::MappedFile(const std::string& filename, const bool writable) :
+    data(NULL),
+    size(0),
+    mapped(false)
+{
+#ifndef _WIN32
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("cannot open file '" + filename + "'");
+
+  struct stat status;
+  if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode))
+  {
+    size = (size_t) status.st_size;
+    if (size == 0)
+    {
+      close(fd);
+      return;
+    }
+
+    // A private mapping is copy-on-write, so it may be writable even though
+    // the file is opened read-only.
+    void* address = mmap(NULL, size,
+        writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address != MAP_FAILED)
+    {
+      // A read-only file is usually read from the beginning to the end.
+      if (!writable)
+        madvise(address, size, MADV_SEQUENTIAL);
+      data = (char*) address;
+      mapped = true;
+    }
+  }
+  close(fd);
+
+  if (mapped)
+    return;
+#endif
+
+  // Read the whole file.
+  std::ifstream stream(filename.c_str(), std::ios::in | std::ios::binary);
+  if (!stream.is_open())
+    throw std::runtime_error("cannot open file '" + filename + "'");
+
+  char block[65536];
+  while (stream.read(block, sizeof(block)) || stream.gcount() > 0)
+    buffer.insert(buffer.end(), block, block + stream.gcount());
+
+  size = buffer.size();
+  data = buffer.empty() ? NULL : &buffer[0];
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+  if (mapped)
+    munmap((void*) data, size);
+#endif
+}
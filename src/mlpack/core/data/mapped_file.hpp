@@ -0,0 +1,79 @@
+/**
+ * @file mapped_file.hpp
+ *
+ * A view of the contents of a file, memory-mapped where possible.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_FILE_HPP
+#define __MLPACK_CORE_DATA_MAPPED_FILE_HPP
+
+#include <string>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * A MappedFile gives access to the contents of a file as one block of memory,
+ * without copying them: on POSIX systems, the file is mapped with mmap(), and
+ * the operating system reads the pages as they are used (and may drop them
+ * again under memory pressure).  Where the file cannot be mapped, it is read
+ * into memory instead.
+ *
+ * By default the mapping is read-only.  A private (copy-on-write) mapping can
+ * be requested instead: the contents may then be modified, and the pages that
+ * are modified are copied for this process, but the file itself is never
+ * changed and unmodified pages remain shared with the page cache.
+ *
+ * The contents are not null-terminated.
+ */
+class MappedFile
+{
+ public:
+  /**
+   * Map the given file.  A std::runtime_error is thrown if the file cannot be
+   * opened.
+   *
+   * @param filename Name of the file.
+   * @param writable If true, map the file copy-on-write, so that the contents
+   *     may be modified through MutableData() (the file is not changed).
+   *     Otherwise, the file is expected to be read sequentially.
+   */
+  explicit MappedFile(const std::string& filename,
+                      const bool writable = false);
+
+  //! Unmap the file.
+  ~MappedFile();
+
+  //! Get the contents of the file (NULL if the file is empty).
+  const char* Data() const { return data; }
+  //! Modify the contents of the file (only if the file is writable).
+  char* MutableData() { return data; }
+  //! Get the size of the file, in bytes.
+  size_t Size() const { return size; }
+
+ private:
+  //! The contents of the file.
+  char* data;
+  //! The size of the file.
+  size_t size;
+  //! Whether data is mapped (otherwise it points into buffer).
+  bool mapped;
+  //! The contents of the file, if it could not be mapped.
+  std::vector<char> buffer;
+
+  //! The file cannot be copied, since it owns its mapping.
+  MappedFile(const MappedFile& other);
+  MappedFile& operator=(const MappedFile& other);
+};
+
+} // namespace data
+} // namespace mlpack
+
+#endif
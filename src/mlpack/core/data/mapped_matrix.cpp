@@ -0,0 +1,140 @@
+/**
+ * @file mapped_matrix.cpp
+ *
+ * Implementation of the non-templated parts of the mapped matrix format: the
+ * header, and the mappings that are kept for loaded matrices.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "mapped_matrix.hpp"
+
+#include <mlpack/core/util/log.hpp>
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+namespace {
+
+//! The magic string at the start of each file.
+const char magic[8] = { 'M', 'L', 'P', 'K', 'M', 'M', 'A', 'T' };
+//! The current version of the format.
+const uint32_t version = 1;
+//! The byte order marker.
+const uint32_t byteOrder = 0x01020304;
+//! The offset of the elements, which puts them at a page boundary.
+const uint64_t offset = 4096;
+
+//! The mapped files of the loaded matrices, by the address of their elements.
+std::map<const void*, std::shared_ptr<MappedFile> >& Mappings()
+{
+  static std::map<const void*, std::shared_ptr<MappedFile> > mappings;
+  return mappings;
+}
+
+//! The mutex protecting Mappings().
+std::mutex& MappingsMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+} // anonymous namespace
+
+mapped::Header mapped::MakeHeader(const ElementKind kind,
+                                  const size_t elementSize,
+                                  const size_t rows,
+                                  const size_t cols)
+{
+  Header header;
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.byteOrder = byteOrder;
+  header.elementKind = (uint32_t) kind;
+  header.elementSize = (uint32_t) elementSize;
+  header.rows = rows;
+  header.cols = cols;
+  header.offset = offset;
+  return header;
+}
+
+void mapped::ReadHeader(const MappedFile& file,
+                        const std::string& filename,
+                        Header& header)
+{
+  const std::string error = "cannot load '" + filename + "': ";
+  if (file.Size() < sizeof(Header))
+    throw std::runtime_error(error + "not a mapped matrix file");
+
+  std::memcpy(&header, file.Data(), sizeof(Header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+    throw std::runtime_error(error + "not a mapped matrix file");
+  if (header.version != version)
+    throw std::runtime_error(error + "unsupported format version");
+  if (header.byteOrder != byteOrder)
+    throw std::runtime_error(error + "file was saved with a different byte "
+        "order");
+
+  // Check that the elements fit in the file, without overflowing.
+  const uint64_t size = file.Size();
+  if (header.offset < sizeof(Header) || header.offset > size ||
+      header.elementSize == 0 || (header.offset % header.elementSize) != 0)
+    throw std::runtime_error(error + "invalid header");
+  const uint64_t available = (size - header.offset) / header.elementSize;
+  if (header.cols != 0 && header.rows > available / header.cols)
+    throw std::runtime_error(error + "file is truncated");
+  if (header.rows * header.cols > (uint64_t) ((size_t) -1))
+    throw std::runtime_error(error + "matrix is too large");
+}
+
+std::unique_ptr<MappedFile> mapped::Open(const std::string& filename,
+                                         Header& header)
+{
+  std::unique_ptr<MappedFile> file(new MappedFile(filename, true));
+  ReadHeader(*file, filename, header);
+  return file;
+}
+
+void mapped::Keep(std::shared_ptr<MappedFile> file, const void* elements)
+{
+  std::lock_guard<std::mutex> lock(MappingsMutex());
+  // The address is in use by the kept mapping, so a second mapping can only
+  // get it if the first was unmapped without being released.
+  Log::Assert(Mappings().count(elements) == 0, "mapped::Keep(): a mapping is "
+      "already kept at this address");
+  Mappings()[elements] = std::move(file);
+}
+
+bool mapped::Kept(const void* elements)
+{
+  std::lock_guard<std::mutex> lock(MappingsMutex());
+  return Mappings().count(elements) > 0;
+}
+
+bool mapped::Release(const void* elements)
+{
+  std::shared_ptr<MappedFile> file;
+  {
+    std::lock_guard<std::mutex> lock(MappingsMutex());
+    std::map<const void*, std::shared_ptr<MappedFile> >::iterator it =
+        Mappings().find(elements);
+    if (it == Mappings().end())
+      return false;
+
+    file = std::move(it->second);
+    Mappings().erase(it);
+  }
+
+  // The file is unmapped here (if it is not kept for other pointers), outside
+  // of the lock.
+  return true;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file mapped_matrix.hpp
+ *
+ * A binary matrix format that can be loaded without copying, by mapping the
+ * file into memory; used by data::Load() and data::Save() for .mmat files.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_MATRIX_HPP
+#define __MLPACK_CORE_DATA_MAPPED_MATRIX_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <stdint.h>
+#include <memory>
+#include "mapped_file.hpp"
+
+namespace mlpack {
+namespace data {
+
+/**
+ * Load a matrix saved with SaveMapped().  The file holds the matrix in
+ * column-major order after a fixed-size header, so when the element type
+ * matches eT and transpose is true (the default of data::Load()), the file is
+ * memory-mapped and the matrix is made to use the mapping as its memory: no
+ * data is read or copied, the load takes constant time, and the pages of the
+ * file are shared (through the page cache) between all processes that load it.
+ *
+ * The mapping is private, so the matrix may be modified without changing the
+ * file; modified pages are copied for this process only.
+ *
+ * @warning Armadillo cannot release a mapping, so the mapping is NOT released
+ *     when the matrix is destroyed.  It is kept (in a registry, by the address
+ *     of the elements) until UnmapMatrix() is called on the matrix, another
+ *     mapped matrix is loaded into it, or the program exits.  Call
+ *     UnmapMatrix() before a mapped matrix goes out of scope, or the file
+ *     stays mapped.  If the matrix is resized, it allocates new memory as
+ *     usual, and the mapping can then only be released with mapped::Release()
+ *     and the old address.  In debug builds, keeping a second mapping at the
+ *     address of one that is still kept is an assertion failure.
+ *
+ * If transpose is false or the element type differs from eT, the data is
+ * copied (and transposed or converted) into the matrix.
+ *
+ * A std::runtime_error is thrown upon failure.
+ *
+ * @param filename Name of the file to load.
+ * @param matrix Matrix to load into.
+ * @param transpose If false, load the transpose of the saved matrix.
+ * @return The number of bytes in the file.
+ */
+template<typename eT>
+size_t LoadMapped(const std::string& filename,
+                  arma::Mat<eT>& matrix,
+                  const bool transpose = true);
+
+/**
+ * Save a matrix so that it can be loaded with LoadMapped().  The file has a
+ * header giving the format version, byte order, element type, and size of the
+ * matrix, and then the elements in column-major order, starting at a page
+ * boundary.  If transpose is true (the default of data::Save()), the matrix is
+ * stored as it is, so that data::Load() with transpose = true gives it back
+ * without copying; otherwise its transpose is stored.
+ *
+ * A std::runtime_error is thrown upon failure.
+ *
+ * @param filename Name of the file to save to.
+ * @param matrix Matrix to save.
+ * @param transpose If false, save the transpose of the matrix.
+ * @return The number of bytes written.
+ */
+template<typename eT>
+size_t SaveMapped(const std::string& filename,
+                  const arma::Mat<eT>& matrix,
+                  const bool transpose = true);
+
+/**
+ * If the matrix uses a mapping made by LoadMapped(), empty the matrix and
+ * unmap the file.
+ *
+ * @param matrix Matrix to empty.
+ * @return Whether a mapping was released.
+ */
+template<typename eT>
+bool UnmapMatrix(arma::Mat<eT>& matrix);
+
+namespace mapped {
+
+//! The kinds of elements that a file may hold.
+enum ElementKind
+{
+  FLOATING = 1,
+  SIGNED = 2,
+  UNSIGNED = 3
+};
+
+/**
+ * The header at the start of each file.  It is written as it is, so all fields
+ * have fixed sizes and there is no padding.
+ */
+struct Header
+{
+  //! "MLPKMMAT".
+  char magic[8];
+  //! The version of the format.
+  uint32_t version;
+  //! 0x01020304, written in the byte order of the machine that saved the file.
+  uint32_t byteOrder;
+  //! The ElementKind of the elements.
+  uint32_t elementKind;
+  //! The size of each element, in bytes.
+  uint32_t elementSize;
+  //! The number of rows of the matrix.
+  uint64_t rows;
+  //! The number of columns of the matrix.
+  uint64_t cols;
+  //! The offset of the elements from the start of the file, in bytes.
+  uint64_t offset;
+};
+
+//! Make a header for a matrix of the given size and element type.
+Header MakeHeader(const ElementKind kind,
+                  const size_t elementSize,
+                  const size_t rows,
+                  const size_t cols);
+
+/**
+ * Read and check the header of a mapped file.  A std::runtime_error is thrown
+ * if it is not a valid matrix file.
+ *
+ * @param file The mapped file.
+ * @param filename Name of the file, for errors.
+ * @param header Set to the header of the file.
+ */
+void ReadHeader(const MappedFile& file,
+                const std::string& filename,
+                Header& header);
+
+/**
+ * Map the file and check its header.  A std::runtime_error is thrown if the
+ * file cannot be opened or is not a valid matrix file.
+ *
+ * @param filename Name of the file.
+ * @param header Set to the header of the file.
+ * @return The mapped file.
+ */
+std::unique_ptr<MappedFile> Open(const std::string& filename, Header& header);
+
+/**
+ * Keep the mapped file until Release() is called with the given pointer into
+ * it (or the program exits).  A file may be kept for several pointers (as by
+ * MappedIArchive); it is unmapped when all of them are released.  Nothing is
+ * released when the matrix using the mapping is destroyed; in debug builds, a
+ * pointer that is already kept is an assertion failure.
+ */
+void Keep(std::shared_ptr<MappedFile> file, const void* elements);
+
+//! Return whether a mapped file is kept for the given pointer.
+bool Kept(const void* elements);
+
+//! Release a mapped file kept by Keep(); returns false if there is none.
+bool Release(const void* elements);
+
+//! Get the ElementKind of eT.
+template<typename eT>
+ElementKind Kind()
+{
+  return std::is_floating_point<eT>::value ? FLOATING :
+      (std::is_signed<eT>::value ? SIGNED : UNSIGNED);
+}
+
+} // namespace mapped
+
+} // namespace data
+} // namespace mlpack
+
+// Include implementation.
+#include "mapped_matrix_impl.hpp"
+
+#endif
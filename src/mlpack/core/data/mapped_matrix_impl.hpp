@@ -0,0 +1,197 @@
+/**
+ * @file mapped_matrix_impl.hpp
+ *
+ * Implementation of LoadMapped(), SaveMapped() and UnmapMatrix().
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_MAPPED_MATRIX_IMPL_HPP
+#define __MLPACK_CORE_DATA_MAPPED_MATRIX_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "mapped_matrix.hpp"
+
+#include <mlpack/core/util/log.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace mlpack {
+namespace data {
+namespace mapped {
+
+/**
+ * Copy the stored elements into the matrix, converting them to eT, and
+ * transposing them if transpose is false.
+ */
+template<typename StoredType, typename eT>
+void Convert(const char* elements,
+             const size_t rows,
+             const size_t cols,
+             arma::Mat<eT>& matrix,
+             const bool transpose)
+{
+  const StoredType* stored = (const StoredType*) elements;
+  if (transpose)
+  {
+    matrix.set_size(rows, cols);
+    for (size_t i = 0; i < rows * cols; ++i)
+      matrix[i] = eT(stored[i]);
+  }
+  else
+  {
+    matrix.set_size(cols, rows);
+    for (size_t j = 0; j < cols; ++j)
+      for (size_t i = 0; i < rows; ++i)
+        matrix(j, i) = eT(stored[j * rows + i]);
+  }
+}
+
+//! Call Convert() with the type of element given by the header.
+template<typename eT>
+void Convert(const Header& header,
+             const char* elements,
+             arma::Mat<eT>& matrix,
+             const bool transpose)
+{
+  const size_t rows = (size_t) header.rows;
+  const size_t cols = (size_t) header.cols;
+
+  if (header.elementKind == FLOATING && header.elementSize == 4)
+    Convert<float>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == FLOATING && header.elementSize == 8)
+    Convert<double>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == SIGNED && header.elementSize == 1)
+    Convert<int8_t>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == SIGNED && header.elementSize == 2)
+    Convert<int16_t>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == SIGNED && header.elementSize == 4)
+    Convert<int32_t>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == SIGNED && header.elementSize == 8)
+    Convert<int64_t>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == UNSIGNED && header.elementSize == 1)
+    Convert<uint8_t>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == UNSIGNED && header.elementSize == 2)
+    Convert<uint16_t>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == UNSIGNED && header.elementSize == 4)
+    Convert<uint32_t>(elements, rows, cols, matrix, transpose);
+  else if (header.elementKind == UNSIGNED && header.elementSize == 8)
+    Convert<uint64_t>(elements, rows, cols, matrix, transpose);
+  else
+    throw std::runtime_error("unsupported element type");
+}
+
+} // namespace mapped
+
+template<typename eT>
+size_t LoadMapped(const std::string& filename,
+                  arma::Mat<eT>& matrix,
+                  const bool transpose)
+{
+  if (!std::is_arithmetic<eT>::value)
+    throw std::runtime_error("cannot load '" + filename + "': only matrices "
+        "of integer or floating-point types can be mapped");
+
+  mapped::Header header;
+  std::unique_ptr<MappedFile> file = mapped::Open(filename, header);
+  const size_t bytes = file->Size();
+  char* elements = file->MutableData() + header.offset;
+
+  // The matrix may already use an earlier mapping; release it afterwards.
+  const eT* previous = matrix.memptr();
+
+  const bool sameType = (header.elementKind == mapped::Kind<eT>() &&
+      header.elementSize == sizeof(eT));
+  if (!sameType || !transpose || header.rows * header.cols == 0)
+  {
+    if (!sameType)
+      Log::Warn << "Matrix in '" << filename << "' has a different element "
+          << "type; converting it (the file is not mapped)." << std::endl;
+
+    try
+    {
+      mapped::Convert(header, elements, matrix, transpose);
+    }
+    catch (std::runtime_error& e)
+    {
+      throw std::runtime_error("cannot load '" + filename + "': " + e.what());
+    }
+  }
+  else
+  {
+    // Make the matrix use the mapping as its memory.  The alias is not
+    // strict, so the matrix may still be resized later (which allocates new
+    // memory), and steal_mem() takes the memory of a non-strict alias without
+    // copying it.
+    arma::Mat<eT> alias((eT*) elements, (size_t) header.rows,
+        (size_t) header.cols, false, false);
+    matrix.steal_mem(alias);
+    if (matrix.memptr() == (const eT*) elements)
+      mapped::Keep(std::move(file), elements);
+  }
+
+  if (previous != NULL && previous != matrix.memptr())
+    mapped::Release(previous);
+
+  return bytes;
+}
+
+template<typename eT>
+size_t SaveMapped(const std::string& filename,
+                  const arma::Mat<eT>& matrix,
+                  const bool transpose)
+{
+  if (!std::is_arithmetic<eT>::value)
+    throw std::runtime_error("cannot save '" + filename + "': only matrices "
+        "of integer or floating-point types can be mapped");
+
+  // The file holds the matrix that LoadMapped() gives back.
+  arma::Mat<eT> transposed;
+  if (!transpose)
+    transposed = trans(matrix);
+  const arma::Mat<eT>& stored = transpose ? matrix : transposed;
+
+  const mapped::Header header = mapped::MakeHeader(mapped::Kind<eT>(),
+      sizeof(eT), stored.n_rows, stored.n_cols);
+
+  std::ofstream stream(filename.c_str(), std::ios::out | std::ios::binary |
+      std::ios::trunc);
+  if (!stream.is_open())
+    throw std::runtime_error("cannot open file '" + filename + "' for "
+        "writing");
+
+  // Pad the header to the offset of the elements.
+  std::vector<char> start(header.offset, 0);
+  std::memcpy(&start[0], &header, sizeof(header));
+  stream.write(&start[0], start.size());
+  stream.write((const char*) stored.memptr(), stored.n_elem * sizeof(eT));
+  stream.close();
+  if (stream.fail())
+    throw std::runtime_error("cannot write to file '" + filename + "'");
+
+  return header.offset + stored.n_elem * sizeof(eT);
+}
+
+template<typename eT>
+bool UnmapMatrix(arma::Mat<eT>& matrix)
+{
+  const eT* elements = matrix.memptr();
+  if (elements == NULL || !mapped::Kept(elements))
+    return false;
+
+  // Empty the matrix first, so that it no longer uses the mapping.
+  matrix.reset();
+  return mapped::Release(elements);
+}
+
+} // namespace data
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file result_writer.cpp
+ *
+ * Implementation of the non-templated parts of ResultWriter.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "result_writer.hpp"
+
+#include <mlpack/core/util/log.hpp>
+
+using namespace mlpack;
+using namespace mlpack::data;
+
+ResultWriter::ResultWriter(const std::string& filename,
+                           const size_t bufferSize) :
+    filename(filename),
+    binary(false),
+    separator(','),
+    bufferSize(bufferSize),
+    bytes(0),
+    wroteMatrix(false)
+{
+  if (!Format(filename, binary, separator))
+    throw std::runtime_error("data::ResultWriter: cannot write '" + filename +
+        "': unsupported format");
+
+  stream.open(filename.c_str(), std::ofstream::out | std::ofstream::binary);
+  if (!stream.is_open())
+    throw std::runtime_error("data::ResultWriter: cannot open '" + filename +
+        "' for writing");
+
+  buffer.reserve(bufferSize);
+}
+
+ResultWriter::~ResultWriter()
+{
+  if (!stream.is_open())
+    return;
+
+  try
+  {
+    Close();
+  }
+  catch (std::exception& e)
+  {
+    Log::Warn << e.what() << std::endl;
+  }
+}
+
+void ResultWriter::Close()
+{
+  if (!stream.is_open())
+    return;
+
+  Flush();
+  stream.close();
+  if (stream.fail())
+    throw std::runtime_error("data::ResultWriter: cannot write to '" +
+        filename + "'");
+}
+
+bool ResultWriter::Supports(const std::string& filename)
+{
+  bool binary;
+  char separator;
+  return Format(filename, binary, separator);
+}
+
+bool ResultWriter::Format(const std::string& filename,
+                          bool& binary,
+                          char& separator)
+{
+  const std::string extension = Extension(filename);
+  binary = (extension == "bin");
+  separator = (extension == "csv") ? ',' : ' ';
+  return (binary || extension == "csv" || extension == "tsv" ||
+      extension == "txt");
+}
+
+void ResultWriter::Append(const char* data, const size_t size)
+{
+  if (buffer.size() + size > bufferSize)
+    Flush();
+
+  // Large blocks are written directly.
+  if (size >= bufferSize)
+  {
+    if (!stream.write(data, size))
+      throw std::runtime_error("data::ResultWriter: cannot write to '" +
+          filename + "'");
+  }
+  else
+  {
+    buffer.insert(buffer.end(), data, data + size);
+  }
+
+  bytes += size;
+}
+
+void ResultWriter::Flush()
+{
+  if (buffer.empty())
+    return;
+
+  if (!stream.write(buffer.data(), buffer.size()))
+    throw std::runtime_error("data::ResultWriter: cannot write to '" +
+        filename + "'");
+  buffer.clear();
+}
@@ -0,0 +1,217 @@
+/**
+ * @file result_writer.hpp
+ *
+ * A buffered writer for the results of programs (labels, neighbors, distances,
+ * probabilities), which formats numbers in parallel and can append labels to a
+ * dataset file without loading it.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_RESULT_WRITER_HPP
+#define __MLPACK_CORE_DATA_RESULT_WRITER_HPP
+
+#include <mlpack/prereqs.hpp>
+#include <fstream>
+#include <vector>
+
+namespace mlpack {
+namespace data {
+
+/**
+ * A ResultWriter writes results to a file through a large buffer.  Numbers are
+ * formatted on the threads of the global util::ThreadPool, a block of lines per
+ * task, and the blocks are written in order.  Integers are written exactly;
+ * floating-point numbers are written in scientific notation with 12 decimals,
+ * as by Armadillo's text formats.
+ *
+ * The format is given by the extension of the file:
+ *
+ *  - .csv: comma-separated values, one point per line;
+ *  - .tsv, .txt: space-separated values, one point per line;
+ *  - .bin: Armadillo binary, as written by data::Save() (the file holds one
+ *    matrix, so WriteColumns() may then be called once only).
+ *
+ * Files written by WriteColumns() can be loaded with data::Load(), which gives
+ * back the matrix.
+ *
+ * For example, to save the neighbors found by a search:
+ *
+ * @code
+ * data::ResultWriter writer("neighbors.csv");
+ * writer.WriteColumns(neighbors);
+ * writer.Close();
+ * @endcode
+ */
+class ResultWriter
+{
+ public:
+  /**
+   * Open a file for writing.  A std::runtime_error is thrown if it cannot be
+   * opened or its format is not supported.
+   *
+   * @param filename Name of the file.
+   * @param bufferSize Number of bytes to buffer before writing to the file.
+   */
+  ResultWriter(const std::string& filename,
+               const size_t bufferSize = (1 << 22));
+
+  /**
+   * Write the rest of the buffer and close the file, if Close() was not called.
+   * Errors are then reported with Log::Warn.
+   */
+  ~ResultWriter();
+
+  /**
+   * Write each column of the matrix as a point (one line, in text files), as
+   * data::Save() does with transpose = true.  A std::runtime_error is thrown if
+   * the file cannot be written.
+   *
+   * @param matrix Matrix to write.
+   */
+  template<typename eT>
+  void WriteColumns(const arma::Mat<eT>& matrix);
+
+  /**
+   * Write each vector as a line, which may have any number of values
+   * (including none).  Only text files can hold such lines.  Whatever the
+   * extension, the values are separated by ", " and written as std::ostream
+   * writes them by default (6 significant digits for floating-point values),
+   * which is the format of the range search results.  A std::runtime_error is
+   * thrown if the file cannot be written.
+   *
+   * @param lines Vectors to write.
+   */
+  template<typename eT>
+  void WriteLines(const std::vector<std::vector<eT> >& lines);
+
+  /**
+   * Write the points of a dataset file, each followed by its label: the points
+   * are copied as they are, without parsing and reformatting them.  In text
+   * files, the label is separated from the point like the fields of the first
+   * point are, and blank lines are copied as they are.  Armadillo binary
+   * datasets must hold doubles.  A std::runtime_error is thrown if a file
+   * cannot be read or written.
+   *
+   * @param datasetFile Name of the dataset file.
+   * @param labels Label of each point of the dataset.
+   * @return false (and nothing is written) if the dataset file is not a text
+   *     file (without an Armadillo header) or Armadillo binary file like this
+   *     one, or does not have one point per label.
+   */
+  template<typename eT>
+  bool WriteLabeled(const std::string& datasetFile,
+                    const arma::Row<eT>& labels);
+
+  /**
+   * Write the rest of the buffer and close the file.  A std::runtime_error is
+   * thrown if the file cannot be written.
+   */
+  void Close();
+
+  //! Get the number of bytes written so far (including the buffer).
+  size_t Bytes() const { return bytes; }
+
+  //! Return whether files with the extension of the given file can be written.
+  static bool Supports(const std::string& filename);
+
+ private:
+  //! Name of the file.
+  std::string filename;
+  //! The file.
+  std::ofstream stream;
+  //! Whether the file is Armadillo binary.
+  bool binary;
+  //! Separator of values in text files.
+  char separator;
+  //! The bytes which have not been written yet.
+  std::vector<char> buffer;
+  //! Number of bytes to buffer.
+  size_t bufferSize;
+  //! Number of bytes written so far.
+  size_t bytes;
+  //! Whether a matrix was written to a binary file.
+  bool wroteMatrix;
+
+  /**
+   * Get the format of files with the extension of the given file.
+   *
+   * @return false if the format is not supported.
+   */
+  static bool Format(const std::string& filename,
+                     bool& binary,
+                     char& separator);
+
+  //! Add bytes to the buffer, and write it if it is full.
+  void Append(const char* data, const size_t size);
+  //! Write the buffer to the file.
+  void Flush();
+
+  /**
+   * Call formatItem(i, text) for each i in [0, count), appending the text of
+   * item i; blocks of grain items are formatted in parallel, and written in
+   * order.
+   */
+  template<typename FormatType>
+  void FormatInParallel(const size_t count,
+                        const size_t grain,
+                        FormatType formatItem);
+
+  //! Write the header of an Armadillo binary file for a matrix of the given
+  //! size and element type.
+  template<typename eT>
+  void WriteBinaryHeader(const size_t rows, const size_t cols);
+
+  //! The writer cannot be copied, since it owns its file.
+  ResultWriter(const ResultWriter& other);
+  ResultWriter& operator=(const ResultWriter& other);
+};
+
+/**
+ * Write a dataset file with the label of each point appended to it (as a last
+ * column, like data::Save() of the dataset with the labels as an extra row),
+ * without loading the dataset: see ResultWriter::WriteLabeled().  If the
+ * output file is the dataset file, the result is written to a temporary file
+ * which then replaces the dataset.
+ *
+ * A std::runtime_error is thrown if a file cannot be read or written.
+ *
+ * @param datasetFile Name of the dataset file.
+ * @param outputFile Name of the file to write (which may be datasetFile).
+ * @param labels Label of each point of the dataset.
+ * @return false (and nothing is written) if the dataset cannot be copied this
+ *     way, because the files have different formats, the format is not
+ *     supported, or the dataset does not have one point per label; the caller
+ *     should then load the dataset and save it with the labels.
+ */
+template<typename eT>
+bool AppendLabels(const std::string& datasetFile,
+                  const std::string& outputFile,
+                  const arma::Row<eT>& labels);
+
+/**
+ * Save a matrix of results as data::Save() does (with transpose = true), but
+ * through a ResultWriter if the format of the file is supported by it.  An
+ * error is reported with Log::Warn, or with Log::Fatal if fatal is true.
+ *
+ * @param filename Name of the file to save to.
+ * @param matrix Matrix to save.
+ * @param fatal If an error should be reported as fatal (default false).
+ * @return Whether the matrix was saved.
+ */
+template<typename eT>
+bool SaveResult(const std::string& filename,
+                const arma::Mat<eT>& matrix,
+                const bool fatal = false);
+
+} // namespace data
+} // namespace mlpack
+
+// Include implementation.
+#include "result_writer_impl.hpp"
+
+#endif
@@ -0,0 +1,381 @@
+/**
+ * @file result_writer_impl.hpp
+ *
+ * Implementation of the templated parts of ResultWriter, and of
+ * AppendLabels().
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_DATA_RESULT_WRITER_IMPL_HPP
+#define __MLPACK_CORE_DATA_RESULT_WRITER_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "result_writer.hpp"
+#include "extension.hpp"
+#include "load_text.hpp"
+#include "mapped_file.hpp"
+#include "save.hpp"
+
+#include <mlpack/core/util/thread_pool.hpp>
+#include <mlpack/core/util/timers.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <type_traits>
+
+namespace mlpack {
+namespace data {
+namespace text {
+
+//! Append an integer to the output.
+template<typename eT>
+void AppendNumber(std::string& out, const eT value, std::false_type)
+{
+  const bool negative = std::is_signed<eT>::value && (int64_t) value < 0;
+  uint64_t magnitude = negative ? (uint64_t) 0 - (uint64_t) (int64_t) value :
+      (uint64_t) value;
+
+  char digits[24];
+  char* p = digits + sizeof(digits);
+  do
+  {
+    *--p = (char) ('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (negative)
+    *--p = '-';
+
+  out.append(p, digits + sizeof(digits) - p);
+}
+
+//! Append a floating-point number to the output, as Armadillo does.
+template<typename eT>
+void AppendNumber(std::string& out, const eT value, std::true_type)
+{
+  char digits[32];
+  const int length = std::snprintf(digits, sizeof(digits), "%.12e",
+      (double) value);
+  out.append(digits, length);
+}
+
+//! Append an integer to the output, as std::ostream does.
+template<typename eT>
+void AppendStreamNumber(std::string& out, const eT value, std::false_type)
+{
+  AppendNumber(out, value, std::false_type());
+}
+
+//! Append a floating-point number to the output, as std::ostream does with its
+//! default precision (6 significant digits).
+template<typename eT>
+void AppendStreamNumber(std::string& out, const eT value, std::true_type)
+{
+  char digits[32];
+  const int length = std::snprintf(digits, sizeof(digits), "%g",
+      (double) value);
+  out.append(digits, length);
+}
+
+} // namespace text
+
+template<typename eT>
+void ResultWriter::WriteColumns(const arma::Mat<eT>& matrix)
+{
+  if (!binary)
+  {
+    // Blocks of about 64 kB of text are formatted at once.
+    const size_t grain = std::max((size_t) 1, (size_t) 4096 /
+        std::max((size_t) 1, (size_t) matrix.n_rows));
+    FormatInParallel(matrix.n_cols, grain, [&](const size_t i,
+                                               std::string& out)
+    {
+      for (size_t d = 0; d < matrix.n_rows; ++d)
+      {
+        if (d != 0)
+          out += separator;
+        text::AppendNumber(out, matrix(d, i),
+            typename std::is_floating_point<eT>::type());
+      }
+      out += '\n';
+    });
+    return;
+  }
+
+  if (wroteMatrix)
+    throw std::runtime_error("data::ResultWriter: '" + filename + "' already "
+        "holds a matrix");
+  wroteMatrix = true;
+
+  // The file holds the transpose of the matrix, in column-major order.
+  WriteBinaryHeader<eT>(matrix.n_cols, matrix.n_rows);
+  std::vector<eT> block(std::min((size_t) matrix.n_cols, (size_t) 65536));
+  for (size_t d = 0; d < matrix.n_rows; ++d)
+  {
+    for (size_t i = 0; i < matrix.n_cols; i += block.size())
+    {
+      const size_t n = std::min(block.size(), (size_t) matrix.n_cols - i);
+      for (size_t j = 0; j < n; ++j)
+        block[j] = matrix(d, i + j);
+      Append((const char*) block.data(), n * sizeof(eT));
+    }
+  }
+}
+
+template<typename eT>
+void ResultWriter::WriteLines(const std::vector<std::vector<eT> >& lines)
+{
+  if (binary)
+    throw std::runtime_error("data::ResultWriter: lines of different lengths "
+        "cannot be written to binary file '" + filename + "'");
+
+  FormatInParallel(lines.size(), 1024, [&](const size_t i, std::string& out)
+  {
+    for (size_t j = 0; j < lines[i].size(); ++j)
+    {
+      if (j != 0)
+        out += ", ";
+      text::AppendStreamNumber(out, lines[i][j],
+          typename std::is_floating_point<eT>::type());
+    }
+    out += '\n';
+  });
+}
+
+template<typename eT>
+bool ResultWriter::WriteLabeled(const std::string& datasetFile,
+                                const arma::Row<eT>& labels)
+{
+  bool datasetBinary;
+  char datasetSeparator;
+  if (!Format(datasetFile, datasetBinary, datasetSeparator) ||
+      datasetBinary != binary)
+    return false;
+
+  const MappedFile file(datasetFile);
+  const char* begin = file.Data();
+  const char* end = begin + file.Size();
+
+  if (binary)
+  {
+    // Only matrices of doubles, with a valid header, are copied.
+    const std::string header = arma::diskio::gen_bin_header(arma::mat());
+    if (file.Size() <= header.size() ||
+        std::memcmp(begin, header.data(), header.size()) != 0 ||
+        begin[header.size()] != '\n')
+      return false;
+    const char* sizeEnd = (const char*) std::memchr(begin + header.size() + 1,
+        '\n', end - begin - header.size() - 1);
+    if (sizeEnd == NULL)
+      return false;
+
+    // The file holds the transpose of the dataset, so each row is a point.
+    size_t points, dimensionality;
+    std::istringstream size(std::string(begin + header.size() + 1, sizeEnd));
+    size >> points >> dimensionality;
+    const char* data = sizeEnd + 1;
+    if (size.fail() || points != labels.n_elem || (dimensionality != 0 &&
+        points > (size_t) (end - data) / sizeof(double) / dimensionality))
+      return false;
+
+    // The labels are another column of the file.
+    WriteBinaryHeader<double>(points, dimensionality + 1);
+    Append(data, points * dimensionality * sizeof(double));
+    std::vector<double> block(std::min(points, (size_t) 65536));
+    for (size_t i = 0; i < points; i += block.size())
+    {
+      const size_t n = std::min(block.size(), points - i);
+      for (size_t j = 0; j < n; ++j)
+        block[j] = (double) labels[i + j];
+      Append((const char*) block.data(), n * sizeof(double));
+    }
+
+    wroteMatrix = true;
+    return true;
+  }
+
+  // The labels are separated from the points as the fields of the first point
+  // are (a .txt file may hold comma-separated values, for instance).  Files
+  // with an Armadillo header are not copied.
+  const char* first = begin;
+  const char* firstEnd = begin;
+  while (first != end)
+  {
+    const char* next;
+    firstEnd = text::LineEnd(first, end, next);
+    if (!text::IsBlankLine(first, firstEnd))
+      break;
+    first = next;
+  }
+  if (end - first >= 12 && std::memcmp(first, "ARMA_MAT_TXT", 12) == 0)
+    return false;
+  const char labelSeparator = (std::memchr(first, ',', firstEnd - first) !=
+      NULL) ? ',' : ' ';
+
+  // Text datasets are copied in chunks of about a megabyte, in parallel.
+  std::vector<const char*> starts;
+  std::vector<size_t> firstLines;
+  text::SplitLines(begin, end, std::max((size_t) 1, file.Size() >> 20),
+      starts, firstLines);
+  if (firstLines.back() != labels.n_elem)
+    return false;
+
+  FormatInParallel(starts.size() - 1, 1, [&](const size_t c,
+                                             std::string& out)
+  {
+    size_t line = firstLines[c];
+    for (const char* p = starts[c]; p != starts[c + 1]; )
+    {
+      const char* next;
+      const char* lineEnd = text::LineEnd(p, starts[c + 1], next);
+      if (text::IsBlankLine(p, lineEnd))
+      {
+        out.append(p, next - p);
+        p = next;
+        continue;
+      }
+
+      // The label goes before the end of the line, which is kept as it is.
+      out.append(p, lineEnd - p);
+      out += labelSeparator;
+      text::AppendNumber(out, labels[line++],
+          typename std::is_floating_point<eT>::type());
+      if (next == lineEnd)
+        out += '\n';
+      else
+        out.append(lineEnd, next - lineEnd);
+      p = next;
+    }
+  });
+
+  return true;
+}
+
+template<typename FormatType>
+void ResultWriter::FormatInParallel(const size_t count,
+                                    const size_t grain,
+                                    FormatType formatItem)
+{
+  // A few blocks per thread are formatted at once, so that only those blocks
+  // are held in memory.
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  std::vector<std::string> blocks(4 * pool.Threads());
+  for (size_t first = 0; first < count; first += blocks.size() * grain)
+  {
+    const size_t blockCount = std::min(blocks.size(),
+        (count - first + grain - 1) / grain);
+    pool.ParallelFor(0, blockCount, 1, [&](const size_t blockBegin,
+                                           const size_t blockEnd)
+    {
+      for (size_t b = blockBegin; b < blockEnd; ++b)
+      {
+        blocks[b].clear();
+        const size_t end = std::min(count, first + (b + 1) * grain);
+        for (size_t i = first + b * grain; i < end; ++i)
+          formatItem(i, blocks[b]);
+      }
+    });
+
+    for (size_t b = 0; b < blockCount; ++b)
+      Append(blocks[b].data(), blocks[b].size());
+  }
+}
+
+template<typename eT>
+void ResultWriter::WriteBinaryHeader(const size_t rows, const size_t cols)
+{
+  std::ostringstream header;
+  header << arma::diskio::gen_bin_header(arma::Mat<eT>()) << '\n' << rows
+      << ' ' << cols << '\n';
+  const std::string headerText = header.str();
+  Append(headerText.data(), headerText.size());
+}
+
+template<typename eT>
+bool AppendLabels(const std::string& datasetFile,
+                  const std::string& outputFile,
+                  const arma::Row<eT>& labels)
+{
+  if (Extension(datasetFile) != Extension(outputFile) ||
+      !ResultWriter::Supports(outputFile))
+    return false;
+
+  // The dataset is replaced by a temporary file with the same extension.
+  const bool replace = (datasetFile == outputFile);
+  const std::string filename = replace ? outputFile + ".tmp." +
+      Extension(outputFile) : outputFile;
+
+  // The file is removed if it could not be written, after it is closed.
+  bool written = false;
+  std::exception_ptr error;
+  {
+    ResultWriter writer(filename);
+    try
+    {
+      written = writer.WriteLabeled(datasetFile, labels);
+      writer.Close();
+    }
+    catch (std::exception& /* e */)
+    {
+      error = std::current_exception();
+    }
+  }
+
+  if (error || !written)
+  {
+    std::remove(filename.c_str());
+    if (error)
+      std::rethrow_exception(error);
+    return false;
+  }
+
+  if (replace && std::rename(filename.c_str(), datasetFile.c_str()) != 0)
+  {
+    std::remove(filename.c_str());
+    throw std::runtime_error("data::AppendLabels(): cannot replace '" +
+        datasetFile + "'");
+  }
+
+  return true;
+}
+
+template<typename eT>
+bool SaveResult(const std::string& filename,
+                const arma::Mat<eT>& matrix,
+                const bool fatal)
+{
+  if (!ResultWriter::Supports(filename))
+    return Save(filename, matrix, fatal);
+
+  Timer::Start("saving_data");
+  try
+  {
+    ResultWriter writer(filename);
+    writer.WriteColumns(matrix);
+    writer.Close();
+  }
+  catch (std::exception& e)
+  {
+    Timer::Stop("saving_data");
+    if (fatal)
+      Log::Fatal << e.what() << std::endl;
+    Log::Warn << e.what() << std::endl;
+    return false;
+  }
+  Timer::Stop("saving_data");
+
+  return true;
+}
+
+} // namespace data
+} // namespace mlpack
+
+#endif
@@ -41,6 +41,12 @@ namespace data /** Functions to load and save matrices. */ {
  *  - Armadillo binary (arma_binary), denoted by .bin
  *  - HDF5 (hdf5_binary), denoted by .hdf5, .hdf, .h5, or .he5
  *
+ * HDF5 datasets are written by SaveHDF5(), in compressed chunks of points.
+ *
+ * In addition, matrices of integer or floating-point types can be saved as
+ * mapped matrices, denoted by .mmat, which data::Load() memory-maps instead of
+ * reading; see SaveMapped() for details.
+ *
  * If the file extension is not one of those types, an error will be given.  If
  * the 'fatal' parameter is set to true, a std::runtime_error exception will be
  * thrown upon failure.  If the 'transpose' parameter is set to true, the matrix
@@ -66,14 +72,20 @@ bool Save(const std::string& filename,
  * used and the filetype cannot be determined, and error will be given.
  *
  * The supported types of files are the same as what is supported by the
- * boost::serialization library:
+ * boost::serialization library, and mlpack's own mapped binary archive:
  *
  *  - text, denoted by .txt
  *  - xml, denoted by .xml
  *  - binary, denoted by .bin
+ *  - mapped binary, denoted by .mbin
+ *
+ * Mapped binary files are the fastest to save and load, and the matrices of the
+ * model can be used without copying them when it is loaded (see
+ * MappedIArchive).
  *
  * The format parameter can take any of the values in the 'format' enum:
- * 'format::autodetect', 'format::text', 'format::xml', and 'format::binary'.
+ * 'format::autodetect', 'format::text', 'format::xml', 'format::binary', and
+ * 'format::mapped'.
  * The autodetect functionality operates on the file extension (so, "file.txt"
  * would be autodetected as text).
  *
@@ -24,6 +24,9 @@
 #include <boost/archive/binary_oarchive.hpp>
 
 #include "serialization_shim.hpp"
+#include "mapped_matrix.hpp"
+#include "mapped_archive.hpp"
+#include "hdf5_io.hpp"
 
 namespace mlpack {
 namespace data {
@@ -51,6 +54,56 @@ bool Save(const std::string& filename,
     return false;
   }
 
+  // Mapped matrices are written by SaveMapped().
+  if (extension == "mmat")
+  {
+    Log::Info << "Saving mapped matrix data to '" << filename << "'."
+        << std::endl;
+    try
+    {
+      SaveMapped(filename, matrix, transpose);
+    }
+    catch (std::exception& e)
+    {
+      Timer::Stop("saving_data");
+      if (fatal)
+        Log::Fatal << e.what() << "; save failed." << std::endl;
+      else
+        Log::Warn << e.what() << "; save failed." << std::endl;
+
+      return false;
+    }
+
+    Timer::Stop("saving_data");
+    return true;
+  }
+
+#ifdef ARMA_USE_HDF5
+  // HDF5 datasets are written in compressed chunks by SaveHDF5().
+  if (extension == "h5" || extension == "hdf5" || extension == "hdf" ||
+      extension == "he5")
+  {
+    Log::Info << "Saving HDF5 data to '" << filename << "'." << std::endl;
+    try
+    {
+      SaveHDF5(filename, matrix, transpose);
+    }
+    catch (std::exception& e)
+    {
+      Timer::Stop("saving_data");
+      if (fatal)
+        Log::Fatal << e.what() << "; save failed." << std::endl;
+      else
+        Log::Warn << e.what() << "; save failed." << std::endl;
+
+      return false;
+    }
+
+    Timer::Stop("saving_data");
+    return true;
+  }
+#endif
+
   // Catch errors opening the file.
   std::fstream stream;
 #ifdef  _WIN32 // Always open in binary mode on Windows.
@@ -98,10 +151,7 @@ bool Save(const std::string& filename,
   else if (extension == "h5" || extension == "hdf5" || extension == "hdf" ||
            extension == "he5")
   {
-#ifdef ARMA_USE_HDF5
-    saveType = arma::hdf5_binary;
-    stringType = "HDF5 data";
-#else
+    // With HDF5 support, these were saved above.
     Timer::Stop("saving_data");
     if (fatal)
       Log::Fatal << "Attempted to save HDF5 data to '" << filename << "', but "
@@ -113,7 +163,6 @@ bool Save(const std::string& filename,
           << std::endl;
 
     return false;
-#endif
   }
   else
   {
@@ -194,14 +243,16 @@ bool Save(const std::string& filename,
       f = format::binary;
     else if (extension == "txt")
       f = format::text;
+    else if (extension == "mbin")
+      f = format::mapped;
     else
     {
       if (fatal)
         Log::Fatal << "Unable to detect type of '" << filename << "'; incorrect"
-            << " extension? (allowed: xml/bin/txt)" << std::endl;
+            << " extension? (allowed: xml/bin/txt/mbin)" << std::endl;
       else
         Log::Warn << "Unable to detect type of '" << filename << "'; save "
-            << "failed.  Incorrect extension? (allowed: xml/bin/txt)"
+            << "failed.  Incorrect extension? (allowed: xml/bin/txt/mbin)"
             << std::endl;
 
       return false;
@@ -211,7 +262,8 @@ bool Save(const std::string& filename,
   // Open the file to save to.
   std::ofstream ofs;
 #ifdef _WIN32
-  if (f == format::binary) // Open non-text types in binary mode on Windows.
+  // Open non-text types in binary mode on Windows.
+  if (f == format::binary || f == format::mapped)
     ofs.open(filename, std::ofstream::out | std::ofstream::binary);
   else
     ofs.open(filename, std::ofstream::out);
@@ -248,6 +300,11 @@ bool Save(const std::string& filename,
       boost::archive::binary_oarchive ar(ofs);
       ar << CreateNVP(t, name);
     }
+    else if (f == format::mapped)
+    {
+      MappedOArchive ar(ofs);
+      ar << CreateNVP(t, name);
+    }
 
     return true;
   }
@@ -1,7 +1,8 @@
 /**
  * @file random.cpp
  *
- * Declarations of global random number generators.
+ * Declarations of global random number generators, and the per-thread random
+ * streams.
  *
  * This file is part of mlpack 2.0.1.
  *
@@ -11,6 +12,12 @@
  * http://www.opensource.org/licenses/BSD-3-Clause for more information.
  */
 #include <random>
+#include <atomic>
+#include "random.hpp"
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 namespace mlpack {
 namespace math {
@@ -22,5 +29,78 @@ std::uniform_real_distribution<> randUniformDist(0.0, 1.0);
 // Global normal distribution.
 std::normal_distribution<> randNormalDist(0.0, 1.0);
 
+namespace {
+
+//! The seed given to RandomSeed().
+std::atomic<uint64_t> masterSeed(0);
+//! The number of stream families created since the last RandomSeed().
+std::atomic<uint64_t> streamFamilies(0);
+//! Incremented by every RandomSeed(), so threads know to restart their stream.
+std::atomic<uint64_t> seedGeneration(0);
+
+//! The stream of a thread, and what it was created from.
+struct ThreadStreamState
+{
+  ThreadStreamState() :
+      generation(0),
+      index(0),
+      indexSet(false),
+      initialized(false)
+  { }
+
+  RandomStream stream;
+  uint64_t generation;
+  size_t index;
+  bool indexSet;
+  bool initialized;
+};
+
+thread_local ThreadStreamState threadState;
+
+} // anonymous namespace
+
+uint64_t NewStreamSeed()
+{
+  const uint64_t family = streamFamilies.fetch_add(1) + 1;
+  return RandomStream::Mix(masterSeed.load() ^ RandomStream::Mix(family));
+}
+
+RandomStream& ThreadStream()
+{
+  const uint64_t generation = seedGeneration.load(std::memory_order_relaxed);
+  if (!threadState.initialized || threadState.generation != generation)
+  {
+    if (!threadState.indexSet)
+    {
+#ifdef _OPENMP
+      threadState.index = (size_t) omp_get_thread_num();
+#else
+      threadState.index = 0;
+#endif
+      threadState.indexSet = true;
+    }
+
+    threadState.stream = RandomStream(masterSeed.load(), threadState.index);
+    threadState.generation = generation;
+    threadState.initialized = true;
+  }
+
+  return threadState.stream;
+}
+
+void SetThreadStreamIndex(const size_t index)
+{
+  threadState.index = index;
+  threadState.indexSet = true;
+  threadState.initialized = false;
+}
+
+void SeedStreams(const uint64_t seed)
+{
+  masterSeed.store(seed);
+  streamFamilies.store(0);
+  seedGeneration.fetch_add(1);
+}
+
 } // namespace math
 } // namespace mlpack
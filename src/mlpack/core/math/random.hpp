@@ -15,27 +15,141 @@
 
 #include <mlpack/prereqs.hpp>
 #include <random>
+#include <stdint.h>
 
 namespace mlpack {
 namespace math /** Miscellaneous math routines. */ {
 
-// Global random object.
+// Global random object, used by the serial functions below (Random(),
+// RandInt() and RandNormal()).  Parallel code should use ThreadStream() or a
+// RandomStream instead.
 extern std::mt19937 randGen;
 // Global uniform distribution.
 extern std::uniform_real_distribution<> randUniformDist;
 // Global normal distribution.
 extern std::normal_distribution<> randNormalDist;
 
+/**
+ * A counter-based random number generator.  The n-th number of a stream is a
+ * hash (the SplitMix64 finalizer) of the stream's key plus n times a fixed odd
+ * constant, so a stream can be created anywhere, skipped ahead with Discard()
+ * in O(1) time, and has no state other than its key and position.  The key is
+ * derived from a seed and a stream number, so many independent streams can be
+ * made from one seed; for instance, one per thread or one per block of work.
+ *
+ * RandomStream satisfies the requirements of a uniform random bit generator,
+ * so it can be used with std::shuffle() and the <random> distributions.
+ */
+class RandomStream
+{
+ public:
+  //! The type of the generated numbers.
+  typedef uint64_t result_type;
+
+  /**
+   * Create the given stream of the given seed.
+   *
+   * @param seed Seed (usually from NewStreamSeed()).
+   * @param stream Index of the stream.
+   */
+  RandomStream(const uint64_t seed = 0, const uint64_t stream = 0) :
+      key(Mix(Mix(seed) ^ (stream * 0xD1B54A32D192ED03ULL +
+          0x8CB92BA72F3D8DD7ULL))),
+      counter(0)
+  { }
+
+  //! Get the smallest value that can be generated.
+  static constexpr result_type min() { return 0; }
+  //! Get the largest value that can be generated.
+  static constexpr result_type max() { return ~((result_type) 0); }
+
+  //! Generate the next number.
+  result_type operator()()
+  {
+    return Mix(key + (++counter) * 0x9E3779B97F4A7C15ULL);
+  }
+
+  //! Skip the next n numbers.
+  void Discard(const uint64_t n) { counter += n; }
+  //! Get the number of numbers generated (or skipped) so far.
+  uint64_t Position() const { return counter; }
+
+  //! Generate a uniform random number in [0, 1).
+  double Uniform()
+  {
+    return (double) ((*this)() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  //! Generate a normally distributed number with mean 0 and variance 1 (with
+  //! the Box-Muller transform).
+  double Normal()
+  {
+    const double u = 1.0 - Uniform(); // In (0, 1], so the log is finite.
+    const double v = Uniform();
+    return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * M_PI * v);
+  }
+
+  //! The SplitMix64 finalizer, a bijective hash of 64-bit integers.
+  static uint64_t Mix(uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+ private:
+  //! The key of the stream.
+  uint64_t key;
+  //! The number of numbers generated so far.
+  uint64_t counter;
+};
+
+/**
+ * Get a new seed for a family of streams, such as the streams used by the
+ * threads or blocks of one parallel algorithm.  Each call returns a different
+ * seed; the sequence of seeds depends only on the seed given to RandomSeed(),
+ * so a program which calls NewStreamSeed() in the same order (typically from
+ * serial code) gets the same streams in every run, for any number of threads.
+ */
+uint64_t NewStreamSeed();
+
+/**
+ * Get the random stream of the calling thread.  Each thread gets its own
+ * stream, derived from the seed given to RandomSeed() and the index of the
+ * thread (the OpenMP thread number, unless set with SetThreadStreamIndex()),
+ * so random numbers can be generated in parallel without locks.  The streams
+ * are restarted by RandomSeed().
+ *
+ * The numbers a thread gets depend on which work it is given, so parallel code
+ * which must give the same result for any number of threads should instead
+ * create one RandomStream per unit of work, from NewStreamSeed().
+ *
+ * Random(), RandInt() and RandNormal() do not use the streams; they draw from
+ * the global generator, so their sequence for a given seed is unchanged, and
+ * they must not be called from parallel code.
+ */
+RandomStream& ThreadStream();
+
+/**
+ * Set the index of the calling thread's stream (see ThreadStream()).  This is
+ * for threads not started by OpenMP, which would otherwise all use stream 0.
+ */
+void SetThreadStreamIndex(const size_t index);
+
+//! Set the seed of the streams (called by RandomSeed()).
+void SeedStreams(const uint64_t seed);
+
 /**
  * Set the random seed used by the random functions (Random() and RandInt()).
- * The seed is casted to a 32-bit integer before being given to the random
- * number generator, but a size_t is taken as a parameter for API consistency.
+ * This also seeds the C library generator and Armadillo's generator, and
+ * restarts the streams of every thread.
  *
  * @param seed Seed for the random number generator.
  */
 inline void RandomSeed(const size_t seed)
 {
   randGen.seed((uint32_t) seed);
+  SeedStreams((uint64_t) seed);
   srand((unsigned int) seed);
 #if ARMA_VERSION_MAJOR > 3 || \
     (ARMA_VERSION_MAJOR == 3 && ARMA_VERSION_MINOR >= 930)
@@ -47,5 +47,17 @@ void RandomBasis(mat& basis, const size_t d)
   }
 }
 
+void RandomProjection(mat& projection,
+                      const size_t d,
+                      const size_t projectedDim)
+{
+  // The orthonormal columns of Q in the economical QR decomposition of a
+  // Gaussian matrix span a uniformly random subspace.
+  mat q, r;
+  while (!qr_econ(q, r, randn<mat>(d, projectedDim))) { }
+
+  projection = std::sqrt(double(d) / double(projectedDim)) * q.t();
+}
+
 } // namespace math
 } // namespace mlpack
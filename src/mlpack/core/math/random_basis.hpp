@@ -28,6 +28,22 @@ namespace math {
  */
 void RandomBasis(arma::mat& basis, const size_t d);
 
+/**
+ * Create a random projection from d dimensions to projectedDim dimensions, in
+ * the style of the Johnson-Lindenstrauss lemma, storing it in the given matrix
+ * (of size projectedDim x d).  The rows of the projection are orthogonal and
+ * scaled by sqrt(d / projectedDim), so squared distances are preserved in
+ * expectation.  This takes O(d projectedDim^2) time, instead of the O(d^3)
+ * needed by RandomBasis().
+ *
+ * @param projection Matrix to store projection in.
+ * @param d Dimensionality of the original space.
+ * @param projectedDim Dimensionality of the projected space (at most d).
+ */
+void RandomProjection(arma::mat& projection,
+                      const size_t d,
+                      const size_t projectedDim);
+
 } // namespace math
 } // namespace mlpack
 
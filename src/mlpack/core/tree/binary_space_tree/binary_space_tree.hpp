@@ -82,10 +82,26 @@ class BinarySpaceTree
   //! delete it.
   MatType* dataset;
 
+  //! The storage of the nodes of a compact tree; see Compact().
+  struct CompactStorage;
+  //! If we are the root of a compact tree, the storage of its nodes (which we
+  //! own); otherwise NULL.
+  CompactStorage* compact;
+
  public:
   //! So other classes can use TreeType::Mat.
   typedef MatType Mat;
 
+  //! The orders in which Compact() can store the nodes of the tree.
+  enum CompactOrder
+  {
+    //! Each node is followed by its left subtree, then by its right subtree.
+    DEPTH_FIRST,
+    //! The van Emde Boas order: the top half of the levels of the tree are
+    //! stored (in this order) first, then each subtree below them.
+    VAN_EMDE_BOAS
+  };
+
   //! A single-tree traverser for binary space trees; see
   //! single_tree_traverser.hpp for implementation.
   template<typename RuleType>
@@ -459,6 +475,20 @@ class BinarySpaceTree
   //! Store the center of the bounding region in the given vector.
   void Center(arma::vec& center) { bound.Center(center); }
 
+  /**
+   * Store the nodes of the tree, which must be built and rooted at this node,
+   * in one block of memory, in the given order, so that traversals touch fewer
+   * cache lines and pages; the ranges of HRectBound bounds are also stored
+   * together, in the same order.  This node stays where it is, and the tree is
+   * unchanged otherwise, so it can be used as before.  The nodes are moved, so
+   * pointers to them are invalidated (as are pointers to nodes held by the
+   * statistics), and the nodes of a compact tree cannot be deleted separately:
+   * they are deleted with this node.
+   *
+   * @param order Order of the nodes in memory.
+   */
+  void Compact(const CompactOrder order = DEPTH_FIRST);
+
  private:
   /**
    * Splits the current node, assigning its left and right children recursively.
@@ -481,6 +511,29 @@ class BinarySpaceTree
                  const size_t maxLeafSize,
                  SplitType<BoundType<MetricType>, MatType>& splitter);
 
+  //! Append the nodes of the subtree of the given node to order, in depth-first
+  //! order.
+  static void DepthFirstOrder(BinarySpaceTree* node,
+                              std::vector<BinarySpaceTree*>& order);
+
+  //! Append the nodes in the top levels of the subtree of the given node to
+  //! order, in van Emde Boas order.
+  static void VanEmdeBoasOrder(BinarySpaceTree* node,
+                               const size_t levels,
+                               std::vector<BinarySpaceTree*>& order);
+
+  //! Append the nodes at the given depth below the given node to nodes, from
+  //! left to right.
+  static void NodesAtDepth(BinarySpaceTree* node,
+                           const size_t depth,
+                           std::vector<BinarySpaceTree*>& nodes);
+
+  //! Return the number of levels of the subtree of the given node.
+  static size_t Levels(const BinarySpaceTree* node);
+
+  //! Delete the nodes of a compact tree, and their storage.
+  static void DeleteCompact(CompactStorage* storage);
+
  protected:
   /**
    * A default constructor.  This is meant to only be used with
@@ -501,6 +554,26 @@ class BinarySpaceTree
   void Serialize(Archive& ar, const unsigned int version);
 };
 
+/**
+ * Compact a tree, if it is a BinarySpaceTree (see BinarySpaceTree::Compact());
+ * other types of trees are left as they are.  This is meant for algorithms
+ * which build their own trees.
+ *
+ * @param tree Root of the tree.
+ */
+template<typename TreeType>
+void CompactTree(TreeType& tree);
+
+//! Compact a BinarySpaceTree, in depth-first order.
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+void CompactTree(BinarySpaceTree<MetricType, StatisticType, MatType, BoundType,
+                                 SplitType>& tree);
+
 } // namespace tree
 } // namespace mlpack
 
@@ -15,11 +15,13 @@
 
 // In case it wasn't included already for some reason.
 #include "binary_space_tree.hpp"
+#include "parallel_build.hpp"
 
 #include <mlpack/core/util/cli.hpp>
 #include <mlpack/core/util/log.hpp>
 #include <mlpack/core/util/string_util.hpp>
 #include <queue>
+#include <unordered_map>
 
 namespace mlpack {
 namespace tree {
@@ -43,7 +45,8 @@ BinarySpaceTree(
     count(data.n_cols), /* and spans all of the dataset. */
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(new MatType(data)) // Copies the dataset.
+    dataset(new MatType(data)), // Copies the dataset.
+    compact(NULL)
 {
   // Do the actual splitting of this node.
   SplitType<BoundType<MetricType>, MatType> splitter;
@@ -71,7 +74,8 @@ BinarySpaceTree(
     count(data.n_cols),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(new MatType(data)) // Copies the dataset.
+    dataset(new MatType(data)), // Copies the dataset.
+    compact(NULL)
 {
   // Initialize oldFromNew correctly.
   oldFromNew.resize(data.n_cols);
@@ -105,7 +109,8 @@ BinarySpaceTree(
     count(data.n_cols),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(new MatType(data)) // Copies the dataset.
+    dataset(new MatType(data)), // Copies the dataset.
+    compact(NULL)
 {
   // Initialize the oldFromNew vector correctly.
   oldFromNew.resize(data.n_cols);
@@ -140,7 +145,8 @@ BinarySpaceTree(MatType&& data, const size_t maxLeafSize) :
     count(data.n_cols),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(new MatType(std::move(data)))
+    dataset(new MatType(std::move(data))),
+    compact(NULL)
 {
   // Do the actual splitting of this node.
   SplitType<BoundType<MetricType>, MatType> splitter;
@@ -168,7 +174,8 @@ BinarySpaceTree(
     count(data.n_cols),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(new MatType(std::move(data)))
+    dataset(new MatType(std::move(data))),
+    compact(NULL)
 {
   // Initialize oldFromNew correctly.
   oldFromNew.resize(dataset->n_cols);
@@ -202,7 +209,8 @@ BinarySpaceTree(
     count(data.n_cols),
     bound(data.n_rows),
     parentDistance(0), // Parent distance for the root is 0: it has no parent.
-    dataset(new MatType(std::move(data)))
+    dataset(new MatType(std::move(data))),
+    compact(NULL)
 {
   // Initialize the oldFromNew vector correctly.
   oldFromNew.resize(dataset->n_cols);
@@ -241,7 +249,8 @@ BinarySpaceTree(
     begin(begin),
     count(count),
     bound(parent->Dataset().n_rows),
-    dataset(&parent->Dataset()) // Point to the parent's dataset.
+    dataset(&parent->Dataset()), // Point to the parent's dataset.
+    compact(NULL)
 {
   // Perform the actual splitting.
   SplitNode(maxLeafSize, splitter);
@@ -270,7 +279,8 @@ BinarySpaceTree(
     begin(begin),
     count(count),
     bound(parent->Dataset().n_rows),
-    dataset(&parent->Dataset())
+    dataset(&parent->Dataset()),
+    compact(NULL)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
@@ -304,7 +314,8 @@ BinarySpaceTree(
     begin(begin),
     count(count),
     bound(parent->Dataset()->n_rows),
-    dataset(&parent->Dataset())
+    dataset(&parent->Dataset()),
+    compact(NULL)
 {
   // Hopefully the vector is initialized correctly!  We can't check that
   // entirely but we can do a minor sanity check.
@@ -345,7 +356,8 @@ BinarySpaceTree(
     parentDistance(other.parentDistance),
     furthestDescendantDistance(other.furthestDescendantDistance),
     // Copy matrix, but only if we are the root.
-    dataset((other.parent == NULL) ? new MatType(*other.dataset) : NULL)
+    dataset((other.parent == NULL) ? new MatType(*other.dataset) : NULL),
+    compact(NULL)
 {
   // Create left and right children (if any).
   if (other.Left())
@@ -403,12 +415,14 @@ BinarySpaceTree(BinarySpaceTree&& other) :
     parentDistance(other.parentDistance),
     furthestDescendantDistance(other.furthestDescendantDistance),
     minimumBoundDistance(other.minimumBoundDistance),
-    dataset(other.dataset)
+    dataset(other.dataset),
+    compact(other.compact)
 {
   // Now we are a clone of the other tree.  But we must also clear the other
   // tree's contents, so it doesn't delete anything when it is destructed.
   other.left = NULL;
   other.right = NULL;
+  other.compact = NULL;
   other.begin = 0;
   other.count = 0;
   other.parentDistance = 0.0;
@@ -452,10 +466,19 @@ template<typename MetricType,
 BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
   ~BinarySpaceTree()
 {
-  if (left)
-    delete left;
-  if (right)
-    delete right;
+  // The nodes of a compact tree are deleted together (the children of each may
+  // have been changed by an algorithm).
+  if (compact)
+  {
+    DeleteCompact(compact);
+  }
+  else
+  {
+    if (left)
+      delete left;
+    if (right)
+      delete right;
+  }
 
   // If we're the root, delete the matrix.
   if (!parent)
@@ -640,8 +663,7 @@ void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
               SplitType<BoundType<MetricType>, MatType>& splitter)
 {
   // We need to expand the bounds of this node properly.
-  if (count > 0)
-    bound |= dataset->cols(begin, begin + count - 1);
+  ExpandBound(bound, *dataset, begin, count);
 
   // Calculate the furthest descendant distance.
   furthestDescendantDistance = 0.5 * bound.Diameter();
@@ -666,11 +688,30 @@ void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
     return;
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
-  left = new BinarySpaceTree(this, begin, splitCol - begin, splitter,
-      maxLeafSize);
-  right = new BinarySpaceTree(this, splitCol, begin + count - splitCol,
-      splitter, maxLeafSize);
+  // by calling their constructors (which perform this splitting process).  The
+  // children of large nodes are built at the same time, the left one by a task
+  // with its own copy of the splitter; they hold different points, so the
+  // result is the same.
+  if (BuildInParallel(count, parallelChildPoints))
+  {
+    SplitType<BoundType<MetricType>, MatType> leftSplitter(splitter);
+    util::TaskGroup children;
+    children.Run([&]()
+    {
+      left = new BinarySpaceTree(this, begin, splitCol - begin, leftSplitter,
+          maxLeafSize);
+    });
+    right = new BinarySpaceTree(this, splitCol, begin + count - splitCol,
+        splitter, maxLeafSize);
+    children.Wait();
+  }
+  else
+  {
+    left = new BinarySpaceTree(this, begin, splitCol - begin, splitter,
+        maxLeafSize);
+    right = new BinarySpaceTree(this, splitCol, begin + count - splitCol,
+        splitter, maxLeafSize);
+  }
 
   // Calculate parent distances for those two nodes.
   arma::vec center, leftCenter, rightCenter;
@@ -698,8 +739,7 @@ SplitNode(std::vector<size_t>& oldFromNew,
 {
   // This should be a single function for Bound.
   // We need to expand the bounds of this node properly.
-  if (count > 0)
-    bound |= dataset->cols(begin, begin + count - 1);
+  ExpandBound(bound, *dataset, begin, count);
 
   // Calculate the furthest descendant distance.
   furthestDescendantDistance = 0.5 * bound.Diameter();
@@ -724,11 +764,29 @@ SplitNode(std::vector<size_t>& oldFromNew,
     return;
 
   // Now that we know the split column, we will recursively split the children
-  // by calling their constructors (which perform this splitting process).
-  left = new BinarySpaceTree(this, begin, splitCol - begin, oldFromNew,
-      splitter, maxLeafSize);
-  right = new BinarySpaceTree(this, splitCol, begin + count - splitCol,
-      oldFromNew, splitter, maxLeafSize);
+  // by calling their constructors (which perform this splitting process).  The
+  // children of large nodes are built at the same time, as above; each updates
+  // only its own part of oldFromNew.
+  if (BuildInParallel(count, parallelChildPoints))
+  {
+    SplitType<BoundType<MetricType>, MatType> leftSplitter(splitter);
+    util::TaskGroup children;
+    children.Run([&]()
+    {
+      left = new BinarySpaceTree(this, begin, splitCol - begin, oldFromNew,
+          leftSplitter, maxLeafSize);
+    });
+    right = new BinarySpaceTree(this, splitCol, begin + count - splitCol,
+        oldFromNew, splitter, maxLeafSize);
+    children.Wait();
+  }
+  else
+  {
+    left = new BinarySpaceTree(this, begin, splitCol - begin, oldFromNew,
+        splitter, maxLeafSize);
+    right = new BinarySpaceTree(this, splitCol, begin + count - splitCol,
+        oldFromNew, splitter, maxLeafSize);
+  }
 
   // Calculate parent distances for those two nodes.
   arma::vec center, leftCenter, rightCenter;
@@ -743,6 +801,239 @@ SplitNode(std::vector<size_t>& oldFromNew,
   right->ParentDistance() = rightParentDistance;
 }
 
+//! The storage of the nodes of a compact tree.
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+struct BinarySpaceTree<MetricType, StatisticType, MatType, BoundType,
+                       SplitType>::CompactStorage
+{
+  //! The nodes other than the root, constructed in place.
+  BinarySpaceTree* nodes;
+  //! The number of nodes (other than the root).
+  size_t numNodes;
+  //! The ranges of the bounds of all the nodes, if they are HRectBounds.
+  std::vector<math::Range> ranges;
+};
+
+//! Return the number of ranges needed to store the ranges of a bound with
+//! those of other bounds; only HRectBound ranges are stored together, and
+//! other bounds keep their own storage.
+template<typename BoundType>
+size_t CompactRanges(const BoundType& /* bound */) { return 0; }
+
+//! Return the number of ranges of an HRectBound.
+template<typename MetricType>
+size_t CompactRanges(const bound::HRectBound<MetricType>& bound)
+{
+  return bound.Dim();
+}
+
+//! Move the ranges of a bound to the given storage (if they can be).
+template<typename BoundType>
+void CompactBound(BoundType& /* bound */, math::Range* /* storage */) { }
+
+//! Move the ranges of an HRectBound to the given storage.
+template<typename MetricType>
+void CompactBound(bound::HRectBound<MetricType>& bound, math::Range* storage)
+{
+  bound.SetStorage(storage);
+}
+
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
+    Compact(const CompactOrder order)
+{
+  Log::Assert(parent == NULL, "BinarySpaceTree::Compact(): only the root of a "
+      "tree can be compacted.");
+
+  // Find the order of the nodes; the first is this node, which stays here.
+  std::vector<BinarySpaceTree*> nodes;
+  if (order == DEPTH_FIRST)
+    DepthFirstOrder(this, nodes);
+  else
+    VanEmdeBoasOrder(this, Levels(this), nodes);
+
+  // The children of each node are found by their old address.
+  std::unordered_map<const BinarySpaceTree*, BinarySpaceTree*> newNodes;
+  newNodes[this] = this;
+
+  CompactStorage* storage = new CompactStorage();
+  storage->numNodes = nodes.size() - 1;
+  storage->nodes = (BinarySpaceTree*) ::operator new(storage->numNodes *
+      sizeof(BinarySpaceTree));
+  for (size_t i = 1; i < nodes.size(); ++i)
+  {
+    new (storage->nodes + i - 1) BinarySpaceTree(std::move(*nodes[i]));
+    newNodes[nodes[i]] = storage->nodes + i - 1;
+  }
+
+  // Now link the moved nodes, and store their bounds together.
+  size_t ranges = 0;
+  for (size_t i = 0; i < nodes.size(); ++i)
+    ranges += CompactRanges(newNodes[nodes[i]]->bound);
+  storage->ranges.resize(ranges);
+
+  ranges = 0;
+  for (size_t i = 0; i < nodes.size(); ++i)
+  {
+    BinarySpaceTree* node = newNodes[nodes[i]];
+    if (node->left)
+      node->left = newNodes[node->left];
+    if (node->right)
+      node->right = newNodes[node->right];
+    if (node->parent)
+      node->parent = newNodes[node->parent];
+
+    const size_t nodeRanges = CompactRanges(node->bound);
+    if (nodeRanges > 0)
+      CompactBound(node->bound, &storage->ranges[ranges]);
+    ranges += nodeRanges;
+  }
+
+  // The old nodes are empty (they were moved), and can be deleted.
+  if (compact)
+  {
+    DeleteCompact(compact);
+  }
+  else
+  {
+    for (size_t i = 1; i < nodes.size(); ++i)
+      delete nodes[i];
+  }
+  compact = storage;
+}
+
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
+    DepthFirstOrder(BinarySpaceTree* node,
+                    std::vector<BinarySpaceTree*>& order)
+{
+  order.push_back(node);
+  if (node->left)
+    DepthFirstOrder(node->left, order);
+  if (node->right)
+    DepthFirstOrder(node->right, order);
+}
+
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
+    VanEmdeBoasOrder(BinarySpaceTree* node,
+                     const size_t levels,
+                     std::vector<BinarySpaceTree*>& order)
+{
+  if (levels == 1)
+  {
+    order.push_back(node);
+    return;
+  }
+
+  // Store the top half of the levels, then each subtree below them (they may
+  // have fewer levels, if the tree is not balanced).
+  const size_t topLevels = levels / 2;
+  VanEmdeBoasOrder(node, topLevels, order);
+
+  std::vector<BinarySpaceTree*> bottom;
+  NodesAtDepth(node, topLevels, bottom);
+  for (size_t i = 0; i < bottom.size(); ++i)
+    VanEmdeBoasOrder(bottom[i], levels - topLevels, order);
+}
+
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
+    NodesAtDepth(BinarySpaceTree* node,
+                 const size_t depth,
+                 std::vector<BinarySpaceTree*>& nodes)
+{
+  if (depth == 0)
+  {
+    nodes.push_back(node);
+    return;
+  }
+
+  if (node->left)
+    NodesAtDepth(node->left, depth - 1, nodes);
+  if (node->right)
+    NodesAtDepth(node->right, depth - 1, nodes);
+}
+
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+size_t BinarySpaceTree<MetricType, StatisticType, MatType, BoundType,
+                       SplitType>::Levels(const BinarySpaceTree* node)
+{
+  const size_t leftLevels = node->left ? Levels(node->left) : 0;
+  const size_t rightLevels = node->right ? Levels(node->right) : 0;
+  return 1 + std::max(leftLevels, rightLevels);
+}
+
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
+    DeleteCompact(CompactStorage* storage)
+{
+  // The children of each node are in the block, so they are not deleted by the
+  // node.
+  for (size_t i = 0; i < storage->numNodes; ++i)
+  {
+    storage->nodes[i].left = NULL;
+    storage->nodes[i].right = NULL;
+    storage->nodes[i].~BinarySpaceTree();
+  }
+
+  ::operator delete(storage->nodes);
+  delete storage;
+}
+
+template<typename TreeType>
+void CompactTree(TreeType& /* tree */)
+{
+  // Nothing to do.
+}
+
+template<typename MetricType,
+         typename StatisticType,
+         typename MatType,
+         template<typename BoundMetricType> class BoundType,
+         template<typename SplitBoundType, typename SplitMatType>
+             class SplitType>
+void CompactTree(BinarySpaceTree<MetricType, StatisticType, MatType, BoundType,
+                                 SplitType>& tree)
+{
+  tree.Compact();
+}
+
 // Default constructor (private), for boost::serialization.
 template<typename MetricType,
          typename StatisticType,
@@ -760,7 +1051,8 @@ BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
     stat(*this),
     parentDistance(0),
     furthestDescendantDistance(0),
-    dataset(NULL)
+    dataset(NULL),
+    compact(NULL)
 {
   // Nothing to do.
 }
@@ -783,10 +1075,18 @@ void BinarySpaceTree<MetricType, StatisticType, MatType, BoundType, SplitType>::
   // If we're loading, and we have children, they need to be deleted.
   if (Archive::is_loading::value)
   {
-    if (left)
-      delete left;
-    if (right)
-      delete right;
+    if (compact)
+    {
+      DeleteCompact(compact);
+      compact = NULL;
+    }
+    else
+    {
+      if (left)
+        delete left;
+      if (right)
+        delete right;
+    }
     if (!parent)
       delete dataset;
   }
@@ -16,6 +16,7 @@
 #define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_MEAN_SPLIT_IMPL_HPP
 
 #include "mean_split.hpp"
+#include "parallel_build.hpp"
 
 namespace mlpack {
 namespace tree {
@@ -185,6 +186,11 @@ size_t MeanSplit<BoundType, MatType>::
                  const size_t splitDimension,
                  const double splitVal)
 {
+  // Large nodes are split in parallel, which gives the same order.
+  if (BuildInParallel(count, parallelBuildPoints))
+    return PartitionInParallel(data, begin, count, splitDimension, splitVal,
+        NULL);
+
   // This method modifies the input dataset.  We loop both from the left and
   // right sides of the points contained in this node.  The points less than
   // splitVal should be on the left side of the matrix, and the points greater
@@ -232,6 +238,11 @@ size_t MeanSplit<BoundType, MatType>::
                  const double splitVal,
                  std::vector<size_t>& oldFromNew)
 {
+  // Large nodes are split in parallel, which gives the same order.
+  if (BuildInParallel(count, parallelBuildPoints))
+    return PartitionInParallel(data, begin, count, splitDimension, splitVal,
+        &oldFromNew);
+
   // This method modifies the input dataset.  We loop both from the left and
   // right sides of the points contained in this node.  The points less than
   // splitVal should be on the left side of the matrix, and the points greater
@@ -0,0 +1,256 @@
+/**
+ * @file parallel_build.hpp
+ *
+ * Parallel versions of the steps of building a BinarySpaceTree node, used for
+ * the nodes near the root, which hold most of the points: computing the bound
+ * of the node, and partitioning its points.  Both give exactly the result of
+ * the serial code, so the tree does not depend on the number of threads.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_TREE_BINARY_SPACE_TREE_PARALLEL_BUILD_HPP
+#define __MLPACK_CORE_TREE_BINARY_SPACE_TREE_PARALLEL_BUILD_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/core/tree/bound_traits.hpp>
+#include <mlpack/core/util/thread_pool.hpp>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace mlpack {
+namespace tree {
+
+//! Nodes with at least this many points are bounded and partitioned in
+//! parallel.
+const size_t parallelBuildPoints = (1 << 17);
+//! The children of nodes with at least this many points are built in parallel.
+const size_t parallelChildPoints = (1 << 13);
+//! The number of points in each block of the parallel steps.
+const size_t parallelBlockPoints = (1 << 13);
+
+//! Return whether a step on the given number of points should be done in
+//! parallel, given the minimum number of points for it.
+inline bool BuildInParallel(const size_t count, const size_t minimum)
+{
+  return (count >= minimum && util::ThreadPool::Global().Threads() > 1);
+}
+
+//! Expand a bound to contain the given points, in parallel: tight bounds (such
+//! as HRectBound) are the union of the bounds of any blocks of the points.
+template<typename BoundType, typename MatType>
+void ExpandBoundInParallel(BoundType& bound,
+                           const MatType& data,
+                           const size_t begin,
+                           const size_t count,
+                           std::true_type /* tight */)
+{
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  bound |= pool.ParallelReduce(begin, begin + count, parallelBlockPoints,
+      BoundType(data.n_rows), [&](const size_t blockBegin,
+                                  const size_t blockEnd)
+      {
+        BoundType blockBound(data.n_rows);
+        blockBound |= data.cols(blockBegin, blockEnd - 1);
+        return blockBound;
+      },
+      [](BoundType a, const BoundType& b) { return a |= b; });
+}
+
+//! Other bounds (such as BallBound) depend on the order of the points, so they
+//! are computed serially.
+template<typename BoundType, typename MatType>
+void ExpandBoundInParallel(BoundType& bound,
+                           const MatType& data,
+                           const size_t begin,
+                           const size_t count,
+                           std::false_type /* tight */)
+{
+  bound |= data.cols(begin, begin + count - 1);
+}
+
+/**
+ * Expand the bound of a node to contain its points; the bounds of large nodes
+ * are computed in parallel, if that gives the same bound.
+ *
+ * @param bound Bound to expand.
+ * @param data The dataset of the tree.
+ * @param begin Index of the first point of the node.
+ * @param count Number of points of the node.
+ */
+template<typename BoundType, typename MatType>
+void ExpandBound(BoundType& bound,
+                 const MatType& data,
+                 const size_t begin,
+                 const size_t count)
+{
+  if (count == 0)
+    return;
+
+  if (!BuildInParallel(count, parallelBuildPoints))
+  {
+    bound |= data.cols(begin, begin + count - 1);
+    return;
+  }
+
+  ExpandBoundInParallel(bound, data, begin, count,
+      std::integral_constant<bool,
+          bound::BoundTraits<BoundType>::HasTightBounds>());
+}
+
+/**
+ * Partition the points of a node in parallel, so that the points whose value
+ * in dimension splitDimension is less than splitVal come first, exactly as the
+ * serial PerformSplit() of MidpointSplit and MeanSplit do it.  These swap the
+ * k-th point from the left which must go right with the k-th point from the
+ * right which must go left, for each k, so the swaps are independent: the
+ * points going left are counted first (which gives the split column), then
+ * the points on the wrong side of it, by block, and each block of the left
+ * side is swapped with its partners.
+ *
+ * @param data The dataset of the tree.
+ * @param begin Index of the first point of the node.
+ * @param count Number of points of the node.
+ * @param splitDimension The dimension to split the node on.
+ * @param splitVal Points with a smaller value in splitDimension go left.
+ * @param oldFromNew If not NULL, the mapping of points, which is updated.
+ * @return The index of the first point of the right side.
+ */
+template<typename MatType>
+size_t PartitionInParallel(MatType& data,
+                           const size_t begin,
+                           const size_t count,
+                           const size_t splitDimension,
+                           const double splitVal,
+                           std::vector<size_t>* oldFromNew)
+{
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  const size_t end = begin + count;
+
+  // Count the points going left.
+  const size_t splitCol = begin + pool.ParallelReduce(begin, end,
+      parallelBlockPoints, (size_t) 0, [&](const size_t blockBegin,
+                                           const size_t blockEnd)
+      {
+        size_t left = 0;
+        for (size_t i = blockBegin; i < blockEnd; ++i)
+          if (data(splitDimension, i) < splitVal)
+            ++left;
+        return left;
+      },
+      [](const size_t a, const size_t b) { return a + b; });
+
+  // The left side is divided in blocks from begin, and the right side in
+  // blocks from end, going down.  Count the points on the wrong side in each
+  // block; wrongLeft[b] and wrongRight[b] are then the numbers before block b.
+  const size_t leftBlocks = (splitCol - begin + parallelBlockPoints - 1) /
+      parallelBlockPoints;
+  const size_t rightBlocks = (end - splitCol + parallelBlockPoints - 1) /
+      parallelBlockPoints;
+  std::vector<size_t> wrongLeft(leftBlocks + 1, 0);
+  std::vector<size_t> wrongRight(rightBlocks + 1, 0);
+  pool.ParallelFor(0, leftBlocks + rightBlocks, 1, [&](const size_t first,
+                                                        const size_t last)
+  {
+    for (size_t b = first; b < last; ++b)
+    {
+      if (b < leftBlocks)
+      {
+        const size_t blockEnd = std::min(splitCol, begin + (b + 1) *
+            parallelBlockPoints);
+        size_t wrong = 0;
+        for (size_t i = begin + b * parallelBlockPoints; i < blockEnd; ++i)
+          if (!(data(splitDimension, i) < splitVal))
+            ++wrong;
+        wrongLeft[b + 1] = wrong;
+      }
+      else
+      {
+        const size_t r = b - leftBlocks;
+        const size_t blockBegin = (end - splitCol > (r + 1) *
+            parallelBlockPoints) ? end - (r + 1) * parallelBlockPoints :
+            splitCol;
+        size_t wrong = 0;
+        for (size_t i = blockBegin; i < end - r * parallelBlockPoints; ++i)
+          if (data(splitDimension, i) < splitVal)
+            ++wrong;
+        wrongRight[r + 1] = wrong;
+      }
+    }
+  });
+  for (size_t b = 0; b < leftBlocks; ++b)
+    wrongLeft[b + 1] += wrongLeft[b];
+  for (size_t r = 0; r < rightBlocks; ++r)
+    wrongRight[r + 1] += wrongRight[r];
+  Log::Assert(wrongLeft[leftBlocks] == wrongRight[rightBlocks]);
+
+  // Find the partner of the first wrong point of each left block, before any
+  // point is moved.
+  std::vector<size_t> partners(leftBlocks);
+  pool.ParallelFor(0, leftBlocks, 1, [&](const size_t first,
+                                         const size_t last)
+  {
+    for (size_t b = first; b < last; ++b)
+    {
+      const size_t rank = wrongLeft[b];
+      if (wrongLeft[b + 1] == rank)
+        continue;
+
+      // The partner is in right block r, after skip other wrong points.
+      const size_t r = std::upper_bound(wrongRight.begin(), wrongRight.end(),
+          rank) - wrongRight.begin() - 1;
+      size_t skip = rank - wrongRight[r];
+      size_t i = end - r * parallelBlockPoints - 1;
+      while (true)
+      {
+        if (data(splitDimension, i) < splitVal)
+        {
+          if (skip == 0)
+            break;
+          --skip;
+        }
+        --i;
+      }
+      partners[b] = i;
+    }
+  });
+
+  // Now swap each wrong point of the left side with its partner.
+  pool.ParallelFor(0, leftBlocks, 1, [&](const size_t first,
+                                         const size_t last)
+  {
+    for (size_t b = first; b < last; ++b)
+    {
+      if (wrongLeft[b + 1] == wrongLeft[b])
+        continue;
+
+      size_t partner = partners[b];
+      const size_t blockEnd = std::min(splitCol, begin + (b + 1) *
+          parallelBlockPoints);
+      for (size_t i = begin + b * parallelBlockPoints; i < blockEnd; ++i)
+      {
+        if (data(splitDimension, i) < splitVal)
+          continue;
+
+        while (!(data(splitDimension, partner) < splitVal))
+          --partner;
+        data.swap_cols(i, partner);
+        if (oldFromNew != NULL)
+          std::swap((*oldFromNew)[i], (*oldFromNew)[partner]);
+        --partner;
+      }
+    }
+  });
+
+  return splitCol;
+}
+
+} // namespace tree
+} // namespace mlpack
+
+#endif
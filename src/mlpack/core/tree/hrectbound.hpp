@@ -88,6 +88,15 @@ class HRectBound
    */
   void Clear();
 
+  /**
+   * Move the range of each dimension to the given memory, which must hold Dim()
+   * ranges, and which the bound will not free: it must be freed after the
+   * bound.  This is used to store the bounds of the nodes of a tree together.
+   *
+   * @param storage Memory for the ranges of the bound.
+   */
+  void SetStorage(math::Range* storage);
+
   //! Gets the dimensionality.
   size_t Dim() const { return dim; }
 
@@ -204,6 +213,8 @@ class HRectBound
   size_t dim;
   //! The bounds for each dimension.
   math::Range* bounds;
+  //! Whether bounds was allocated by this bound (see SetStorage()).
+  bool ownsBounds;
   //! Cached minimum width of bound.
   double minWidth;
 };
@@ -31,6 +31,7 @@ template<typename MetricType>
 inline HRectBound<MetricType>::HRectBound() :
     dim(0),
     bounds(NULL),
+    ownsBounds(true),
     minWidth(0)
 { /* Nothing to do. */ }
 
@@ -42,6 +43,7 @@ template<typename MetricType>
 inline HRectBound<MetricType>::HRectBound(const size_t dimension) :
     dim(dimension),
     bounds(new math::Range[dim]),
+    ownsBounds(true),
     minWidth(0)
 { /* Nothing to do. */ }
 
@@ -52,6 +54,7 @@ template<typename MetricType>
 inline HRectBound<MetricType>::HRectBound(const HRectBound& other) :
     dim(other.Dim()),
     bounds(new math::Range[dim]),
+    ownsBounds(true),
     minWidth(other.MinWidth())
 {
   // Copy other bounds over.
@@ -69,11 +72,12 @@ inline HRectBound<MetricType>& HRectBound<MetricType>::operator=(
   if (dim != other.Dim())
   {
     // Reallocation is necessary.
-    if (bounds)
+    if (bounds && ownsBounds)
       delete[] bounds;
 
     dim = other.Dim();
     bounds = new math::Range[dim];
+    ownsBounds = true;
   }
 
   // Now copy each of the bound values.
@@ -92,11 +96,13 @@ template<typename MetricType>
 inline HRectBound<MetricType>::HRectBound(HRectBound&& other) :
     dim(other.dim),
     bounds(other.bounds),
+    ownsBounds(other.ownsBounds),
     minWidth(other.minWidth)
 {
   // Fix the other bound.
   other.dim = 0;
   other.bounds = NULL;
+  other.ownsBounds = true;
   other.minWidth = 0.0;
 }
 
@@ -106,10 +112,25 @@ inline HRectBound<MetricType>::HRectBound(HRectBound&& other) :
 template<typename MetricType>
 inline HRectBound<MetricType>::~HRectBound()
 {
-  if (bounds)
+  if (bounds && ownsBounds)
     delete[] bounds;
 }
 
+/**
+ * Move the ranges to memory which is not owned by the bound.
+ */
+template<typename MetricType>
+inline void HRectBound<MetricType>::SetStorage(math::Range* storage)
+{
+  for (size_t i = 0; i < dim; i++)
+    storage[i] = bounds[i];
+
+  if (bounds && ownsBounds)
+    delete[] bounds;
+  bounds = storage;
+  ownsBounds = false;
+}
+
 /**
  * Resets all dimensions to the empty set.
  */
@@ -456,9 +477,10 @@ void HRectBound<MetricType>::Serialize(Archive& ar,
   // Allocate memory for the bounds, if necessary.
   if (Archive::is_loading::value)
   {
-    if (bounds)
+    if (bounds && ownsBounds)
       delete[] bounds;
     bounds = new math::Range[dim];
+    ownsBounds = true;
   }
 
   ar & data::CreateArrayNVP(bounds, dim, "bounds");
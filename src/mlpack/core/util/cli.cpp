@@ -15,6 +15,7 @@
 #include <boost/program_options.hpp>
 #include <boost/any.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <fstream>
 #include <iostream>
 #include <string>
 
@@ -22,6 +23,12 @@
 #include "log.hpp"
 
 #include "option.hpp"
+#include "perf_counters.hpp"
+#include "thread_pool.hpp"
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 using namespace mlpack;
 using namespace mlpack::util;
@@ -62,14 +69,7 @@ CLI::CLI(const CLI& other) : desc(other.desc),
 CLI::~CLI()
 {
   // Terminate the program timers.
-  std::map<std::string, timeval>::iterator it;
-  for (it = timer.GetAllTimers().begin(); it != timer.GetAllTimers().end();
-       ++it)
-  {
-    std::string i = (*it).first;
-    if (timer.GetState(i) == 1)
-      Timer::Stop(i);
-  }
+  timer.StopAllTimers();
 
   // Did the user ask for verbose output?  If so we need to print everything.
   // But only if the user did not ask for help or info.
@@ -79,23 +79,34 @@ CLI::~CLI()
     Print();
 
     Log::Info << "Program timers:" << std::endl;
-    std::map<std::string, timeval>::iterator it;
-    for (it = timer.GetAllTimers().begin(); it != timer.GetAllTimers().end();
-        ++it)
+    const std::vector<std::string> names = timer.GetAllTimers();
+    for (size_t i = 0; i < names.size(); ++i)
     {
-      std::string i = (*it).first;
-      Log::Info << "  " << i << ": ";
-      timer.PrintTimer((*it).first);
+      Log::Info << "  " << names[i] << ": ";
+      timer.PrintTimer(names[i]);
     }
   }
 
+  // Save the timers, if the user asked for it.
+  if (HasParam("timers_file") && !HasParam("help") && !HasParam("info"))
+  {
+    const std::string& timersFile = GetParam<std::string>("timers_file");
+    std::ofstream stream(timersFile.c_str());
+    if (stream.is_open())
+      timer.SaveJSON(stream);
+    else
+      Log::Warn << "Cannot open file '" << timersFile << "' to save timers."
+          << std::endl;
+  }
+
   // Notify the user if we are debugging, but only if we actually parsed the
   // options.  This way this output doesn't show up inexplicably for someone who
   // may not have wanted it there (i.e. in Boost unit tests).
   if (didParse)
     Log::Debug << "Compiled with debugging symbols." << std::endl;
 
-  return;
+  // Write the rest of the output, and stop the background writer.
+  LogSink::Global().Stop();
 }
 
 /**
@@ -238,6 +249,38 @@ void CLI::DefaultMessages()
     Log::Info.ignoreInput = false;
   }
 
+  // Size the thread pool, and give OpenMP the same number of threads, so that
+  // code using either does not oversubscribe the machine.
+  if (HasParam("threads") || HasParam("pin_threads"))
+  {
+    const int threads = GetParam<int>("threads");
+    if (threads < 0)
+      Log::Fatal << "Invalid number of threads (" << threads << ")!  Must be "
+          << "0 (use all cores) or greater." << std::endl;
+
+    ThreadPool::Configure((size_t) threads, HasParam("pin_threads"));
+    const size_t poolThreads = ThreadPool::Global().Threads();
+#ifdef _OPENMP
+    omp_set_num_threads((int) poolThreads);
+#endif
+    Log::Info << "Using " << poolThreads << " threads"
+        << (ThreadPool::Global().Pinned() ? ", pinned to CPUs." : ".")
+        << std::endl;
+  }
+
+  // Count hardware events in every timer started from now on.
+  if (HasParam("perf_counters"))
+  {
+    PerfCounters::Enabled() = true;
+    if (!PerfCounters::Supported())
+      Log::Warn << "Hardware performance counters are not available; timers "
+          << "will not count hardware events.  (On Linux, check "
+          << "/proc/sys/kernel/perf_event_paranoid.)" << std::endl;
+  }
+
+  // From now on, log output is written in the background.
+  LogSink::Global().Start();
+
   // Notify the user if we are debugging.  This is not done in the constructor
   // because the output streams may not be set up yet.  We also don't want this
   // message twice if the user just asked for help or information.
@@ -762,3 +805,12 @@ PARAM_STRING("info", "Get help on a specific module or option.", "", "");
 PARAM_FLAG("verbose", "Display informational messages and the full list of "
     "parameters and timers at the end of execution.", "v");
 PARAM_FLAG("version", "Display the version of mlpack.", "V");
+PARAM_STRING("timers_file", "If specified, save the timers to this file as "
+    "JSON.", "", "");
+PARAM_FLAG("perf_counters", "Count hardware events (cycles, instructions, cache "
+    "misses, and floating-point operations) in every timer, where the system "
+    "supports it.", "");
+PARAM_INT("threads", "Number of threads to use (0 uses all cores, or the value "
+    "of OMP_NUM_THREADS).", "", 0);
+PARAM_FLAG("pin_threads", "Pin each thread of the thread pool to its own CPU.  "
+    "To pin OpenMP threads, set OMP_PROC_BIND instead.", "");
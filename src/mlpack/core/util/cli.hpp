@@ -705,6 +705,8 @@ class CLI
 
   //! So that Timer::Start() and Timer::Stop() can access the timer variable.
   friend class Timer;
+  //! So that ScopedTimer can access the timer variable.
+  friend class ScopedTimer;
 
  public:
   //! Pointer to the ProgramDoc object.
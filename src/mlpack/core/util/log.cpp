@@ -41,22 +41,33 @@ using namespace mlpack;
 using namespace mlpack::util;
 
 // Only output debugging output if in debug mode.
-#ifdef DEBUG
+#if defined(DEBUG) && (MLPACK_LOG_LEVEL < 1)
 PrefixedOutStream Log::Debug = PrefixedOutStream(std::cout,
-    BASH_CYAN "[DEBUG] " BASH_CLEAR);
+    BASH_CYAN "[DEBUG] " BASH_CLEAR, false, false, &LogSink::Global());
 #else
 NullOutStream Log::Debug = NullOutStream();
 #endif
 
+#if (MLPACK_LOG_LEVEL < 2)
 PrefixedOutStream Log::Info = PrefixedOutStream(std::cout,
-    BASH_GREEN "[INFO ] " BASH_CLEAR, true /* unless --verbose */, false);
+    BASH_GREEN "[INFO ] " BASH_CLEAR, true /* unless --verbose */, false,
+    &LogSink::Global());
+#else
+NullOutStream Log::Info = NullOutStream();
+#endif
 PrefixedOutStream Log::Warn = PrefixedOutStream(std::cout,
-    BASH_YELLOW "[WARN ] " BASH_CLEAR, false, false);
+    BASH_YELLOW "[WARN ] " BASH_CLEAR, false, false, &LogSink::Global());
 PrefixedOutStream Log::Fatal = PrefixedOutStream(std::cerr,
-    BASH_RED "[FATAL] " BASH_CLEAR, false, true /* fatal */);
+    BASH_RED "[FATAL] " BASH_CLEAR, false, true /* fatal */,
+    &LogSink::Global());
 
 std::ostream& Log::cout = std::cout;
 
+void Log::Flush()
+{
+  LogSink::Global().Flush();
+}
+
 // Only do anything for Assert() if in debugging mode.
 #ifdef DEBUG
 void Log::Assert(bool condition, const std::string& message)
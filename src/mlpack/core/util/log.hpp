@@ -18,6 +18,19 @@
 
 #include "prefixedoutstream.hpp"
 #include "nulloutstream.hpp"
+#include "log_sink.hpp"
+
+/**
+ * The least severe level of Log output that is compiled in: 0 keeps all of it
+ * (Log::Debug is still only kept in debug builds), 1 removes Log::Debug, and 2
+ * removes Log::Info too.  Removed levels are NullOutStreams, so that the output
+ * sent to them is not even formatted.  mlpack and the programs using it must be
+ * compiled with the same level; the MLPACK_LOG_LEVEL CMake option sets it for
+ * the whole build (for instance, cmake -DMLPACK_LOG_LEVEL=2).
+ */
+#ifndef MLPACK_LOG_LEVEL
+  #define MLPACK_LOG_LEVEL 0
+#endif
 
 namespace mlpack {
 
@@ -50,7 +63,13 @@ namespace mlpack {
  *
  * Any messages sent to Log::Debug will not be shown when compiling in non-debug
  * mode.  Messages to Log::Info will only be shown when the --verbose flag is
- * given to the program (or rather, the CLI class).
+ * given to the program (or rather, the CLI class).  Levels below
+ * MLPACK_LOG_LEVEL are compiled out entirely.
+ *
+ * The lines of Log::Debug, Log::Info and Log::Warn are written by
+ * util::LogSink::Global(), which mlpack programs run in the background, so
+ * logging from several threads, or in loops, is cheap and safe.  Call Flush()
+ * before writing to std::cout directly.
  *
  * @see PrefixedOutStream, NullOutStream, CLI
  */
@@ -66,9 +85,12 @@ class Log
                      const std::string& message = "Assert Failed.");
 
 
+  //! Write the lines queued by the Log streams.
+  static void Flush();
+
   // We only use PrefixedOutStream if the program is compiled with debug
   // symbols.
-#ifdef DEBUG
+#if defined(DEBUG) && (MLPACK_LOG_LEVEL < 1)
   //! Prints debug output with the appropriate tag: [DEBUG].
   static util::PrefixedOutStream Debug;
 #else
@@ -76,9 +98,14 @@ class Log
   static util::NullOutStream Debug;
 #endif
 
+#if (MLPACK_LOG_LEVEL < 2)
   //! Prints informational messages if --verbose is specified, prefixed with
   //! [INFO ].
   static util::PrefixedOutStream Info;
+#else
+  //! Dumps informational messages, which are compiled out.
+  static util::NullOutStream Info;
+#endif
 
   //! Prints warning messages prefixed with [WARN ].
   static util::PrefixedOutStream Warn;
@@ -0,0 +1,280 @@
+/**
+ * @file log_sink.cpp
+ *
+ * Implementation of LogSink.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "log_sink.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+namespace {
+
+//! The identifier of the last sink created.
+std::atomic<uint64_t> lastId(0);
+
+//! Whether the queues of the calling thread have been destroyed (the main
+//! thread's are destroyed before static objects, at exit).
+thread_local bool threadExited = false;
+
+//! Stop the global sink, at exit.
+void StopGlobal()
+{
+  LogSink::Global().Stop();
+}
+
+} // anonymous namespace
+
+//! The lines queued by one thread.  Only the thread adds lines (at tail), and
+//! only the thread holding drainMutex removes them (at head).
+struct LogSink::Queue
+{
+  Queue() : head(0), tail(0), closed(false) { }
+
+  //! The number of lines the queue can hold.
+  static const size_t capacity = 256;
+
+  //! A queued line.
+  struct Line
+  {
+    Line() : destination(NULL) { }
+
+    std::ostream* destination;
+    std::string text;
+  };
+
+  //! The lines, used as a ring.
+  Line lines[capacity];
+  //! The number of lines removed so far.
+  std::atomic<size_t> head;
+  //! The number of lines added so far.
+  std::atomic<size_t> tail;
+  //! Set when the thread has exited.
+  std::atomic<bool> closed;
+};
+
+LogSink::LogSink() :
+    pending(false),
+    running(false),
+    stopping(false),
+    id(++lastId)
+{
+  // Nothing to do.
+}
+
+LogSink::~LogSink()
+{
+  Stop();
+}
+
+void LogSink::Start()
+{
+  if (running.load())
+    return;
+
+  running.store(true);
+  writer = std::thread(&LogSink::Run, this);
+}
+
+void LogSink::Stop()
+{
+  if (!running.exchange(false))
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    stopping.store(true);
+  }
+  wake.notify_one();
+  writer.join();
+  stopping.store(false);
+
+  // Lines queued while the writer was stopping are written now.
+  Flush();
+}
+
+void LogSink::Write(std::ostream& destination, std::string& line)
+{
+  Queue* queue = running.load() ? LocalQueue() : NULL;
+  if (queue == NULL)
+  {
+    // The lines queued before are written first.
+    std::lock_guard<std::mutex> lock(drainMutex);
+    Drain();
+    destination << line << std::flush;
+    line.clear();
+    return;
+  }
+
+  const size_t tail = queue->tail.load(std::memory_order_relaxed);
+  while (tail - queue->head.load(std::memory_order_acquire) ==
+      Queue::capacity)
+  {
+    // The queue is full, so wait for the writer (or empty it ourselves, if the
+    // sink has been stopped).
+    if (!running.load())
+    {
+      Flush();
+    }
+    else
+    {
+      if (!pending.exchange(true))
+        wake.notify_one();
+      std::this_thread::yield();
+    }
+  }
+
+  // The text of the line is swapped with the (empty) text of the slot, so that
+  // the memory of both is reused.
+  Queue::Line& slot = queue->lines[tail % Queue::capacity];
+  slot.destination = &destination;
+  slot.text.swap(line);
+  line.clear();
+  queue->tail.store(tail + 1);
+
+  if (!running.load())
+  {
+    // The sink was stopped meanwhile, so the line may not have been seen.
+    Flush();
+  }
+  else if (!pending.exchange(true))
+  {
+    wake.notify_one();
+  }
+}
+
+void LogSink::Flush()
+{
+  std::lock_guard<std::mutex> lock(drainMutex);
+  Drain();
+}
+
+LogSink& LogSink::Global()
+{
+  // The Log streams may be used by the destructors of static objects, so the
+  // sink is never destroyed; its lines are written when the program exits.
+  static LogSink* sink = NULL;
+  static std::once_flag created;
+  std::call_once(created, []()
+  {
+    sink = new LogSink();
+    std::atexit(StopGlobal);
+  });
+
+  return *sink;
+}
+
+LogSink::Queue* LogSink::LocalQueue()
+{
+  //! The queues of the calling thread (one for each sink it has used), which
+  //! are closed when it exits.
+  struct LocalQueues
+  {
+    ~LocalQueues()
+    {
+      for (size_t i = 0; i < queues.size(); ++i)
+        queues[i].second->closed.store(true);
+      threadExited = true;
+    }
+
+    std::vector<std::pair<uint64_t, std::shared_ptr<Queue> > > queues;
+  };
+
+  if (threadExited)
+    return NULL;
+
+  thread_local LocalQueues local;
+  for (size_t i = 0; i < local.queues.size(); ++i)
+    if (local.queues[i].first == id)
+      return local.queues[i].second.get();
+
+  std::shared_ptr<Queue> queue(new Queue());
+  {
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    queues.push_back(queue);
+  }
+  local.queues.push_back(std::make_pair(id, queue));
+
+  return queue.get();
+}
+
+void LogSink::Run()
+{
+  while (true)
+  {
+    pending.store(false);
+    bool wrote;
+    {
+      std::lock_guard<std::mutex> lock(drainMutex);
+      wrote = Drain();
+    }
+
+    if (wrote)
+      continue;
+    if (stopping.load())
+      break;
+
+    // The wait is bounded, in case a notification is missed (threads do not
+    // take wakeMutex to queue lines).
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wake.wait_for(lock, std::chrono::milliseconds(10), [this]()
+    {
+      return pending.load() || stopping.load();
+    });
+  }
+}
+
+bool LogSink::Drain()
+{
+  std::vector<std::shared_ptr<Queue> > current;
+  {
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    current = queues;
+  }
+
+  bool wrote = false;
+  std::vector<std::ostream*> written;
+  for (size_t q = 0; q < current.size(); ++q)
+  {
+    Queue& queue = *current[q];
+
+    // The thread adds no lines once it is closed, so a closed queue is empty
+    // after the lines seen here are written.
+    const bool closed = queue.closed.load();
+    const size_t tail = queue.tail.load(std::memory_order_acquire);
+    for (size_t i = queue.head.load(std::memory_order_relaxed); i != tail; ++i)
+    {
+      Queue::Line& line = queue.lines[i % Queue::capacity];
+      line.destination->write(line.text.data(), line.text.size());
+      if (std::find(written.begin(), written.end(), line.destination) ==
+          written.end())
+        written.push_back(line.destination);
+      line.text.clear();
+      wrote = true;
+    }
+    queue.head.store(tail, std::memory_order_release);
+
+    if (closed)
+    {
+      std::lock_guard<std::mutex> lock(queuesMutex);
+      queues.erase(std::remove(queues.begin(), queues.end(), current[q]),
+          queues.end());
+    }
+  }
+
+  for (size_t i = 0; i < written.size(); ++i)
+    written[i]->flush();
+
+  return wrote;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file log_sink.hpp
+ *
+ * An asynchronous sink for the lines written to the Log streams: each thread
+ * queues its lines without locking, and a background thread writes them.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_UTIL_LOG_SINK_HPP
+#define __MLPACK_CORE_UTIL_LOG_SINK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * A sink for complete lines of log output.  While the sink is running, each
+ * thread puts its lines in its own bounded queue, which is lock-free (there is
+ * one writer, the thread, and one reader), and a background thread writes the
+ * queued lines to their streams; a thread only waits if its queue is full.
+ * The lines of one thread are written in order, and lines are never
+ * interleaved, but lines of different threads are only ordered approximately.
+ * While the sink is stopped, lines are written by the calling thread.
+ *
+ * Log::Info, Log::Warn and Log::Debug send their lines to the Global() sink,
+ * which CLI starts once the options of a program are parsed and stops when
+ * the program ends; Log::Fatal calls Flush() and then writes directly, so that
+ * the fatal error is the last line shown.  Code which writes to std::cout
+ * directly, while the sink may hold lines for it, should call Flush() first.
+ */
+class LogSink
+{
+ public:
+  //! Create a stopped sink.
+  LogSink();
+
+  //! Stop the sink, writing the queued lines.
+  ~LogSink();
+
+  //! Start the background writer, if it is not running.
+  void Start();
+
+  //! Write the queued lines and stop the background writer, if it is running.
+  void Stop();
+
+  //! Return whether the background writer is running.
+  bool Running() const { return running.load(); }
+
+  /**
+   * Write a line (which should end with a newline) to the given stream: the
+   * line is queued if the sink is running, and written now otherwise.  The
+   * contents of line are taken, and it is left empty.
+   *
+   * @param destination Stream to write the line to.
+   * @param line The line.
+   */
+  void Write(std::ostream& destination, std::string& line);
+
+  //! Write the queued lines now, in the calling thread.
+  void Flush();
+
+  //! Get the sink used by the Log streams.  It is never destroyed, so it can
+  //! be used until the program exits.
+  static LogSink& Global();
+
+ private:
+  //! The queue of lines of one thread.
+  struct Queue;
+
+  //! Get the queue of the calling thread, creating it if necessary; NULL is
+  //! returned if the thread is exiting.
+  Queue* LocalQueue();
+
+  //! The loop of the background writer.
+  void Run();
+
+  //! Write the queued lines, and remove the queues of threads that exited.
+  //! drainMutex must be held.
+  //!
+  //! @return Whether any line was written.
+  bool Drain();
+
+  //! The queue of each thread that has written lines.
+  std::vector<std::shared_ptr<Queue> > queues;
+  //! Lock for queues.
+  std::mutex queuesMutex;
+  //! Lock held while lines are taken from the queues (there must be only one
+  //! reader), or written directly.
+  std::mutex drainMutex;
+
+  //! The background writer.
+  std::thread writer;
+  //! Lock for the background writer to wait on.
+  std::mutex wakeMutex;
+  //! Signalled when lines are queued, or the sink is stopping.
+  std::condition_variable wake;
+  //! Set when lines have been queued since the writer last woke.
+  std::atomic<bool> pending;
+  //! Whether the sink is running.
+  std::atomic<bool> running;
+  //! Set while the background writer is being stopped.
+  std::atomic<bool> stopping;
+  //! Unique identifier of this sink.
+  uint64_t id;
+
+  //! The sink cannot be copied.
+  LogSink(const LogSink& other);
+  LogSink& operator=(const LogSink& other);
+};
+
+} // namespace util
+} // namespace mlpack
+
+#endif
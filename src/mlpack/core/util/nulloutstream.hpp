@@ -23,8 +23,9 @@ namespace mlpack {
 namespace util {
 
 /**
- * Used for Log::Debug when not compiled with debugging symbols.  This class
- * does nothing and should be optimized out entirely by the compiler.
+ * Used for Log::Debug when not compiled with debugging symbols, and for the
+ * levels of Log below MLPACK_LOG_LEVEL.  This class does nothing and should be
+ * optimized out entirely by the compiler.
  */
 class NullOutStream
 {
@@ -32,12 +33,12 @@ class NullOutStream
   /**
    * Does nothing.
    */
-  NullOutStream() { }
+  NullOutStream() : ignoreInput(true) { }
 
   /**
    * Does nothing.
    */
-  NullOutStream(const NullOutStream& /* other */) { }
+  NullOutStream(const NullOutStream& /* other */) : ignoreInput(true) { }
 
   //! Does nothing.
   NullOutStream& operator<<(bool) { return *this; }
@@ -78,6 +79,10 @@ class NullOutStream
   //! Does nothing.
   template<typename T>
   NullOutStream& operator<<(const T&) { return *this; }
+
+  //! Has no effect (the output is always discarded); present so that code
+  //! which shows or hides a stream compiles for either kind of stream.
+  bool ignoreInput;
 };
 
 } // namespace util
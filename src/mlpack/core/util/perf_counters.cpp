@@ -0,0 +1,211 @@
+/**
+ * @file perf_counters.cpp
+ *
+ * Implementation of PerfCounters.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "perf_counters.hpp"
+
+#include <cstring>
+
+#ifdef __linux__
+  #include <linux/perf_event.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+  #include <cpuid.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+namespace {
+
+//! The processors whose floating-point events are known.
+enum FloatingPointEvents
+{
+  NONE,
+  INTEL,
+  AMD
+};
+
+//! Find which floating-point events the processor has.
+FloatingPointEvents ProcessorEvents()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(0, &eax, &ebx, &ecx, &edx) == 0)
+    return NONE;
+
+  char vendor[13];
+  std::memcpy(vendor, &ebx, 4);
+  std::memcpy(vendor + 4, &edx, 4);
+  std::memcpy(vendor + 8, &ecx, 4);
+  vendor[12] = '\0';
+
+  if (std::strcmp(vendor, "GenuineIntel") == 0)
+    return INTEL;
+
+  if (std::strcmp(vendor, "AuthenticAMD") == 0 &&
+      __get_cpuid(1, &eax, &ebx, &ecx, &edx) != 0)
+  {
+    // The family is the base family plus the extended family.
+    const unsigned int family = ((eax >> 8) & 0xf) + ((eax >> 20) & 0xff);
+    if (family >= 0x17)
+      return AMD;
+  }
+#endif
+
+  return NONE;
+}
+
+} // anonymous namespace
+
+PerfCounters::PerfCounters()
+{
+#ifdef __linux__
+  Open(CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 1);
+  Open(INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, 1);
+  Open(CACHE_REFERENCES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES,
+      1);
+  Open(CACHE_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, 1);
+
+  // There is no generic event for floating-point operations, so raw events of
+  // the processor are used.
+  switch (ProcessorEvents())
+  {
+    case INTEL:
+      // FP_ARITH_INST_RETIRED (event 0xc7) counts instructions (FMA counts
+      // twice); the unit mask selects the width, and the weight is the number
+      // of operations per instruction.  Masks with the same weight are counted
+      // together, to use fewer hardware counters.
+      Open(FP_OPS, PERF_TYPE_RAW, 0x03c7, 1);  // Scalar single and double.
+      Open(FP_OPS, PERF_TYPE_RAW, 0x04c7, 2);  // 128-bit double.
+      Open(FP_OPS, PERF_TYPE_RAW, 0x18c7, 4);  // 128-bit single, 256-bit double.
+      Open(FP_OPS, PERF_TYPE_RAW, 0x60c7, 8);  // 256-bit single, 512-bit double.
+      Open(FP_OPS, PERF_TYPE_RAW, 0x80c7, 16); // 512-bit single.
+      break;
+
+    case AMD:
+      // RETIRED_SSE_AVX_FLOPS (event 0x03) counts operations directly.
+      Open(FP_OPS, PERF_TYPE_RAW, 0xff03, 1);
+      break;
+
+    case NONE:
+      break;
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+  for (size_t c = 0; c < Count; ++c)
+    for (size_t e = 0; e < events[c].size(); ++e)
+      close(events[c][e].fd);
+#endif
+}
+
+bool PerfCounters::Any() const
+{
+  for (size_t c = 0; c < Count; ++c)
+    if (Available(c))
+      return true;
+
+  return false;
+}
+
+void PerfCounters::Read(uint64_t* values) const
+{
+  for (size_t c = 0; c < Count; ++c)
+  {
+    values[c] = 0;
+#ifdef __linux__
+    for (size_t e = 0; e < events[c].size(); ++e)
+    {
+      // The value, the time the event was enabled, and the time it was
+      // counting; if it was multiplexed, the value is scaled to the whole time.
+      uint64_t data[3];
+      if (read(events[c][e].fd, data, sizeof(data)) != (ssize_t) sizeof(data))
+        continue;
+
+      uint64_t value = data[0];
+      if (data[2] == 0)
+        value = 0;
+      else if (data[2] < data[1])
+        value = (uint64_t) ((double) value * ((double) data[1] /
+            (double) data[2]));
+
+      values[c] += events[c][e].weight * value;
+    }
+#endif
+  }
+}
+
+const char* PerfCounters::Name(const size_t counter)
+{
+  switch (counter)
+  {
+    case CYCLES:
+      return "cycles";
+    case INSTRUCTIONS:
+      return "instructions";
+    case CACHE_REFERENCES:
+      return "cache_references";
+    case CACHE_MISSES:
+      return "cache_misses";
+    case FP_OPS:
+      return "fp_ops";
+    default:
+      return "unknown";
+  }
+}
+
+bool PerfCounters::Supported()
+{
+  const PerfCounters counters;
+  return counters.Any();
+}
+
+void PerfCounters::Open(const size_t counter,
+                        const uint32_t type,
+                        const uint64_t config,
+                        const uint64_t weight)
+{
+#ifdef __linux__
+  perf_event_attr attributes;
+  std::memset(&attributes, 0, sizeof(attributes));
+  attributes.size = sizeof(attributes);
+  attributes.type = type;
+  attributes.config = config;
+  // Only count user space, which unprivileged processes are usually allowed
+  // to do.
+  attributes.exclude_kernel = 1;
+  attributes.exclude_hv = 1;
+  attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  // Count the calling thread, on any CPU.
+  const long fd = syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+  if (fd < 0)
+    return;
+
+  Event event;
+  event.fd = (int) fd;
+  event.weight = weight;
+  events[counter].push_back(event);
+#else
+  (void) counter;
+  (void) type;
+  (void) config;
+  (void) weight;
+#endif
+}
@@ -0,0 +1,119 @@
+/**
+ * @file perf_counters.hpp
+ *
+ * Hardware performance counters of the calling thread, read with the Linux
+ * perf_event interface.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_UTIL_PERF_COUNTERS_HPP
+#define __MLPACK_CORE_UTIL_PERF_COUNTERS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * A set of hardware performance counters which count the events of the thread
+ * that created it: cycles, instructions, cache references and misses (of the
+ * last level cache), and double or single precision floating-point operations.
+ * The counters run from construction on, and Read() gets their current values;
+ * the events of a section of code are the difference between two reads.
+ *
+ * The counters are only available on Linux, and only if the kernel allows it
+ * (see /proc/sys/kernel/perf_event_paranoid); floating-point operations are
+ * only counted on Intel processors with the FP_ARITH_INST_RETIRED events
+ * (Broadwell and newer) and AMD processors of family 17h and newer.  Counters
+ * which are not available read as 0.  When there are more events than hardware
+ * counters, the kernel multiplexes them, and the values are scaled estimates.
+ *
+ * Timers use these counters when Enabled() is set (with the --perf_counters
+ * option of every mlpack program), and report them for every timer.
+ */
+class PerfCounters
+{
+ public:
+  //! The events that are counted.
+  enum Counter
+  {
+    CYCLES = 0,
+    INSTRUCTIONS,
+    CACHE_REFERENCES,
+    CACHE_MISSES,
+    FP_OPS
+  };
+
+  //! Number of counters.
+  static const size_t Count = 5;
+
+  //! Open the counters of the calling thread.
+  PerfCounters();
+
+  //! Close the counters.
+  ~PerfCounters();
+
+  //! Get whether the given counter could be opened.
+  bool Available(const size_t counter) const
+  {
+    return !events[counter].empty();
+  }
+
+  //! Get whether any counter could be opened.
+  bool Any() const;
+
+  /**
+   * Read the current value of each counter (0 for counters which are not
+   * available).
+   *
+   * @param values Array of Count values to fill.
+   */
+  void Read(uint64_t* values) const;
+
+  //! Get the name of a counter, as used in the JSON output of timers.
+  static const char* Name(const size_t counter);
+
+  //! Get whether hardware counters are available in this process.
+  static bool Supported();
+
+  //! Modify whether timers count hardware events (default false).
+  static bool& Enabled()
+  {
+    static bool enabled = false;
+    return enabled;
+  }
+
+ private:
+  //! One open event, and the weight of its counts.
+  struct Event
+  {
+    int fd;
+    uint64_t weight;
+  };
+
+  //! Open an event of the calling thread and add it to the given counter.
+  void Open(const size_t counter,
+            const uint32_t type,
+            const uint64_t config,
+            const uint64_t weight);
+
+  //! The events of each counter; the value of a counter is the weighted sum of
+  //! the counts of its events.
+  std::vector<Event> events[Count];
+
+  //! The counters cannot be copied, since they own their file descriptors.
+  PerfCounters(const PerfCounters& other);
+  PerfCounters& operator=(const PerfCounters& other);
+};
+
+} // namespace util
+} // namespace mlpack
+
+#endif
@@ -20,8 +20,44 @@
 
 #include "prefixedoutstream.hpp"
 
+#include <utility>
+#include <vector>
+
 using namespace mlpack::util;
 
+namespace {
+
+//! Whether the pending lines of the calling thread have been destroyed (the
+//! main thread's are destroyed before static objects, at exit).
+thread_local bool linesDestroyed = false;
+
+//! The lines the calling thread is building, for each stream with a sink.
+struct PendingLines
+{
+  ~PendingLines() { linesDestroyed = true; }
+
+  std::vector<std::pair<const PrefixedOutStream*, std::string> > lines;
+};
+
+thread_local PendingLines pendingLines;
+
+} // anonymous namespace
+
+std::string* PrefixedOutStream::PendingLine() const
+{
+  if (linesDestroyed)
+    return NULL;
+
+  std::vector<std::pair<const PrefixedOutStream*, std::string> >& lines =
+      pendingLines.lines;
+  for (size_t i = 0; i < lines.size(); ++i)
+    if (lines[i].first == this)
+      return &lines[i].second;
+
+  lines.push_back(std::make_pair(this, std::string()));
+  return &lines.back().second;
+}
+
 /**
  * These are all necessary because gcc's template mechanism does not seem smart
  * enough to figure out what I want to pass into operator<< without these.  That
@@ -25,6 +25,7 @@
 #include <boost/utility/enable_if.hpp>
 #include <boost/type_traits.hpp>
 
+#include <mlpack/core/util/log_sink.hpp>
 #include <mlpack/core/util/sfinae_utility.hpp>
 #include <mlpack/core/util/string_util.hpp>
 
@@ -55,6 +56,11 @@ namespace util {
  *
  * These objects are used for the mlpack::Log levels (DEBUG, INFO, WARN, and
  * FATAL).
+ *
+ * If a LogSink is given, each thread builds its own lines, and they are written
+ * by the sink, whole, while it is running; so the stream may be used by several
+ * threads at once.  Fatal streams only flush the sink, before their output.
+ * Output to an ignored stream (other than a fatal one) is not even formatted.
  */
 class PrefixedOutStream
 {
@@ -67,18 +73,21 @@ class PrefixedOutStream
    * @param ignoreInput If true, the stream will not be printed.
    * @param fatal If true, a std::runtime_error exception is thrown after
    *     printing a newline.
+   * @param sink If not NULL, the sink which writes the lines of the stream.
    */
   PrefixedOutStream(std::ostream& destination,
                     const char* prefix,
                     bool ignoreInput = false,
-                    bool fatal = false) :
+                    bool fatal = false,
+                    LogSink* sink = NULL) :
       destination(destination),
       ignoreInput(ignoreInput),
       prefix(prefix),
       // We want the first call to operator<< to prefix the prefix so we set
       // carriageReturned to true.
       carriageReturned(true),
-      fatal(fatal)
+      fatal(fatal),
+      sink(sink)
     { /* nothing to do */ }
 
   //! Write a bool to the stream.
@@ -142,6 +151,12 @@ class PrefixedOutStream
    */
   inline void PrefixIfNeeded();
 
+  /**
+   * Get the line the calling thread is building for this stream, for the sink
+   * (NULL is returned if the thread is exiting).
+   */
+  std::string* PendingLine() const;
+
   //! Contains the prefix we must prepend to each line.
   std::string prefix;
 
@@ -152,6 +167,9 @@ class PrefixedOutStream
   //! If true, a std::runtime_error exception will be thrown when a CR is
   //! encountered.
   bool fatal;
+
+  //! The sink which writes the lines, if any.
+  LogSink* sink;
 };
 
 } // namespace util
@@ -32,6 +32,59 @@ PrefixedOutStream& PrefixedOutStream::operator<<(const T& s)
 template<typename T>
 void PrefixedOutStream::BaseLogic(const T& val)
 {
+  // Output that is not shown is not formatted either (but fatal streams must
+  // still throw).
+  if (ignoreInput && !fatal)
+    return;
+
+  // The lines of the other streams are written by the sink while it is running
+  // (and a line begun then is finished the same way).
+  std::string* pendingLine = NULL;
+  if (sink != NULL && !fatal)
+  {
+    pendingLine = PendingLine();
+    if (pendingLine != NULL && pendingLine->empty() && !sink->Running())
+      pendingLine = NULL;
+  }
+
+  if (pendingLine != NULL)
+  {
+    std::ostringstream convert;
+    convert << val;
+    if (convert.fail())
+    {
+      convert.clear();
+      convert.str("Failed lexical_cast<std::string>(T) for output; output not "
+          "shown.\n");
+    }
+
+    // Each complete line is given to the sink.
+    const std::string line = convert.str();
+    size_t nl;
+    size_t pos = 0;
+    while ((nl = line.find('\n', pos)) != std::string::npos)
+    {
+      if (pendingLine->empty())
+        *pendingLine = prefix;
+      pendingLine->append(line, pos, nl + 1 - pos);
+      sink->Write(destination, *pendingLine);
+      pos = nl + 1;
+    }
+
+    if (pos != line.length())
+    {
+      if (pendingLine->empty())
+        *pendingLine = prefix;
+      pendingLine->append(line, pos, std::string::npos);
+    }
+
+    return;
+  }
+
+  // The lines queued for other streams come before fatal output.
+  if (fatal && sink != NULL)
+    sink->Flush();
+
   // We will use this to track whether or not we need to terminate at the end of
   // this call (only for streams which terminate after a newline).
   bool newlined = false;
@@ -0,0 +1,313 @@
+/**
+ * @file thread_pool.cpp
+ *
+ * Implementation of ThreadPool and TaskGroup.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "thread_pool.hpp"
+#include "log.hpp"
+
+#include <mlpack/core/math/random.hpp>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+namespace {
+
+//! The shared pool.
+std::unique_ptr<ThreadPool> globalPool;
+//! Settings of the shared pool.
+size_t globalThreads = 0;
+bool globalPin = false;
+//! Lock for the shared pool and its settings.
+std::mutex globalMutex;
+
+//! The pool the calling thread is a worker of (if any).
+thread_local ThreadPool* currentPool = NULL;
+//! The queue of the calling thread, if it is a worker of currentPool.
+thread_local size_t currentQueue = 0;
+
+} // anonymous namespace
+
+ThreadPool::ThreadPool(const size_t threads, const bool pin) :
+    pending(0),
+    nextQueue(0),
+    stopping(false),
+    pinned(pin)
+{
+  const size_t total = (threads == 0) ? DefaultThreads() : threads;
+
+  if (pin)
+  {
+#ifdef __linux__
+    // Only use the CPUs this process may run on.
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) == 0)
+    {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        if (CPU_ISSET(cpu, &allowed))
+          cpus.push_back(cpu);
+    }
+#endif
+
+    if (cpus.empty())
+    {
+      Log::Warn << "ThreadPool: pinning threads to CPUs is not supported on this"
+          << " system; threads will not be pinned." << std::endl;
+      pinned = false;
+    }
+    else
+    {
+      if (total > cpus.size())
+        Log::Warn << "ThreadPool: " << total << " threads requested but only "
+            << cpus.size() << " CPUs are available; some CPUs will run more "
+            << "than one thread." << std::endl;
+
+      // Worker i is pinned to CPU i, so the first CPU is left to the calling
+      // thread.  The calling thread itself is not pinned: OpenMP threads
+      // inherit its affinity, and would all share one CPU.
+    }
+  }
+
+  queues.resize(total);
+  for (size_t i = 0; i < total; ++i)
+    queues[i].reset(new Queue());
+
+  workers.reserve(total - 1);
+  for (size_t i = 1; i < total; ++i)
+    workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  sleepCondition.notify_all();
+
+  for (size_t i = 0; i < workers.size(); ++i)
+    workers[i].join();
+
+  // Without workers, queued tasks are run here.
+  while (RunPendingTask()) { }
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+  // Workers queue their tasks on their own queue; other threads spread them
+  // over all the queues.
+  const size_t queue = (currentPool == this) ? currentQueue :
+      (nextQueue++ % queues.size());
+
+  // The task is counted before it is queued, so that Take() cannot decrement
+  // the count below zero; a thread woken early just looks again.
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    ++pending;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+    queues[queue]->tasks.push_back(std::move(task));
+  }
+  sleepCondition.notify_one();
+}
+
+bool ThreadPool::RunPendingTask()
+{
+  std::function<void()> task;
+  if (!Take((currentPool == this) ? currentQueue : queues.size(), task))
+    return false;
+
+  task();
+  return true;
+}
+
+size_t ThreadPool::ThreadIndex() const
+{
+  return (currentPool == this) ? currentQueue : 0;
+}
+
+size_t ThreadPool::DefaultThreads()
+{
+#ifdef _OPENMP
+  const size_t threads = (size_t) omp_get_max_threads();
+#else
+  const size_t threads = (size_t) std::thread::hardware_concurrency();
+#endif
+  return std::max(threads, (size_t) 1);
+}
+
+ThreadPool& ThreadPool::Global()
+{
+  std::lock_guard<std::mutex> lock(globalMutex);
+  if (!globalPool)
+    globalPool.reset(new ThreadPool(globalThreads, globalPin));
+  return *globalPool;
+}
+
+void ThreadPool::Configure(const size_t threads, const bool pin)
+{
+  std::lock_guard<std::mutex> lock(globalMutex);
+  globalThreads = threads;
+  globalPin = pin;
+  globalPool.reset();
+}
+
+void ThreadPool::WorkerLoop(const size_t index)
+{
+  currentPool = this;
+  currentQueue = index;
+  if (pinned)
+    Pin(cpus[index % cpus.size()]);
+
+  // Give each worker its own random stream, distinct from the streams of the
+  // OpenMP threads.
+  math::SetThreadStreamIndex((((size_t) 1) << 31) + index);
+
+#ifdef _OPENMP
+  // The pool's threads are already busy, so an OpenMP region started by a task
+  // (such as a BLAS call) must not start a team of its own.
+  omp_set_num_threads(1);
+#endif
+
+  while (true)
+  {
+    std::function<void()> task;
+    if (Take(index, task))
+    {
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepCondition.wait(lock, [this]() { return stopping || pending > 0; });
+    if (stopping && pending == 0)
+      return;
+  }
+}
+
+bool ThreadPool::Take(const size_t own, std::function<void()>& task)
+{
+  if (pending == 0)
+    return false;
+
+  // The newest task of our own queue is the most likely to have its data in
+  // cache.
+  if (own < queues.size())
+  {
+    Queue& queue = *queues[own];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty())
+    {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      --pending;
+      return true;
+    }
+  }
+
+  // Steal the oldest task of another queue.
+  const size_t start = (own < queues.size()) ? own + 1 : 0;
+  for (size_t i = 0; i < queues.size(); ++i)
+  {
+    Queue& queue = *queues[(start + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty())
+    {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      --pending;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void ThreadPool::Pin(const int cpu)
+{
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0)
+    Log::Warn << "ThreadPool: could not pin thread to CPU " << cpu << "."
+        << std::endl;
+#else
+  (void) cpu;
+#endif
+}
+
+void ThreadPool::Sleep(const std::atomic<size_t>& outstanding)
+{
+  std::unique_lock<std::mutex> lock(sleepMutex);
+  sleepCondition.wait(lock, [this, &outstanding]()
+      { return pending > 0 || outstanding == 0; });
+}
+
+void ThreadPool::WakeWaiters()
+{
+  // Taking the lock makes sure a thread in Sleep() is either waiting, or will
+  // see the change before it waits.
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+  }
+  sleepCondition.notify_all();
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool) :
+    pool(pool),
+    outstanding(0)
+{
+  // Nothing to do.
+}
+
+TaskGroup::~TaskGroup()
+{
+  try
+  {
+    Wait();
+  }
+  catch (...)
+  {
+    // Exceptions cannot be thrown from a destructor.
+  }
+}
+
+void TaskGroup::Wait()
+{
+  // Run queued tasks (ours or not) until ours are finished, so that waiting
+  // inside a task does not deadlock.  When nothing is queued, our remaining
+  // tasks are running on other threads, so block until they finish or more
+  // work is queued.
+  while (outstanding > 0)
+  {
+    if (!pool.RunPendingTask())
+      pool.Sleep(outstanding);
+  }
+
+  std::lock_guard<std::mutex> lock(errorMutex);
+  if (error)
+  {
+    std::exception_ptr e = error;
+    error = std::exception_ptr();
+    std::rethrow_exception(e);
+  }
+}
@@ -0,0 +1,246 @@
+/**
+ * @file thread_pool.hpp
+ *
+ * A work-stealing thread pool shared by all of mlpack, with parallel-for,
+ * parallel-reduce, and task group helpers.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_UTIL_THREAD_POOL_HPP
+#define __MLPACK_CORE_UTIL_THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mlpack {
+namespace util {
+
+/**
+ * A pool of worker threads which run tasks.  Each worker has its own queue of
+ * tasks: a worker takes the newest task from its own queue, and when that is
+ * empty it steals the oldest task from another queue, so work submitted by one
+ * thread is spread over all of them.  Threads waiting for a TaskGroup run
+ * queued tasks while there are any, and only block when there is nothing to
+ * run, so tasks may submit and wait for other tasks.
+ *
+ * Most code should use the shared pool returned by Global(), which is sized by
+ * the --threads option of every mlpack program (see CLI), instead of creating
+ * its own.  The OpenMP runtime is given the same number of threads, for the
+ * code which still uses OpenMP.  OpenMP regions started inside a task by a
+ * worker (for instance, by an OpenMP BLAS) run on that worker alone, so that
+ * the two runtimes do not oversubscribe the machine.
+ *
+ * @code
+ * ThreadPool& pool = ThreadPool::Global();
+ * pool.ParallelFor(0, data.n_cols, 1024, [&](size_t begin, size_t end)
+ * {
+ *   for (size_t i = begin; i < end; ++i)
+ *     data.col(i) /= arma::norm(data.col(i), 2);
+ * });
+ * @endcode
+ */
+class ThreadPool
+{
+ public:
+  /**
+   * Start a pool with the given number of threads, counting the thread which
+   * waits for the work (so threads - 1 workers are started).
+   *
+   * @param threads Number of threads; 0 uses the number of OpenMP threads (or
+   *     cores, without OpenMP).
+   * @param pin If true, pin each worker to its own CPU.  The calling thread
+   *     is not pinned, so the OpenMP threads it starts keep the CPUs of the
+   *     process.
+   */
+  explicit ThreadPool(const size_t threads = 0, const bool pin = false);
+
+  //! Finish the queued tasks and stop the workers.
+  ~ThreadPool();
+
+  //! Get the number of threads, including the thread which waits for work.
+  size_t Threads() const { return workers.size() + 1; }
+  //! Get whether the workers are pinned to CPUs.
+  bool Pinned() const { return pinned; }
+
+  /**
+   * Get the index of the calling thread in this pool: i for the worker using
+   * queue i (1 <= i < Threads()), and 0 for any thread outside the pool, such
+   * as the one waiting for the work.  This can index per-thread scratch memory
+   * used inside a task, as long as the task does not wait for other tasks
+   * (with a TaskGroup) while it uses the memory, since the thread may run
+   * other tasks while it waits.
+   */
+  size_t ThreadIndex() const;
+
+  /**
+   * Queue a task.  The task must not throw; use a TaskGroup to run tasks which
+   * may throw, or to wait for tasks.
+   */
+  void Submit(std::function<void()> task);
+
+  /**
+   * Run one queued task in the calling thread, if there is one.
+   *
+   * @return Whether a task was run.
+   */
+  bool RunPendingTask();
+
+  /**
+   * Call function(chunkBegin, chunkEnd) for consecutive chunks of grain
+   * indices that cover [begin, end), in parallel.  The calling thread takes
+   * part in the work.
+   *
+   * @param begin First index.
+   * @param end One past the last index.
+   * @param grain Number of indices in each chunk.
+   * @param function Function to call for each chunk.
+   */
+  template<typename FunctionType>
+  void ParallelFor(const size_t begin,
+                   const size_t end,
+                   const size_t grain,
+                   FunctionType function);
+
+  /**
+   * Compute map(chunkBegin, chunkEnd) for consecutive chunks of grain indices
+   * that cover [begin, end), in parallel, and combine the results with
+   * combine(a, b), starting from identity.  The results are combined in the
+   * order of the chunks, so the result depends only on grain and not on the
+   * number of threads.
+   *
+   * @param begin First index.
+   * @param end One past the last index.
+   * @param grain Number of indices in each chunk.
+   * @param identity Initial value of the result.
+   * @param map Function which computes the result of a chunk.
+   * @param combine Function which combines two results.
+   */
+  template<typename T, typename MapType, typename CombineType>
+  T ParallelReduce(const size_t begin,
+                   const size_t end,
+                   const size_t grain,
+                   const T& identity,
+                   MapType map,
+                   CombineType combine);
+
+  //! Get the shared pool, which is started by the first call.
+  static ThreadPool& Global();
+
+  /**
+   * Set the number of threads and the pinning of the shared pool.  If the
+   * pool has been started, it is stopped, and restarted with the new settings
+   * by the next call to Global(); this must not be done while it is in use.
+   */
+  static void Configure(const size_t threads, const bool pin);
+
+  //! Get the number of threads to use by default (see the constructor).
+  static size_t DefaultThreads();
+
+ private:
+  //! A queue of tasks, with its lock.
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()> > tasks;
+  };
+
+  //! The loop run by each worker.
+  void WorkerLoop(const size_t index);
+  //! Take a task, first from the back of queue 'own' (if valid), and then from
+  //! the front of the other queues.
+  bool Take(const size_t own, std::function<void()>& task);
+  //! Pin the calling thread to the given CPU.
+  static void Pin(const int cpu);
+
+  //! Block until a task is queued or outstanding is 0 (for TaskGroup::Wait()).
+  void Sleep(const std::atomic<size_t>& outstanding);
+  //! Wake the threads blocked in Sleep(), after a TaskGroup has finished.
+  void WakeWaiters();
+
+  friend class TaskGroup;
+
+  //! The worker threads.
+  std::vector<std::thread> workers;
+  //! The queues; queue 0 belongs to threads outside the pool, and queue i to
+  //! worker i - 1.
+  std::vector<std::unique_ptr<Queue> > queues;
+  //! The CPUs the workers are pinned to (if pinned).
+  std::vector<int> cpus;
+
+  //! Lock for sleeping workers and waiting threads.
+  std::mutex sleepMutex;
+  //! Signalled when a task is queued, a TaskGroup finishes, or the pool is
+  //! stopped.
+  std::condition_variable sleepCondition;
+
+  //! Number of queued tasks that have not been taken.  It is incremented
+  //! before a task is queued and decremented after it is taken, so it never
+  //! goes below zero.
+  std::atomic<size_t> pending;
+  //! Next queue for tasks submitted from outside the pool.
+  std::atomic<size_t> nextQueue;
+  //! Set when the pool is being destroyed.
+  std::atomic<bool> stopping;
+  //! Whether the workers are pinned.
+  bool pinned;
+};
+
+/**
+ * A group of tasks run on a ThreadPool, which can be waited for together.  If
+ * a task throws, the first exception is rethrown by Wait().
+ *
+ * @code
+ * TaskGroup group;
+ * group.Run([&]() { left.Build(); });
+ * group.Run([&]() { right.Build(); });
+ * group.Wait();
+ * @endcode
+ */
+class TaskGroup
+{
+ public:
+  //! Create a group which runs its tasks on the given pool.
+  explicit TaskGroup(ThreadPool& pool = ThreadPool::Global());
+
+  //! Wait for the tasks (exceptions are discarded).
+  ~TaskGroup();
+
+  //! Run a task.
+  template<typename FunctionType>
+  void Run(FunctionType task);
+
+  //! Wait for every task run so far, running queued tasks meanwhile (and
+  //! blocking when there are none), and rethrow the first exception thrown by
+  //! a task.
+  void Wait();
+
+ private:
+  //! The pool the tasks run on.
+  ThreadPool& pool;
+  //! Number of tasks not yet finished.
+  std::atomic<size_t> outstanding;
+  //! Lock for error.
+  std::mutex errorMutex;
+  //! The first exception thrown by a task.
+  std::exception_ptr error;
+};
+
+} // namespace util
+} // namespace mlpack
+
+// Include implementation.
+#include "thread_pool_impl.hpp"
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file thread_pool_impl.hpp
+ *
+ * Implementation of the templated functions of ThreadPool and TaskGroup.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_CORE_UTIL_THREAD_POOL_IMPL_HPP
+#define __MLPACK_CORE_UTIL_THREAD_POOL_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace mlpack {
+namespace util {
+
+template<typename FunctionType>
+void ThreadPool::ParallelFor(const size_t begin,
+                             const size_t end,
+                             const size_t grain,
+                             FunctionType function)
+{
+  if (end <= begin)
+    return;
+
+  const size_t chunkSize = std::max(grain, (size_t) 1);
+  const size_t chunks = (end - begin + chunkSize - 1) / chunkSize;
+  const size_t tasks = std::min(chunks, Threads());
+  if (tasks <= 1)
+  {
+    for (size_t c = 0; c < chunks; ++c)
+      function(begin + c * chunkSize, std::min(begin + (c + 1) * chunkSize,
+          end));
+    return;
+  }
+
+  // Rather than one task per chunk, start one task per thread, and let each
+  // take the next chunk until there are none left.
+  std::atomic<size_t> nextChunk(0);
+  TaskGroup group(*this);
+  for (size_t t = 0; t < tasks; ++t)
+  {
+    group.Run([&]()
+    {
+      for (size_t c = nextChunk++; c < chunks; c = nextChunk++)
+        function(begin + c * chunkSize, std::min(begin + (c + 1) * chunkSize,
+            end));
+    });
+  }
+  group.Wait();
+}
+
+template<typename T, typename MapType, typename CombineType>
+T ThreadPool::ParallelReduce(const size_t begin,
+                             const size_t end,
+                             const size_t grain,
+                             const T& identity,
+                             MapType map,
+                             CombineType combine)
+{
+  if (end <= begin)
+    return identity;
+
+  const size_t chunkSize = std::max(grain, (size_t) 1);
+  const size_t chunks = (end - begin + chunkSize - 1) / chunkSize;
+  std::vector<T> results(chunks, identity);
+  ParallelFor(0, chunks, 1, [&](const size_t chunkBegin, const size_t chunkEnd)
+  {
+    for (size_t c = chunkBegin; c < chunkEnd; ++c)
+      results[c] = map(begin + c * chunkSize, std::min(begin + (c + 1) *
+          chunkSize, end));
+  });
+
+  T result = identity;
+  for (size_t c = 0; c < chunks; ++c)
+    result = combine(result, results[c]);
+  return result;
+}
+
+template<typename FunctionType>
+void TaskGroup::Run(FunctionType task)
+{
+  ++outstanding;
+  pool.Submit([this, task]()
+  {
+    try
+    {
+      task();
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error)
+        error = std::current_exception();
+    }
+
+    // The group may be destroyed as soon as outstanding is 0, so the pool is
+    // read first.
+    ThreadPool& groupPool = pool;
+    if (--outstanding == 0)
+      groupPool.WakeWaiters();
+  });
+}
+
+} // namespace util
+} // namespace mlpack
+
+#endif
@@ -19,21 +19,106 @@
 #include <map>
 #include <string>
 
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
 using namespace mlpack;
 
-// On Windows machines, we need to define timersub.
-#ifdef _WIN32
-inline void timersub(const timeval* tvp, const timeval* uvp, timeval* vvp)
+namespace {
+
+//! Lock for liveTimers and liveId.
+std::mutex liveMutex;
+//! The Timers object that exists (there is at most one, owned by CLI).
+Timers* liveTimers = NULL;
+//! The identifier of liveTimers.
+uint64_t liveId = 0;
+//! The identifier of the last Timers object created.
+uint64_t lastId = 0;
+//! Whether the timers of this thread have been destroyed (the main thread's are
+//! destroyed before CLI, at exit).
+thread_local bool threadExited = false;
+
+//! Convert nanoseconds to a timeval.
+timeval ToTimeval(const uint64_t nanoseconds)
+{
+  timeval tv;
+  tv.tv_sec = (long) (nanoseconds / 1000000000ULL);
+  tv.tv_usec = (long) ((nanoseconds % 1000000000ULL) / 1000ULL);
+  return tv;
+}
+
+//! Write a number of nanoseconds as seconds, with every digit.
+template<typename StreamType>
+void WriteSeconds(StreamType& stream, const uint64_t nanoseconds)
+{
+  stream << (nanoseconds / 1000000000ULL) << "." << std::setw(9)
+      << std::setfill('0') << (nanoseconds % 1000000000ULL)
+      << std::setfill(' ');
+}
+
+//! Write a string as a JSON string.
+void WriteJSONString(std::ostream& stream, const std::string& str)
 {
-  vvp->tv_sec = tvp->tv_sec - uvp->tv_sec;
-  vvp->tv_usec = tvp->tv_usec - uvp->tv_usec;
-  if (vvp->tv_usec < 0)
+  stream << '"';
+  for (size_t i = 0; i < str.size(); ++i)
   {
-     --vvp->tv_sec;
-     vvp->tv_usec += 1000000;
+    const char c = str[i];
+    if (c == '"' || c == '\\')
+      stream << '\\' << c;
+    else if ((unsigned char) c < 0x20)
+      stream << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+          << (int) c << std::dec << std::setfill(' ');
+    else
+      stream << c;
   }
+  stream << '"';
 }
-#endif
+
+//! A node of the tree of timer names, for the JSON output.
+struct TimerNode
+{
+  TimerNode() : handle(0), hasTimer(false) { }
+
+  Timer::Handle handle;
+  bool hasTimer;
+  std::map<std::string, std::unique_ptr<TimerNode> > children;
+};
+
+} // anonymous namespace
+
+//! The timers of one thread.
+struct Timers::ThreadState
+{
+  ThreadState() : owner(NULL), ownerId(0), index(0) { }
+
+  ~ThreadState()
+  {
+    // If the Timers object still exists, it keeps this thread's statistics,
+    // including the time of the timers still running (such as total_time).
+    std::lock_guard<std::mutex> lock(liveMutex);
+    if (owner != NULL && liveTimers == owner && liveId == ownerId)
+    {
+      owner->StopAllTimers();
+      owner->Retire(*this);
+    }
+    threadExited = true;
+  }
+
+  //! The Timers object the slots belong to.
+  Timers* owner;
+  //! The identifier of owner.
+  uint64_t ownerId;
+  //! Index of the thread.
+  size_t index;
+  //! The state of each timer in this thread, indexed by handle.
+  std::vector<std::unique_ptr<Slot> > slots;
+  //! The active scoped timers.
+  std::vector<Timer::Handle> scopes;
+  //! The hardware counters of this thread (if they have been used).
+  std::unique_ptr<util::PerfCounters> counters;
+};
 
 /**
  * Start the given timer.
@@ -59,32 +144,143 @@ timeval Timer::Get(const std::string& name)
   return CLI::GetSingleton().timer.GetTimer(name);
 }
 
-std::map<std::string, timeval>& Timers::GetAllTimers()
+Timer::Handle Timer::Register(const std::string& name)
 {
-  return timers;
+  return CLI::GetSingleton().timer.Register(name);
+}
+
+void Timer::Start(const Handle handle)
+{
+  CLI::GetSingleton().timer.StartTimer(handle);
+}
+
+void Timer::Stop(const Handle handle)
+{
+  CLI::GetSingleton().timer.StopTimer(handle);
+}
+
+uint64_t Timer::Nanoseconds(const std::string& name)
+{
+  return CLI::GetSingleton().timer.Nanoseconds(name);
+}
+
+uint64_t Timer::Runs(const std::string& name)
+{
+  return CLI::GetSingleton().timer.Runs(name);
+}
+
+uint64_t Timer::Counter(const std::string& name, const size_t counter)
+{
+  return CLI::GetSingleton().timer.Counter(name, counter);
+}
+
+void Timer::AddBytes(const std::string& name, const uint64_t bytes)
+{
+  CLI::GetSingleton().timer.AddBytes(name, bytes);
+}
+
+void Timer::SaveJSON(std::ostream& stream)
+{
+  CLI::GetSingleton().timer.SaveJSON(stream);
+}
+
+ScopedTimer::ScopedTimer(const std::string& name)
+{
+  Timers& timers = CLI::GetSingleton().timer;
+  handle = timers.Register(timers.ScopedName(name));
+  timers.StartTimer(handle);
+  timers.PushScope(handle);
+}
+
+ScopedTimer::ScopedTimer(const Timer::Handle handle) : handle(handle)
+{
+  Timers& timers = CLI::GetSingleton().timer;
+  timers.StartTimer(handle);
+  timers.PushScope(handle);
+}
+
+ScopedTimer::~ScopedTimer()
+{
+  Timers& timers = CLI::GetSingleton().timer;
+  timers.PopScope();
+  timers.StopTimer(handle);
+}
+
+Timers::Timers() : nextThread(0)
+{
+  std::lock_guard<std::mutex> lock(liveMutex);
+  id = ++lastId;
+  liveTimers = this;
+  liveId = id;
+}
+
+Timers::~Timers()
+{
+  std::lock_guard<std::mutex> lock(liveMutex);
+  if (liveTimers == this)
+    liveTimers = NULL;
+}
+
+std::vector<std::string> Timers::GetAllTimers() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::string> names;
+  for (std::map<std::string, Timer::Handle>::const_iterator it =
+      handles.begin(); it != handles.end(); ++it)
+    names.push_back(it->first);
+  return names;
 }
 
 timeval Timers::GetTimer(const std::string& timerName)
 {
-  return timers[timerName];
+  return ToTimeval(Nanoseconds(timerName));
+}
+
+uint64_t Timers::Nanoseconds(const std::string& timerName)
+{
+  const Timer::Handle handle = Register(timerName);
+  std::lock_guard<std::mutex> lock(mutex);
+  return records[handle].nanoseconds.load();
+}
+
+uint64_t Timers::Runs(const std::string& timerName)
+{
+  const Timer::Handle handle = Register(timerName);
+  std::lock_guard<std::mutex> lock(mutex);
+  return records[handle].runs.load();
+}
+
+uint64_t Timers::Counter(const std::string& timerName, const size_t counter)
+{
+  const Timer::Handle handle = Register(timerName);
+  std::lock_guard<std::mutex> lock(mutex);
+  return records[handle].counters[counter].load();
+}
+
+void Timers::AddBytes(const std::string& timerName, const uint64_t bytes)
+{
+  const Timer::Handle handle = Register(timerName);
+  std::lock_guard<std::mutex> lock(mutex);
+  records[handle].bytes.fetch_add(bytes, std::memory_order_relaxed);
 }
 
 bool Timers::GetState(std::string timerName)
 {
-  return timerState[timerName];
+  return LocalSlot(Register(timerName)).running;
 }
 
 void Timers::PrintTimer(const std::string& timerName)
 {
-  timeval& t = timers[timerName];
-  Log::Info << t.tv_sec << "." << std::setw(6) << std::setfill('0')
-      << t.tv_usec << "s";
+  const uint64_t nanoseconds = Nanoseconds(timerName);
+  const uint64_t totalSeconds = nanoseconds / 1000000000ULL;
+  WriteSeconds(Log::Info, nanoseconds);
+  Log::Info << "s";
 
   // Also output convenient day/hr/min/sec.
-  int days = t.tv_sec / 86400; // Integer division rounds down.
-  int hours = (t.tv_sec % 86400) / 3600;
-  int minutes = (t.tv_sec % 3600) / 60;
-  int seconds = (t.tv_sec % 60);
+  int days = totalSeconds / 86400; // Integer division rounds down.
+  int hours = (totalSeconds % 86400) / 3600;
+  int minutes = (totalSeconds % 3600) / 60;
+  int seconds = (totalSeconds % 60);
   // No output if it didn't even take a minute.
   if (!(days == 0 && hours == 0 && minutes == 0))
   {
@@ -118,171 +314,426 @@ void Timers::PrintTimer(const std::string& timerName)
     {
       if (output)
         Log::Info << ", ";
-      Log::Info << seconds << "." << std::setw(1) << (t.tv_usec / 100000) <<
-          "secs";
+      Log::Info << seconds << "." << std::setw(1)
+          << ((nanoseconds % 1000000000ULL) / 100000000ULL) << "secs";
       output = true;
     }
 
     Log::Info << ")";
   }
 
-  Log::Info << std::endl;
-}
+  const uint64_t runs = Runs(timerName);
+  if (runs > 1)
+    Log::Info << " in " << runs << " runs";
 
-void Timers::GetTime(timeval* tv)
-{
-#if defined(__MACH__) && defined(__APPLE__)
-
-  static mach_timebase_info_data_t info;
-
-  // If this is the first time we've run, get the timebase.
-  // We can use denom == 0 to indicate that sTimebaseInfo is
-  // uninitialised.
-  if (info.denom == 0) {
-    (void) mach_timebase_info(&info);
+  const Timer::Handle handle = Register(timerName);
+  uint64_t bytes;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    bytes = records[handle].bytes.load();
   }
-
-  // Hope that the multiplication doesn't overflow.
-  uint64_t nsecs = mach_absolute_time() * info.numer / info.denom;
-  tv->tv_sec = nsecs / 1e9;
-  tv->tv_usec = (nsecs / 1e3) - (tv->tv_sec * 1e6);
-
-#elif defined(_POSIX_VERSION)
-#if defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
-
-  // Get the right clock_id.
-#if defined(CLOCK_MONOTONIC_PRECISE)
-  static const clockid_t id = CLOCK_MONOTONIC_PRECISE;
-#elif defined(CLOCK_MONOTONIC_RAW)
-  static const clockid_t id = CLOCK_MONOTONIC_RAW;
-#elif defined(CLOCK_MONOTONIC)
-  static const clockid_t id = CLOCK_MONOTONIC;
-#elif defined(CLOCK_REALTIME)
-  static const clockid_t id = CLOCK_REALTIME;
-#else
-  static const clockid_t id = ((clockid_t) - 1);
-#endif // CLOCK
-
-  struct timespec ts;
-
-  // Returns the current value tp for the specified clock_id.
-  if (clock_gettime(id, &ts) != -1 && id != ((clockid_t) - 1))
+  if (bytes > 0)
   {
-    tv->tv_sec = ts.tv_sec;
-    tv->tv_usec = ts.tv_nsec / 1e3;
+    Log::Info << ", " << bytes << " bytes";
+    // Bytes per nanosecond are GB/s.
+    if (nanoseconds > 0)
+      Log::Info << " (" << (1000.0 * bytes / nanoseconds) << " MB/s)";
   }
 
-  // Fallback for the clock_gettime function.
-  gettimeofday(tv, NULL);
+  Log::Info << std::endl;
 
-#endif  // _POSIX_TIMERS
-#elif defined(_WIN32)
+  // Print the hardware events, if they were counted.
+  uint64_t counters[util::PerfCounters::Count];
+  unsigned int counted;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t c = 0; c < util::PerfCounters::Count; ++c)
+      counters[c] = records[handle].counters[c].load();
+    counted = records[handle].counted.load();
+  }
 
-  static double frequency = 0.0;
-  static LARGE_INTEGER offset;
+  if (counted == 0)
+    return;
 
-  // If this is the first time we've run, get the frequency.
-  // We use frequency == 0.0 to indicate that
-  // QueryPerformanceFrequency is uninitialised.
-  if (frequency == 0.0)
+  Log::Info << "    ";
+  bool output = false;
+  for (size_t c = 0; c < util::PerfCounters::Count; ++c)
   {
-    LARGE_INTEGER pF;
-    if (!QueryPerformanceFrequency(&pF))
+    if (!(counted & (1 << c)))
+      continue;
+
+    if (output)
+      Log::Info << ", ";
+    Log::Info << util::PerfCounters::Name(c) << ": " << counters[c];
+    output = true;
+    if (c == util::PerfCounters::INSTRUCTIONS &&
+        counters[util::PerfCounters::CYCLES] > 0)
     {
-      // Fallback for the QueryPerformanceCounter function.
-      FileTimeToTimeVal(tv);
+      Log::Info << " (" << ((double) counters[c] /
+          counters[util::PerfCounters::CYCLES]) << " per cycle)";
     }
-    else
+    else if (c == util::PerfCounters::CACHE_MISSES &&
+        counters[util::PerfCounters::CACHE_REFERENCES] > 0)
     {
-      QueryPerformanceCounter(&offset);
-      frequency = (double)pF.QuadPart / 1000000.0;
+      Log::Info << " (" << (100.0 * counters[c] /
+          counters[util::PerfCounters::CACHE_REFERENCES]) << "%)";
+    }
+    else if (c == util::PerfCounters::FP_OPS && nanoseconds > 0)
+    {
+      // Operations per nanosecond are GFLOP/s.
+      Log::Info << " (" << ((double) counters[c] / nanoseconds)
+          << " GFLOP/s)";
     }
   }
+  Log::Info << std::endl;
+}
 
-  if (frequency != 0.0)
-  {
-    LARGE_INTEGER pC;
-    // Get the current performance-counter value.
-    QueryPerformanceCounter(&pC);
-
-    pC.QuadPart -= offset.QuadPart;
-    double microseconds = (double)pC.QuadPart / frequency;
-    pC.QuadPart = microseconds;
-    tv->tv_sec = (long)pC.QuadPart / 1000000;
-    tv->tv_usec = (long)(pC.QuadPart % 1000000);
-  }
+Timer::Handle Timers::Register(const std::string& timerName)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::map<std::string, Timer::Handle>::const_iterator it =
+      handles.find(timerName);
+  if (it != handles.end())
+    return it->second;
+
+  const Timer::Handle handle = records.size();
+  records.emplace_back(timerName);
+  handles[timerName] = handle;
+  return handle;
+}
 
-#endif
+std::string Timers::Name(const Timer::Handle handle)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return records[handle].name;
 }
 
 void Timers::StartTimer(const std::string& timerName)
 {
-  if ((timerState[timerName] == 1) && (timerName != "total_time"))
+  StartTimer(Register(timerName));
+}
+
+void Timers::StartTimer(const Timer::Handle handle)
+{
+  Slot& slot = LocalSlot(handle);
+  if (slot.running && (slot.record->name != "total_time"))
   {
     std::ostringstream error;
-    error << "Timer::Start(): timer '" << timerName
+    error << "Timer::Start(): timer '" << slot.record->name
         << "' has already been started";
     throw std::runtime_error(error.str());
   }
 
-  timerState[timerName] = true;
+  slot.running = true;
+  slot.counting = util::PerfCounters::Enabled();
+  if (slot.counting)
+    LocalCounters().Read(slot.startCounters);
+  slot.start = std::chrono::steady_clock::now();
+}
 
-  timeval tmp;
-  tmp.tv_sec = 0;
-  tmp.tv_usec = 0;
+void Timers::StopTimer(const std::string& timerName)
+{
+  StopTimer(Register(timerName));
+}
 
-  GetTime(&tmp);
+void Timers::StopTimer(const Timer::Handle handle)
+{
+  const std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
 
-  // Check to see if the timer already exists.  If it does, we'll subtract the
-  // old value.
-  if (timers.count(timerName) == 1)
+  Slot& slot = LocalSlot(handle);
+  if (!slot.running)
   {
-    timeval tmpDelta;
+    if (slot.record->name == "total_time")
+      return;
+
+    std::ostringstream error;
+    error << "Timer::Stop(): timer '" << slot.record->name
+        << "' has already been stopped";
+    throw std::runtime_error(error.str());
+  }
+
+  slot.running = false;
+  const uint64_t elapsed = (uint64_t)
+      std::chrono::duration_cast<std::chrono::nanoseconds>(now -
+      slot.start).count();
 
-    timersub(&tmp, &timers[timerName], &tmpDelta);
+  // Only this thread writes to its slot, so relaxed atomics suffice; they are
+  // atomic only so that SaveJSON() can read them from another thread.
+  slot.nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+  slot.runs.fetch_add(1, std::memory_order_relaxed);
+  slot.record->nanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+  slot.record->runs.fetch_add(1, std::memory_order_relaxed);
 
-    tmp = tmpDelta;
+  if (slot.counting)
+  {
+    util::PerfCounters& counters = LocalCounters();
+    uint64_t stopCounters[util::PerfCounters::Count];
+    counters.Read(stopCounters);
+    for (size_t c = 0; c < util::PerfCounters::Count; ++c)
+    {
+      if (!counters.Available(c))
+        continue;
+
+      // Scaled (multiplexed) values may not be monotonic.
+      if (stopCounters[c] > slot.startCounters[c])
+        slot.record->counters[c].fetch_add(stopCounters[c] -
+            slot.startCounters[c], std::memory_order_relaxed);
+      slot.record->counted.fetch_or(1 << c, std::memory_order_relaxed);
+    }
   }
+}
 
-  timers[timerName] = tmp;
+void Timers::StopAllTimers()
+{
+  // The timers of an exiting thread were stopped with its state.
+  if (threadExited)
+    return;
+
+  ThreadState& state = LocalState();
+  for (size_t i = 0; i < state.slots.size(); ++i)
+    if (state.slots[i] && state.slots[i]->running)
+      StopTimer((Timer::Handle) i);
 }
 
-#ifdef _WIN32
-void Timers::FileTimeToTimeVal(timeval* tv)
+void Timers::PushScope(const Timer::Handle handle)
 {
-  FILETIME ftime;
-  uint64_t ptime = 0;
-  // Acquire the file time.
-  GetSystemTimeAsFileTime(&ftime);
-  // Now convert FILETIME to timeval.
-  ptime |= ftime.dwHighDateTime;
-  ptime = ptime << 32;
-  ptime |= ftime.dwLowDateTime;
-  ptime /= 10;
-  ptime -= DELTA_EPOCH_IN_MICROSECS;
+  LocalState().scopes.push_back(handle);
+}
 
-  tv->tv_sec = (long) (ptime / 1000000UL);
-  tv->tv_usec = (long) (ptime % 1000000UL);
+void Timers::PopScope()
+{
+  LocalState().scopes.pop_back();
 }
-#endif // _WIN32
 
-void Timers::StopTimer(const std::string& timerName)
+std::string Timers::ScopedName(const std::string& timerName)
+{
+  ThreadState& state = LocalState();
+  if (state.scopes.empty())
+    return timerName;
+  return Name(state.scopes.back()) + "/" + timerName;
+}
+
+void Timers::SaveJSON(std::ostream& stream)
 {
-  if ((timerState[timerName] == 0) && (timerName != "total_time"))
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Collect the runs and time of each thread for each timer.
+  std::vector<std::map<size_t, std::pair<uint64_t, uint64_t> > >
+      threadStats(records.size());
+  for (size_t t = 0; t < threads.size(); ++t)
   {
-    std::ostringstream error;
-    error << "Timer::Stop(): timer '" << timerName
-        << "' has already been stopped";
-    throw std::runtime_error(error.str());
+    for (size_t h = 0; h < threads[t]->slots.size(); ++h)
+    {
+      const Slot* slot = threads[t]->slots[h].get();
+      if (slot != NULL && slot->runs.load() > 0)
+        threadStats[h][threads[t]->index] = std::make_pair(slot->runs.load(),
+            slot->nanoseconds.load());
+    }
+  }
+  for (std::map<std::pair<size_t, Timer::Handle>,
+      std::pair<uint64_t, uint64_t> >::const_iterator it = retired.begin();
+      it != retired.end(); ++it)
+    threadStats[it->first.second][it->first.first] = it->second;
+
+  // Build the tree of names.
+  TimerNode root;
+  for (size_t h = 0; h < records.size(); ++h)
+  {
+    TimerNode* node = &root;
+    std::istringstream path(records[h].name);
+    std::string part;
+    while (std::getline(path, part, '/'))
+    {
+      std::unique_ptr<TimerNode>& child = node->children[part];
+      if (!child)
+        child.reset(new TimerNode());
+      node = child.get();
+    }
+    node->handle = h;
+    node->hasTimer = true;
+  }
+
+  // Write the tree, depth-first.
+  struct Writer
+  {
+    static void Write(std::ostream& stream,
+                      const TimerNode& node,
+                      const std::deque<Record>& records,
+                      const std::vector<std::map<size_t,
+                          std::pair<uint64_t, uint64_t> > >& threadStats,
+                      const std::string& indent)
+    {
+      stream << "{";
+      bool first = true;
+      if (node.hasTimer)
+      {
+        const Record& record = records[node.handle];
+        const uint64_t nanoseconds = record.nanoseconds.load();
+        stream << "\n" << indent << "  \"seconds\": ";
+        WriteSeconds(stream, nanoseconds);
+        stream << ",\n" << indent << "  \"nanoseconds\": " << nanoseconds
+            << ",\n" << indent << "  \"runs\": " << record.runs.load()
+            << ",\n" << indent << "  \"threads\": [";
+        const std::map<size_t, std::pair<uint64_t, uint64_t> >& stats =
+            threadStats[node.handle];
+        for (std::map<size_t, std::pair<uint64_t, uint64_t> >::const_iterator
+            it = stats.begin(); it != stats.end(); ++it)
+        {
+          stream << ((it == stats.begin()) ? "\n" : ",\n") << indent
+              << "    { \"thread\": " << it->first << ", \"runs\": "
+              << it->second.first << ", \"nanoseconds\": " << it->second.second
+              << " }";
+        }
+        stream << (stats.empty() ? "]" : "\n" + indent + "  ]");
+        first = false;
+
+        const uint64_t bytes = record.bytes.load();
+        if (bytes > 0)
+        {
+          stream << ",\n" << indent << "  \"bytes\": " << bytes;
+          if (nanoseconds > 0)
+            stream << ",\n" << indent << "  \"megabytes_per_second\": "
+                << (1000.0 * bytes / nanoseconds);
+        }
+
+        const unsigned int counted = record.counted.load();
+        if (counted != 0)
+        {
+          uint64_t counters[util::PerfCounters::Count];
+          for (size_t c = 0; c < util::PerfCounters::Count; ++c)
+            counters[c] = record.counters[c].load();
+
+          stream << ",\n" << indent << "  \"counters\": {";
+          bool firstCounter = true;
+          for (size_t c = 0; c < util::PerfCounters::Count; ++c)
+          {
+            if (!(counted & (1 << c)))
+              continue;
+
+            stream << (firstCounter ? "\n" : ",\n") << indent << "    \""
+                << util::PerfCounters::Name(c) << "\": " << counters[c];
+            firstCounter = false;
+          }
+
+          // Derived rates, where they are defined.
+          const uint64_t cycles = counters[util::PerfCounters::CYCLES];
+          const uint64_t references =
+              counters[util::PerfCounters::CACHE_REFERENCES];
+          if ((counted & (1 << util::PerfCounters::INSTRUCTIONS)) && cycles > 0)
+            stream << ",\n" << indent << "    \"instructions_per_cycle\": "
+                << ((double) counters[util::PerfCounters::INSTRUCTIONS] /
+                cycles);
+          if ((counted & (1 << util::PerfCounters::CACHE_MISSES)) &&
+              references > 0)
+            stream << ",\n" << indent << "    \"cache_miss_rate\": "
+                << ((double) counters[util::PerfCounters::CACHE_MISSES] /
+                references);
+          if ((counted & (1 << util::PerfCounters::FP_OPS)) && nanoseconds > 0)
+            stream << ",\n" << indent << "    \"gflops\": "
+                << ((double) counters[util::PerfCounters::FP_OPS] /
+                nanoseconds);
+          stream << "\n" << indent << "  }";
+        }
+      }
+
+      if (!node.children.empty())
+      {
+        stream << (first ? "\n" : ",\n") << indent << "  \"children\": {";
+        for (std::map<std::string, std::unique_ptr<TimerNode> >::const_iterator
+            it = node.children.begin(); it != node.children.end(); ++it)
+        {
+          stream << ((it == node.children.begin()) ? "\n" : ",\n") << indent
+              << "    ";
+          WriteJSONString(stream, it->first);
+          stream << ": ";
+          Write(stream, *it->second, records, threadStats, indent + "    ");
+        }
+        stream << "\n" << indent << "  }";
+        first = false;
+      }
+
+      stream << (first ? "}" : "\n" + indent + "}");
+    }
+  };
+
+  stream << "{\n  \"timers\": ";
+  if (root.children.empty())
+  {
+    stream << "{}";
+  }
+  else
+  {
+    // The top level has no timer of its own, so write its children directly.
+    stream << "{";
+    for (std::map<std::string, std::unique_ptr<TimerNode> >::const_iterator it =
+        root.children.begin(); it != root.children.end(); ++it)
+    {
+      stream << ((it == root.children.begin()) ? "\n" : ",\n") << "    ";
+      WriteJSONString(stream, it->first);
+      stream << ": ";
+      Writer::Write(stream, *it->second, records, threadStats, "    ");
+    }
+    stream << "\n  }";
   }
+  stream << "\n}\n";
+}
 
-  timerState[timerName] = false;
+Timers::ThreadState& Timers::LocalState()
+{
+  thread_local ThreadState state;
+  if (state.owner != this || state.ownerId != id)
+  {
+    // This thread has not used these timers yet (or only used a previous
+    // Timers object, whose slots are no longer valid).
+    state.slots.clear();
+    state.scopes.clear();
+    state.owner = this;
+    state.ownerId = id;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    state.index = nextThread++;
+    threads.push_back(&state);
+  }
 
-  timeval delta, b, a = timers[timerName];
+  return state;
+}
 
-  GetTime(&b);
+Timers::Slot& Timers::LocalSlot(const Timer::Handle handle)
+{
+  ThreadState& state = LocalState();
+  if (handle >= state.slots.size() || !state.slots[handle])
+  {
+    // The slots are resized with the lock held, because SaveJSON() may read
+    // them from another thread.
+    std::lock_guard<std::mutex> lock(mutex);
+    if (handle >= state.slots.size())
+      state.slots.resize(handle + 1);
+    state.slots[handle].reset(new Slot(&records[handle]));
+  }
+
+  return *state.slots[handle];
+}
+
+util::PerfCounters& Timers::LocalCounters()
+{
+  ThreadState& state = LocalState();
+  if (!state.counters)
+    state.counters.reset(new util::PerfCounters());
+  return *state.counters;
+}
+
+void Timers::Retire(ThreadState& state)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (size_t h = 0; h < state.slots.size(); ++h)
+  {
+    if (state.slots[h] && state.slots[h]->runs.load() > 0)
+      retired[std::make_pair(state.index, (Timer::Handle) h)] =
+          std::make_pair(state.slots[h]->runs.load(),
+          state.slots[h]->nanoseconds.load());
+  }
 
-  // Calculate the delta time.
-  timersub(&b, &a, &delta);
-  timers[timerName] = delta;
+  threads.erase(std::remove(threads.begin(), threads.end(), &state),
+      threads.end());
 }
@@ -15,8 +15,18 @@
 #ifndef __MLPACK_CORE_UTILITIES_TIMERS_HPP
 #define __MLPACK_CORE_UTILITIES_TIMERS_HPP
 
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "perf_counters.hpp"
 
 #if defined(__unix__) || defined(__unix)
   #include <time.h>       // clock_gettime()
@@ -62,13 +72,28 @@
 namespace mlpack {
 
 /**
- * The timer class provides a way for mlpack methods to be timed.  The three
- * methods contained in this class allow a named timer to be started and
- * stopped, and its value to be obtained.
+ * The timer class provides a way for mlpack methods to be timed.  A named timer
+ * can be started and stopped, and its value obtained.
+ *
+ * Timers measure nanoseconds with a steady clock, and are thread-safe: each
+ * thread starts and stops its own runs of a timer, and the total time, the
+ * number of runs, and the runs of each thread are accumulated.  For code which
+ * is timed very often, Register() returns a handle which can be started and
+ * stopped without looking up the name.  Timers can be nested by giving them
+ * names separated by '/' (such as "clustering/iteration/assignment"), either
+ * directly or with ScopedTimer.
+ *
+ * If util::PerfCounters::Enabled() is set (with --perf_counters), each timer
+ * also counts the hardware events (cycles, instructions, cache misses, and
+ * floating-point operations) of the threads that run it.
  */
 class Timer
 {
  public:
+  //! A handle to a timer, which can be started and stopped without looking up
+  //! the name of the timer.
+  typedef size_t Handle;
+
   /**
    * Start the given timer.  If a timer is started, then stopped, then
    * re-started, then re-stopped, the final value of the timer is the length of
@@ -76,7 +101,7 @@ class Timer
    * run, and do not reset.
    *
    * @note A std::runtime_error exception will be thrown if a timer is started
-   * twice.
+   * twice (by the same thread).
    *
    * @param name Name of timer to be started.
    */
@@ -85,8 +110,8 @@ class Timer
   /**
    * Stop the given timer.
    *
-   * @note A std::runtime_error exception will be thrown if a timer is started
-   * twice.
+   * @note A std::runtime_error exception will be thrown if a timer is stopped
+   * twice (by the same thread).
    *
    * @param name Name of timer to be stopped.
    */
@@ -98,18 +123,87 @@ class Timer
    * @param name Name of timer to return value of.
    */
   static timeval Get(const std::string& name);
+
+  /**
+   * Get a handle to the timer with the given name, creating the timer if it
+   * does not exist.  The handle is valid until CLI::Destroy() is called.
+   *
+   * @param name Name of the timer.
+   */
+  static Handle Register(const std::string& name);
+
+  //! Start the timer with the given handle.
+  static void Start(const Handle handle);
+  //! Stop the timer with the given handle.
+  static void Stop(const Handle handle);
+
+  //! Get the total time of the given timer, in nanoseconds.
+  static uint64_t Nanoseconds(const std::string& name);
+  //! Get the number of completed runs of the given timer.
+  static uint64_t Runs(const std::string& name);
+  //! Get the total count of a hardware event (see util::PerfCounters) in the
+  //! completed runs of the given timer.
+  static uint64_t Counter(const std::string& name, const size_t counter);
+
+  /**
+   * Add to the number of bytes processed by the given timer, so that its
+   * throughput is reported with it.
+   *
+   * @param name Name of the timer.
+   * @param bytes Number of bytes to add.
+   */
+  static void AddBytes(const std::string& name, const uint64_t bytes);
+
+  //! Save every timer as JSON (see Timers::SaveJSON()).
+  static void SaveJSON(std::ostream& stream);
+};
+
+/**
+ * A ScopedTimer starts a timer when it is constructed and stops it when it is
+ * destroyed.  A ScopedTimer created with a name is nested in the scoped timers
+ * that are active in the same thread: ScopedTimer("assignment") inside
+ * ScopedTimer("iteration") inside ScopedTimer("clustering") times
+ * "clustering/iteration/assignment".  A ScopedTimer created with a handle uses
+ * the full name of the handle and looks nothing up, but timers nested inside
+ * it are still named after it.
+ *
+ * @code
+ * const Timer::Handle assignment =
+ *     Timer::Register("clustering/iteration/assignment");
+ * for (size_t i = 0; i < blocks; ++i)
+ * {
+ *   ScopedTimer t(assignment);
+ *   ...
+ * }
+ * @endcode
+ */
+class ScopedTimer
+{
+ public:
+  //! Start the timer with the given name, nested in the active scoped timers.
+  explicit ScopedTimer(const std::string& name);
+  //! Start the timer with the given handle.
+  explicit ScopedTimer(const Timer::Handle handle);
+  //! Stop the timer.
+  ~ScopedTimer();
+
+ private:
+  //! The timer.
+  Timer::Handle handle;
 };
 
 class Timers
 {
  public:
-  //! Nothing to do for the constructor.
-  Timers() { }
+  //! Create an empty set of timers.
+  Timers();
+  //! Destroy the timers.
+  ~Timers();
 
   /**
-   * Returns a copy of all the timers used via this interface.
+   * Get the names of all the timers used via this interface.
    */
-  std::map<std::string, timeval>& GetAllTimers();
+  std::vector<std::string> GetAllTimers() const;
 
   /**
    * Returns a copy of the timer specified.
@@ -118,47 +212,147 @@ class Timers
    */
   timeval GetTimer(const std::string& timerName);
 
+  //! Get the total time of a timer, in nanoseconds.
+  uint64_t Nanoseconds(const std::string& timerName);
+  //! Get the number of completed runs of a timer.
+  uint64_t Runs(const std::string& timerName);
+  //! Get the total count of a hardware event in the completed runs of a timer.
+  uint64_t Counter(const std::string& timerName, const size_t counter);
+  //! Add to the number of bytes processed by a timer.
+  void AddBytes(const std::string& timerName, const uint64_t bytes);
+
   /**
    * Prints the specified timer.  If it took longer than a minute to complete
-   * the timer will be displayed in days, hours, and minutes as well.
+   * the timer will be displayed in days, hours, and minutes as well.  If
+   * hardware events were counted, they are printed on a second line, with the
+   * instructions per cycle, the cache miss rate, and the GFLOP/s.  If bytes
+   * were added to the timer, the throughput is printed too.
    *
    * @param timerName The name of the timer in question.
    */
   void PrintTimer(const std::string& timerName);
 
   /**
-   * Initializes a timer, available like a normal value specified on
-   * the command line.  Timers are of type timeval.  If a timer is started, then
-   * stopped, then re-started, then stopped, the final timer value will be the
-   * length of both runs of the timer.
-   *
-   * @param timerName The name of the timer in question.
-   */
+   * Save every timer as JSON.  Nested timers (with names separated by '/') are
+   * nested objects; each timer has its total time, number of runs, and the
+   * runs and time of each thread that ran it, the bytes processed (if any),
+   * and the hardware events counted (if any).
+   *
+   * @param stream Stream to write to.
+   */
+  void SaveJSON(std::ostream& stream);
+
+  //! Get a handle to the timer with the given name, creating it if necessary.
+  Timer::Handle Register(const std::string& timerName);
+  //! Get the name of the timer with the given handle.
+  std::string Name(const Timer::Handle handle);
+
+  /**
+   * Initializes a timer, available like a normal value specified on
+   * the command line.  If a timer is started, then stopped, then re-started,
+   * then stopped, the final timer value will be the length of both runs of the
+   * timer.
+   *
+   * @param timerName The name of the timer in question.
+   */
   void StartTimer(const std::string& timerName);
+  //! Start the timer with the given handle.
+  void StartTimer(const Timer::Handle handle);
 
   /**
-   * Halts the timer, and replaces it's value with
-   * the delta time from it's start
-   *
-   * @param timerName The name of the timer in question.
-   */
+   * Halts the timer, and adds the time since it was started to its value.
+   *
+   * @param timerName The name of the timer in question.
+   */
   void StopTimer(const std::string& timerName);
+  //! Stop the timer with the given handle.
+  void StopTimer(const Timer::Handle handle);
 
   /**
-   * Returns state of the given timer.
-   * 
+   * Returns whether the given timer is running in the calling thread.
+   *
    * @param timerName The name of the timer in question.
    */
   bool GetState(std::string timerName);
-  
+
+  //! Stop every timer running in the calling thread.
+  void StopAllTimers();
+
+  //! Push a timer on the calling thread's stack of scoped timers.
+  void PushScope(const Timer::Handle handle);
+  //! Pop the calling thread's innermost scoped timer.
+  void PopScope();
+  //! Get the full name of a timer nested in the calling thread's innermost
+  //! scoped timer.
+  std::string ScopedName(const std::string& timerName);
+
  private:
-  //! A map of all the timers that are being tracked.
-  std::map<std::string, timeval> timers;
-  //! A map that contains whether or not each timer is currently running.
-  std::map<std::string, bool> timerState;
+  //! The totals of a timer.
+  struct Record
+  {
+    Record(const std::string& name) :
+        name(name), nanoseconds(0), runs(0), bytes(0), counted(0)
+    {
+      for (size_t c = 0; c < util::PerfCounters::Count; ++c)
+        counters[c] = 0;
+    }
+
+    std::string name;
+    std::atomic<uint64_t> nanoseconds;
+    std::atomic<uint64_t> runs;
+    //! The number of bytes processed (see Timer::AddBytes()).
+    std::atomic<uint64_t> bytes;
+    //! The hardware events counted in the completed runs.
+    std::atomic<uint64_t> counters[util::PerfCounters::Count];
+    //! Bit c is set if counter c was available in some run.
+    std::atomic<unsigned int> counted;
+  };
+
+  //! The state of a timer in one thread.
+  struct Slot
+  {
+    Slot(Record* record) :
+        record(record), running(false), counting(false), nanoseconds(0),
+        runs(0) { }
+
+    Record* record;
+    std::chrono::steady_clock::time_point start;
+    bool running;
+    //! Whether hardware events are counted in the current run.
+    bool counting;
+    //! The hardware counters when the current run started.
+    uint64_t startCounters[util::PerfCounters::Count];
+    std::atomic<uint64_t> nanoseconds;
+    std::atomic<uint64_t> runs;
+  };
+
+  //! The timers of one thread.
+  struct ThreadState;
+
+  //! Get the calling thread's timers.
+  ThreadState& LocalState();
+  //! Get the calling thread's state of the given timer.
+  Slot& LocalSlot(const Timer::Handle handle);
+  //! Get the calling thread's hardware counters, opening them if necessary.
+  util::PerfCounters& LocalCounters();
+  //! Keep the statistics of a thread which is exiting.
+  void Retire(ThreadState& state);
 
-  void FileTimeToTimeVal(timeval* tv);
-  void GetTime(timeval* tv);
+  //! Lock for everything below.
+  mutable std::mutex mutex;
+  //! The handle of each timer name.
+  std::map<std::string, Timer::Handle> handles;
+  //! The totals of each timer, indexed by handle.
+  std::deque<Record> records;
+  //! The timers of each thread which is running.
+  std::vector<ThreadState*> threads;
+  //! The runs and time of threads which have exited, by thread and handle.
+  std::map<std::pair<size_t, Timer::Handle>,
+      std::pair<uint64_t, uint64_t> > retired;
+  //! The index to give to the next thread.
+  size_t nextThread;
+  //! Unique identifier of this object.
+  uint64_t id;
 };
 
 } // namespace mlpack
@@ -48,5 +48,5 @@ int main(int argc, char** argv)
     probabilities[i] = gmm.Probability(dataset.unsafe_col(i));
 
   // And save the result.
-  data::Save(CLI::GetParam<string>("output_file"), probabilities);
+  data::SaveResult(CLI::GetParam<string>("output_file"), probabilities);
 }
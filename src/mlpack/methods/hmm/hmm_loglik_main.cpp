@@ -62,6 +62,8 @@ struct Loglik
 
     const double loglik = hmm.LogLikelihood(dataSeq);
 
+    // The result is written after the log output.
+    Log::Flush();
     cout << loglik << endl;
   }
 };
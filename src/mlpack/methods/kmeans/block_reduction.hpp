@@ -0,0 +1,211 @@
+/**
+ * @file block_reduction.hpp
+ *
+ * Parallel reductions over blocks of points, with an optional deterministic
+ * mode whose result does not depend on the number of threads.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_BLOCK_REDUCTION_HPP
+#define __MLPACK_METHODS_KMEANS_BLOCK_REDUCTION_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Partial results of a Lloyd iteration over some of the points: the sum of the
+ * points assigned to each cluster, the number of points in each cluster, and
+ * (optionally) the sum of squared distances of the points in each cluster.
+ */
+struct ClusterPartial
+{
+  //! Sum of the points assigned to each cluster.
+  arma::mat sums;
+  //! Number of points assigned to each cluster.
+  arma::Col<size_t> counts;
+  //! Sum of squared distances of the points in each cluster (may be empty).
+  arma::vec variances;
+
+  //! Set the partial results to zero for the given dimensionality and number
+  //! of clusters.  This does not reallocate memory if the size is unchanged.
+  void Reset(const size_t dimensionality,
+             const size_t clusters,
+             const bool withVariances)
+  {
+    sums.zeros(dimensionality, clusters);
+    counts.zeros(clusters);
+    if (withVariances)
+      variances.zeros(clusters);
+    else
+      variances.reset();
+  }
+
+  //! Add the partial results of other points.
+  ClusterPartial& operator+=(const ClusterPartial& other)
+  {
+    sums += other.sums;
+    counts += other.counts;
+    if (variances.n_elem > 0)
+      variances += other.variances;
+    return *this;
+  }
+};
+
+/**
+ * BlockReduction computes a sum over a range of items (usually points) in
+ * parallel, on the shared util::ThreadPool.  The items are split into blocks of
+ * a fixed size; the caller accumulates each block into a partial result, and
+ * the partial results are summed.
+ *
+ * In the default (fast) mode, one task per thread takes blocks until there are
+ * none left, accumulating them into its own partial result, and the per-task
+ * results are added at the end.  This is as fast as possible, but
+ * floating-point addition is not associative, so the result depends on the
+ * number of threads and on which task takes each block.
+ *
+ * In the deterministic mode (see Deterministic()), every block is accumulated
+ * into its own partial result, and the partial results are added with a
+ * pairwise tree whose shape depends only on the number of blocks.  To bound the
+ * memory used, the blocks are processed in waves of WaveSize blocks: each wave
+ * is reduced by a tree, and the wave results are added in order.  The result is
+ * then identical for any number of threads.  The overhead compared to the fast
+ * mode is:
+ *
+ *  - memory for WaveSize partial results instead of one per thread;
+ *  - one addition of a partial result per block instead of per thread, which
+ *    for the Lloyd step is O(d k) per block of BlockSize points, compared to
+ *    the O(d k) per point spent on distances (so about 1 / BlockSize extra);
+ *  - a synchronization point per level of the tree in each wave, which matters
+ *    mostly for small datasets.
+ *
+ * block_reduction_benchmark.cpp (mlpack_block_reduction_benchmark) times both
+ * modes on the reduction of a naive Lloyd iteration; run it with --threads to
+ * compare them at a given number of threads.
+ *
+ * Integer results (such as counts) are exact either way; only floating-point
+ * sums are affected by the mode.
+ */
+class BlockReduction
+{
+ public:
+  //! Number of points in each block.
+  static const size_t BlockSize = 4096;
+  //! Number of blocks reduced together in the deterministic mode.
+  static const size_t WaveSize = 64;
+
+  //! Modify whether reductions are deterministic (independent of the number of
+  //! threads).  The default is false.
+  static bool& Deterministic()
+  {
+    static bool deterministic = false;
+    return deterministic;
+  }
+
+  /**
+   * Reduce over the items [0, items).  Blocks of at most blockSize items are
+   * accumulated with accumulate(partial, begin, end), which must process the
+   * items in [begin, end) in order and may be called from several threads at
+   * once (with different partial results).  It runs on the threads of the
+   * shared util::ThreadPool, and unless it waits for other tasks itself, it may
+   * use util::ThreadPool::ThreadIndex() to index per-thread scratch memory.
+   * Partial results are zeroed with reset(partial) and added with operator+=.
+   *
+   * @param items Number of items.
+   * @param blockSize Number of items in each block.
+   * @param partials Storage for partial results, reused between calls.
+   * @param reset Function which zeroes a partial result.
+   * @param accumulate Function which accumulates a block into a partial result.
+   * @param result The sum of all the blocks (output).
+   */
+  template<typename PartialType, typename ResetType, typename AccumulateType>
+  static void Reduce(const size_t items,
+                     const size_t blockSize,
+                     std::vector<PartialType>& partials,
+                     ResetType reset,
+                     AccumulateType accumulate,
+                     PartialType& result)
+  {
+    const size_t blocks = (items + blockSize - 1) / blockSize;
+    reset(result);
+
+    util::ThreadPool& pool = util::ThreadPool::Global();
+
+    if (!Deterministic())
+    {
+      // Each task has its own partial result (rather than each thread, since a
+      // thread waiting for other work may run several tasks).
+      const size_t tasks = std::max(std::min(blocks, pool.Threads()),
+          (size_t) 1);
+      if (partials.size() < tasks)
+        partials.resize(tasks);
+
+      std::atomic<size_t> nextBlock(0);
+      util::TaskGroup group(pool);
+      for (size_t t = 0; t < tasks; ++t)
+      {
+        reset(partials[t]);
+        group.Run([&, t]()
+        {
+          for (size_t b = nextBlock++; b < blocks; b = nextBlock++)
+            accumulate(partials[t], b * blockSize,
+                std::min((b + 1) * blockSize, items));
+        });
+      }
+      group.Wait();
+
+      for (size_t t = 0; t < tasks; ++t)
+        result += partials[t];
+
+      return;
+    }
+
+    if (partials.size() < WaveSize)
+      partials.resize(WaveSize);
+
+    for (size_t waveBegin = 0; waveBegin < blocks; waveBegin += WaveSize)
+    {
+      const size_t waveBlocks = std::min((size_t) WaveSize,
+          blocks - waveBegin);
+
+      pool.ParallelFor(0, waveBlocks, 1, [&](const size_t begin,
+                                             const size_t end)
+      {
+        for (size_t w = begin; w < end; ++w)
+        {
+          const size_t b = waveBegin + w;
+          reset(partials[w]);
+          accumulate(partials[w], b * blockSize,
+              std::min((b + 1) * blockSize, items));
+        }
+      });
+
+      // Add the partial results with a pairwise tree: at each level, block w
+      // absorbs block w + stride, for every w that is a multiple of
+      // 2 * stride.
+      for (size_t stride = 1; stride < waveBlocks; stride *= 2)
+      {
+        const size_t pairs = (waveBlocks - stride + 2 * stride - 1) /
+            (2 * stride);
+        pool.ParallelFor(0, pairs, 1, [&](const size_t begin, const size_t end)
+        {
+          for (size_t p = begin; p < end; ++p)
+            partials[2 * stride * p] += partials[2 * stride * p + stride];
+        });
+      }
+
+      result += partials[0];
+    }
+  }
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * @file block_reduction_benchmark.cpp
+ *
+ * A small benchmark of the fast and deterministic modes of BlockReduction,
+ * using the reduction of a naive Lloyd iteration.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include <mlpack/core.hpp>
+#include "block_reduction.hpp"
+
+PROGRAM_INFO("BlockReduction benchmark", "This program times the reduction of "
+    "a naive Lloyd iteration (the assignment of every point to its closest "
+    "centroid, and the sums of the points in each cluster) with BlockReduction "
+    "in its fast mode and in its deterministic mode.  The points are drawn "
+    "uniformly at random, and the first points are used as the centroids."
+    "\n\n"
+    "Give --threads to choose the number of threads, and --verbose to see the "
+    "timers 'fast_reduction' and 'deterministic_reduction', which cover all "
+    "the iterations of each mode.");
+
+PARAM_INT("points", "Number of points.", "n", 1000000);
+PARAM_INT("dimensionality", "Dimensionality of the points.", "d", 10);
+PARAM_INT("clusters", "Number of clusters.", "c", 100);
+PARAM_INT("iterations", "Number of iterations timed in each mode.", "I", 10);
+PARAM_INT("seed", "Random seed.  If 0, 'std::time(NULL)' is used.", "s", 0);
+
+using namespace mlpack;
+using namespace mlpack::kmeans;
+using namespace std;
+
+// Run the given number of reductions in the current mode of BlockReduction.
+void Reduce(const arma::mat& dataset,
+            const arma::mat& centroids,
+            const size_t iterations,
+            ClusterPartial& result)
+{
+  std::vector<ClusterPartial> partials;
+  for (size_t iteration = 0; iteration < iterations; ++iteration)
+  {
+    BlockReduction::Reduce(dataset.n_cols, BlockReduction::BlockSize, partials,
+        [&centroids](ClusterPartial& partial)
+        {
+          partial.Reset(centroids.n_rows, centroids.n_cols, false);
+        },
+        [&dataset, &centroids](ClusterPartial& partial, const size_t begin,
+                               const size_t end)
+        {
+          for (size_t i = begin; i < end; ++i)
+          {
+            const double* point = dataset.colptr(i);
+            size_t closest = 0;
+            double minDistance = DBL_MAX;
+            for (size_t c = 0; c < centroids.n_cols; ++c)
+            {
+              const double* centroid = centroids.colptr(c);
+              double distance = 0.0;
+              for (size_t d = 0; d < dataset.n_rows; ++d)
+                distance += (point[d] - centroid[d]) * (point[d] - centroid[d]);
+
+              if (distance < minDistance)
+              {
+                minDistance = distance;
+                closest = c;
+              }
+            }
+
+            double* sum = partial.sums.colptr(closest);
+            for (size_t d = 0; d < dataset.n_rows; ++d)
+              sum[d] += point[d];
+            ++partial.counts[closest];
+          }
+        }, result);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  CLI::ParseCommandLine(argc, argv);
+
+  if (CLI::GetParam<int>("seed") != 0)
+    math::RandomSeed((size_t) CLI::GetParam<int>("seed"));
+  else
+    math::RandomSeed((size_t) std::time(NULL));
+
+  const int points = CLI::GetParam<int>("points");
+  const int dimensionality = CLI::GetParam<int>("dimensionality");
+  const int clusters = CLI::GetParam<int>("clusters");
+  const int iterations = CLI::GetParam<int>("iterations");
+  if (points <= 0 || dimensionality <= 0 || clusters <= 0 || iterations <= 0)
+    Log::Fatal << "--points, --dimensionality, --clusters and --iterations must "
+        << "be positive." << endl;
+  if (clusters > points)
+    Log::Fatal << "--clusters (" << clusters << ") must not be larger than "
+        << "--points (" << points << ")." << endl;
+
+  arma::mat dataset((size_t) dimensionality, (size_t) points, arma::fill::randu);
+  const arma::mat centroids(dataset.cols(0, (size_t) clusters - 1));
+
+  ClusterPartial fast, deterministic;
+
+  BlockReduction::Deterministic() = false;
+  Timer::Start("fast_reduction");
+  Reduce(dataset, centroids, (size_t) iterations, fast);
+  Timer::Stop("fast_reduction");
+
+  BlockReduction::Deterministic() = true;
+  Timer::Start("deterministic_reduction");
+  Reduce(dataset, centroids, (size_t) iterations, deterministic);
+  Timer::Stop("deterministic_reduction");
+
+  // The counts are exact in both modes; the sums may differ by rounding.
+  if (arma::any(fast.counts != deterministic.counts))
+    Log::Fatal << "The counts of the two modes differ!" << endl;
+
+  Log::Info << "Largest difference between the sums of the two modes: "
+      << arma::abs(fast.sums - deterministic.sums).max() << "." << endl;
+}
@@ -22,6 +22,8 @@
 #include <mlpack/core/tree/cover_tree.hpp>
 
 #include "dual_tree_kmeans_statistic.hpp"
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
 
 namespace mlpack {
 namespace kmeans {
@@ -54,9 +56,12 @@ class DualTreeKMeans
 
   /**
    * Construct the DualTreeKMeans object, which will construct a tree on the
-   * points.
+   * points.  The workspace is not used; all bounds are stored in the tree.
    */
-  DualTreeKMeans(const MatType& dataset, MetricType& metric);
+  DualTreeKMeans(const MatType& dataset,
+                 MetricType& metric,
+                 LloydWorkspace& workspace,
+                 const LloydStepOptions& options = LloydStepOptions());
 
   /**
    * Delete the tree constructed by the DualTreeKMeans object.
@@ -112,6 +117,12 @@ class DualTreeKMeans
 
   arma::mat interclusterDistances; // Static storage for intercluster distances.
 
+  //! Timers of the update of the bounds in the tree, the dual-tree traversal,
+  //! and the update of the centroids, registered once.
+  Timer::Handle treeUpdateTimer;
+  Timer::Handle traversalTimer;
+  Timer::Handle updateTimer;
+
   //! Update the bounds in the tree before the next iteration.
   //! centroids is the current (not yet searched) centroids.
   void UpdateTree(Tree& node,
@@ -160,6 +171,11 @@ void RestoreChildren(TreeType& node,
                      const typename boost::enable_if_c<tree::TreeTraits<
                          TreeType>::BinaryTree>::type* junk = 0);
 
+//! Utility function for setting the true parent and children held by the
+//! statistic of each node to the current ones, after the nodes are moved.
+template<typename TreeType>
+void UpdateTrueLinks(TreeType& node);
+
 //! A template typedef for the DualTreeKMeans algorithm with the default tree
 //! type (a kd-tree).
 template<typename MetricType, typename MatType>
@@ -58,7 +58,9 @@ template<typename MetricType,
                   typename TreeMatType> class TreeType>
 DualTreeKMeans<MetricType, MatType, TreeType>::DualTreeKMeans(
     const MatType& dataset,
-    MetricType& metric) :
+    MetricType& metric,
+    LloydWorkspace& /* workspace */,
+    const LloydStepOptions& /* options */) :
     datasetOrig(dataset),
     tree(new Tree(const_cast<MatType&>(dataset))),
     dataset(tree->Dataset()),
@@ -69,7 +71,10 @@ DualTreeKMeans<MetricType, MatType, TreeType>::DualTreeKMeans(
     lowerBounds(dataset.n_cols),
     prunedPoints(dataset.n_cols, false), // Fill with false.
     assignments(dataset.n_cols),
-    visited(dataset.n_cols, false) // Fill with false.
+    visited(dataset.n_cols, false), // Fill with false.
+    treeUpdateTimer(Timer::Register("clustering/tree_update")),
+    traversalTimer(Timer::Register("clustering/tree_traversal")),
+    updateTimer(Timer::Register("clustering/update"))
 {
   for (size_t i = 0; i < dataset.n_cols; ++i)
   {
@@ -79,6 +84,11 @@ DualTreeKMeans<MetricType, MatType, TreeType>::DualTreeKMeans(
   assignments.fill(size_t(-1));
   upperBounds.fill(DBL_MAX);
   lowerBounds.fill(DBL_MAX);
+
+  // Store the nodes of the tree together, for faster traversals; the nodes are
+  // moved, so the links held by the statistics are updated.
+  tree::CompactTree(*tree);
+  UpdateTrueLinks(*tree);
 }
 
 template<typename MetricType,
@@ -141,7 +151,9 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
 
     Timer::Stop("knn");
 
+    Timer::Start(treeUpdateTimer);
     UpdateTree(*tree, oldCentroids);
+    Timer::Stop(treeUpdateTimer);
 
     for (size_t i = 0; i < dataset.n_cols; ++i)
       visited[i] = false;
@@ -168,7 +180,9 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
 
   // Set the number of pruned centroids in the root to 0.
   tree->Stat().Pruned() = 0;
+  Timer::Start(traversalTimer);
   traverser.Traverse(*tree, *centroidTree);
+  Timer::Stop(traversalTimer);
   distanceCalculations += rules.BaseCases() + rules.Scores();
 
   Timer::Start("tree_mod");
@@ -176,6 +190,7 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
   Timer::Stop("tree_mod");
 
   // Now we need to extract the clusters.
+  Timer::Start(updateTimer);
   newCentroids.zeros(centroids.n_rows, centroids.n_cols);
   counts.zeros(centroids.n_cols);
   ExtractCentroids(*tree, newCentroids, counts, oldCentroids);
@@ -206,6 +221,7 @@ double DualTreeKMeans<MetricType, MatType, TreeType>::Iterate(
     }
   }
   distanceCalculations += centroids.n_cols;
+  Timer::Stop(updateTimer);
 
   delete centroidTree;
 
@@ -692,6 +708,18 @@ void RestoreChildren(TreeType& node,
   }
 }
 
+//! Utility function for setting the true parent and children of each node.
+template<typename TreeType>
+void UpdateTrueLinks(TreeType& node)
+{
+  node.Stat().TrueParent() = node.Parent();
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    node.Stat().TrueChild(i) = &node.Child(i);
+    UpdateTrueLinks(node.Child(i));
+  }
+}
+
 } // namespace kmeans
 } // namespace mlpack
 
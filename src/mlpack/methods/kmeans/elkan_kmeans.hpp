@@ -14,6 +14,10 @@
 #ifndef __MLPACK_METHODS_KMEANS_ELKAN_KMEANS_HPP
 #define __MLPACK_METHODS_KMEANS_ELKAN_KMEANS_HPP
 
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
+#include "max_variance_new_cluster.hpp"
+
 namespace mlpack {
 namespace kmeans {
 
@@ -24,7 +28,10 @@ class ElkanKMeans
   /**
    * Construct the ElkanKMeans object, which must store several sets of bounds.
    */
-  ElkanKMeans(const MatType& dataset, MetricType& metric);
+  ElkanKMeans(const MatType& dataset,
+              MetricType& metric,
+              LloydWorkspace& workspace,
+              const LloydStepOptions& options = LloydStepOptions());
 
   /**
    * Run a single iteration of Elkan's algorithm, updating the given centroids
@@ -38,6 +45,20 @@ class ElkanKMeans
                  arma::mat& newCentroids,
                  arma::Col<size_t>& counts);
 
+  /**
+   * Handle an empty cluster by taking the point furthest from the centroid of
+   * the cluster with maximum variance (see MaxVarianceNewCluster).
+   *
+   * @return Number of points changed.
+   */
+  int EmptyClusterAdjust(const MatType& data,
+                         const size_t emptyCluster,
+                         const arma::mat& oldCentroids,
+                         arma::mat& newCentroids,
+                         arma::Col<size_t>& clusterCounts,
+                         MetricType& metric,
+                         const size_t iteration);
+
   size_t DistanceCalculations() const { return distanceCalculations; }
 
  private:
@@ -45,6 +66,8 @@ class ElkanKMeans
   const MatType& dataset;
   //! The instantiated metric.
   MetricType& metric;
+  //! Scratch memory reused by every iteration.
+  LloydWorkspace& workspace;
 
   //! Holds intra-cluster distances.
   arma::mat clusterDistances;
@@ -59,8 +82,24 @@ class ElkanKMeans
   //! Lower bounds on the distance between each point and each cluster.
   arma::mat lowerBounds;
 
+  //! Policy used to fill empty clusters.
+  MaxVarianceNewCluster emptyClusterPolicy;
+
   //! Track distance calculations.
   size_t distanceCalculations;
+
+  //! The centroids before the last call to EmptyClusterAdjust(), kept up to
+  //! date for the moved columns.
+  arma::mat previousCentroids;
+  //! The cluster counts before the last call to EmptyClusterAdjust().
+  arma::Col<size_t> previousCounts;
+  //! The iteration in which previousCentroids was copied.
+  size_t adjustIteration;
+
+  //! Timers of the phases of each iteration, registered once.
+  Timer::Handle boundsTimer;
+  Timer::Handle assignmentTimer;
+  Timer::Handle updateTimer;
 };
 
 } // namespace kmeans
@@ -22,20 +22,80 @@ namespace kmeans {
 
 template<typename MetricType, typename MatType>
 ElkanKMeans<MetricType, MatType>::ElkanKMeans(const MatType& dataset,
-                                              MetricType& metric) :
+                                              MetricType& metric,
+                                              LloydWorkspace& workspace,
+                                              const LloydStepOptions& options) :
     dataset(dataset),
     metric(metric),
-    distanceCalculations(0)
+    workspace(workspace),
+    emptyClusterPolicy(options.mixedPrecision ? &workspace : NULL),
+    distanceCalculations(0),
+    adjustIteration(size_t(-1)),
+    boundsTimer(Timer::Register("clustering/bounds")),
+    assignmentTimer(Timer::Register("clustering/assignment")),
+    updateTimer(Timer::Register("clustering/update"))
 {
 
 }
 
+template<typename MetricType, typename MatType>
+int ElkanKMeans<MetricType, MatType>::EmptyClusterAdjust(
+    const MatType& data,
+    const size_t emptyCluster,
+    const arma::mat& oldCentroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& clusterCounts,
+    MetricType& metric,
+    const size_t iteration)
+{
+  // The policy moves centroids (the empty one, and the one it takes a point
+  // from) after Iterate() has updated the bounds, so steps 5 and 6 have to be
+  // done again for these movements.
+  //
+  // The centroids are copied once per iteration, before the first empty
+  // cluster is filled, and afterwards only the moved columns are updated.  The
+  // moved centroids are the ones whose counts the policy changed.
+  if (adjustIteration != iteration)
+  {
+    previousCentroids = newCentroids;
+    adjustIteration = iteration;
+  }
+  previousCounts = clusterCounts;
+
+  const int changed = (int) emptyClusterPolicy.EmptyCluster(data,
+      emptyCluster, oldCentroids, newCentroids, clusterCounts, metric,
+      iteration);
+
+  for (size_t c = 0; c < newCentroids.n_cols; ++c)
+  {
+    if (clusterCounts[c] == previousCounts[c])
+      continue;
+
+    const double movement = metric.Evaluate(previousCentroids.col(c),
+                                            newCentroids.col(c));
+    previousCentroids.col(c) = newCentroids.col(c);
+    ++distanceCalculations;
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      lowerBounds(c, i) -= movement;
+      if (assignments[i] == c)
+        upperBounds(i) += movement;
+    }
+  }
+
+  return changed;
+}
+
 // Run a single iteration of Elkan's algorithm for Lloyd iterations.
 template<typename MetricType, typename MatType>
 double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
                                                  arma::mat& newCentroids,
                                                  arma::Col<size_t>& counts)
 {
+  // Each phase has its own timer (and hardware counters, with
+  // --perf_counters), run once per iteration.
+  Timer::Start(boundsTimer);
+
   // Clear new centroids.
   newCentroids.zeros(centroids.n_rows, centroids.n_cols);
   counts.zeros(centroids.n_cols);
@@ -49,7 +109,8 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
   clusterDistances.diag().fill(DBL_MAX);
 
   // Initially set r(x) to true.
-  std::vector<bool> mustRecalculate(dataset.n_cols, true);
+  std::vector<bool>& mustRecalculate = workspace.PointFlags();
+  mustRecalculate.assign(dataset.n_cols, true);
 
   // If this is the first iteration, we must reset all the bounds.
   if (lowerBounds.n_rows != centroids.n_cols)
@@ -79,9 +140,13 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
 
   // Now find the closest cluster to each other cluster.  We multiply by 0.5 so
   // that this is equivalent to s(c) for each cluster c.
-  minClusterDistances = 0.5 * arma::min(clusterDistances).t();
+  minClusterDistances.set_size(centroids.n_cols);
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+    minClusterDistances(c) = 0.5 * clusterDistances.col(c).min();
+  Timer::Stop(boundsTimer);
 
   // Now loop over all points, and see which ones need to be updated.
+  Timer::Start(assignmentTimer);
   for (size_t i = 0; i < dataset.n_cols; ++i)
   {
     // Step 2: identify all points such that u(x) <= s(c(x)).
@@ -154,16 +219,18 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     newCentroids.col(assignments[i]) += arma::vec(dataset.col(i));
     counts[assignments[i]]++;
   }
+  Timer::Stop(assignmentTimer);
 
   // Now, normalize and calculate the distance each cluster has moved.
-  arma::vec moveDistances(centroids.n_cols);
+  Timer::Start(updateTimer);
+  arma::vec& moveDistances = workspace.ClusterValues();
   double cNorm = 0.0; // Cluster movement for residual.
   for (size_t c = 0; c < centroids.n_cols; ++c)
   {
     if (counts[c] > 0)
       newCentroids.col(c) /= counts[c];
     else
-      newCentroids.fill(DBL_MAX); // Fill with invalid value.
+      newCentroids.col(c).fill(DBL_MAX); // Fill with invalid value.
 
     moveDistances(c) = metric.Evaluate(newCentroids.col(c), centroids.col(c));
     cNorm += std::pow(moveDistances(c), 2.0);
@@ -183,6 +250,7 @@ double ElkanKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     //   r(x) = true (we are setting that at the start of every iteration).
     upperBounds(i) += moveDistances(assignments[i]);
   }
+  Timer::Stop(updateTimer);
 
   return std::sqrt(cNorm);
 }
@@ -14,6 +14,10 @@
 #ifndef __MLPACK_METHODS_KMEANS_HAMERLY_KMEANS_HPP
 #define __MLPACK_METHODS_KMEANS_HAMERLY_KMEANS_HPP
 
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
+#include "max_variance_new_cluster.hpp"
+
 namespace mlpack {
 namespace kmeans {
 
@@ -25,7 +29,10 @@ class HamerlyKMeans
    * Construct the HamerlyKMeans object, which must store several sets of
    * bounds.
    */
-  HamerlyKMeans(const MatType& dataset, MetricType& metric);
+  HamerlyKMeans(const MatType& dataset,
+                MetricType& metric,
+                LloydWorkspace& workspace,
+                const LloydStepOptions& options = LloydStepOptions());
 
   /**
    * Run a single iteration of Hamerly's algorithm, updating the given centroids
@@ -39,6 +46,20 @@ class HamerlyKMeans
                  arma::mat& newCentroids,
                  arma::Col<size_t>& counts);
 
+  /**
+   * Handle an empty cluster by taking the point furthest from the centroid of
+   * the cluster with maximum variance (see MaxVarianceNewCluster).
+   *
+   * @return Number of points changed.
+   */
+  int EmptyClusterAdjust(const MatType& data,
+                         const size_t emptyCluster,
+                         const arma::mat& oldCentroids,
+                         arma::mat& newCentroids,
+                         arma::Col<size_t>& clusterCounts,
+                         MetricType& metric,
+                         const size_t iteration);
+
   size_t DistanceCalculations() const { return distanceCalculations; }
 
  private:
@@ -46,6 +67,8 @@ class HamerlyKMeans
   const MatType& dataset;
   //! The instantiated metric.
   MetricType& metric;
+  //! Scratch memory reused by every iteration.
+  LloydWorkspace& workspace;
 
   //! Minimum cluster distances from each cluster.
   arma::vec minClusterDistances;
@@ -57,8 +80,24 @@ class HamerlyKMeans
   //! Assignments for each point.
   arma::Col<size_t> assignments;
 
+  //! Policy used to fill empty clusters.
+  MaxVarianceNewCluster emptyClusterPolicy;
+
   //! Track distance calculations.
   size_t distanceCalculations;
+
+  //! The centroids before the last call to EmptyClusterAdjust(), kept up to
+  //! date for the moved columns.
+  arma::mat previousCentroids;
+  //! The cluster counts before the last call to EmptyClusterAdjust().
+  arma::Col<size_t> previousCounts;
+  //! The iteration in which previousCentroids was copied.
+  size_t adjustIteration;
+
+  //! Timers of the phases of each iteration, registered once.
+  Timer::Handle boundsTimer;
+  Timer::Handle assignmentTimer;
+  Timer::Handle updateTimer;
 };
 
 } // namespace kmeans
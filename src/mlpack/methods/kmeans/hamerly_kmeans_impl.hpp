@@ -22,14 +22,72 @@ namespace kmeans {
 
 template<typename MetricType, typename MatType>
 HamerlyKMeans<MetricType, MatType>::HamerlyKMeans(const MatType& dataset,
-                                                  MetricType& metric) :
+                                                  MetricType& metric,
+                                                  LloydWorkspace& workspace,
+                                                  const LloydStepOptions&
+                                                      options) :
     dataset(dataset),
     metric(metric),
-    distanceCalculations(0)
+    workspace(workspace),
+    emptyClusterPolicy(options.mixedPrecision ? &workspace : NULL),
+    distanceCalculations(0),
+    adjustIteration(size_t(-1)),
+    boundsTimer(Timer::Register("clustering/bounds")),
+    assignmentTimer(Timer::Register("clustering/assignment")),
+    updateTimer(Timer::Register("clustering/update"))
 {
   // Nothing to do.
 }
 
+template<typename MetricType, typename MatType>
+int HamerlyKMeans<MetricType, MatType>::EmptyClusterAdjust(
+    const MatType& data,
+    const size_t emptyCluster,
+    const arma::mat& oldCentroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& clusterCounts,
+    MetricType& metric,
+    const size_t iteration)
+{
+  // The policy moves centroids (the empty one, and the one it takes a point
+  // from) after Iterate() has updated the bounds, so the bounds have to be
+  // updated again for these movements, as in Update-Bounds().
+  //
+  // The centroids are copied once per iteration, before the first empty
+  // cluster is filled, and afterwards only the moved columns are updated.  The
+  // moved centroids are the ones whose counts the policy changed.
+  if (adjustIteration != iteration)
+  {
+    previousCentroids = newCentroids;
+    adjustIteration = iteration;
+  }
+  previousCounts = clusterCounts;
+
+  const int changed = (int) emptyClusterPolicy.EmptyCluster(data,
+      emptyCluster, oldCentroids, newCentroids, clusterCounts, metric,
+      iteration);
+
+  for (size_t c = 0; c < newCentroids.n_cols; ++c)
+  {
+    if (clusterCounts[c] == previousCounts[c])
+      continue;
+
+    const double movement = metric.Evaluate(previousCentroids.col(c),
+                                            newCentroids.col(c));
+    previousCentroids.col(c) = newCentroids.col(c);
+    ++distanceCalculations;
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      if (assignments[i] == c)
+        upperBounds(i) += movement;
+      else
+        lowerBounds(i) -= movement;
+    }
+  }
+
+  return changed;
+}
+
 template<typename MetricType, typename MatType>
 double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
                                                    arma::mat& newCentroids,
@@ -37,6 +95,10 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
 {
   size_t hamerlyPruned = 0;
 
+  // Each phase has its own timer (and hardware counters, with
+  // --perf_counters), run once per iteration.
+  Timer::Start(boundsTimer);
+
   // If this is the first iteration, we need to set all the bounds.
   if (minClusterDistances.n_elem != centroids.n_cols)
   {
@@ -68,7 +130,9 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
         minClusterDistances(j) = dist;
     }
   }
+  Timer::Stop(boundsTimer);
 
+  Timer::Start(assignmentTimer);
   for (size_t i = 0; i < dataset.n_cols; ++i)
   {
     const double m = std::max(minClusterDistances(assignments[i]),
@@ -127,13 +191,15 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     newCentroids.col(assignments[i]) += dataset.col(i);
     ++counts(assignments[i]);
   }
+  Timer::Stop(assignmentTimer);
 
   // Normalize centroids and calculate cluster movement (contains parts of
   // Move-Centers() and Update-Bounds()).
+  Timer::Start(updateTimer);
   double furthestMovement = 0.0;
   double secondFurthestMovement = 0.0;
   size_t furthestMovingCluster = 0;
-  arma::vec centroidMovements(centroids.n_cols);
+  arma::vec& centroidMovements = workspace.ClusterValues();
   double centroidMovement = 0.0;
   for (size_t c = 0; c < centroids.n_cols; ++c)
   {
@@ -170,6 +236,7 @@ double HamerlyKMeans<MetricType, MatType>::Iterate(const arma::mat& centroids,
     else
       lowerBounds(i) -= furthestMovement;
   }
+  Timer::Stop(updateTimer);
 
   Log::Info << "Hamerly prunes: " << hamerlyPruned << ".\n";
 
@@ -0,0 +1,110 @@
+/**
+ * @file kernel_kmeans.hpp
+ *
+ * Kernel k-means clustering on a low-rank approximation of the kernel matrix,
+ * obtained with the Nystroem method.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KERNEL_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_KERNEL_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+#include <mlpack/methods/nystroem_method/nystroem_method.hpp>
+#include <mlpack/methods/nystroem_method/kmeans_selection.hpp>
+#include "kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * KernelKMeans clusters points in the feature space of a kernel, which can
+ * separate clusters that are not linearly separable in the input space.  Exact
+ * kernel k-means needs the N x N kernel matrix, so instead the Nystroem method
+ * is used to compute features G (rank x N) such that the kernel matrix is
+ * approximately G^T G.  Then ordinary (Euclidean) k-means is run on the columns
+ * of G, which costs O(N k rank) per iteration with the default Lloyd step.
+ *
+ * @code
+ * extern arma::mat data;
+ * kernel::GaussianKernel kernel(0.5);
+ * KernelKMeans<kernel::GaussianKernel> kkm(kernel, 100);
+ *
+ * arma::Row<size_t> assignments;
+ * arma::mat centroids;
+ * kkm.Cluster(data, 10, assignments, centroids);
+ * @endcode
+ *
+ * @tparam KernelType Type of kernel (see core/kernels/).
+ * @tparam PointSelectionPolicy Policy used by the Nystroem method to select the
+ *     landmark points.
+ * @tparam ClusteringType Type of k-means to run in the feature space.
+ */
+template<typename KernelType,
+         typename PointSelectionPolicy = kernel::KMeansSelection<>,
+         typename ClusteringType = KMeans<> >
+class KernelKMeans
+{
+ public:
+  /**
+   * Create the KernelKMeans object.
+   *
+   * @param kernel Instantiated kernel.
+   * @param rank Rank of the kernel matrix approximation (the dimensionality of
+   *     the feature space).
+   * @param clustering Instantiated k-means object to run in the feature space.
+   */
+  KernelKMeans(KernelType& kernel,
+               const size_t rank,
+               const ClusteringType& clustering = ClusteringType());
+
+  /**
+   * Cluster the given data.  The centroids are returned in the feature space;
+   * the features themselves can be accessed with Features() afterwards.
+   *
+   * @param data Dataset to cluster.
+   * @param clusters Number of clusters.
+   * @param assignments Cluster assignment of each point (output).
+   * @param centroids Centroids in the feature space (output; rank x clusters).
+   */
+  void Cluster(const arma::mat& data,
+               const size_t clusters,
+               arma::Row<size_t>& assignments,
+               arma::mat& centroids);
+
+  //! Get the rank of the approximation.
+  size_t Rank() const { return rank; }
+  //! Modify the rank of the approximation.
+  size_t& Rank() { return rank; }
+
+  //! Get the features of the last clustered dataset (rank x N).
+  const arma::mat& Features() const { return features; }
+
+  //! Get the k-means object used in the feature space.
+  const ClusteringType& Clustering() const { return clustering; }
+  //! Modify the k-means object used in the feature space.
+  ClusteringType& Clustering() { return clustering; }
+
+ private:
+  //! The instantiated kernel.
+  KernelType& kernel;
+  //! Rank of the approximation.
+  size_t rank;
+  //! The k-means object used in the feature space.
+  ClusteringType clustering;
+  //! Features of the last clustered dataset, one column per point.
+  arma::mat features;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "kernel_kmeans_impl.hpp"
+
+#endif
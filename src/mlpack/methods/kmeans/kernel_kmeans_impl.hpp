@@ -0,0 +1,73 @@
+/**
+ * @file kernel_kmeans_impl.hpp
+ *
+ * Implementation of kernel k-means with the Nystroem method.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KERNEL_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_KERNEL_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kernel_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename KernelType,
+         typename PointSelectionPolicy,
+         typename ClusteringType>
+KernelKMeans<KernelType, PointSelectionPolicy, ClusteringType>::KernelKMeans(
+    KernelType& kernel,
+    const size_t rank,
+    const ClusteringType& clustering) :
+    kernel(kernel),
+    rank(rank),
+    clustering(clustering)
+{
+  // Nothing to do.
+}
+
+template<typename KernelType,
+         typename PointSelectionPolicy,
+         typename ClusteringType>
+void KernelKMeans<KernelType, PointSelectionPolicy, ClusteringType>::Cluster(
+    const arma::mat& data,
+    const size_t clusters,
+    arma::Row<size_t>& assignments,
+    arma::mat& centroids)
+{
+  size_t approximationRank = rank;
+  if (approximationRank > data.n_cols)
+  {
+    Log::Warn << "KernelKMeans::Cluster(): rank (" << rank << ") is greater "
+        << "than the number of points (" << data.n_cols << "); using "
+        << data.n_cols << "." << std::endl;
+    approximationRank = data.n_cols;
+  }
+
+  // The Nystroem method gives G (N x rank) with K ~ G G^T; we want one column
+  // per point.
+  Timer::Start("nystroem_method");
+  arma::mat g;
+  kernel::NystroemMethod<KernelType, PointSelectionPolicy> nm(data, kernel,
+      approximationRank);
+  nm.Apply(g);
+  features = g.t();
+  Timer::Stop("nystroem_method");
+
+  Log::Info << "KernelKMeans::Cluster(): computed " << approximationRank
+      << "-dimensional features for " << data.n_cols << " points." << std::endl;
+
+  clustering.Cluster(features, clusters, assignments, centroids);
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
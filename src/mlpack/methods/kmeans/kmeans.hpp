@@ -19,6 +19,8 @@
 #include <mlpack/core/metrics/lmetric.hpp>
 #include "random_partition.hpp"
 #include "max_variance_new_cluster.hpp"
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
 #include "naive_kmeans.hpp"
 
 #include <mlpack/core/tree/binary_space_tree.hpp>
@@ -61,7 +63,10 @@ namespace kmeans /** K-Means clustering. */ {
  *     data, const size_t emptyCluster, const arma::mat& oldCentroids,
  *     arma::mat& newCentroids, arma::Col<size_t>& counts, MetricType& metric,
  *     const size_t iteration)'.
- * @tparam LloydStepType Implementation of single Lloyd step to use.
+ * @tparam LloydStepType Implementation of single Lloyd step to use; must
+ *     implement a constructor taking 'const MatType& dataset, MetricType&
+ *     metric, LloydWorkspace& workspace, const LloydStepOptions& options' (the
+ *     workspace is scratch memory that may be reused in every iteration).
  *
  * @see RandomPartition, RefinedStart, AllowEmptyClusters,
  *      MaxVarianceNewCluster, NaiveKMeans, ElkanKMeans
@@ -86,11 +91,13 @@ class KMeans
    *     specially initialized partitioning policy is required.
    * @param emptyClusterAction Optional EmptyClusterPolicy object; for when a
    *     specially initialized empty cluster policy is required.
+   * @param lloydOptions Optional options passed to the Lloyd step.
    */
   KMeans(const size_t maxIterations = 1000,
          const MetricType metric = MetricType(),
          const InitialPartitionPolicy partitioner = InitialPartitionPolicy(),
-         const EmptyClusterPolicy emptyClusterAction = EmptyClusterPolicy());
+         const EmptyClusterPolicy emptyClusterAction = EmptyClusterPolicy(),
+         const LloydStepOptions& lloydOptions = LloydStepOptions());
 
 
   /**
@@ -177,6 +184,11 @@ class KMeans
   //! Modify the empty cluster policy.
   EmptyClusterPolicy& EmptyClusterAction() { return emptyClusterAction; }
 
+  //! Get the options passed to the Lloyd step.
+  const LloydStepOptions& LloydOptions() const { return lloydOptions; }
+  //! Modify the options passed to the Lloyd step.
+  LloydStepOptions& LloydOptions() { return lloydOptions; }
+
   //! Serialize the k-means object.
   template<typename Archive>
   void Serialize(Archive& ar, const unsigned int version);
@@ -190,6 +202,8 @@ class KMeans
   InitialPartitionPolicy partitioner;
   //! Instantiated empty cluster policy.
   EmptyClusterPolicy emptyClusterAction;
+  //! Options passed to the Lloyd step.
+  LloydStepOptions lloydOptions;
 };
 
 } // namespace kmeans
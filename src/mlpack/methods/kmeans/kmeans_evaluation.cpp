@@ -0,0 +1,266 @@
+/**
+ * @file kmeans_evaluation.cpp
+ *
+ * Implementation of the clustering quality measures in KMeansEvaluation.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "kmeans_evaluation.hpp"
+#include "block_reduction.hpp"
+
+using namespace mlpack;
+using namespace mlpack::kmeans;
+
+//! Number of points whose distances are computed with each GEMM.
+static const size_t blockSize = 1024;
+
+double KMeansEvaluation::Inertia(const arma::mat& data,
+                                 const arma::Row<size_t>& assignments,
+                                 const arma::mat& centroids)
+{
+  double inertia;
+  std::vector<double> partials;
+  BlockReduction::Reduce(data.n_cols, BlockReduction::BlockSize, partials,
+      [](double& partial) { partial = 0.0; },
+      [&](double& partial, const size_t begin, const size_t end)
+      {
+        for (size_t i = begin; i < end; ++i)
+        {
+          const double* point = data.colptr(i);
+          const double* centroid = centroids.colptr(assignments[i]);
+          for (size_t d = 0; d < data.n_rows; ++d)
+            partial += (point[d] - centroid[d]) * (point[d] - centroid[d]);
+        }
+      }, inertia);
+
+  return inertia;
+}
+
+double KMeansEvaluation::SimplifiedSilhouette(
+    const arma::mat& data,
+    const arma::Row<size_t>& assignments,
+    const arma::mat& centroids)
+{
+  if (centroids.n_cols < 2 || data.n_cols == 0)
+    return 0.0;
+
+  arma::vec ownDistances, otherDistances;
+  CentroidDistances(data, assignments, centroids, ownDistances, otherDistances);
+
+  double silhouette;
+  std::vector<double> partials;
+  BlockReduction::Reduce(data.n_cols, BlockReduction::BlockSize, partials,
+      [](double& partial) { partial = 0.0; },
+      [&](double& partial, const size_t begin, const size_t end)
+      {
+        for (size_t i = begin; i < end; ++i)
+        {
+          const double a = ownDistances[i];
+          const double b = otherDistances[i];
+          const double maxDistance = std::max(a, b);
+          if (maxDistance > 0.0)
+            partial += (b - a) / maxDistance;
+        }
+      }, silhouette);
+
+  return silhouette / data.n_cols;
+}
+
+double KMeansEvaluation::DaviesBouldin(const arma::mat& data,
+                                       const arma::Row<size_t>& assignments,
+                                       const arma::mat& centroids)
+{
+  // Compute the average distance of the points in each cluster to the
+  // centroid.
+  arma::vec ownDistances, otherDistances;
+  CentroidDistances(data, assignments, centroids, ownDistances, otherDistances);
+
+  arma::vec scatter(centroids.n_cols, arma::fill::zeros);
+  arma::Col<size_t> counts(centroids.n_cols, arma::fill::zeros);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    scatter[assignments[i]] += ownDistances[i];
+    ++counts[assignments[i]];
+  }
+
+  size_t nonEmpty = 0;
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+  {
+    if (counts[c] > 0)
+    {
+      scatter[c] /= counts[c];
+      ++nonEmpty;
+    }
+  }
+
+  if (nonEmpty < 2)
+    return 0.0;
+
+  // The ratio of each cluster is computed in parallel, but they are summed in
+  // order so that the result does not depend on the number of threads.
+  arma::vec maxRatios(centroids.n_cols, arma::fill::zeros);
+
+  util::ThreadPool::Global().ParallelFor(0, centroids.n_cols, 1,
+      [&](const size_t begin, const size_t end)
+  {
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (counts[i] == 0)
+        continue;
+
+      double maxRatio = 0.0;
+      for (size_t j = 0; j < centroids.n_cols; ++j)
+      {
+        if (j == i || counts[j] == 0)
+          continue;
+
+        const double separation = arma::norm(centroids.col(i) -
+            centroids.col(j), 2);
+        const double ratio = (separation > 0.0) ?
+            (scatter[i] + scatter[j]) / separation : DBL_MAX;
+        maxRatio = std::max(maxRatio, ratio);
+      }
+
+      maxRatios[i] = maxRatio;
+    }
+  });
+
+  return arma::accu(maxRatios) / nonEmpty;
+}
+
+double KMeansEvaluation::SampledSilhouette(const arma::mat& data,
+                                           const arma::Row<size_t>& assignments,
+                                           const size_t clusters,
+                                           const size_t samples)
+{
+  if (clusters < 2 || data.n_cols == 0)
+    return 0.0;
+
+  // Pick the points to evaluate.
+  arma::uvec sampled;
+  if (samples >= data.n_cols)
+  {
+    sampled = arma::linspace<arma::uvec>(0, data.n_cols - 1, data.n_cols);
+  }
+  else
+  {
+    const arma::uvec permutation = arma::shuffle(
+        arma::linspace<arma::uvec>(0, data.n_cols - 1, data.n_cols));
+    sampled = permutation.subvec(0, samples - 1);
+  }
+
+  arma::Col<size_t> counts(clusters, arma::fill::zeros);
+  for (size_t i = 0; i < data.n_cols; ++i)
+    ++counts[assignments[i]];
+
+  const arma::vec norms = arma::trans(arma::sum(arma::square(data)));
+
+  // Each block of sampled points is compared with the whole dataset with one
+  // GEMM.
+  const size_t sampleBlockSize = 64;
+  const size_t blocks = (sampled.n_elem + sampleBlockSize - 1) /
+      sampleBlockSize;
+  // The sum of each block is stored and the blocks are summed in order, so that
+  // the result does not depend on the number of threads.
+  arma::vec blockSilhouettes(blocks, arma::fill::zeros);
+
+  util::ThreadPool::Global().ParallelFor(0, blocks, 1,
+      [&](const size_t chunkBegin, const size_t chunkEnd)
+  {
+    for (size_t b = chunkBegin; b < chunkEnd; ++b)
+    {
+      const size_t begin = b * sampleBlockSize;
+      const size_t end = std::min(begin + sampleBlockSize,
+          (size_t) sampled.n_elem);
+      const arma::uvec indices = sampled.subvec(begin, end - 1);
+      const arma::mat sampleBlock = data.cols(indices);
+
+      // Column s holds the inner products of sampled point s with every point.
+      const arma::mat products = data.t() * sampleBlock;
+      arma::vec clusterSums(clusters);
+
+      for (size_t s = 0; s < indices.n_elem; ++s)
+      {
+        const size_t index = indices[s];
+        const size_t own = assignments[index];
+        if (counts[own] <= 1)
+          continue; // The silhouette of a singleton is 0.
+
+        clusterSums.zeros();
+        for (size_t j = 0; j < data.n_cols; ++j)
+        {
+          if (j == index)
+            continue;
+
+          const double squared = norms[index] - 2.0 * products(j, s) +
+              norms[j];
+          clusterSums[assignments[j]] += std::sqrt(std::max(squared, 0.0));
+        }
+
+        const double a = clusterSums[own] / (counts[own] - 1);
+        double bDistance = DBL_MAX;
+        for (size_t c = 0; c < clusters; ++c)
+          if (c != own && counts[c] > 0)
+            bDistance = std::min(bDistance, clusterSums[c] / counts[c]);
+
+        if (bDistance == DBL_MAX)
+          continue; // Only one non-empty cluster.
+
+        const double maxDistance = std::max(a, bDistance);
+        if (maxDistance > 0.0)
+          blockSilhouettes[b] += (bDistance - a) / maxDistance;
+      }
+    }
+  });
+
+  return arma::accu(blockSilhouettes) / sampled.n_elem;
+}
+
+void KMeansEvaluation::CentroidDistances(const arma::mat& data,
+                                         const arma::Row<size_t>& assignments,
+                                         const arma::mat& centroids,
+                                         arma::vec& ownDistances,
+                                         arma::vec& otherDistances)
+{
+  ownDistances.set_size(data.n_cols);
+  otherDistances.set_size(data.n_cols);
+
+  const arma::rowvec centroidNorms = arma::sum(arma::square(centroids));
+  const size_t blocks = (data.n_cols + blockSize - 1) / blockSize;
+
+  util::ThreadPool::Global().ParallelFor(0, blocks, 1,
+      [&](const size_t chunkBegin, const size_t chunkEnd)
+  {
+    for (size_t b = chunkBegin; b < chunkEnd; ++b)
+    {
+      const size_t begin = b * blockSize;
+      const size_t end = std::min(begin + blockSize, (size_t) data.n_cols);
+
+      // Column i holds the squared distances (up to the norm of point i) from
+      // point i to each centroid.
+      arma::mat distances = -2.0 * (centroids.t() * data.cols(begin, end - 1));
+      distances.each_col() += centroidNorms.t();
+
+      for (size_t i = begin; i < end; ++i)
+      {
+        const double norm = arma::dot(data.col(i), data.col(i));
+        const double* column = distances.colptr(i - begin);
+        const size_t own = assignments[i];
+
+        double other = DBL_MAX;
+        for (size_t c = 0; c < centroids.n_cols; ++c)
+          if (c != own && column[c] < other)
+            other = column[c];
+
+        ownDistances[i] = std::sqrt(std::max(column[own] + norm, 0.0));
+        otherDistances[i] = (other == DBL_MAX) ? 0.0 :
+            std::sqrt(std::max(other + norm, 0.0));
+      }
+    }
+  });
+}
@@ -0,0 +1,123 @@
+/**
+ * @file kmeans_evaluation.hpp
+ *
+ * Measures of the quality of a clustering which can be computed without
+ * comparing every pair of points: inertia, the simplified silhouette, the
+ * Davies-Bouldin index, and a silhouette estimated from a sample of points.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_EVALUATION_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_EVALUATION_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * Quality measures for a Euclidean clustering given by a set of assignments
+ * and centroids.  The exact silhouette needs every pairwise distance, which is
+ * O(N^2); the measures here cost O(N k d) (or O(s N d) for the sampled
+ * silhouette with s samples).  Distances from points to centroids are computed
+ * with the norm expansion ||x||^2 - 2 x^T c + ||c||^2, one GEMM per block of
+ * points.  Every measure is computed in parallel on the shared
+ * util::ThreadPool; the sums are reproducible for any number of threads if
+ * BlockReduction::Deterministic() is set.
+ *
+ * @code
+ * extern arma::mat data;
+ * extern arma::Row<size_t> assignments;
+ * extern arma::mat centroids;
+ *
+ * const double inertia = KMeansEvaluation::Inertia(data, assignments,
+ *     centroids);
+ * const double silhouette = KMeansEvaluation::SimplifiedSilhouette(data,
+ *     assignments, centroids);
+ * @endcode
+ */
+class KMeansEvaluation
+{
+ public:
+  /**
+   * Compute the inertia of the clustering: the sum of squared distances from
+   * each point to the centroid of its cluster.  Smaller is better.
+   *
+   * @param data Dataset that was clustered.
+   * @param assignments Cluster assignment of each point.
+   * @param centroids Centroid of each cluster.
+   */
+  static double Inertia(const arma::mat& data,
+                        const arma::Row<size_t>& assignments,
+                        const arma::mat& centroids);
+
+  /**
+   * Compute the simplified silhouette of the clustering.  For each point, a is
+   * the distance to the centroid of its cluster and b is the distance to the
+   * nearest other centroid, and the silhouette of the point is
+   * (b - a) / max(a, b).  The average over all points is returned; it is
+   * between -1 and 1, and larger is better.
+   *
+   * @param data Dataset that was clustered.
+   * @param assignments Cluster assignment of each point.
+   * @param centroids Centroid of each cluster.
+   */
+  static double SimplifiedSilhouette(const arma::mat& data,
+                                     const arma::Row<size_t>& assignments,
+                                     const arma::mat& centroids);
+
+  /**
+   * Compute the Davies-Bouldin index of the clustering: the average, over each
+   * cluster i, of the maximum over each other cluster j of
+   * (S_i + S_j) / d(c_i, c_j), where S_i is the average distance of the points
+   * in cluster i to its centroid.  Smaller is better.  Empty clusters are
+   * ignored.
+   *
+   * @param data Dataset that was clustered.
+   * @param assignments Cluster assignment of each point.
+   * @param centroids Centroid of each cluster.
+   */
+  static double DaviesBouldin(const arma::mat& data,
+                              const arma::Row<size_t>& assignments,
+                              const arma::mat& centroids);
+
+  /**
+   * Estimate the (true) silhouette of the clustering from a random sample of
+   * points.  For each sampled point, a is its average distance to the other
+   * points in its cluster and b is the smallest average distance to the points
+   * of another cluster, both computed over the whole dataset.  The average
+   * silhouette (b - a) / max(a, b) of the sampled points is returned.  Points
+   * in clusters of size 1 have a silhouette of 0.
+   *
+   * @param data Dataset that was clustered.
+   * @param assignments Cluster assignment of each point.
+   * @param clusters Number of clusters.
+   * @param samples Number of points to sample (if at least the number of
+   *     points, the exact silhouette is computed).
+   */
+  static double SampledSilhouette(const arma::mat& data,
+                                  const arma::Row<size_t>& assignments,
+                                  const size_t clusters,
+                                  const size_t samples);
+
+ private:
+  /**
+   * Compute, for each point, the distance to its own centroid and the distance
+   * to the nearest other centroid.
+   */
+  static void CentroidDistances(const arma::mat& data,
+                                const arma::Row<size_t>& assignments,
+                                const arma::mat& centroids,
+                                arma::vec& ownDistances,
+                                arma::vec& otherDistances);
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
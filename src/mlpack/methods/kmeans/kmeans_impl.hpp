@@ -15,7 +15,7 @@
 #include "kmeans.hpp"
 
 #include <mlpack/core/metrics/lmetric.hpp>
-#include <time.h>
+
 namespace mlpack {
 namespace kmeans {
 
@@ -28,9 +28,10 @@ template<typename MetricType, typename InitialPartitionPolicy,
 KMeans<MetricType, InitialPartitionPolicy, EmptyClusterPolicy, LloydStepType,
 		MatType>::KMeans(const size_t maxIterations, const MetricType metric,
 		const InitialPartitionPolicy partitioner,
-		const EmptyClusterPolicy emptyClusterAction) :
+		const EmptyClusterPolicy emptyClusterAction,
+		const LloydStepOptions& lloydOptions) :
 		maxIterations(maxIterations), metric(metric), partitioner(partitioner), emptyClusterAction(
-				emptyClusterAction) {
+				emptyClusterAction), lloydOptions(lloydOptions) {
 	// Nothing to do.
 }
 
@@ -113,12 +114,13 @@ void KMeans<MetricType, InitialPartitionPolicy, EmptyClusterPolicy,
 
 	size_t iteration = 0;
 
-	LloydStepType<MetricType, MatType> lloydStep(data, metric);
+	// The workspace holds the temporary matrices of the Lloyd step, so that they
+	// are only allocated once instead of in every iteration.
+	LloydWorkspace workspace(data.n_cols, clusters);
+	LloydStepType<MetricType, MatType> lloydStep(data, metric, workspace,
+			lloydOptions);
 	arma::mat centroidsOther;
 	double cNorm;
-	struct timespec st,ed;
-	clock_gettime(CLOCK_REALTIME,&st);
-	std::cout << "Begin!" << std::endl;
 	do {
 		// We have two centroid matrices.  We don't want to copy anything, so,
 		// depending on the iteration number, we use a different centroid matrix...
@@ -143,18 +145,12 @@ void KMeans<MetricType, InitialPartitionPolicy, EmptyClusterPolicy,
 		}
 
 		iteration++;
-		std::cout << "Iteration" << iteration << std::endl;
 		Log::Info << "KMeans::Cluster(): iteration " << iteration
 				<< ", residual " << cNorm << ".\n";
 		if (isnan(cNorm) || isinf(cNorm))
 			cNorm = 1e-4; // Keep iterating.
 
 	} while (cNorm > 1e-5 && iteration != maxIterations);
-	clock_gettime(CLOCK_REALTIME,&ed);
-	//st = clock() - st;
-	//st /= CLOCKS_PER_SEC;
-	printf("Time:%lfs\n", (double)ed.tv_sec - st.tv_sec);
-    //printf("iteration:%d\n", iteration);
 
 	// If we ended on an even iteration, then the centroids are in the
 	// centroidsOther matrix, and we need to steal its memory (steal_mem() avoids
@@ -171,6 +167,8 @@ void KMeans<MetricType, InitialPartitionPolicy, EmptyClusterPolicy,
 	}
 	Log::Info << lloydStep.DistanceCalculations() << " distance calculations."
 			<< std::endl;
+	Log::Info << "Lloyd step workspace: " << workspace.Size() << " bytes."
+			<< std::endl;
 }
 
 /**
@@ -14,16 +14,23 @@
 #include <mlpack/core.hpp>
 
 #include "kmeans.hpp"
+#include "kmeans_sweep.hpp"
+#include "kmeans_evaluation.hpp"
 #include "allow_empty_clusters.hpp"
 #include "refined_start.hpp"
 #include "elkan_kmeans.hpp"
 #include "hamerly_kmeans.hpp"
 #include "pelleg_moore_kmeans.hpp"
 #include "dual_tree_kmeans.hpp"
+#include "projected_kmeans.hpp"
+#include "quantized_kmeans.hpp"
+#include "kernel_kmeans.hpp"
+#include "online_kmeans.hpp"
 //#include "papi.h"
 
 using namespace mlpack;
 using namespace mlpack::kmeans;
+using namespace mlpack::kernel;
 using namespace std;
 
 // Define parameters for the executable.
@@ -50,14 +57,82 @@ PROGRAM_INFO("K-Means Clustering", "This program performs K-Means clustering "
 		"('hamerly'), the dual-tree k-means algorithm ('dualtree'), and the "
 		"dual-tree k-means algorithm using the cover tree ('dualtree-covertree')."
 		"\n\n"
+		"For high-dimensional data, the --projection_dim option projects the "
+		"dataset to the given number of dimensions with a random projection.  The "
+		"projected distances are used to shortlist candidate centroids for each "
+		"point in each iteration, and only the candidates are compared in the "
+		"full dimensionality; the final assignments are computed against the "
+		"full-dimensional centroids."
+		"\n\n"
+		"For large datasets, --quantize ('int8' or 'fp16') stores a compressed "
+		"copy of the dataset with 8 or 16 bits per element (each dimension is "
+		"scaled separately), which is read instead of the original data in each "
+		"Lloyd iteration.  Points whose closest two centroids are too close to "
+		"tell apart with the compressed data are reassigned with the original "
+		"data, unless --skip_recheck is given; the new centroids are the means of "
+		"the compressed points.  Empty clusters and the final assignments are also "
+		"computed from the compressed points.  If the dataset is a .mmat file "
+		"(which can be written with mlpack's data::Save()), it is mapped instead "
+		"of loaded, so only the compressed copy is held in memory, and the "
+		"original points are read from the file only when they are rechecked."
+		"\n\n"
+		"To help choose the number of clusters, --k_range can be given as "
+		"'start:stop:step' (for instance, '10:200:10') instead of --clusters.  "
+		"Then the dataset is clustered once for each number of clusters in the "
+		"range, with each clustering warm-started from the solution for a smaller"
+		" number of clusters by splitting the clusters with the highest sum of "
+		"squared errors.  Each clustering uses the Lloyd step and empty cluster "
+		"options given (such as --algorithm and --allow_empty_clusters), and the"
+		" first uses --refined_start if it is given.  The inertia and BIC of each"
+		" clustering are printed, and can be saved with --sweep_file, which will "
+		"contain one row per number of clusters with the columns k, inertia, and "
+		"BIC.  --initial_centroids, --kernel, and k-means models can't be used "
+		"with --k_range."
+		"\n\n"
+		"Clusters that are not linearly separable can be found with kernel "
+		"k-means by specifying --kernel.  The Nystroem method is used to compute "
+		"a --kernel_rank dimensional approximation of the kernel feature space, "
+		"and k-means is run in that space, so the N x N kernel matrix is never "
+		"formed.  The available kernels are 'linear', 'gaussian', 'polynomial', "
+		"'laplacian', 'epanechnikov', and 'cosine'; the kernel parameters are "
+		"given with --bandwidth, --degree, and --offset.  With --kernel, the "
+		"centroids saved with --centroid_file are in the feature space."
+		"\n\n"
+		"To cluster data that arrives in batches, a model can be saved with "
+		"--output_model_file; it holds the centroids and the (weighted) number "
+		"and sum of the points in each cluster.  A model given with "
+		"--input_model_file is updated with the points in --input_file only: the"
+		" weights of the points seen before are multiplied by --decay, and then "
+		"at most --batch_iterations Lloyd iterations are run on the new points.  "
+		"The assignments of the new points can be saved as usual, and the updated"
+		" model can be saved with --output_model_file."
+		"\n\n"
+		"If --evaluate (-E) is specified, the quality of the clustering is "
+		"printed to standard output: the inertia (sum of squared distances from each "
+		"point to its centroid), the simplified silhouette (which uses distances "
+		"to centroids instead of to every point), the Davies-Bouldin index, and "
+		"the silhouette estimated from --silhouette_samples random points."
+		"\n\n"
+		"By default, sums over points computed in parallel (such as the new "
+		"centroids in each iteration) may differ in the last bits depending on the"
+		" number of threads.  If --deterministic is specified, these sums are "
+		"computed over fixed-size blocks of points and added in a fixed order, so"
+		" that runs with the same --seed give identical results for any number of"
+		" threads, at a small cost in speed."
+		"\n\n"
+		"With --mixed_precision, the naive Lloyd step computes the inner products "
+		"between points and centroids in single precision, and only recomputes in "
+		"double precision the points whose two closest centroids are too close to"
+		" tell apart, so the assignments are the same as in double precision."
+		"\n\n"
 		"As of October 2014, the --overclustering option has been removed.  If you "
 		"want this support back, let us know -- file a bug at "
 		"https://github.com/mlpack/mlpack/ or get in touch through another means.");
 
 // Required options.
 PARAM_STRING_REQ("input_file", "Input dataset to perform clustering on.", "i");
-PARAM_INT_REQ("clusters", "Number of clusters to find (0 autodetects from "
-		"initial centroids).", "c");
+PARAM_INT("clusters", "Number of clusters to find (0 autodetects from "
+		"initial centroids).  Required unless --k_range is given.", "c", 0);
 
 // Output options.
 PARAM_FLAG("in_place", "If specified, a column containing the learned cluster "
@@ -85,6 +160,61 @@ PARAM_INT("samplings", "Number of samplings to perform for refined start (use "
 PARAM_DOUBLE("percentage", "Percentage of dataset to use for each refined start"
 		" sampling (use when --refined_start is specified).", "p", 0.02);
 
+// Parameters for sweeping over the number of clusters.
+PARAM_STRING("k_range", "Range of numbers of clusters to try, as "
+		"'start:stop:step'.", "", "");
+PARAM_STRING("sweep_file", "If specified with --k_range, the number of "
+		"clusters, inertia, and BIC of each clustering are written to this file.",
+		"", "");
+
+// Parameters for random projection k-means.
+PARAM_INT("projection_dim", "If nonzero, use the random projection Lloyd step "
+		"with data projected to this many dimensions.", "", 0);
+
+// Parameters for compressed-data k-means.
+PARAM_STRING("quantize", "If specified, run the Lloyd iterations on a copy of "
+		"the dataset compressed to 'int8' or 'fp16'.", "", "");
+PARAM_FLAG("skip_recheck", "If specified with --quantize, do not reassign "
+		"points with near-tie distances using the original data.", "");
+
+// Parameters for kernel k-means.
+PARAM_STRING("kernel", "If specified, run kernel k-means with this kernel "
+		"('linear', 'gaussian', 'polynomial', 'laplacian', 'epanechnikov', or "
+		"'cosine').", "", "");
+PARAM_INT("kernel_rank", "Rank of the Nystroem approximation of the kernel "
+		"matrix (use when --kernel is specified).", "", 100);
+PARAM_DOUBLE("bandwidth", "Bandwidth, for 'gaussian', 'laplacian', and "
+		"'epanechnikov' kernels.", "", 1.0);
+PARAM_DOUBLE("degree", "Degree of polynomial, for 'polynomial' kernel.", "",
+		1.0);
+PARAM_DOUBLE("offset", "Offset, for 'polynomial' kernel.", "", 0.0);
+
+// Parameters for online k-means.
+PARAM_STRING("input_model_file", "If specified, update this k-means model with "
+		"the points in --input_file instead of clustering from scratch.", "", "");
+PARAM_STRING("output_model_file", "If specified, save the k-means model "
+		"(centroids and per-cluster weights and sums) to this file.", "", "");
+PARAM_DOUBLE("decay", "Factor by which to multiply the weight of the points "
+		"seen before when updating a model given with --input_model_file.", "",
+		1.0);
+PARAM_INT("batch_iterations", "Maximum number of Lloyd iterations on the new "
+		"points when updating a model given with --input_model_file.", "", 10);
+
+// Parameters for evaluating the clustering.
+PARAM_FLAG("evaluate", "If specified, measures of the quality of the "
+		"clustering will be computed and printed.", "E");
+PARAM_INT("silhouette_samples", "Number of points to sample to estimate the "
+		"silhouette (use when --evaluate is specified; 0 skips the estimate).",
+		"", 1000);
+
+PARAM_FLAG("deterministic", "If specified, parallel sums are computed in a "
+		"fixed order, so that results do not depend on the number of threads.",
+		"");
+
+PARAM_FLAG("mixed_precision", "If specified, assign points to centroids with "
+		"single precision inner products, and recompute near ties in double "
+		"precision.", "");
+
 PARAM_STRING("algorithm", "Algorithm to use for the Lloyd iteration ('naive', "
 		"'pelleg-moore', 'elkan', 'hamerly', 'dualtree', or 'dualtree-covertree').",
 		"a", "naive");
@@ -102,7 +232,46 @@ void FindLloydStepType(const InitialPartitionPolicy& ipp);
 // Given the template parameters, sanitize/load input and run k-means.
 template<typename InitialPartitionPolicy, typename EmptyClusterPolicy, template<
 		class, class > class LloydStepType>
-void RunKMeans(const InitialPartitionPolicy& ipp);
+void RunKMeans(const InitialPartitionPolicy& ipp,
+		const LloydStepOptions& options = LloydStepOptions());
+
+// Run k-means on the dataset, and compute the assignments if assignments is
+// not NULL.
+template<typename KMeansType>
+void ClusterDataset(KMeansType& kmeans, const arma::mat& dataset,
+		const size_t clusters, arma::Row<size_t>* assignments,
+		arma::mat& centroids, const bool initialCentroidGuess);
+
+// Run k-means on compressed data, computing the assignments from the
+// compressed data too.
+template<typename InitialPartitionPolicy, typename EmptyClusterPolicy>
+void ClusterDataset(KMeans<metric::EuclideanDistance, InitialPartitionPolicy,
+		EmptyClusterPolicy, QuantizedKMeans>& kmeans, const arma::mat& dataset,
+		const size_t clusters, arma::Row<size_t>* assignments,
+		arma::mat& centroids, const bool initialCentroidGuess);
+
+// Run k-means for every number of clusters in --k_range with the given KMeans
+// object.
+template<typename KMeansType>
+void RunSweep(KMeansType& kmeans);
+
+// Train or update a model for online k-means.
+void RunOnlineKMeans();
+
+// Run kernel k-means with the kernel given by --kernel.
+void RunKernelKMeans();
+
+// Run kernel k-means with the given kernel.
+template<typename KernelType>
+void RunKernelKMeans(KernelType& kernel);
+
+// Save the assignments (and possibly the dataset) as requested by --in_place,
+// --output_file, and --labels_only.
+void SaveAssignments(arma::mat& dataset, const arma::Row<size_t>& assignments);
+
+// Compute and print the measures of the quality of a clustering.
+void Evaluate(const arma::mat& dataset, const arma::Row<size_t>& assignments,
+		const arma::mat& centroids);
 
 int main(int argc, char** argv) {
 	CLI::ParseCommandLine(argc, argv);
@@ -113,6 +282,35 @@ int main(int argc, char** argv) {
 	else
 		math::RandomSeed((size_t) std::time(NULL));
 
+	BlockReduction::Deterministic() = CLI::HasParam("deterministic");
+
+	// --clusters can't be a required option, because --k_range gives the numbers
+	// of clusters instead (and a model given with --input_model_file has its
+	// own), so check it here.
+	if (!CLI::HasParam("clusters") && !CLI::HasParam("k_range")
+			&& !CLI::HasParam("input_model_file"))
+		Log::Fatal << "Either --clusters (-c) or --k_range must be specified."
+				<< endl;
+
+	// A sweep goes through the same choice of policies and Lloyd step as a
+	// single clustering, in RunKMeans().
+	if (CLI::HasParam("k_range") && (CLI::HasParam("initial_centroids")
+			|| CLI::HasParam("kernel") || CLI::HasParam("input_model_file")
+			|| CLI::HasParam("output_model_file")))
+		Log::Fatal << "--k_range can't be used with --initial_centroids, "
+				<< "--kernel, --input_model_file, or --output_model_file." << endl;
+
+	if (CLI::HasParam("input_model_file")
+			|| CLI::HasParam("output_model_file")) {
+		RunOnlineKMeans();
+		return 0;
+	}
+
+	if (CLI::HasParam("kernel")) {
+		RunKernelKMeans();
+		return 0;
+	}
+
 	// Now, start building the KMeans type that we'll be using.  Start with the
 	// initial partition policy.  The call to FindEmptyClusterPolicy<> results in
 	// a call to RunKMeans<> and the algorithm is completed.
@@ -151,23 +349,67 @@ void FindEmptyClusterPolicy(const InitialPartitionPolicy& ipp) {
 template<typename InitialPartitionPolicy, typename EmptyClusterPolicy>
 void FindLloydStepType(const InitialPartitionPolicy& ipp) {
 	const string algorithm = CLI::GetParam < string > ("algorithm");
+	LloydStepOptions options;
+	options.mixedPrecision = CLI::HasParam("mixed_precision");
+	if (CLI::GetParam<int>("projection_dim") < 0)
+		Log::Fatal << "Invalid projected dimensionality ("
+				<< CLI::GetParam<int>("projection_dim") << ")!  Must be greater "
+				<< "than or equal to 0." << endl;
+
+	if (CLI::GetParam<int>("projection_dim") > 0) {
+		if (algorithm != "naive")
+			Log::Warn << "--projection_dim is specified, so --algorithm ('"
+					<< algorithm << "') is ignored." << endl;
+		if (CLI::HasParam("quantize"))
+			Log::Warn << "--projection_dim is specified, so --quantize is ignored."
+					<< endl;
+
+		options.projectionDim = (size_t) CLI::GetParam<int>("projection_dim");
+		RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ProjectedKMeans>(
+				ipp, options);
+		return;
+	}
+
+	if (CLI::HasParam("quantize")) {
+		const string quantize = CLI::GetParam<string>("quantize");
+		if (quantize == "int8")
+			options.quantization = QuantizedMatrix::INT8;
+		else if (quantize == "fp16")
+			options.quantization = QuantizedMatrix::FP16;
+		else
+			Log::Fatal << "Unknown quantization: '" << quantize << "'.  Supported "
+					<< "options are 'int8' and 'fp16'." << endl;
+
+		if (algorithm != "naive")
+			Log::Warn << "--quantize is specified, so --algorithm ('"
+					<< algorithm << "') is ignored." << endl;
+
+		options.recheck = !CLI::HasParam("skip_recheck");
+		RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, QuantizedKMeans>(
+				ipp, options);
+		return;
+	}
+
+	if (algorithm == "elkan")
+		RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ElkanKMeans>(ipp,
+				options);
+	else if (algorithm == "hamerly")
+		RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans>(ipp,
+				options);
 	/*
-	 if (algorithm == "elkan")
-	 RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, ElkanKMeans>(ipp);
-	 else if (algorithm == "hamerly")
-	 RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, HamerlyKMeans>(ipp);
-	 else if (algorithm == "pelleg-moore")
-	 RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
-	 PellegMooreKMeans>(ipp);
 	 else if (algorithm == "dualtree")
 	 RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
 	 DefaultDualTreeKMeans>(ipp);
 	 else if (algorithm == "dualtree-covertree")
 	 RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
 	 CoverTreeDualTreeKMeans>(ipp);
-	 else */
-	if (algorithm == "naive")
-		RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans>(ipp);
+	 */
+	else if (algorithm == "naive")
+		RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy, NaiveKMeans>(ipp,
+				options);
+	else if (algorithm == "pelleg-moore")
+		RunKMeans<InitialPartitionPolicy, EmptyClusterPolicy,
+				PellegMooreKMeans>(ipp, options);
 	else
 		Log::Fatal << "Unknown algorithm: '" << algorithm
 				<< "'.  Supported options"
@@ -178,8 +420,23 @@ void FindLloydStepType(const InitialPartitionPolicy& ipp) {
 // Given the template parameters, sanitize/load input and run k-means.
 template<typename InitialPartitionPolicy, typename EmptyClusterPolicy, template<
 		class, class > class LloydStepType>
-void RunKMeans(const InitialPartitionPolicy& ipp) {
+void RunKMeans(const InitialPartitionPolicy& ipp,
+		const LloydStepOptions& options) {
 	// Now, do validation of input options.
+	const int maxIterations = CLI::GetParam<int>("max_iterations");
+	if (maxIterations < 0) {
+		Log::Fatal << "Invalid value for maximum iterations (" << maxIterations
+				<< ")! Must be greater than or equal to 0." << endl;
+	}
+
+	if (CLI::HasParam("k_range")) {
+		KMeans<metric::EuclideanDistance, InitialPartitionPolicy,
+				EmptyClusterPolicy, LloydStepType> kmeans(maxIterations,
+				metric::EuclideanDistance(), ipp, EmptyClusterPolicy(), options);
+		RunSweep(kmeans);
+		return;
+	}
+
 	const string inputFile = CLI::GetParam < string > ("input_file");
 	int clusters = CLI::GetParam<int>("clusters");
 	if (clusters < 0) {
@@ -194,10 +451,10 @@ void RunKMeans(const InitialPartitionPolicy& ipp) {
 				<< "provided!" << endl;
 	}
 
-	const int maxIterations = CLI::GetParam<int>("max_iterations");
-	if (maxIterations < 0) {
-		Log::Fatal << "Invalid value for maximum iterations (" << maxIterations
-				<< ")! Must be greater than or equal to 0." << endl;
+	if (CLI::GetParam<int>("silhouette_samples") < 0) {
+		Log::Fatal << "Invalid number of silhouette samples ("
+				<< CLI::GetParam<int>("silhouette_samples") << ")! Must be greater "
+				<< "than or equal to 0." << endl;
 	}
 
 	// Make sure we have an output file if we're not doing the work in-place.
@@ -208,9 +465,11 @@ void RunKMeans(const InitialPartitionPolicy& ipp) {
 				<< "no results will be saved." << std::endl;
 	}
 
-	// Load our dataset.
+	// Load our dataset.  A .mmat file is mapped, and the mapping is not
+	// released when the matrix is destroyed, so it is released at the end.
 	arma::mat dataset;
 	data::Load(inputFile, dataset, true); // Fatal upon failure.
+	const double* mappedData = dataset.memptr();
 
 	arma::mat centroids;
 
@@ -234,52 +493,340 @@ void RunKMeans(const InitialPartitionPolicy& ipp) {
 	Timer::Start("clustering");
 	KMeans<metric::EuclideanDistance, InitialPartitionPolicy,
 			EmptyClusterPolicy, LloydStepType> kmeans(maxIterations,
-			metric::EuclideanDistance(), ipp);
+			metric::EuclideanDistance(), ipp, EmptyClusterPolicy(), options);
 
-	if (CLI::HasParam("output_file") || CLI::HasParam("in_place")) {
+	if (CLI::HasParam("output_file") || CLI::HasParam("in_place")
+			|| CLI::HasParam("evaluate")) {
 		// We need to get the assignments.
 		arma::Row<size_t> assignments;
 
-		kmeans.Cluster(dataset, clusters, assignments, centroids, false,
+		ClusterDataset(kmeans, dataset, clusters, &assignments, centroids,
 				initialCentroidGuess);
 		Timer::Stop("clustering");
 
-		// Now figure out what to do with our results.
-		if (CLI::HasParam("in_place")) {
-			// Add the column of assignments to the dataset; but we have to convert
-			// them to type double first.
-			arma::rowvec converted(assignments.n_elem);
-			for (size_t i = 0; i < assignments.n_elem; i++)
-				converted(i) = (double) assignments(i);
+		// Evaluate before the labels are added to the dataset.
+		if (CLI::HasParam("evaluate"))
+			Evaluate(dataset, assignments, centroids);
 
-			dataset.insert_rows(dataset.n_rows, converted);
-
-			// Save the dataset.
-			data::Save(inputFile, dataset);
-		} else {
-			if (CLI::HasParam("labels_only")) {
-				// Save only the labels.
-				string outputFile = CLI::GetParam < string > ("output_file");
-				data::Save(outputFile, assignments);
-			} else {
-				// Convert the assignments to doubles.
-				arma::rowvec converted(assignments.n_elem);
-				for (size_t i = 0; i < assignments.n_elem; i++)
-					converted(i) = (double) assignments(i);
-
-				dataset.insert_rows(dataset.n_rows, converted);
-
-				// Now save, in the different file.
-				string outputFile = CLI::GetParam < string > ("output_file");
-				data::Save(outputFile, dataset);
-			}
-		}
+		SaveAssignments(dataset, assignments);
 	} else {
-		kmeans.Cluster(dataset, clusters, centroids, initialCentroidGuess);
+		ClusterDataset(kmeans, dataset, clusters, NULL, centroids,
+				initialCentroidGuess);
 		Timer::Stop("clustering");
 	}
 
 	// Should we write the centroids to a file?
 	if (CLI::HasParam("centroid_file"))
 		data::Save(CLI::GetParam < std::string > ("centroid_file"), centroids);
+
+	// With --in_place the dataset may have moved off the mapping, so the
+	// mapping is then released by its address.
+	if (!data::UnmapMatrix(dataset))
+		data::mapped::Release(mappedData);
+}
+
+// Run k-means on the dataset, and compute the assignments if assignments is
+// not NULL.
+template<typename KMeansType>
+void ClusterDataset(KMeansType& kmeans, const arma::mat& dataset,
+		const size_t clusters, arma::Row<size_t>* assignments,
+		arma::mat& centroids, const bool initialCentroidGuess) {
+	if (assignments)
+		kmeans.Cluster(dataset, clusters, *assignments, centroids, false,
+				initialCentroidGuess);
+	else
+		kmeans.Cluster(dataset, clusters, centroids, initialCentroidGuess);
+}
+
+// Run k-means on compressed data.  The dataset is compressed once, here, and
+// used both by the Lloyd steps and for the final assignments, so that the
+// original data is only read again for the rechecks.
+template<typename InitialPartitionPolicy, typename EmptyClusterPolicy>
+void ClusterDataset(KMeans<metric::EuclideanDistance, InitialPartitionPolicy,
+		EmptyClusterPolicy, QuantizedKMeans>& kmeans, const arma::mat& dataset,
+		const size_t clusters, arma::Row<size_t>* assignments,
+		arma::mat& centroids, const bool initialCentroidGuess) {
+	if (!data::mapped::Kept(dataset.memptr()))
+		Log::Info << "The dataset is not a mapped .mmat file, so it is kept in "
+				<< "memory for the rechecks." << endl;
+
+	LloydStepOptions options = kmeans.LloydOptions();
+	const QuantizedMatrix quantizedData(dataset, options.quantization);
+	Log::Info << "Compressed " << dataset.n_cols << " points to "
+			<< quantizedData.Size() << " bytes." << endl;
+
+	options.quantizedData = &quantizedData;
+	kmeans.LloydOptions() = options;
+	kmeans.Cluster(dataset, clusters, centroids, initialCentroidGuess);
+
+	if (assignments) {
+		metric::EuclideanDistance metric;
+		LloydWorkspace workspace(dataset.n_cols, centroids.n_cols);
+		QuantizedKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+				metric, workspace, options);
+		lloydStep.Assign(centroids, *assignments);
+		Log::Info << lloydStep.Rechecks() << " points rechecked with the "
+				<< "original data for the final assignments." << endl;
+	}
+
+	// The compressed dataset is about to be destroyed.
+	options.quantizedData = NULL;
+	kmeans.LloydOptions() = options;
+}
+
+// Run k-means for every number of clusters in --k_range with the given KMeans
+// object.
+template<typename KMeansType>
+void RunSweep(KMeansType& kmeans) {
+	const string range = CLI::GetParam < string > ("k_range");
+	size_t start, stop, step;
+	char separator1, separator2;
+	istringstream rangeStream(range);
+	if (!(rangeStream >> start >> separator1 >> stop >> separator2 >> step)
+			|| separator1 != ':' || separator2 != ':' || start == 0 || step == 0
+			|| stop < start)
+		Log::Fatal << "Invalid --k_range '" << range << "'; must be "
+				<< "'start:stop:step' with 0 < start <= stop and step > 0." << endl;
+
+	if (CLI::HasParam("in_place") || CLI::HasParam("output_file")
+			|| CLI::HasParam("centroid_file") || CLI::HasParam("evaluate"))
+		Log::Warn << "--k_range is specified, so --in_place, --output_file, "
+				<< "--centroid_file, and --evaluate are ignored." << endl;
+	if (CLI::HasParam("clusters"))
+		Log::Warn << "--k_range is specified, so --clusters is ignored." << endl;
+
+	// A .mmat file is mapped, and the mapping is released at the end.
+	arma::mat dataset;
+	data::Load(CLI::GetParam < string > ("input_file"), dataset, true);
+	const double* mappedData = dataset.memptr();
+
+	arma::Col<size_t> clusters(((stop - start) / step) + 1);
+	for (size_t i = 0; i < clusters.n_elem; ++i)
+		clusters[i] = start + i * step;
+
+	Timer::Start("clustering");
+	KMeansSweep sweep(dataset);
+	arma::vec inertia, bic;
+	vector<arma::mat> centroids;
+	sweep.Sweep(kmeans, clusters, inertia, bic, centroids);
+	Timer::Stop("clustering");
+
+	// The table is the output asked for, so it is printed even without
+	// --verbose.  It has one column per number of clusters, and is transposed
+	// when saved.
+	arma::mat table(3, clusters.n_elem);
+	Log::Flush();
+	cout << "k\tinertia\tBIC" << endl;
+	for (size_t i = 0; i < clusters.n_elem; ++i) {
+		cout << clusters[i] << "\t" << inertia[i] << "\t" << bic[i] << endl;
+		table(0, i) = (double) clusters[i];
+		table(1, i) = inertia[i];
+		table(2, i) = bic[i];
+	}
+
+	if (CLI::HasParam("sweep_file"))
+		data::Save(CLI::GetParam < string > ("sweep_file"), table, true);
+
+	if (!data::UnmapMatrix(dataset))
+		data::mapped::Release(mappedData);
+}
+
+// Compute and print the measures of the quality of a clustering.
+void Evaluate(const arma::mat& dataset, const arma::Row<size_t>& assignments,
+		const arma::mat& centroids) {
+	Timer::Start("evaluation");
+	const double inertia = KMeansEvaluation::Inertia(dataset, assignments,
+			centroids);
+	const double simplifiedSilhouette = KMeansEvaluation::SimplifiedSilhouette(
+			dataset, assignments, centroids);
+	const double daviesBouldin = KMeansEvaluation::DaviesBouldin(dataset,
+			assignments, centroids);
+
+	// The measures are the output asked for, so they are printed even without
+	// --verbose (and when Log::Info is compiled out with MLPACK_LOG_LEVEL).
+	Log::Flush();
+	cout << "Inertia: " << inertia << "." << endl;
+	cout << "Simplified silhouette: " << simplifiedSilhouette << "." << endl;
+	cout << "Davies-Bouldin index: " << daviesBouldin << "." << endl;
+
+	const size_t samples = (size_t) CLI::GetParam<int>("silhouette_samples");
+	if (samples > 0) {
+		const double silhouette = KMeansEvaluation::SampledSilhouette(dataset,
+				assignments, centroids.n_cols, samples);
+		cout << "Silhouette (" << std::min(samples, (size_t) dataset.n_cols)
+				<< " samples): " << silhouette << "." << endl;
+	}
+	Timer::Stop("evaluation");
+}
+
+// Train or update a model for online k-means.
+void RunOnlineKMeans() {
+	const int batchIterations = CLI::GetParam<int>("batch_iterations");
+	if (batchIterations <= 0)
+		Log::Fatal << "Invalid number of batch iterations (" << batchIterations
+				<< ")! Must be greater than 0." << endl;
+
+	if (CLI::HasParam("kernel") || CLI::HasParam("projection_dim")
+			|| CLI::HasParam("refined_start")
+			|| CLI::HasParam("initial_centroids"))
+		Log::Warn << "A k-means model is used, so --kernel, --projection_dim, "
+				<< "--refined_start, and --initial_centroids are ignored." << endl;
+
+	arma::mat dataset;
+	data::Load(CLI::GetParam < string > ("input_file"), dataset, true);
+
+	OnlineKMeans model((size_t) batchIterations);
+	arma::Row<size_t> assignments;
+	Timer::Start("clustering");
+	if (CLI::HasParam("input_model_file")) {
+		data::Load(CLI::GetParam < string > ("input_model_file"), "kmeans_model",
+				model, true);
+		model.MaxIterations() = (size_t) batchIterations;
+		model.Update(dataset, CLI::GetParam<double>("decay"), assignments);
+	} else {
+		const int clusters = CLI::GetParam<int>("clusters");
+		if (clusters <= 0)
+			Log::Fatal << "Invalid number of clusters requested (" << clusters
+					<< ")! Must be greater than 0 when training a new model." << endl;
+
+		model.Train(dataset, (size_t) clusters, assignments);
+	}
+	Timer::Stop("clustering");
+
+	if (CLI::HasParam("evaluate"))
+		Evaluate(dataset, assignments, model.Centroids());
+
+	SaveAssignments(dataset, assignments);
+
+	if (CLI::HasParam("centroid_file"))
+		data::Save(CLI::GetParam < std::string > ("centroid_file"),
+				model.Centroids());
+
+	if (CLI::HasParam("output_model_file"))
+		data::Save(CLI::GetParam < string > ("output_model_file"), "kmeans_model",
+				model);
+}
+
+// Run kernel k-means with the kernel given by --kernel.
+void RunKernelKMeans() {
+	const string kernelType = CLI::GetParam < string > ("kernel");
+	if (kernelType == "linear") {
+		LinearKernel kernel;
+		RunKernelKMeans(kernel);
+	} else if (kernelType == "gaussian") {
+		GaussianKernel kernel(CLI::GetParam<double>("bandwidth"));
+		RunKernelKMeans(kernel);
+	} else if (kernelType == "polynomial") {
+		PolynomialKernel kernel(CLI::GetParam<double>("degree"),
+				CLI::GetParam<double>("offset"));
+		RunKernelKMeans(kernel);
+	} else if (kernelType == "laplacian") {
+		LaplacianKernel kernel(CLI::GetParam<double>("bandwidth"));
+		RunKernelKMeans(kernel);
+	} else if (kernelType == "epanechnikov") {
+		EpanechnikovKernel kernel(CLI::GetParam<double>("bandwidth"));
+		RunKernelKMeans(kernel);
+	} else if (kernelType == "cosine") {
+		CosineDistance kernel;
+		RunKernelKMeans(kernel);
+	} else {
+		Log::Fatal << "Unknown kernel: '" << kernelType << "'.  Supported options "
+				<< "are 'linear', 'gaussian', 'polynomial', 'laplacian', "
+				<< "'epanechnikov', and 'cosine'." << endl;
+	}
+}
+
+// Run kernel k-means with the given kernel.
+template<typename KernelType>
+void RunKernelKMeans(KernelType& kernel) {
+	const int clusters = CLI::GetParam<int>("clusters");
+	if (clusters <= 0)
+		Log::Fatal << "Invalid number of clusters requested (" << clusters
+				<< ")! Must be greater than 0 when --kernel is specified." << endl;
+
+	const int rank = CLI::GetParam<int>("kernel_rank");
+	if (rank <= 0)
+		Log::Fatal << "Invalid kernel rank (" << rank << ")! Must be greater "
+				<< "than 0." << endl;
+
+	const int maxIterations = CLI::GetParam<int>("max_iterations");
+	if (maxIterations < 0) {
+		Log::Fatal << "Invalid value for maximum iterations (" << maxIterations
+				<< ")! Must be greater than or equal to 0." << endl;
+	}
+
+	if (CLI::HasParam("initial_centroids") || CLI::HasParam("refined_start")
+			|| CLI::HasParam("projection_dim"))
+		Log::Warn << "--kernel is specified, so --initial_centroids, "
+				<< "--refined_start, and --projection_dim are ignored." << endl;
+
+	if (!CLI::HasParam("in_place") && !CLI::HasParam("output_file")
+			&& !CLI::HasParam("centroid_file") && !CLI::HasParam("evaluate")) {
+		Log::Warn
+				<< "--output_file, --in_place, and --centroid_file are not set; "
+				<< "no results will be saved." << std::endl;
+	}
+
+	arma::mat dataset;
+	data::Load(CLI::GetParam < string > ("input_file"), dataset, true);
+
+	Timer::Start("clustering");
+	KernelKMeans<KernelType> kkm(kernel, (size_t) rank,
+			KMeans<>((size_t) maxIterations));
+	arma::Row<size_t> assignments;
+	arma::mat centroids;
+	kkm.Cluster(dataset, (size_t) clusters, assignments, centroids);
+	Timer::Stop("clustering");
+
+	// The clustering is evaluated in the feature space, where it was computed.
+	if (CLI::HasParam("evaluate"))
+		Evaluate(kkm.Features(), assignments, centroids);
+
+	SaveAssignments(dataset, assignments);
+
+	if (CLI::HasParam("centroid_file"))
+		data::Save(CLI::GetParam < std::string > ("centroid_file"), centroids);
+}
+
+// Write the dataset with the assignments as its last row.  The dataset file is
+// copied with the labels appended, if its format allows it; otherwise the
+// labels are added to the loaded dataset, which is saved.
+void SaveLabeledDataset(arma::mat& dataset,
+		const arma::Row<size_t>& assignments, const string& outputFile) {
+	try {
+		if (data::AppendLabels(CLI::GetParam < string > ("input_file"),
+				outputFile, assignments))
+			return;
+	} catch (std::exception& e) {
+		Log::Fatal << "Cannot save to '" << outputFile << "': " << e.what()
+				<< endl;
+	}
+
+	// Convert the assignments to doubles.
+	arma::rowvec converted(assignments.n_elem);
+	for (size_t i = 0; i < assignments.n_elem; i++)
+		converted(i) = (double) assignments(i);
+
+	dataset.insert_rows(dataset.n_rows, converted);
+	data::Save(outputFile, dataset);
+}
+
+// Save the assignments (and possibly the dataset) as requested by --in_place,
+// --output_file, and --labels_only.
+void SaveAssignments(arma::mat& dataset, const arma::Row<size_t>& assignments) {
+	// Now figure out what to do with our results.
+	if (CLI::HasParam("in_place")) {
+		// Add the column of assignments to the dataset.
+		SaveLabeledDataset(dataset, assignments,
+				CLI::GetParam < string > ("input_file"));
+	} else if (CLI::HasParam("output_file")) {
+		string outputFile = CLI::GetParam < string > ("output_file");
+		if (CLI::HasParam("labels_only")) {
+			// Save only the labels.
+			data::SaveResult(outputFile, assignments);
+		} else {
+			// Now save, in the different file.
+			SaveLabeledDataset(dataset, assignments, outputFile);
+		}
+	}
 }
@@ -0,0 +1,189 @@
+/**
+ * @file kmeans_sweep.cpp
+ *
+ * Implementation of KMeansSweep, which runs k-means for many values of k over
+ * a single dataset.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "kmeans_sweep.hpp"
+#include "block_reduction.hpp"
+
+using namespace mlpack;
+using namespace mlpack::kmeans;
+
+namespace {
+
+/**
+ * The results of KMeansSweep::Assign() for some of the points.  The point
+ * furthest from each centroid is combined by taking the larger distance, or the
+ * lower index for equal distances, so it does not depend on the order in which
+ * the partial results are added.
+ */
+struct SweepPartial
+{
+  //! Number of points assigned to each cluster.
+  arma::Col<size_t> counts;
+  //! Sum of squared errors of each cluster.
+  arma::vec sse;
+  //! Squared distance of the furthest point of each cluster.
+  arma::vec furthestDistances;
+  //! Index of the furthest point of each cluster.
+  arma::Col<size_t> furthest;
+
+  //! Set the partial results to zero.
+  void Reset(const size_t clusters)
+  {
+    counts.zeros(clusters);
+    sse.zeros(clusters);
+    furthestDistances.set_size(clusters);
+    furthestDistances.fill(-1.0);
+    furthest.zeros(clusters);
+  }
+
+  //! Add the partial results of other points.
+  SweepPartial& operator+=(const SweepPartial& other)
+  {
+    counts += other.counts;
+    sse += other.sse;
+    for (size_t c = 0; c < furthest.n_elem; ++c)
+    {
+      if (other.furthestDistances[c] > furthestDistances[c] ||
+          (other.furthestDistances[c] == furthestDistances[c] &&
+           other.furthest[c] < furthest[c]))
+      {
+        furthestDistances[c] = other.furthestDistances[c];
+        furthest[c] = other.furthest[c];
+      }
+    }
+    return *this;
+  }
+};
+
+} // anonymous namespace
+
+KMeansSweep::KMeansSweep(const arma::mat& dataset,
+                         const size_t maxIterations) :
+    dataset(dataset),
+    norms(arma::trans(arma::sum(arma::square(dataset)))),
+    maxIterations(maxIterations)
+{
+  // Nothing else to do.
+}
+
+void KMeansSweep::Sweep(const arma::Col<size_t>& clusters,
+                        arma::vec& inertia,
+                        arma::vec& bic,
+                        std::vector<arma::mat>& centroids)
+{
+  KMeans<> kmeans(maxIterations);
+  Sweep(kmeans, clusters, inertia, bic, centroids);
+}
+
+double KMeansSweep::BIC(const size_t points,
+                        const size_t dimensionality,
+                        const arma::Col<size_t>& counts,
+                        const double inertia)
+{
+  const double n = (double) points;
+  const double d = (double) dimensionality;
+  const double k = (double) counts.n_elem;
+
+  // The maximum likelihood estimate of the shared variance.
+  if (points <= counts.n_elem || inertia <= 0.0)
+    return -DBL_MAX;
+  const double variance = inertia / (n - k);
+
+  double logLikelihood = 0.0;
+  for (size_t i = 0; i < counts.n_elem; ++i)
+  {
+    if (counts[i] == 0)
+      continue;
+
+    const double ni = (double) counts[i];
+    logLikelihood += ni * std::log(ni) - ni * std::log(n) -
+        ni / 2.0 * std::log(2.0 * M_PI) - ni * d / 2.0 * std::log(variance) -
+        (ni - k) / 2.0;
+  }
+
+  // k - 1 mixing weights, k d coordinates of the centroids, and the variance.
+  const double parameters = (k - 1) + k * d + 1;
+
+  return logLikelihood - parameters / 2.0 * std::log(n);
+}
+
+double KMeansSweep::Assign(const arma::mat& centroids,
+                           arma::Col<size_t>& counts,
+                           arma::vec& sse,
+                           arma::Col<size_t>& furthest) const
+{
+  const arma::rowvec centroidNorms = arma::sum(arma::square(centroids));
+
+  // Each block of points is assigned with one GEMM, so that we never need an
+  // N x k matrix.
+  const size_t clusters = centroids.n_cols;
+  std::vector<SweepPartial> partials;
+  SweepPartial result;
+  BlockReduction::Reduce(dataset.n_cols, BlockReduction::BlockSize, partials,
+      [clusters](SweepPartial& partial)
+      {
+        partial.Reset(clusters);
+      },
+      [&](SweepPartial& partial, const size_t begin, const size_t end)
+      {
+        arma::mat distances = -2.0 * (centroids.t() *
+            dataset.cols(begin, end - 1));
+        distances.each_col() += centroidNorms.t();
+
+        for (size_t i = begin; i < end; ++i)
+        {
+          arma::uword closest;
+          const double minDistance = distances.col(i - begin).min(closest);
+
+          // Guard against cancellation in the norm expansion.
+          const double distance = std::max(minDistance + norms[i], 0.0);
+
+          ++partial.counts[closest];
+          partial.sse[closest] += distance;
+          if (distance > partial.furthestDistances[closest])
+          {
+            partial.furthestDistances[closest] = distance;
+            partial.furthest[closest] = i;
+          }
+        }
+      }, result);
+
+  counts = result.counts;
+  sse = result.sse;
+  furthest = result.furthest;
+
+  return arma::accu(sse);
+}
+
+void KMeansSweep::Split(arma::mat& centroids,
+                        arma::Col<size_t>& counts,
+                        arma::vec& sse,
+                        arma::Col<size_t>& furthest,
+                        const size_t k) const
+{
+  while (centroids.n_cols < k)
+  {
+    // Split each cluster at most once per pass, since we don't know the new
+    // statistics of a split cluster until we reassign the points.
+    const size_t oldClusters = centroids.n_cols;
+    const size_t splits = std::min(k - oldClusters, oldClusters);
+    const arma::uvec highest = arma::sort_index(sse, "descend");
+
+    centroids.resize(centroids.n_rows, oldClusters + splits);
+    for (size_t s = 0; s < splits; ++s)
+      centroids.col(oldClusters + s) = dataset.col(furthest[highest[s]]);
+
+    if (centroids.n_cols < k)
+      Assign(centroids, counts, sse, furthest);
+  }
+}
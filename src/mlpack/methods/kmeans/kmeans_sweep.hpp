@@ -0,0 +1,157 @@
+/**
+ * @file kmeans_sweep.hpp
+ *
+ * Run k-means for many values of k over a single dataset, warm-starting each
+ * value of k from the solution for a smaller k, and report the inertia and
+ * Bayesian information criterion for each k.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_SWEEP_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_SWEEP_HPP
+
+#include <mlpack/core.hpp>
+#include "kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * KMeansSweep clusters one dataset with Euclidean k-means for a list of values
+ * of k, which is useful for choosing k.  Each value of k is clustered with
+ * KMeans::Cluster(), so the sweep uses the Lloyd step, initial partition
+ * policy and empty cluster policy of the given KMeans object.  The squared
+ * norms of the points are computed once, and are used to compute the
+ * statistics of each solution (below) with the norm expansion
+ * ||x||^2 - 2 x^T c + ||c||^2, one GEMM per block of points; the blocks are
+ * processed in parallel and their results are added with BlockReduction.
+ *
+ * The values of k are clustered in increasing order.  The smallest starts from
+ * the initial partition policy of the KMeans object; each following value of k
+ * starts from the solution for the previous value, by repeatedly splitting the
+ * clusters with the highest sum of squared errors (the point in the cluster
+ * that is furthest from its centroid becomes a new centroid).  So the warm
+ * starts do not depend on the number of threads.
+ *
+ * For each k, the inertia (sum of squared distances from each point to its
+ * centroid) and the BIC of the spherical Gaussian model used by X-means are
+ * reported:
+ *
+ * @code
+ * @inproceedings{pelleg2000x,
+ *   title={X-means: Extending K-means with Efficient Estimation of the Number
+ *       of Clusters},
+ *   author={Pelleg, Dan and Moore, Andrew W.},
+ *   booktitle={Proceedings of the Seventeenth International Conference on
+ *       Machine Learning (ICML 2000)},
+ *   pages={727--734},
+ *   year={2000}
+ * }
+ * @endcode
+ */
+class KMeansSweep
+{
+ public:
+  /**
+   * Prepare to sweep over k for the given dataset.  This computes the squared
+   * norms of every point.
+   *
+   * @param dataset Dataset to cluster.
+   * @param maxIterations Maximum number of Lloyd iterations for each k, when
+   *     the sweep is run with a default KMeans object.
+   */
+  KMeansSweep(const arma::mat& dataset, const size_t maxIterations = 1000);
+
+  /**
+   * Cluster the dataset for each of the given values of k with the given
+   * KMeans object.  The results for clusters[i] are stored in inertia[i],
+   * bic[i], and centroids[i].
+   *
+   * @param kmeans KMeans object to cluster with.
+   * @param clusters Values of k to cluster with.
+   * @param inertia Inertia for each value of k (output).
+   * @param bic BIC for each value of k (output; larger is better).
+   * @param centroids Centroids for each value of k (output).
+   */
+  template<typename KMeansType>
+  void Sweep(KMeansType& kmeans,
+             const arma::Col<size_t>& clusters,
+             arma::vec& inertia,
+             arma::vec& bic,
+             std::vector<arma::mat>& centroids);
+
+  /**
+   * Cluster the dataset for each of the given values of k with the default
+   * KMeans type, limited to MaxIterations() Lloyd iterations for each k.
+   *
+   * @param clusters Values of k to cluster with.
+   * @param inertia Inertia for each value of k (output).
+   * @param bic BIC for each value of k (output; larger is better).
+   * @param centroids Centroids for each value of k (output).
+   */
+  void Sweep(const arma::Col<size_t>& clusters,
+             arma::vec& inertia,
+             arma::vec& bic,
+             std::vector<arma::mat>& centroids);
+
+  /**
+   * Compute the BIC of the X-means spherical Gaussian model for a clustering.
+   *
+   * @param points Number of points.
+   * @param dimensionality Dimensionality of the points.
+   * @param counts Number of points in each cluster.
+   * @param inertia Sum of squared distances of each point to its centroid.
+   */
+  static double BIC(const size_t points,
+                    const size_t dimensionality,
+                    const arma::Col<size_t>& counts,
+                    const double inertia);
+
+  //! Get the maximum number of iterations for each k (default KMeans only).
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of iterations for each k (default KMeans only).
+  size_t& MaxIterations() { return maxIterations; }
+
+ private:
+  //! The dataset.
+  const arma::mat& dataset;
+  //! Squared norms of each point, shared by every clustering.
+  arma::vec norms;
+  //! Maximum number of Lloyd iterations for each k, for the default KMeans.
+  size_t maxIterations;
+
+  /**
+   * Assign every point to its closest centroid, and compute the number of
+   * points, the sum of squared errors, and the point furthest from the
+   * centroid of each cluster.
+   *
+   * @return Total sum of squared errors.
+   */
+  double Assign(const arma::mat& centroids,
+                arma::Col<size_t>& counts,
+                arma::vec& sse,
+                arma::Col<size_t>& furthest) const;
+
+  /**
+   * Add centroids until there are k of them, by splitting the clusters with
+   * the highest sum of squared errors.
+   */
+  void Split(arma::mat& centroids,
+             arma::Col<size_t>& counts,
+             arma::vec& sse,
+             arma::Col<size_t>& furthest,
+             const size_t k) const;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "kmeans_sweep_impl.hpp"
+
+#endif
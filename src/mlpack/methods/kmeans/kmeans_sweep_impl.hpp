@@ -0,0 +1,63 @@
+/**
+ * @file kmeans_sweep_impl.hpp
+ *
+ * Implementation of the templated sweep of KMeansSweep.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_KMEANS_SWEEP_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_KMEANS_SWEEP_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "kmeans_sweep.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename KMeansType>
+void KMeansSweep::Sweep(KMeansType& kmeans,
+                        const arma::Col<size_t>& clusters,
+                        arma::vec& inertia,
+                        arma::vec& bic,
+                        std::vector<arma::mat>& centroids)
+{
+  inertia.zeros(clusters.n_elem);
+  bic.zeros(clusters.n_elem);
+  centroids.resize(clusters.n_elem);
+
+  // Warm starts only make sense going from small k to large k.
+  const arma::uvec order = arma::sort_index(clusters);
+
+  arma::Col<size_t> counts;
+  arma::vec sse;
+  arma::Col<size_t> furthest;
+  for (size_t j = 0; j < clusters.n_elem; ++j)
+  {
+    const size_t index = order[j];
+    if (j == 0)
+    {
+      // The first clustering starts from the initial partition policy.
+      kmeans.Cluster(dataset, clusters[index], centroids[index], false);
+    }
+    else
+    {
+      // Warm-start from the previous solution.
+      centroids[index] = centroids[order[j - 1]];
+      Split(centroids[index], counts, sse, furthest, clusters[index]);
+      kmeans.Cluster(dataset, clusters[index], centroids[index], true);
+    }
+
+    inertia[index] = Assign(centroids[index], counts, sse, furthest);
+    bic[index] = BIC(dataset.n_cols, dataset.n_rows, counts, inertia[index]);
+  }
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * @file lloyd_step_options.hpp
+ *
+ * Options which KMeans passes to the Lloyd step it constructs.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_LLOYD_STEP_OPTIONS_HPP
+#define __MLPACK_METHODS_KMEANS_LLOYD_STEP_OPTIONS_HPP
+
+#include <mlpack/core.hpp>
+#include "quantized_matrix.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The options of the Lloyd steps.  KMeans constructs its Lloyd step in every
+ * call to Cluster(), so the options are given to the KMeans object (see
+ * KMeans::LloydOptions()), which passes them to the constructor of the Lloyd
+ * step.  Each Lloyd step uses the options that apply to it and ignores the
+ * others.  The defaults give the behavior of the Lloyd steps without options.
+ */
+struct LloydStepOptions
+{
+  //! Set the default options.
+  LloydStepOptions() :
+      projectionDim(0),
+      candidates(0),
+      quantization(QuantizedMatrix::INT8),
+      recheck(true),
+      quantizedData(NULL),
+      mixedPrecision(false)
+  { }
+
+  //! The projected dimensionality used by ProjectedKMeans; 0 chooses
+  //! automatically.
+  size_t projectionDim;
+  //! The number of candidate centroids that ProjectedKMeans checks in full
+  //! dimensionality for each point; 0 chooses automatically.
+  size_t candidates;
+
+  //! The type of compression used by QuantizedKMeans.
+  QuantizedMatrix::Type quantization;
+  //! Whether QuantizedKMeans reassigns points with near-tie distances using
+  //! the original data.
+  bool recheck;
+  //! If not NULL, the compressed dataset that QuantizedKMeans uses instead of
+  //! compressing the dataset itself; it must outlive the Lloyd step.
+  const QuantizedMatrix* quantizedData;
+
+  //! Whether NaiveKMeans, and MaxVarianceNewCluster in the other Lloyd steps,
+  //! assign points in mixed precision (see MixedPrecisionAssignment).
+  bool mixedPrecision;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,154 @@
+/**
+ * @file lloyd_workspace.hpp
+ *
+ * Scratch memory shared by the iterations of a Lloyd step, so that the
+ * iterations do not need to allocate memory.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_LLOYD_WORKSPACE_HPP
+#define __MLPACK_METHODS_KMEANS_LLOYD_WORKSPACE_HPP
+
+#include <mlpack/core.hpp>
+#include "block_reduction.hpp"
+#include "mixed_precision_assignment.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The LloydWorkspace holds the temporary matrices that a Lloyd step needs in
+ * every iteration.  KMeans::Cluster() creates one workspace, sized for the
+ * number of points and clusters, and passes it to the constructor of the Lloyd
+ * step; the step then reuses the same memory in every iteration instead of
+ * allocating new matrices.
+ *
+ * The per-cluster and per-point buffers are allocated when the workspace is
+ * constructed.  The distance matrix is only needed by some Lloyd steps, so it
+ * is allocated by the first call to Distances() and then reused as long as the
+ * requested size does not change.  Likewise, the single precision copy of the
+ * dataset used by mixed precision assignments is only made by the first call
+ * to FloatData(), and is then shared by every user of the workspace.
+ */
+class LloydWorkspace
+{
+ public:
+  /**
+   * Allocate the buffers for a clustering of the given size.
+   *
+   * @param points Number of points in the dataset.
+   * @param clusters Number of clusters.
+   */
+  LloydWorkspace(const size_t points, const size_t clusters) :
+      clusterValues(clusters),
+      centroidNorms(clusters),
+      pointFlags(points)
+  { }
+
+  /**
+   * Get a matrix for distances (or inner products) of the given size.  The
+   * matrix is only reallocated if the size differs from the last call.  The
+   * contents are not initialized.
+   */
+  arma::mat& Distances(const size_t rows, const size_t cols)
+  {
+    if (distances.n_rows != rows || distances.n_cols != cols)
+      distances.set_size(rows, cols);
+    return distances;
+  }
+
+  /**
+   * Get the single precision copy of the dataset (see
+   * MixedPrecisionAssignment).  The copy and the norm of each point (see
+   * PointNorms()) are computed by the first call, so the dataset is converted
+   * once per clustering.  Every call must give the same dataset.
+   */
+  template<typename MatType>
+  const arma::fmat& FloatData(const MatType& data)
+  {
+    if (floatData.n_cols != data.n_cols)
+    {
+      MixedPrecisionAssignment::ToFloat(data, floatData);
+      pointNorms.set_size(data.n_cols);
+      for (size_t i = 0; i < data.n_cols; ++i)
+        pointNorms[i] = arma::norm(data.col(i), 2);
+    }
+    return floatData;
+  }
+
+  //! Get the norm (not squared) of each point, computed by FloatData().
+  const arma::vec& PointNorms() const { return pointNorms; }
+
+  /**
+   * Get one buffer of single precision inner products per thread, for
+   * MixedPrecisionAssignment::AssignBlock().  There are at least the given
+   * number of buffers; call this outside of parallel regions.
+   */
+  std::vector<arma::fmat>& FloatProducts(const size_t threads)
+  {
+    if (floatProducts.size() < threads)
+      floatProducts.resize(threads);
+    return floatProducts;
+  }
+
+  //! Get a vector with one element per cluster (such as centroid movements).
+  arma::vec& ClusterValues() { return clusterValues; }
+  //! Get a vector for the squared norms of each centroid.
+  arma::vec& CentroidNorms() { return centroidNorms; }
+  //! Get one flag per point.
+  std::vector<bool>& PointFlags() { return pointFlags; }
+  //! Get the partial results for BlockReduction::Reduce().
+  std::vector<ClusterPartial>& Partials() { return partials; }
+  //! Get storage for the result of BlockReduction::Reduce().
+  ClusterPartial& Result() { return result; }
+
+  //! Get the total size of the buffers, in bytes.
+  size_t Size() const
+  {
+    size_t size = sizeof(double) * (distances.n_elem + clusterValues.n_elem +
+        centroidNorms.n_elem + pointNorms.n_elem) + sizeof(float) *
+        floatData.n_elem + (pointFlags.size() + 7) / 8 + Size(result);
+    for (size_t i = 0; i < floatProducts.size(); ++i)
+      size += sizeof(float) * floatProducts[i].n_elem;
+    for (size_t i = 0; i < partials.size(); ++i)
+      size += Size(partials[i]);
+    return size;
+  }
+
+ private:
+  //! Distances (or inner products) between centroids and points.
+  arma::mat distances;
+  //! Single precision copy of the dataset.
+  arma::fmat floatData;
+  //! Norm of each point of the dataset.
+  arma::vec pointNorms;
+  //! Single precision inner products, one buffer per thread.
+  std::vector<arma::fmat> floatProducts;
+  //! One value per cluster.
+  arma::vec clusterValues;
+  //! Squared norms of the centroids.
+  arma::vec centroidNorms;
+  //! One flag per point.
+  std::vector<bool> pointFlags;
+  //! Partial results of a parallel reduction.
+  std::vector<ClusterPartial> partials;
+  //! Result of a parallel reduction.
+  ClusterPartial result;
+
+  //! Get the size of a partial result, in bytes.
+  static size_t Size(const ClusterPartial& partial)
+  {
+    return sizeof(double) * (partial.sums.n_elem + partial.variances.n_elem) +
+        sizeof(size_t) * partial.counts.n_elem;
+  }
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -17,6 +17,7 @@
 #define __MLPACK_METHODS_KMEANS_MAX_VARIANCE_NEW_CLUSTER_HPP
 
 #include <mlpack/core.hpp>
+#include "lloyd_workspace.hpp"
 
 namespace mlpack {
 namespace kmeans {
@@ -29,7 +30,18 @@ class MaxVarianceNewCluster
 {
  public:
   //! Default constructor required by EmptyClusterPolicy.
-  MaxVarianceNewCluster() : iteration(size_t(-1)) { }
+  MaxVarianceNewCluster() : iteration(size_t(-1)), workspace(NULL) { }
+
+  /**
+   * Construct the policy for a Lloyd step.  If workspace is not NULL, the
+   * assignments are computed in mixed precision (see
+   * MixedPrecisionAssignment), with the single precision copy of the dataset
+   * held by the workspace.
+   *
+   * @param workspace The workspace of the Lloyd step, or NULL.
+   */
+  explicit MaxVarianceNewCluster(LloydWorkspace* workspace) :
+      iteration(size_t(-1)), workspace(workspace) { }
 
   /**
    * Take the point furthest from the centroid of the cluster with maximum
@@ -67,6 +79,9 @@ class MaxVarianceNewCluster
   arma::vec variances;
   //! Cached assignments for each point.
   arma::Row<size_t> assignments;
+  //! The workspace holding the single precision dataset, if mixed precision is
+  //! used.
+  LloydWorkspace* workspace;
 
   //! Called when we are on a new iteration.
   template<typename MetricType, typename MatType>
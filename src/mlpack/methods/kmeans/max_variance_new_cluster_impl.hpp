@@ -116,6 +116,35 @@ void MaxVarianceNewCluster::Precalculate(const MatType& data,
 	variances.zeros(oldCentroids.n_cols);
 	assignments.set_size(data.n_cols);
 
+	if (workspace) {
+		// Compute the inner products in single precision, a block at a time, from
+		// the copy of the data in the workspace (converted once per clustering),
+		// and recompute the uncertain assignments in double precision.
+		const arma::fmat& floatData = workspace->FloatData(data);
+		const arma::fmat floatCentroids = arma::conv_to<arma::fmat>::from(
+				oldCentroids);
+		arma::vec cct(oldCentroids.n_cols);
+		for (size_t i = 0; i < oldCentroids.n_cols; i++)
+			cct[i] = arma::dot(oldCentroids.col(i), oldCentroids.col(i));
+
+		MixedPrecisionAssignment::AssignBlock(data, floatData,
+				workspace->PointNorms(), oldCentroids, floatCentroids, cct, metric,
+				0, data.n_cols, workspace->FloatProducts(1)[0],
+				assignments.memptr());
+
+		for (size_t i = 0; i < data.n_cols; i++)
+			variances[assignments[i]] += std::pow(
+					metric.Evaluate(data.col(i), oldCentroids.col(assignments[i])),
+					2.0);
+
+		for (size_t i = 0; i < clusterCounts.n_elem; ++i)
+			if (clusterCounts[i] <= 1)
+				variances[i] = 0;
+			else
+				variances[i] /= clusterCounts[i];
+		return;
+	}
+
 	arma::mat dataset_t = data.t();
 	arma::mat dist_matrix(data.n_cols, oldCentroids.n_cols);
 	dist_matrix = dataset_t * oldCentroids;
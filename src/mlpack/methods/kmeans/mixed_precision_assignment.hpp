@@ -0,0 +1,210 @@
+/**
+ * @file mixed_precision_assignment.hpp
+ *
+ * Assignment of points to their closest centroids using single-precision inner
+ * products, with the points whose assignment is uncertain recomputed in double
+ * precision.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_MIXED_PRECISION_ASSIGNMENT_HPP
+#define __MLPACK_METHODS_KMEANS_MIXED_PRECISION_ASSIGNMENT_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * The closest centroid to a point x minimizes ||c||^2 - 2 x^T c, so the
+ * assignment step only needs the inner products x^T c, which can be computed
+ * for all points at once with a GEMM.  In mixed-precision mode, the points and
+ * centroids are rounded to float and the GEMM is done in single precision,
+ * which is about twice as fast and moves half the data.
+ *
+ * Rounding the inputs and summing d products in float gives an inner product
+ * within (d + 3) u ||x|| ||c|| of the exact one, where u = 2^-24 is the unit
+ * roundoff of float.  The squared centroid norms are kept in double, so every
+ * ||c||^2 - 2 x^T c is known to within
+ *
+ *   E(x) = 2 (d + 4) u ||x|| max_c ||c||.
+ *
+ * If the second smallest value is more than 2 E(x) above the smallest, the
+ * closest centroid is certain.  Otherwise, every centroid within 2 E(x) of the
+ * smallest value is compared with the double precision metric.  The result is
+ * the same as a double precision assignment, and only points near a boundary
+ * between clusters pay for the recomputation.
+ *
+ * Mixed precision is enabled with LloydStepOptions::mixedPrecision.  The
+ * single precision copy of the dataset is kept in the LloydWorkspace (see
+ * LloydWorkspace::FloatData()), so it is converted once per clustering and
+ * shared by NaiveKMeans and MaxVarianceNewCluster, and the inner products are
+ * computed SubBlockSize points at a time (see AssignBlock()), so no k x N
+ * matrix is needed.
+ */
+class MixedPrecisionAssignment
+{
+ public:
+  //! Number of points whose inner products are computed at once by
+  //! AssignBlock(), so that the products stay in cache.
+  static const size_t SubBlockSize = 256;
+
+  //! Convert a dense matrix to single precision.
+  static void ToFloat(const arma::mat& input, arma::fmat& output)
+  {
+    output = arma::conv_to<arma::fmat>::from(input);
+  }
+
+  //! Convert a sparse matrix to a dense single precision matrix.
+  template<typename eT>
+  static void ToFloat(const arma::SpMat<eT>& input, arma::fmat& output)
+  {
+    output = arma::conv_to<arma::fmat>::from(arma::Mat<eT>(input));
+  }
+
+  //! Get the bound on the error of ||c||^2 - 2 x^T c for a point with the
+  //! given norm, when the largest centroid norm is maxCentroidNorm.
+  static double ErrorBound(const size_t dimensionality,
+                           const double pointNorm,
+                           const double maxCentroidNorm)
+  {
+    return 2.0 * (dimensionality + 4) * std::pow(2.0, -24.0) * pointNorm *
+        maxCentroidNorm;
+  }
+
+  /**
+   * Find the closest centroid to a point, given the single precision inner
+   * products of the point with every centroid.
+   *
+   * @param point The point (in double precision).
+   * @param pointNorm The norm (not squared) of the point.
+   * @param products The inner products of the point with every centroid.
+   * @param centroids The centroids.
+   * @param centroidNorms The squared norms of the centroids.
+   * @param maxCentroidNorm The largest norm (not squared) of the centroids.
+   * @param metric The metric used for the double precision comparisons.
+   * @param rechecked Set to true if the double precision metric was used.
+   * @return Index of the closest centroid.
+   */
+  template<typename VecType, typename MetricType>
+  static size_t Closest(const VecType& point,
+                        const double pointNorm,
+                        const float* products,
+                        const arma::mat& centroids,
+                        const arma::vec& centroidNorms,
+                        const double maxCentroidNorm,
+                        MetricType& metric,
+                        bool& rechecked)
+  {
+    const size_t clusters = centroids.n_cols;
+    size_t closest = 0;
+    double minValue = DBL_MAX;
+    double secondValue = DBL_MAX;
+    for (size_t c = 0; c < clusters; ++c)
+    {
+      const double value = centroidNorms[c] - 2.0 * (double) products[c];
+      if (value < minValue)
+      {
+        secondValue = minValue;
+        minValue = value;
+        closest = c;
+      }
+      else if (value < secondValue)
+      {
+        secondValue = value;
+      }
+    }
+
+    const double window = 2.0 * ErrorBound(centroids.n_rows, pointNorm,
+        maxCentroidNorm);
+    rechecked = (secondValue - minValue <= window);
+    if (!rechecked)
+      return closest;
+
+    // Compare the candidates in double precision.
+    double minDistance = DBL_MAX;
+    for (size_t c = 0; c < clusters; ++c)
+    {
+      if (centroidNorms[c] - 2.0 * (double) products[c] > minValue + window)
+        continue;
+
+      const double distance = metric.Evaluate(point, centroids.col(c));
+      if (distance < minDistance)
+      {
+        minDistance = distance;
+        closest = c;
+      }
+    }
+
+    return closest;
+  }
+
+  /**
+   * Find the closest centroid of each of the points [begin, end).  The single
+   * precision inner products are computed SubBlockSize points at a time into
+   * the given buffer.
+   *
+   * @param data The points (in double precision).
+   * @param floatData The points in single precision.
+   * @param pointNorms The norm (not squared) of each point.
+   * @param centroids The centroids.
+   * @param floatCentroids The centroids in single precision.
+   * @param centroidNorms The squared norms of the centroids.
+   * @param metric The metric used for the double precision comparisons.
+   * @param begin First point.
+   * @param end One past the last point.
+   * @param products Buffer for the inner products; it is resized if needed.
+   * @param closest Set to the index of the closest centroid of each point
+   *     (point i is at closest[i - begin]).
+   * @return The number of points compared in double precision.
+   */
+  template<typename MatType, typename MetricType>
+  static size_t AssignBlock(const MatType& data,
+                            const arma::fmat& floatData,
+                            const arma::vec& pointNorms,
+                            const arma::mat& centroids,
+                            const arma::fmat& floatCentroids,
+                            const arma::vec& centroidNorms,
+                            MetricType& metric,
+                            const size_t begin,
+                            const size_t end,
+                            arma::fmat& products,
+                            size_t* closest)
+  {
+    const size_t clusters = centroids.n_cols;
+    if (products.n_rows != clusters || products.n_cols != SubBlockSize)
+      products.set_size(clusters, SubBlockSize);
+    const double maxCentroidNorm = std::sqrt(centroidNorms.max());
+
+    size_t rechecks = 0;
+    for (size_t subBegin = begin; subBegin < end; subBegin += SubBlockSize)
+    {
+      const size_t subEnd = std::min(subBegin + SubBlockSize, end);
+      arma::fmat subProducts(products.memptr(), clusters, subEnd - subBegin,
+          false, true);
+      subProducts = floatCentroids.t() * floatData.cols(subBegin, subEnd - 1);
+
+      for (size_t i = subBegin; i < subEnd; ++i)
+      {
+        bool rechecked;
+        closest[i - begin] = Closest(data.col(i), pointNorms[i],
+            subProducts.colptr(i - subBegin), centroids, centroidNorms,
+            maxCentroidNorm, metric, rechecked);
+        if (rechecked)
+          ++rechecks;
+      }
+    }
+
+    return rechecks;
+  }
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
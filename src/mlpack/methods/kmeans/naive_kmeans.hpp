@@ -16,6 +16,11 @@
 #ifndef __MLPACK_METHODS_KMEANS_NAIVE_KMEANS_HPP
 #define __MLPACK_METHODS_KMEANS_NAIVE_KMEANS_HPP
 
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
+#include "block_reduction.hpp"
+#include "mixed_precision_assignment.hpp"
+
 namespace mlpack {
 namespace kmeans {
 
@@ -36,8 +41,12 @@ public:
 	 *
 	 * @param dataset Dataset.
 	 * @param metric Instantiated metric.
+	 * @param workspace Scratch memory reused by every iteration.
+	 * @param options Options of the Lloyd step; mixedPrecision is used.
 	 */
-	NaiveKMeans(const MatType& dataset, MetricType& metric);
+	NaiveKMeans(const MatType& dataset, MetricType& metric,
+			LloydWorkspace& workspace,
+			const LloydStepOptions& options = LloydStepOptions());
 
 	/**
 	 * Run a single iteration of the Lloyd algorithm, updating the given centroids
@@ -53,6 +62,12 @@ public:
 		return distanceCalculations;
 	}
 
+	//! Return the number of points whose assignment was recomputed in double
+	//! precision (see MixedPrecisionAssignment).
+	size_t Rechecks() const {
+		return rechecks;
+	}
+
 	int EmptyClusterAdjust(const MatType& data, const size_t emptyCluster,
 				const arma::mat& oldCentroids, arma::mat& newCentroids,
 				arma::Col<size_t>& clusterCounts, MetricType& metric,
@@ -60,10 +75,9 @@ public:
 private:
 	//! The dataset.
 	const MatType& dataset;
+	//! Scratch memory for the distances between points and centroids.
+	LloydWorkspace& workspace;
 
-	arma::mat ddt;
-
-	arma::mat dataset_t;
 	arma::vec variances;
 	//! Cached assignments for each point.
 	arma::Row<size_t> assignments;
@@ -72,8 +86,20 @@ private:
 	size_t iteration;
 	//! Number of distance calculations.
 	size_t distanceCalculations;
+	//! Number of points reassigned in double precision.
+	size_t rechecks;
+
+	//! Whether points are assigned in mixed precision.
+	bool mixedPrecision;
 
+	//! Single precision copy of the centroids, if mixed precision is used.  The
+	//! single precision dataset is kept in the workspace.
+	arma::fmat floatCentroids;
 
+	//! Timers of the phases of each iteration, registered once.
+	Timer::Handle distancesTimer;
+	Timer::Handle assignmentTimer;
+	Timer::Handle updateTimer;
 };
 
 } // namespace kmeans
@@ -25,18 +25,15 @@ namespace kmeans {
 
 template<typename MetricType, typename MatType>
 NaiveKMeans<MetricType, MatType>::NaiveKMeans(const MatType& dataset,
-		MetricType& metric) :
-		dataset(dataset), metric(metric), distanceCalculations(0) {
-	ddt.zeros(dataset.n_cols, 1);
-	dataset_t = dataset.t();
-	double sum;
-	for (size_t i = 0; i < dataset.n_cols; i++) {
-		sum = 0;
-		for (size_t j = 0; j < dataset.n_rows; j++)
-			sum += dataset(j, i) * dataset(j, i);
-		ddt(i, 0) = sum;
-	}
-
+		MetricType& metric, LloydWorkspace& workspace,
+		const LloydStepOptions& options) :
+		dataset(dataset), workspace(workspace), metric(metric),
+		distanceCalculations(0), rechecks(0),
+		mixedPrecision(options.mixedPrecision),
+		distancesTimer(Timer::Register("clustering/distances")),
+		assignmentTimer(Timer::Register("clustering/assignment")),
+		updateTimer(Timer::Register("clustering/update")) {
+	// Nothing to do.
 }
 
 template<typename MetricType, typename MatType>
@@ -111,42 +108,101 @@ template<typename MetricType, typename MatType>
 double NaiveKMeans<MetricType, MatType>::Iterate(arma::mat& centroids,
 		arma::mat& newCentroids, arma::Col<size_t>& counts) {
 
-	newCentroids.zeros(centroids.n_rows, centroids.n_cols);
-	counts.zeros(centroids.n_cols);
-	variances.zeros(centroids.n_cols);
 	assignments.set_size(dataset.n_cols);
 
-	arma::mat dist_matrix(dataset.n_cols, centroids.n_cols);
-	dist_matrix = dataset_t * centroids;
-	arma::mat cct(centroids.n_cols, 1);
-
-	double sum;
-	for (size_t i = 0; i < centroids.n_cols; i++) {
-		sum = 0;
-		for (size_t j = 0; j < centroids.n_rows; j++)
-			sum += centroids(j, i) * centroids(j, i);
-		cct(i, 0) = sum;
-	}
-	dist_matrix = -2 * dist_matrix;
-	dist_matrix.each_col() += ddt;
-	arma::mat dist_matrix_t = dist_matrix.t();
-	dist_matrix_t.each_col() += cct;
-
-	for (size_t i = 0; i < dataset.n_cols; i++) {
-
-		arma::uword closestCluster; // Invalid value.
-		dist_matrix_t.col(i).min(closestCluster);
-
-		Log::Assert(closestCluster != centroids.n_cols);
-
-		// We now have the minimum distance centroid index.  Update that centroid.
-		newCentroids.col(closestCluster) += dataset.col(i);
-		++counts(closestCluster);
-		assignments[i] = closestCluster;
-		variances[closestCluster] += std::pow(
-				metric.Evaluate(dataset.col(i), centroids.col(closestCluster)),
-				2.0);
+	// Each phase has its own timer (and hardware counters, with
+	// --perf_counters), run once per iteration.
+	Timer::Start(distancesTimer);
+
+	arma::vec& cct = workspace.CentroidNorms();
+	for (size_t i = 0; i < centroids.n_cols; i++)
+		cct[i] = arma::dot(centroids.col(i), centroids.col(i));
+
+	// Compute the inner products between every centroid and every point into
+	// the workspace, which is only allocated in the first iteration.  The
+	// squared distance from point i to centroid c is
+	// ||x_i||^2 - 2 x_i^T c + ||c||^2, and since ||x_i||^2 is the same for every
+	// centroid, it does not change which centroid is closest.  In mixed
+	// precision mode the products are computed in single precision instead,
+	// block by block while the points are assigned, and the double precision
+	// matrix is left empty.
+	arma::mat& distances = workspace.Distances(
+			mixedPrecision ? 0 : centroids.n_cols,
+			mixedPrecision ? 0 : dataset.n_cols);
+	// The blocks are assigned on the shared thread pool, with a buffer of
+	// single precision products for each thread.
+	util::ThreadPool& pool = util::ThreadPool::Global();
+	std::vector<arma::fmat>& floatProducts = workspace.FloatProducts(
+			mixedPrecision ? pool.Threads() : 0);
+	const arma::fmat* floatDataset = NULL;
+	if (mixedPrecision) {
+		// The workspace converts the dataset in the first iteration only.
+		floatDataset = &workspace.FloatData(dataset);
+		floatCentroids = arma::conv_to<arma::fmat>::from(centroids);
+	} else {
+		distances = centroids.t() * dataset;
 	}
+	Timer::Stop(distancesTimer);
+
+	// Assign the points in parallel.  Each block of points accumulates its own
+	// sums, counts, and variances, and BlockReduction adds them up (in a fixed
+	// order if BlockReduction::Deterministic() is set).
+	const size_t dimensionality = centroids.n_rows;
+	const size_t clusters = centroids.n_cols;
+	std::atomic<size_t> iterationRechecks(0);
+	ClusterPartial& result = workspace.Result();
+	Timer::Start(assignmentTimer);
+	BlockReduction::Reduce(dataset.n_cols, BlockReduction::BlockSize,
+			workspace.Partials(),
+			[dimensionality, clusters](ClusterPartial& partial) {
+				partial.Reset(dimensionality, clusters, true);
+			},
+			[&](ClusterPartial& partial, const size_t begin, const size_t end) {
+				size_t blockRechecks = 0;
+				if (mixedPrecision) {
+					const size_t t = pool.ThreadIndex();
+					blockRechecks = MixedPrecisionAssignment::AssignBlock(dataset,
+							*floatDataset, workspace.PointNorms(), centroids,
+							floatCentroids, cct, metric, begin, end, floatProducts[t],
+							assignments.memptr() + begin);
+				}
+
+				for (size_t i = begin; i < end; i++) {
+					size_t closestCluster = clusters; // Invalid value.
+					if (mixedPrecision) {
+						closestCluster = assignments[i];
+					} else {
+						const double* products = distances.colptr(i);
+						double minDistance = DBL_MAX;
+						for (size_t j = 0; j < clusters; j++) {
+							const double distance = cct[j] - 2.0 * products[j];
+							if (distance < minDistance) {
+								minDistance = distance;
+								closestCluster = j;
+							}
+						}
+					}
+
+					Log::Assert(closestCluster != clusters);
+
+					// We now have the minimum distance centroid index.  Update that
+					// centroid.
+					partial.sums.col(closestCluster) += dataset.col(i);
+					++partial.counts(closestCluster);
+					assignments[i] = closestCluster;
+					partial.variances[closestCluster] += std::pow(
+							metric.Evaluate(dataset.col(i),
+									centroids.col(closestCluster)), 2.0);
+				}
+
+				iterationRechecks += blockRechecks;
+			}, result);
+	Timer::Stop(assignmentTimer);
+
+	Timer::Start(updateTimer);
+	newCentroids = result.sums;
+	counts = result.counts;
+	variances = result.variances;
 
 	// Now normalize the centroid.
 	for (size_t i = 0; i < centroids.n_cols; ++i)
@@ -156,6 +212,10 @@ double NaiveKMeans<MetricType, MatType>::Iterate(arma::mat& centroids,
 			newCentroids.col(i).fill(DBL_MAX); // Invalid value.
 
 	distanceCalculations += centroids.n_cols * dataset.n_cols;
+	rechecks += iterationRechecks.load();
+	if (mixedPrecision)
+		Log::Debug << "NaiveKMeans: " << iterationRechecks.load() << " points "
+				<< "reassigned in double precision." << std::endl;
 
 	// Calculate cluster distortion for this iteration.
 	double cNorm = 0.0;
@@ -170,6 +230,7 @@ double NaiveKMeans<MetricType, MatType>::Iterate(arma::mat& centroids,
 			variances[i] = 0;
 		else
 			variances[i] /= counts[i];
+	Timer::Stop(updateTimer);
 
 	return std::sqrt(cNorm);
 }
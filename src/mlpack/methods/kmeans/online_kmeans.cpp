@@ -0,0 +1,161 @@
+/**
+ * @file online_kmeans.cpp
+ *
+ * Implementation of OnlineKMeans, a k-means model which can be updated with
+ * new batches of data.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "online_kmeans.hpp"
+#include "kmeans.hpp"
+
+using namespace mlpack;
+using namespace mlpack::kmeans;
+
+OnlineKMeans::OnlineKMeans(const size_t maxIterations) :
+    maxIterations(maxIterations)
+{
+  // Nothing to do.
+}
+
+OnlineKMeans::OnlineKMeans(const arma::mat& data,
+                           const arma::Row<size_t>& assignments,
+                           const size_t clusters,
+                           const size_t maxIterations) :
+    maxIterations(maxIterations)
+{
+  sums.zeros(data.n_rows, clusters);
+  weights.zeros(clusters);
+  centroids.zeros(data.n_rows, clusters);
+
+  arma::Col<size_t> counts(clusters, arma::fill::zeros);
+  arma::mat batchSums(data.n_rows, clusters, arma::fill::zeros);
+  for (size_t i = 0; i < data.n_cols; ++i)
+  {
+    batchSums.col(assignments[i]) += data.col(i);
+    ++counts[assignments[i]];
+  }
+
+  UpdateCentroids(batchSums, counts);
+  sums = batchSums;
+  weights = arma::conv_to<arma::vec>::from(counts);
+}
+
+void OnlineKMeans::Train(const arma::mat& data,
+                         const size_t clusters,
+                         arma::Row<size_t>& assignments)
+{
+  KMeans<> kmeans;
+  arma::mat initialCentroids;
+  kmeans.Cluster(data, clusters, assignments, initialCentroids);
+
+  *this = OnlineKMeans(data, assignments, clusters, maxIterations);
+}
+
+void OnlineKMeans::Update(const arma::mat& batch,
+                          const double decay,
+                          arma::Row<size_t>& assignments)
+{
+  if (centroids.n_cols == 0)
+    Log::Fatal << "OnlineKMeans::Update(): the model has not been trained!"
+        << std::endl;
+  if (batch.n_rows != centroids.n_rows)
+    Log::Fatal << "OnlineKMeans::Update(): batch dimensionality ("
+        << batch.n_rows << ") does not match model dimensionality ("
+        << centroids.n_rows << ")!" << std::endl;
+  if (decay <= 0.0 || decay > 1.0)
+    Log::Fatal << "OnlineKMeans::Update(): decay (" << decay << ") must be "
+        << "greater than 0 and less than or equal to 1!" << std::endl;
+
+  // Forget some of the history.
+  sums *= decay;
+  weights *= decay;
+
+  // The invalid assignment makes every point count as changed in the first
+  // iteration.
+  assignments.set_size(batch.n_cols);
+  assignments.fill(centroids.n_cols);
+
+  arma::mat batchSums(centroids.n_rows, centroids.n_cols, arma::fill::zeros);
+  arma::Col<size_t> batchCounts(centroids.n_cols, arma::fill::zeros);
+  size_t iteration = 0;
+  do
+  {
+    const size_t changed = Assign(batch, assignments);
+    if (changed == 0)
+      break;
+
+    batchSums.zeros();
+    batchCounts.zeros();
+    for (size_t i = 0; i < batch.n_cols; ++i)
+    {
+      batchSums.col(assignments[i]) += batch.col(i);
+      ++batchCounts[assignments[i]];
+    }
+
+    UpdateCentroids(batchSums, batchCounts);
+    ++iteration;
+
+    Log::Info << "OnlineKMeans::Update(): iteration " << iteration << ", "
+        << changed << " assignments changed." << std::endl;
+  } while (iteration < maxIterations);
+
+  // Now the batch becomes part of the history.
+  sums += batchSums;
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+    weights[c] += batchCounts[c];
+}
+
+size_t OnlineKMeans::Assign(const arma::mat& batch,
+                            arma::Row<size_t>& assignments) const
+{
+  const arma::rowvec centroidNorms = arma::sum(arma::square(centroids));
+
+  // Compute distances (up to the norm of each point, which doesn't change the
+  // closest centroid) one block of points at a time.
+  const size_t blockSize = 1024;
+  const size_t blocks = (batch.n_cols + blockSize - 1) / blockSize;
+  return util::ThreadPool::Global().ParallelReduce((size_t) 0, blocks,
+      (size_t) 1, (size_t) 0,
+      [&](const size_t chunkBegin, const size_t chunkEnd)
+  {
+    size_t changed = 0;
+    for (size_t b = chunkBegin; b < chunkEnd; ++b)
+    {
+      const size_t begin = b * blockSize;
+      const size_t end = std::min(begin + blockSize, (size_t) batch.n_cols);
+      arma::mat distances = -2.0 * (centroids.t() *
+          batch.cols(begin, end - 1));
+      distances.each_col() += centroidNorms.t();
+
+      for (size_t i = begin; i < end; ++i)
+      {
+        arma::uword closest;
+        distances.col(i - begin).min(closest);
+        if (assignments[i] != closest)
+        {
+          assignments[i] = closest;
+          ++changed;
+        }
+      }
+    }
+
+    return changed;
+  }, [](const size_t a, const size_t b) { return a + b; });
+}
+
+void OnlineKMeans::UpdateCentroids(const arma::mat& batchSums,
+                                   const arma::Col<size_t>& batchCounts)
+{
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+  {
+    const double weight = weights[c] + batchCounts[c];
+    if (weight > 0.0)
+      centroids.col(c) = (sums.col(c) + batchSums.col(c)) / weight;
+  }
+}
@@ -0,0 +1,143 @@
+/**
+ * @file online_kmeans.hpp
+ *
+ * A k-means model which can be updated with new batches of data without
+ * reclustering all of the data seen before.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_ONLINE_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_ONLINE_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * OnlineKMeans holds a Euclidean k-means model as, for each cluster, the
+ * (weighted) sum of the points assigned to it and their total weight; the
+ * centroid is the sum divided by the weight.  This is enough to fold in a new
+ * batch of points without the points seen before: the history is first decayed
+ * (multiplied by a factor in (0, 1], so that old points count less), and then
+ * a few Lloyd iterations are run on the new batch only, with each centroid
+ * computed from the decayed history plus the batch points currently assigned
+ * to it.  An update therefore costs O(B k d) per iteration for a batch of B
+ * points, regardless of how much data was seen before.
+ *
+ * @code
+ * extern arma::mat data;
+ * OnlineKMeans model;
+ * arma::Row<size_t> assignments;
+ * model.Train(data, 10, assignments);
+ *
+ * // Later, when a new batch arrives...
+ * extern arma::mat batch;
+ * model.Update(batch, 0.9, assignments);
+ * @endcode
+ */
+class OnlineKMeans
+{
+ public:
+  /**
+   * Create an empty model, which must be trained (or loaded) before it is
+   * updated.
+   *
+   * @param maxIterations Maximum number of Lloyd iterations on each batch.
+   */
+  OnlineKMeans(const size_t maxIterations = 10);
+
+  /**
+   * Create the model from a clustering of a dataset: the sums and weights are
+   * computed from the given assignments.
+   *
+   * @param data Dataset that was clustered.
+   * @param assignments Cluster assignment of each point.
+   * @param clusters Number of clusters.
+   * @param maxIterations Maximum number of Lloyd iterations on each batch.
+   */
+  OnlineKMeans(const arma::mat& data,
+               const arma::Row<size_t>& assignments,
+               const size_t clusters,
+               const size_t maxIterations = 10);
+
+  /**
+   * Train the model from scratch by running k-means on the given data.
+   *
+   * @param data Dataset to cluster.
+   * @param clusters Number of clusters.
+   * @param assignments Cluster assignment of each point (output).
+   */
+  void Train(const arma::mat& data,
+             const size_t clusters,
+             arma::Row<size_t>& assignments);
+
+  /**
+   * Fold a new batch of points into the model.  The weights and sums of the
+   * points seen before are multiplied by the decay factor, and then Lloyd
+   * iterations are run on the batch until its assignments do not change or
+   * MaxIterations() is reached.
+   *
+   * @param batch New points.
+   * @param decay Factor in (0, 1] by which to multiply the weight of the points
+   *     seen before; 1 does not forget anything.
+   * @param assignments Cluster assignment of each point in the batch (output).
+   */
+  void Update(const arma::mat& batch,
+              const double decay,
+              arma::Row<size_t>& assignments);
+
+  //! Get the centroids of each cluster.
+  const arma::mat& Centroids() const { return centroids; }
+  //! Get the weighted sums of the points in each cluster.
+  const arma::mat& Sums() const { return sums; }
+  //! Get the total weight of the points in each cluster.
+  const arma::vec& Weights() const { return weights; }
+
+  //! Get the maximum number of Lloyd iterations on each batch.
+  size_t MaxIterations() const { return maxIterations; }
+  //! Modify the maximum number of Lloyd iterations on each batch.
+  size_t& MaxIterations() { return maxIterations; }
+
+  //! Serialize the model.
+  template<typename Archive>
+  void Serialize(Archive& ar, const unsigned int /* version */)
+  {
+    ar & data::CreateNVP(sums, "sums");
+    ar & data::CreateNVP(weights, "weights");
+    ar & data::CreateNVP(centroids, "centroids");
+    ar & data::CreateNVP(maxIterations, "maxIterations");
+  }
+
+ private:
+  //! Weighted sum of the points in each cluster.
+  arma::mat sums;
+  //! Total weight of the points in each cluster.
+  arma::vec weights;
+  //! Centroid of each cluster (sums divided by weights).
+  arma::mat centroids;
+  //! Maximum number of Lloyd iterations on each batch.
+  size_t maxIterations;
+
+  /**
+   * Assign each point of the batch to its closest centroid.
+   *
+   * @return Number of points whose assignment changed.
+   */
+  size_t Assign(const arma::mat& batch, arma::Row<size_t>& assignments) const;
+
+  //! Recompute the centroids from the sums and weights, plus the given batch
+  //! sums and counts.  Clusters with no weight keep their centroid.
+  void UpdateCentroids(const arma::mat& batchSums,
+                       const arma::Col<size_t>& batchCounts);
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
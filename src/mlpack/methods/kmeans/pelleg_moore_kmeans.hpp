@@ -17,6 +17,10 @@
 
 #include <mlpack/core/tree/binary_space_tree.hpp>
 #include "pelleg_moore_kmeans_statistic.hpp"
+#include "max_variance_new_cluster.hpp"
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
+#include "block_reduction.hpp"
 
 namespace mlpack {
 namespace kmeans {
@@ -39,15 +43,27 @@ namespace kmeans {
  * organization={ACM}
  * }
  * @endcode
+ *
+ * Blacklists are stored as packed bitsets on a per-depth stack (see
+ * PellegMooreKMeansRules), so no memory is allocated while scoring nodes.  The
+ * top of the tree is traversed serially and the subtrees below it are
+ * traversed in parallel on the shared util::ThreadPool, each thread
+ * accumulating into its own centroids and counts.
  */
 template<typename MetricType, typename MatType>
 class PellegMooreKMeans
 {
  public:
   /**
-   * Construct the PellegMooreKMeans object, which must construct a tree.
+   * Construct the PellegMooreKMeans object, which must construct a tree.  The
+   * per-thread buffers depend on the shape of the tree and are kept by this
+   * object, so the workspace is only used to fill empty clusters in mixed
+   * precision (if options.mixedPrecision is set).
    */
-  PellegMooreKMeans(const MatType& dataset, MetricType& metric);
+  PellegMooreKMeans(const MatType& dataset,
+                    MetricType& metric,
+                    LloydWorkspace& workspace,
+                    const LloydStepOptions& options = LloydStepOptions());
 
   /**
    * Delete the tree constructed by the PellegMooreKMeans object.
@@ -66,6 +82,20 @@ class PellegMooreKMeans
                  arma::mat& newCentroids,
                  arma::Col<size_t>& counts);
 
+  /**
+   * Handle an empty cluster by taking the point furthest from the centroid of
+   * the cluster with maximum variance (see MaxVarianceNewCluster).
+   *
+   * @return Number of points changed.
+   */
+  int EmptyClusterAdjust(const MatType& data,
+                         const size_t emptyCluster,
+                         const arma::mat& oldCentroids,
+                         arma::mat& newCentroids,
+                         arma::Col<size_t>& clusterCounts,
+                         MetricType& metric,
+                         const size_t iteration);
+
   //! Return the number of distance calculations.
   size_t DistanceCalculations() const { return distanceCalculations; }
   //! Modify the number of distance calculations.
@@ -87,6 +117,34 @@ class PellegMooreKMeans
 
   //! Track distance calculations.
   size_t distanceCalculations;
+
+  //! Per-thread blacklist stacks, reused between iterations.
+  std::vector<std::vector<uint64_t> > blacklistStacks;
+  //! Subtrees left to traverse after the serial part of the traversal.
+  std::vector<TreeType*> frontier;
+  //! Parent blacklists of the subtrees in the frontier.
+  std::vector<uint64_t> frontierBlacklists;
+
+  //! Per-subtree partial results, used in deterministic mode.
+  std::vector<ClusterPartial> partials;
+  //! Sum of the per-subtree partial results, used in deterministic mode.
+  ClusterPartial result;
+
+  //! Policy used to fill empty clusters.
+  MaxVarianceNewCluster emptyClusterPolicy;
+
+  //! Timers of the tree traversal and of the update of the centroids,
+  //! registered once.
+  Timer::Handle traversalTimer;
+  Timer::Handle updateTimer;
+
+  /**
+   * Normalize the new centroids by the counts, and return the residual (the
+   * root of the sum of squared distances each centroid moved).
+   */
+  double Normalize(const arma::mat& centroids,
+                   arma::mat& newCentroids,
+                   const arma::Col<size_t>& counts);
 };
 
 } // namespace kmeans
@@ -24,14 +24,20 @@ namespace kmeans {
 template<typename MetricType, typename MatType>
 PellegMooreKMeans<MetricType, MatType>::PellegMooreKMeans(
     const MatType& dataset,
-    MetricType& metric) :
+    MetricType& metric,
+    LloydWorkspace& workspace,
+    const LloydStepOptions& options) :
     datasetOrig(dataset),
     tree(new TreeType(const_cast<MatType&>(datasetOrig))),
     dataset(tree->Dataset()),
     metric(metric),
-    distanceCalculations(0)
+    distanceCalculations(0),
+    emptyClusterPolicy(options.mixedPrecision ? &workspace : NULL),
+    traversalTimer(Timer::Register("clustering/tree_traversal")),
+    updateTimer(Timer::Register("clustering/update"))
 {
-  // Nothing to do.
+  // Store the nodes of the tree together, for faster traversals.
+  tree::CompactTree(*tree);
 }
 
 template<typename MetricType, typename MatType>
@@ -41,6 +47,20 @@ PellegMooreKMeans<MetricType, MatType>::~PellegMooreKMeans()
     delete tree;
 }
 
+template<typename MetricType, typename MatType>
+int PellegMooreKMeans<MetricType, MatType>::EmptyClusterAdjust(
+    const MatType& data,
+    const size_t emptyCluster,
+    const arma::mat& oldCentroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& clusterCounts,
+    MetricType& metric,
+    const size_t iteration)
+{
+  return (int) emptyClusterPolicy.EmptyCluster(data, emptyCluster,
+      oldCentroids, newCentroids, clusterCounts, metric, iteration);
+}
+
 // Run a single iteration.
 template<typename MetricType, typename MatType>
 double PellegMooreKMeans<MetricType, MatType>::Iterate(
@@ -51,18 +71,116 @@ double PellegMooreKMeans<MetricType, MatType>::Iterate(
   newCentroids.zeros(centroids.n_rows, centroids.n_cols);
   counts.zeros(centroids.n_cols);
 
-  // Create rules object.
+  // The subtrees are traversed on the shared thread pool.
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  const size_t threads = pool.Threads();
+  if (blacklistStacks.size() < threads)
+    blacklistStacks.resize(threads);
+
+  // Traverse the top of the tree serially, until there are enough subtrees to
+  // keep every thread busy.  With only one thread, the whole tree is a single
+  // subtree.  In deterministic mode the number of subtrees must not depend on
+  // the number of threads, so we always aim for one wave of subtrees.
+  const bool deterministic = BlockReduction::Deterministic();
+  const size_t targetSubtrees = deterministic ?
+      (size_t) BlockReduction::WaveSize : ((threads > 1) ? 4 * threads : 1);
+  size_t frontierDepth = 1;
+  while ((size_t(1) << (frontierDepth - 1)) < targetSubtrees)
+    ++frontierDepth;
+
+  // Every thread times the subtrees it traverses, so that the hardware
+  // counters of the traversal (with --perf_counters) cover all the threads.
   typedef PellegMooreKMeansRules<MetricType, TreeType> RulesType;
-  RulesType rules(dataset, centroids, newCentroids, counts, metric);
+  frontier.clear();
+  frontierBlacklists.clear();
+  RulesType rules(dataset, centroids, newCentroids, counts, metric,
+      blacklistStacks[0]);
+  {
+    ScopedTimer t(traversalTimer);
+    rules.Expand(*tree, 1, frontierDepth, frontier, frontierBlacklists);
+  }
+  distanceCalculations += rules.DistanceCalculations();
 
-  // Use single-tree traverser.
-  typename TreeType::template SingleTreeTraverser<RulesType> traverser(rules);
+  const size_t words = rules.BlacklistWords();
+  if (deterministic)
+  {
+    // Each subtree accumulates into its own partial result, and the partial
+    // results are added in a fixed order.
+    std::vector<size_t> threadDistanceCalculations(threads, 0);
+    const size_t dimensionality = centroids.n_rows;
+    const size_t clusters = centroids.n_cols;
+    BlockReduction::Reduce(frontier.size(), 1, partials,
+        [dimensionality, clusters](ClusterPartial& partial)
+        { partial.Reset(dimensionality, clusters, false); },
+        [&](ClusterPartial& partial, const size_t begin, const size_t end)
+        {
+          const size_t t = pool.ThreadIndex();
+          ScopedTimer timer(traversalTimer);
+          for (size_t i = begin; i < end; ++i)
+          {
+            RulesType threadRules(dataset, centroids, partial.sums,
+                partial.counts, metric, blacklistStacks[t]);
+            threadRules.SetParentBlacklist(&frontierBlacklists[i * words]);
+            threadRules.Traverse(*frontier[i], 1);
+            threadDistanceCalculations[t] += threadRules.DistanceCalculations();
+          }
+        }, result);
 
-  // Now, do a traversal with a fake query index (since the query index is
-  // irrelevant; we are checking each node with all clusters.
-  traverser.Traverse(0, *tree);
+    newCentroids += result.sums;
+    counts += result.counts;
+    for (size_t t = 0; t < threads; ++t)
+      distanceCalculations += threadDistanceCalculations[t];
 
-  distanceCalculations += rules.DistanceCalculations();
+    return Normalize(centroids, newCentroids, counts);
+  }
+
+  // Now traverse each remaining subtree independently.  Each thread has its
+  // own accumulators, which we combine afterwards.
+  std::vector<arma::mat> threadCentroids(threads);
+  std::vector<arma::Col<size_t> > threadCounts(threads);
+  std::vector<size_t> threadDistanceCalculations(threads, 0);
+
+  pool.ParallelFor(0, frontier.size(), 1, [&](const size_t begin,
+                                               const size_t end)
+  {
+    const size_t t = pool.ThreadIndex();
+    if (threadCentroids[t].n_elem == 0)
+    {
+      threadCentroids[t].zeros(centroids.n_rows, centroids.n_cols);
+      threadCounts[t].zeros(centroids.n_cols);
+    }
+
+    ScopedTimer timer(traversalTimer);
+    for (size_t i = begin; i < end; ++i)
+    {
+      RulesType threadRules(dataset, centroids, threadCentroids[t],
+          threadCounts[t], metric, blacklistStacks[t]);
+      threadRules.SetParentBlacklist(&frontierBlacklists[i * words]);
+      threadRules.Traverse(*frontier[i], 1);
+      threadDistanceCalculations[t] += threadRules.DistanceCalculations();
+    }
+  });
+
+  for (size_t t = 0; t < threads; ++t)
+  {
+    if (threadCentroids[t].n_elem == 0)
+      continue;
+
+    newCentroids += threadCentroids[t];
+    counts += threadCounts[t];
+    distanceCalculations += threadDistanceCalculations[t];
+  }
+
+  return Normalize(centroids, newCentroids, counts);
+}
+
+template<typename MetricType, typename MatType>
+double PellegMooreKMeans<MetricType, MatType>::Normalize(
+    const arma::mat& centroids,
+    arma::mat& newCentroids,
+    const arma::Col<size_t>& counts)
+{
+  ScopedTimer t(updateTimer);
 
   // Now, calculate how far the clusters moved, after normalizing them.
   double residual = 0.0;
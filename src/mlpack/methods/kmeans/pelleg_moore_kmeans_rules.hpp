@@ -16,7 +16,8 @@
 #ifndef __MLPACK_METHODS_KMEANS_PELLEG_MOORE_KMEANS_RULES_HPP
 #define __MLPACK_METHODS_KMEANS_PELLEG_MOORE_KMEANS_RULES_HPP
 
-#include <mlpack/methods/neighbor_search/ns_traversal_info.hpp>
+#include <mlpack/core.hpp>
+#include <mlpack/core/metrics/lmetric.hpp>
 
 namespace mlpack {
 namespace kmeans {
@@ -28,10 +29,15 @@ namespace kmeans {
  * due to the pruning rule used to determine if one cluster dominates a node
  * with respect to another cluster.
  *
- * Our implementation here abuses the single-tree algorithm abstractions a
- * little bit.  Instead of doing a traversal for a particular query point, in
- * this case we consider all clusters at once---so the query point is entirely
- * ignored during in BaseCase() and Score().
+ * Instead of doing a traversal for a particular query point, in this case we
+ * consider all clusters at once, so this class drives its own depth-first
+ * traversal (see Traverse()) rather than using the tree's SingleTreeTraverser.
+ * This lets the blacklist of each node live in a packed bitset on a per-depth
+ * stack: the blacklist of a node at depth d is stored at level d of the stack,
+ * and is built from the blacklist of its parent at level (d - 1).  Level 0
+ * holds the blacklist of the parent of the first node visited (all zeros when
+ * the traversal starts at the root).  No memory is allocated during the
+ * traversal once the stack is deep enough.
  */
 template<typename MetricType, typename TreeType>
 class PellegMooreKMeansRules
@@ -46,43 +52,62 @@ class PellegMooreKMeansRules
    * @param counts Current cluster counts, to be replaced with new cluster
    *      counts.
    * @param metric Instantiated metric.
+   * @param blacklistStack Storage for the per-depth blacklist stack.  It will
+   *      be grown as necessary, and may be reused between traversals.
    */
   PellegMooreKMeansRules(const typename TreeType::Mat& dataset,
                          const arma::mat& centroids,
                          arma::mat& newCentroids,
                          arma::Col<size_t>& counts,
-                         MetricType& metric);
+                         MetricType& metric,
+                         std::vector<uint64_t>& blacklistStack);
 
   /**
-   * The BaseCase() function for this single-tree algorithm does nothing.
-   * Instead, point-to-cluster comparisons are handled as necessary in Score().
+   * Traverse the subtree rooted at the given node, which is at the given depth
+   * of the blacklist stack.  The blacklist of the node's parent must already
+   * be stored at level (depth - 1) of the stack.
    *
-   * @param queryIndex Index of query point (fake, will be ignored).
-   * @param referenceIndex Index of reference point.
+   * @param referenceNode Node to traverse.
+   * @param depth Depth of the node in the stack (at least 1).
    */
-  double BaseCase(const size_t queryIndex, const size_t referenceIndex);
+  void Traverse(TreeType& referenceNode, const size_t depth);
 
   /**
-   * Determine if a cluster can be pruned, and if not, perform point-to-cluster
-   * comparisons.  The point-to-cluster comparisons are performed here and not
-   * in BaseCase() because of the complexity of managing the blacklist.
+   * Traverse the tree down to the given depth, but instead of descending into
+   * the nodes at that depth, append them to the frontier (along with the
+   * blacklist of their parent, so that the subtrees can be traversed
+   * independently later with SetParentBlacklist() and Traverse()).  This is
+   * used to split the traversal into independent subtrees for parallelism.
    *
-   * @param queryIndex Index of query point (fake, will be ignored).
-   * @param referenceNode Node containing points in the dataset.
+   * @param referenceNode Node to expand.
+   * @param depth Depth of the node in the stack (at least 1).
+   * @param frontierDepth Depth at which to stop descending.
+   * @param frontier Nodes that still need to be traversed (output).
+   * @param frontierBlacklists Parent blacklists of each node in the frontier,
+   *      BlacklistWords() words per node (output).
    */
-  double Score(const size_t queryIndex, TreeType& referenceNode);
+  void Expand(TreeType& referenceNode,
+              const size_t depth,
+              const size_t frontierDepth,
+              std::vector<TreeType*>& frontier,
+              std::vector<uint64_t>& frontierBlacklists);
 
   /**
-   * Rescore to determine if a node can be pruned.  In this case, a node can
-   * never be pruned during rescoring, so this just returns oldScore.
+   * Determine if a node can be pruned, and if not, perform point-to-cluster
+   * comparisons for the points held directly in the node.  The blacklist of
+   * the node is written to the given level of the stack.
    *
-   * @param queryIndex Index of query point (fake, will be ignored).
    * @param referenceNode Node containing points in the dataset.
-   * @param oldScore Resulting score from Score().
+   * @param depth Depth of the node in the stack (at least 1).
+   * @return DBL_MAX if the node was pruned, 0 otherwise.
    */
-  double Rescore(const size_t queryIndex,
-                 TreeType& referenceNode,
-                 const double oldScore);
+  double Score(TreeType& referenceNode, const size_t depth);
+
+  //! Set the parent blacklist (level 0 of the stack) before a Traverse().
+  void SetParentBlacklist(const uint64_t* parentBlacklist);
+
+  //! Get the number of 64-bit words in each blacklist.
+  size_t BlacklistWords() const { return words; }
 
   //! Get the number of distance calculations that have been performed.
   size_t DistanceCalculations() const { return distanceCalculations; }
@@ -100,9 +125,45 @@ class PellegMooreKMeansRules
   arma::Col<size_t>& counts;
   //! Instantiated metric.
   MetricType& metric;
+  //! The per-depth blacklist stack.
+  std::vector<uint64_t>& blacklistStack;
+  //! Number of 64-bit words in each blacklist.
+  size_t words;
+  //! Scratch space for the corner point, only used by metrics that aren't
+  //! LMetrics.
+  arma::vec cornerPoint;
 
   //! The number of O(d) distance calculations that have been performed.
   size_t distanceCalculations;
+
+  //! Return whether cluster c is set in the given blacklist.
+  static bool IsBlacklisted(const uint64_t* blacklist, const size_t c)
+  { return (blacklist[c / 64] >> (c % 64)) & 1; }
+
+  //! Set cluster c in the given blacklist.
+  static void SetBlacklisted(uint64_t* blacklist, const size_t c)
+  { blacklist[c / 64] |= (uint64_t(1) << (c % 64)); }
+
+  /**
+   * Return true if cluster 'closest' dominates the node with respect to
+   * cluster 'other'; that is, if the corner of the node's bound furthest in
+   * the direction of 'other' is still closer to 'closest'.  For LMetrics this
+   * is computed as a single fused pass over the dimensions without forming
+   * the corner point.
+   */
+  template<int Power, bool TakeRoot>
+  bool Dominates(const metric::LMetric<Power, TakeRoot>& lmetric,
+                 const TreeType& referenceNode,
+                 const size_t closest,
+                 const size_t other);
+
+  //! Return true if cluster 'closest' dominates the node with respect to
+  //! cluster 'other', for general metrics.
+  template<typename OtherMetricType>
+  bool Dominates(const OtherMetricType& otherMetric,
+                 const TreeType& referenceNode,
+                 const size_t closest,
+                 const size_t other);
 };
 
 } // namespace kmeans
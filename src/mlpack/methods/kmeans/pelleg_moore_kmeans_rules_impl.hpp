@@ -28,56 +28,94 @@ PellegMooreKMeansRules<MetricType, TreeType>::PellegMooreKMeansRules(
     const arma::mat& centroids,
     arma::mat& newCentroids,
     arma::Col<size_t>& counts,
-    MetricType& metric) :
+    MetricType& metric,
+    std::vector<uint64_t>& blacklistStack) :
     dataset(dataset),
     centroids(centroids),
     newCentroids(newCentroids),
     counts(counts),
     metric(metric),
+    blacklistStack(blacklistStack),
+    words((centroids.n_cols + 63) / 64),
     distanceCalculations(0)
 {
-  // Nothing to do.
+  // Make sure there is room for at least the parent level and the root, and
+  // start with an empty parent blacklist.
+  if (blacklistStack.size() < 2 * words)
+    blacklistStack.resize(2 * words);
+  std::fill(blacklistStack.begin(), blacklistStack.begin() + words, 0);
 }
 
 template<typename MetricType, typename TreeType>
-inline force_inline
-double PellegMooreKMeansRules<MetricType, TreeType>::BaseCase(
-    const size_t /* queryIndex */,
-    const size_t /* referenceIndex */)
+void PellegMooreKMeansRules<MetricType, TreeType>::SetParentBlacklist(
+    const uint64_t* parentBlacklist)
 {
-  return 0.0;
+  std::copy(parentBlacklist, parentBlacklist + words, blacklistStack.begin());
+}
+
+template<typename MetricType, typename TreeType>
+void PellegMooreKMeansRules<MetricType, TreeType>::Traverse(
+    TreeType& referenceNode,
+    const size_t depth)
+{
+  if (Score(referenceNode, depth) == DBL_MAX)
+    return;
+
+  // Recursion order doesn't make a difference.
+  for (size_t i = 0; i < referenceNode.NumChildren(); ++i)
+    Traverse(referenceNode.Child(i), depth + 1);
+}
+
+template<typename MetricType, typename TreeType>
+void PellegMooreKMeansRules<MetricType, TreeType>::Expand(
+    TreeType& referenceNode,
+    const size_t depth,
+    const size_t frontierDepth,
+    std::vector<TreeType*>& frontier,
+    std::vector<uint64_t>& frontierBlacklists)
+{
+  if (depth >= frontierDepth)
+  {
+    frontier.push_back(&referenceNode);
+    const uint64_t* parent = &blacklistStack[(depth - 1) * words];
+    frontierBlacklists.insert(frontierBlacklists.end(), parent, parent + words);
+    return;
+  }
+
+  if (Score(referenceNode, depth) == DBL_MAX)
+    return;
+
+  for (size_t i = 0; i < referenceNode.NumChildren(); ++i)
+    Expand(referenceNode.Child(i), depth + 1, frontierDepth, frontier,
+        frontierBlacklists);
 }
 
 template<typename MetricType, typename TreeType>
 double PellegMooreKMeansRules<MetricType, TreeType>::Score(
-    const size_t /* queryIndex */,
-    TreeType& referenceNode)
+    TreeType& referenceNode,
+    const size_t depth)
 {
-  // Obtain the parent's blacklist.  If this is the root node, we'll start with
-  // an empty blacklist.  This means that after each iteration, we don't need to
-  // reset any statistics.
-  if (referenceNode.Parent() == NULL ||
-      referenceNode.Parent()->Stat().Blacklist().n_elem == 0)
-    referenceNode.Stat().Blacklist().zeros(centroids.n_cols);
-  else
-    referenceNode.Stat().Blacklist() =
-        referenceNode.Parent()->Stat().Blacklist();
-
-  // The query index is a fake index that we won't use, and the reference node
-  // holds all of the points in the dataset.  Our goal is to determine whether
-  // or not this node is dominated by a single cluster.
-  const size_t whitelisted = centroids.n_cols -
-      arma::accu(referenceNode.Stat().Blacklist());
+  // Grow the stack if this node is deeper than anything we have seen.  This
+  // only happens during the first few traversals.
+  if (blacklistStack.size() < (depth + 1) * words)
+    blacklistStack.resize(2 * (depth + 1) * words);
 
-  distanceCalculations += whitelisted;
+  // Obtain the parent's blacklist.  The blacklist of the root's parent is
+  // empty, so after each iteration we don't need to reset anything.
+  const uint64_t* parentBlacklist = &blacklistStack[(depth - 1) * words];
+  uint64_t* blacklist = &blacklistStack[depth * words];
+  std::copy(parentBlacklist, parentBlacklist + words, blacklist);
 
-  // Which cluster has minimum distance to the node?
+  // Our goal is to determine whether or not this node is dominated by a single
+  // cluster.  Which cluster has minimum distance to the node?
+  size_t whitelisted = 0;
   size_t closestCluster = centroids.n_cols;
   double minMinDistance = DBL_MAX;
   for (size_t i = 0; i < centroids.n_cols; ++i)
   {
-    if (referenceNode.Stat().Blacklist()[i] == 0)
+    if (!IsBlacklisted(blacklist, i))
     {
+      ++whitelisted;
       const double minDistance = referenceNode.MinDistance(centroids.col(i));
       if (minDistance < minMinDistance)
       {
@@ -87,6 +125,8 @@ double PellegMooreKMeansRules<MetricType, TreeType>::Score(
     }
   }
 
+  distanceCalculations += whitelisted;
+
   // Now, for every other whitelisted cluster, determine if the closest cluster
   // owns the point.  This calculation is specific to hyperrectangle trees (but,
   // this implementation is specific to kd-trees, so that's okay).  For
@@ -95,32 +135,14 @@ double PellegMooreKMeansRules<MetricType, TreeType>::Score(
   size_t newBlacklisted = 0;
   for (size_t c = 0; c < centroids.n_cols; ++c)
   {
-    if (referenceNode.Stat().Blacklist()[c] == 1 || c == closestCluster)
+    if (IsBlacklisted(blacklist, c) || c == closestCluster)
       continue;
 
-    // This algorithm comes from the proof of Lemma 4 in the extended version
-    // of the Pelleg-Moore paper (the CMU tech report, that is).  It has been
-    // adapted for speed.
-    arma::vec cornerPoint(centroids.n_rows);
-    for (size_t d = 0; d < referenceNode.Bound().Dim(); ++d)
-    {
-      if (centroids(d, c) > centroids(d, closestCluster))
-        cornerPoint(d) = referenceNode.Bound()[d].Hi();
-      else
-        cornerPoint(d) = referenceNode.Bound()[d].Lo();
-    }
-
-    const double closestDist = metric.Evaluate(cornerPoint,
-        centroids.col(closestCluster));
-    const double otherDist = metric.Evaluate(cornerPoint, centroids.col(c));
-
-    distanceCalculations += 3; // One for cornerPoint, then two distances.
-
-    if (closestDist < otherDist)
+    if (Dominates(metric, referenceNode, closestCluster, c))
     {
       // The closest cluster dominates the node with respect to the cluster c.
       // So we can blacklist c.
-      referenceNode.Stat().Blacklist()[c] = 1;
+      SetBlacklisted(blacklist, c);
       ++newBlacklisted;
     }
   }
@@ -142,7 +164,7 @@ double PellegMooreKMeansRules<MetricType, TreeType>::Score(
     double bestDistance = DBL_MAX;
     for (size_t c = 0; c < centroids.n_cols; ++c)
     {
-      if (referenceNode.Stat().Blacklist()[c] == 1)
+      if (IsBlacklisted(blacklist, c))
         continue;
 
       ++distanceCalculations;
@@ -163,20 +185,94 @@ double PellegMooreKMeansRules<MetricType, TreeType>::Score(
     ++counts(bestCluster);
   }
 
-  // Otherwise, we're not sure, so we can't prune.  Recursion order doesn't make
-  // a difference, so we'll just return a score of 0.
+  // Otherwise, we're not sure, so we can't prune.
   return 0.0;
 }
 
 template<typename MetricType, typename TreeType>
-double PellegMooreKMeansRules<MetricType, TreeType>::Rescore(
-    const size_t /* queryIndex */,
-    TreeType& /* referenceNode */,
-    const double oldScore)
+template<int Power, bool TakeRoot>
+inline force_inline
+bool PellegMooreKMeansRules<MetricType, TreeType>::Dominates(
+    const metric::LMetric<Power, TakeRoot>& /* lmetric */,
+    const TreeType& referenceNode,
+    const size_t closest,
+    const size_t other)
+{
+  // This algorithm comes from the proof of Lemma 4 in the extended version of
+  // the Pelleg-Moore paper (the CMU tech report, that is).  The corner point
+  // takes the high side of the bound in each dimension where 'other' is
+  // larger than 'closest', and the low side otherwise.  Since taking the root
+  // is monotonic, we only need the sign of the difference of the unrooted
+  // distances from the corner to each centroid, which we accumulate in one
+  // pass.
+  //
+  // The Chebyshev distance (Power == INT_MAX) is a maximum and not a sum of
+  // powers, so for it we keep the largest difference in each dimension from
+  // the corner to each centroid instead.
+  const double* closestCol = centroids.colptr(closest);
+  const double* otherCol = centroids.colptr(other);
+  double difference = 0.0;
+  double closestMax = 0.0;
+  double otherMax = 0.0;
+  for (size_t d = 0; d < referenceNode.Bound().Dim(); ++d)
+  {
+    const double corner = (otherCol[d] > closestCol[d]) ?
+        referenceNode.Bound()[d].Hi() : referenceNode.Bound()[d].Lo();
+
+    if (Power == INT_MAX)
+    {
+      closestMax = std::max(closestMax, std::abs(corner - closestCol[d]));
+      otherMax = std::max(otherMax, std::abs(corner - otherCol[d]));
+    }
+    else if (Power == 2)
+    {
+      // (x - a)^2 - (x - b)^2 = (b - a)(2x - a - b).
+      difference += (otherCol[d] - closestCol[d]) *
+          (2.0 * corner - closestCol[d] - otherCol[d]);
+    }
+    else
+    {
+      difference += std::pow(std::abs(corner - closestCol[d]), Power) -
+          std::pow(std::abs(corner - otherCol[d]), Power);
+    }
+  }
+
+  // The fused pass costs about as much as a single distance calculation.
+  ++distanceCalculations;
+
+  if (Power == INT_MAX)
+    return (closestMax < otherMax);
+
+  return (difference < 0.0);
+}
+
+template<typename MetricType, typename TreeType>
+template<typename OtherMetricType>
+bool PellegMooreKMeansRules<MetricType, TreeType>::Dominates(
+    const OtherMetricType& /* otherMetric */,
+    const TreeType& referenceNode,
+    const size_t closest,
+    const size_t other)
 {
-  // There's no possible way that calling Rescore() can produce a prune now when
-  // it couldn't before.
-  return oldScore;
+  // We can't fuse the distance calculations for a general metric, so build the
+  // corner point in a reused buffer.
+  if (cornerPoint.n_elem != centroids.n_rows)
+    cornerPoint.set_size(centroids.n_rows);
+
+  for (size_t d = 0; d < referenceNode.Bound().Dim(); ++d)
+  {
+    if (centroids(d, other) > centroids(d, closest))
+      cornerPoint(d) = referenceNode.Bound()[d].Hi();
+    else
+      cornerPoint(d) = referenceNode.Bound()[d].Lo();
+  }
+
+  const double closestDist = metric.Evaluate(cornerPoint,
+      centroids.col(closest));
+  const double otherDist = metric.Evaluate(cornerPoint, centroids.col(other));
+  distanceCalculations += 2;
+
+  return (closestDist < otherDist);
 }
 
 } // namespace kmeans
@@ -2,8 +2,8 @@
  * @file pelleg_moore_kmeans_statistic.hpp
  * @author Ryan Curtin
  *
- * A StatisticType for trees which holds the blacklist for various k-means
- * clusters.  See the Pelleg and Moore paper for more details.
+ * A StatisticType for trees which caches the centroid of each node for
+ * Pelleg-Moore k-means.  See the Pelleg and Moore paper for more details.
  *
  * This file is part of mlpack 2.0.1.
  *
@@ -19,9 +19,11 @@ namespace mlpack {
 namespace kmeans {
 
 /**
- * A statistic for trees which holds the blacklist for Pelleg-Moore k-means
- * clustering (which represents the clusters that cannot possibly own any points
- * in a node).
+ * A statistic for trees which holds the centroid of each node for Pelleg-Moore
+ * k-means clustering.  The blacklists themselves (which represent the clusters
+ * that cannot possibly own any points in a node) are not stored in the tree;
+ * they are kept as packed bitsets on a per-depth stack by
+ * PellegMooreKMeansRules.
  */
 class PellegMooreKMeansStatistic
 {
@@ -55,19 +57,12 @@ class PellegMooreKMeansStatistic
       centroid.fill(DBL_MAX); // Invalid centroid.  What else can we do?
   }
 
-  //! Get the cluster blacklist.
-  const arma::uvec& Blacklist() const { return blacklist; }
-  //! Modify the cluster blacklist.
-  arma::uvec& Blacklist() { return blacklist; }
-
   //! Get the node's centroid.
   const arma::vec& Centroid() const { return centroid; }
   //! Modify the node's centroid (be careful!).
   arma::vec& Centroid() { return centroid; }
 
  private:
-  //! The cluster blacklist for the node.
-  arma::uvec blacklist;
   //! The centroid of the node, cached for use during prunes.
   arma::vec centroid;
 };
@@ -0,0 +1,165 @@
+/**
+ * @file projected_kmeans.hpp
+ *
+ * An implementation of a Lloyd step for k-means clustering which uses a random
+ * projection of the data to shortlist candidate centroids for each point, and
+ * then chooses among the candidates with full-dimensional distances.  This is
+ * useful for datasets with very high dimensionality.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_PROJECTED_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_PROJECTED_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+#include "max_variance_new_cluster.hpp"
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
+#include "block_reduction.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * A Lloyd step which projects the dataset to a lower dimension with a
+ * Johnson-Lindenstrauss random projection (see math::RandomProjection()).
+ * Each iteration, the centroids are projected too, and the distances between
+ * the projected points and the projected centroids (computed with one GEMM per
+ * block of points) are used to select a short list of candidate centroids for
+ * each point.  Only the candidates are compared with the full-dimensional
+ * distance, so an iteration costs O(N k p + N s d) instead of O(N k d), where p
+ * is the projected dimensionality and s is the number of candidates.
+ *
+ * The centroids themselves are always full-dimensional means of the points
+ * assigned to them, and KMeans computes the final assignments against the
+ * full-dimensional centroids, so the projection only affects which candidates
+ * are considered during the iterations.
+ *
+ * The blocks of points are assigned in parallel and their sums are added with
+ * BlockReduction, so the centroids do not depend on the number of threads if
+ * BlockReduction::Deterministic() is set.
+ *
+ * The projected dimensionality and the number of candidates are given by the
+ * projectionDim and candidates members of LloydStepOptions.
+ *
+ * @code
+ * LloydStepOptions options;
+ * options.projectionDim = 50;
+ * KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+ *     ProjectedKMeans> k(1000, metric::EuclideanDistance(), RandomPartition(),
+ *     MaxVarianceNewCluster(), options);
+ * k.Cluster(data, 100, assignments, centroids);
+ * @endcode
+ *
+ * @tparam MetricType Type of metric used with this implementation.
+ * @tparam MatType Matrix type (arma::mat or arma::sp_mat).
+ */
+template<typename MetricType, typename MatType>
+class ProjectedKMeans
+{
+ public:
+  /**
+   * Construct the ProjectedKMeans object, which draws the random projection and
+   * projects the dataset.
+   *
+   * @param dataset Dataset.
+   * @param metric Instantiated metric.
+   * @param workspace Scratch memory for the partial sums of the blocks of
+   *     points.
+   * @param options Options of the Lloyd step; projectionDim, candidates and
+   *     mixedPrecision (for empty clusters) are used.
+   */
+  ProjectedKMeans(const MatType& dataset,
+                  MetricType& metric,
+                  LloydWorkspace& workspace,
+                  const LloydStepOptions& options = LloydStepOptions());
+
+  /**
+   * Run a single iteration of the Lloyd algorithm, updating the given centroids
+   * into the newCentroids matrix.
+   *
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids.
+   * @param counts Current counts, to be overwritten with new counts.
+   */
+  double Iterate(const arma::mat& centroids,
+                 arma::mat& newCentroids,
+                 arma::Col<size_t>& counts);
+
+  /**
+   * Handle an empty cluster by taking the point furthest from the centroid of
+   * the cluster with maximum variance (see MaxVarianceNewCluster).
+   *
+   * @return Number of points changed.
+   */
+  int EmptyClusterAdjust(const MatType& data,
+                         const size_t emptyCluster,
+                         const arma::mat& oldCentroids,
+                         arma::mat& newCentroids,
+                         arma::Col<size_t>& clusterCounts,
+                         MetricType& metric,
+                         const size_t iteration);
+
+  //! Return the number of distance calculations.
+  size_t DistanceCalculations() const { return distanceCalculations; }
+
+  //! Get the random projection (projected dimensionality x dimensionality).
+  const arma::mat& Projection() const { return projection; }
+
+  //! Get the number of candidate centroids checked in full dimensionality for
+  //! each point (0 chooses automatically).
+  size_t Candidates() const { return candidates; }
+
+  //! Number of points whose projected products are computed at once by each
+  //! thread.
+  static const size_t SubBlockSize = 1024;
+
+ private:
+  //! The dataset.
+  const MatType& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+  //! Scratch memory reused by every iteration.
+  LloydWorkspace& workspace;
+
+  //! The number of candidates for each point (0 chooses automatically).
+  size_t candidates;
+
+  //! The random projection.
+  arma::mat projection;
+  //! The projected dataset.
+  arma::mat projectedData;
+
+  //! The projected centroids, reused between iterations.
+  arma::mat projectedCentroids;
+  //! Squared norms of the projected centroids.
+  arma::rowvec projectedCentroidNorms;
+  //! Projected inner products of a sub-block of points, one buffer per thread.
+  std::vector<arma::mat> productBuffers;
+  //! Candidate ordering scratch space, one per thread.
+  std::vector<std::vector<size_t> > orders;
+
+  //! Policy used to fill empty clusters.
+  MaxVarianceNewCluster emptyClusterPolicy;
+
+  //! Number of distance calculations.
+  size_t distanceCalculations;
+
+  //! Timers of the phases of each iteration, registered once.
+  Timer::Handle projectionTimer;
+  Timer::Handle assignmentTimer;
+  Timer::Handle updateTimer;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "projected_kmeans_impl.hpp"
+
+#endif
@@ -0,0 +1,206 @@
+/**
+ * @file projected_kmeans_impl.hpp
+ *
+ * Implementation of the random projection Lloyd step for k-means clustering.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_PROJECTED_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_PROJECTED_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "projected_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+ProjectedKMeans<MetricType, MatType>::ProjectedKMeans(
+    const MatType& dataset,
+    MetricType& metric,
+    LloydWorkspace& workspace,
+    const LloydStepOptions& options) :
+    dataset(dataset),
+    metric(metric),
+    workspace(workspace),
+    candidates(options.candidates),
+    emptyClusterPolicy(options.mixedPrecision ? &workspace : NULL),
+    distanceCalculations(0),
+    projectionTimer(Timer::Register("clustering/projection")),
+    assignmentTimer(Timer::Register("clustering/assignment")),
+    updateTimer(Timer::Register("clustering/update"))
+{
+  size_t projectionDim = options.projectionDim;
+  if (projectionDim == 0)
+    projectionDim = std::min((size_t) dataset.n_rows, (size_t) 32);
+
+  if (projectionDim > dataset.n_rows)
+  {
+    Log::Warn << "ProjectedKMeans: projected dimensionality (" << projectionDim
+        << ") is greater than the dimensionality of the data ("
+        << dataset.n_rows << "); using " << dataset.n_rows << "." << std::endl;
+    projectionDim = dataset.n_rows;
+  }
+
+  math::RandomProjection(projection, dataset.n_rows, projectionDim);
+  projectedData = projection * dataset;
+
+  Log::Info << "ProjectedKMeans: projected " << dataset.n_rows << "-dimensional"
+      << " data to " << projectionDim << " dimensions." << std::endl;
+}
+
+template<typename MetricType, typename MatType>
+int ProjectedKMeans<MetricType, MatType>::EmptyClusterAdjust(
+    const MatType& data,
+    const size_t emptyCluster,
+    const arma::mat& oldCentroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& clusterCounts,
+    MetricType& metric,
+    const size_t iteration)
+{
+  return (int) emptyClusterPolicy.EmptyCluster(data, emptyCluster,
+      oldCentroids, newCentroids, clusterCounts, metric, iteration);
+}
+
+// Run a single iteration.
+template<typename MetricType, typename MatType>
+double ProjectedKMeans<MetricType, MatType>::Iterate(
+    const arma::mat& centroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& counts)
+{
+  const size_t dimensionality = centroids.n_rows;
+  const size_t clusters = centroids.n_cols;
+
+  size_t candidates = this->candidates;
+  if (candidates == 0)
+    candidates = std::max((size_t) 3, clusters / 8);
+  candidates = std::min(candidates, clusters);
+
+  // Each phase has its own timer (and hardware counters, with
+  // --perf_counters), run once per iteration.
+  Timer::Start(projectionTimer);
+
+  // Project the centroids.  The squared norms of the projected points are the
+  // same for every centroid, so they don't affect the ordering and we don't
+  // need to add them.
+  projectedCentroids = projection * centroids;
+  projectedCentroidNorms = arma::sum(arma::square(projectedCentroids));
+  Timer::Stop(projectionTimer);
+
+  Timer::Start(assignmentTimer);
+
+  // The blocks are assigned on the shared thread pool, and each thread has its
+  // own buffer of projected products and candidate ordering.
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  if (productBuffers.size() < pool.Threads())
+  {
+    productBuffers.resize(pool.Threads());
+    orders.resize(pool.Threads());
+  }
+
+  // Sum the points assigned to each cluster (in a fixed order if
+  // BlockReduction::Deterministic() is set).
+  ClusterPartial& result = workspace.Result();
+  BlockReduction::Reduce(dataset.n_cols, BlockReduction::BlockSize,
+      workspace.Partials(),
+      [dimensionality, clusters](ClusterPartial& partial)
+      {
+        partial.Reset(dimensionality, clusters, false);
+      },
+      [&](ClusterPartial& partial, const size_t begin, const size_t end)
+      {
+        const size_t t = pool.ThreadIndex();
+        std::vector<size_t>& order = orders[t];
+        order.resize(clusters);
+        productBuffers[t].set_size(clusters, SubBlockSize);
+
+        for (size_t subBegin = begin; subBegin < end; subBegin += SubBlockSize)
+        {
+          const size_t subEnd = std::min(subBegin + SubBlockSize, end);
+
+          // Projected inner products for this sub-block; each column holds the
+          // products of one point with every centroid.  The last sub-block may
+          // be smaller, so we use an alias of the buffer.
+          arma::mat products(productBuffers[t].memptr(), clusters,
+              subEnd - subBegin, false, true);
+          products = projectedCentroids.t() *
+              projectedData.cols(subBegin, subEnd - 1);
+
+          for (size_t i = subBegin; i < subEnd; ++i)
+          {
+            // Turn the products into projected distances (up to the point
+            // norm).
+            double* distances = products.colptr(i - subBegin);
+            for (size_t c = 0; c < clusters; ++c)
+              distances[c] = projectedCentroidNorms[c] - 2.0 * distances[c];
+
+            // Shortlist the candidates with the smallest projected distances.
+            for (size_t c = 0; c < clusters; ++c)
+              order[c] = c;
+            if (candidates < clusters)
+            {
+              std::nth_element(order.begin(), order.begin() + candidates - 1,
+                  order.end(), [distances](const size_t a, const size_t b)
+                  { return distances[a] < distances[b]; });
+            }
+
+            // Now check the candidates in the full dimensionality.
+            size_t closestCluster = clusters;
+            double minDistance = DBL_MAX;
+            for (size_t j = 0; j < candidates; ++j)
+            {
+              const double distance = metric.Evaluate(dataset.col(i),
+                  centroids.col(order[j]));
+              if (distance < minDistance)
+              {
+                minDistance = distance;
+                closestCluster = order[j];
+              }
+            }
+
+            Log::Assert(closestCluster != clusters);
+
+            partial.sums.col(closestCluster) += dataset.col(i);
+            ++partial.counts(closestCluster);
+          }
+        }
+      }, result);
+
+  distanceCalculations += candidates * dataset.n_cols;
+  Timer::Stop(assignmentTimer);
+
+  // Now normalize the centroids and calculate how far they moved.
+  Timer::Start(updateTimer);
+  newCentroids = result.sums;
+  counts = result.counts;
+  double cNorm = 0.0;
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+  {
+    if (counts(c) == 0)
+    {
+      newCentroids.col(c).fill(DBL_MAX); // Invalid value.
+    }
+    else
+    {
+      newCentroids.col(c) /= counts(c);
+      cNorm += std::pow(metric.Evaluate(centroids.col(c), newCentroids.col(c)),
+          2.0);
+    }
+  }
+  distanceCalculations += centroids.n_cols;
+  Timer::Stop(updateTimer);
+
+  return std::sqrt(cNorm);
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -0,0 +1,215 @@
+/**
+ * @file quantized_kmeans.hpp
+ *
+ * A Lloyd step for k-means clustering which reads the dataset in compressed
+ * (8-bit or 16-bit) form, for large datasets where the iteration is limited by
+ * memory bandwidth.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_QUANTIZED_KMEANS_HPP
+#define __MLPACK_METHODS_KMEANS_QUANTIZED_KMEANS_HPP
+
+#include <mlpack/core.hpp>
+#include "lloyd_workspace.hpp"
+#include "lloyd_step_options.hpp"
+#include "block_reduction.hpp"
+#include "quantized_matrix.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * A Lloyd step which compresses the dataset into a QuantizedMatrix when it is
+ * constructed, and then only reads the compressed points in each iteration.
+ * Points are decompressed into a small per-thread buffer one sub-block at a
+ * time, and the inner products with the (double precision) centroids are
+ * computed from the buffer with one GEMM per sub-block, so each point costs 1
+ * (INT8) or 2 (FP16) bytes per dimension of memory traffic instead of 8.
+ *
+ * The decompressed point is within QuantizedMatrix::ErrorBound() of the
+ * original, so by the triangle inequality every distance is known to within
+ * that bound.  If the distances to the closest and second closest centroids
+ * are further apart than twice the bound, the assignment is the same as with
+ * the original data.  Otherwise (a near tie), and if the recheck option is
+ * set, the point is reassigned using the original dataset.  Rechecks are rare
+ * unless the clusters overlap heavily.
+ *
+ * The new centroids are the means of the decompressed points.  The
+ * compression error of each element is bounded and is not biased in any
+ * direction, so the centroids differ from the exact means by much less than
+ * ErrorBound().
+ *
+ * Apart from the rechecks, the original dataset is only read when the step is
+ * constructed (to compress it): empty clusters are filled from the compressed
+ * points (as MaxVarianceNewCluster would), and Assign() gives the final
+ * assignments from the compressed points too.  So if the dataset is a matrix
+ * loaded with data::LoadMapped() (as data::Load() does for .mmat files), it
+ * does not have to stay in memory; only the pages of the rechecked points are
+ * read again from the file.
+ *
+ * Because KMeans constructs the Lloyd step itself, the type of compression,
+ * whether to recheck near ties, and (optionally) a dataset that has already
+ * been compressed are given in the LloydStepOptions of the KMeans object.
+ *
+ * @code
+ * LloydStepOptions options;
+ * options.quantization = QuantizedMatrix::FP16;
+ * KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+ *     QuantizedKMeans> k(1000, metric::EuclideanDistance(), RandomPartition(),
+ *     MaxVarianceNewCluster(), options);
+ * k.Cluster(data, 100, centroids);
+ * @endcode
+ *
+ * @tparam MetricType Type of metric used with this implementation; the error
+ *     bounds assume the Euclidean distance.
+ * @tparam MatType Matrix type (only arma::mat is supported).
+ */
+template<typename MetricType, typename MatType>
+class QuantizedKMeans
+{
+ public:
+  /**
+   * Construct the QuantizedKMeans object, which compresses the dataset (unless
+   * options.quantizedData is given).
+   *
+   * @param dataset Dataset.
+   * @param metric Instantiated metric.
+   * @param workspace Scratch memory reused by every iteration.
+   * @param options Options of the Lloyd step; the quantization, recheck and
+   *     quantizedData options are used.
+   */
+  QuantizedKMeans(const MatType& dataset,
+                  MetricType& metric,
+                  LloydWorkspace& workspace,
+                  const LloydStepOptions& options = LloydStepOptions());
+
+  /**
+   * Run a single iteration of the Lloyd algorithm, updating the given centroids
+   * into the newCentroids matrix.
+   *
+   * @param centroids Current cluster centroids.
+   * @param newCentroids New cluster centroids.
+   * @param counts Current counts, to be overwritten with new counts.
+   */
+  double Iterate(const arma::mat& centroids,
+                 arma::mat& newCentroids,
+                 arma::Col<size_t>& counts);
+
+  /**
+   * Handle an empty cluster by taking the point furthest from the centroid of
+   * the cluster with maximum variance (see MaxVarianceNewCluster).  The
+   * variances and assignments of the last call to Iterate() and the compressed
+   * points are used, so the data is not read.
+   *
+   * @return Number of points changed.
+   */
+  int EmptyClusterAdjust(const MatType& data,
+                         const size_t emptyCluster,
+                         const arma::mat& oldCentroids,
+                         arma::mat& newCentroids,
+                         arma::Col<size_t>& clusterCounts,
+                         MetricType& metric,
+                         const size_t iteration);
+
+  /**
+   * Assign every point to its closest centroid, using the compressed points and
+   * rechecking near ties (if enabled) like Iterate() does.
+   *
+   * @param centroids Cluster centroids.
+   * @param pointAssignments Set to the index of the closest centroid of each
+   *     point.
+   */
+  void Assign(const arma::mat& centroids, arma::Row<size_t>& pointAssignments);
+
+  //! Return the number of distance calculations.
+  size_t DistanceCalculations() const { return distanceCalculations; }
+  //! Return the number of points reassigned with the original data.
+  size_t Rechecks() const { return rechecks; }
+
+  //! Get the compressed dataset.
+  const QuantizedMatrix& QuantizedData() const { return *quantizedData; }
+
+  //! Number of points decompressed at once by each thread.
+  static const size_t SubBlockSize = 256;
+
+ private:
+  //! The dataset.
+  const MatType& dataset;
+  //! The instantiated metric.
+  MetricType& metric;
+  //! Scratch memory reused by every iteration.
+  LloydWorkspace& workspace;
+
+  //! The compressed dataset, if it was not given in the options.
+  QuantizedMatrix ownedData;
+  //! The compressed dataset (ownedData or the one given in the options).
+  const QuantizedMatrix* quantizedData;
+  //! Whether near ties are reassigned with the original data.
+  bool recheck;
+
+  //! The shared thread pool, set by AllocateBuffers().
+  util::ThreadPool* pool;
+  //! Decompressed points, one buffer per thread.
+  std::vector<arma::mat> pointBuffers;
+  //! Inner products of the decompressed points and centroids, one buffer per
+  //! thread.
+  std::vector<arma::mat> productBuffers;
+
+  //! Cluster of each point in the last iteration, for empty clusters.
+  arma::Row<size_t> assignments;
+  //! Variance of each cluster in the last iteration, for empty clusters.
+  arma::vec variances;
+
+  //! Number of distance calculations.
+  size_t distanceCalculations;
+  //! Number of points reassigned with the original data.
+  size_t rechecks;
+
+  //! Timers of the phases of each iteration, registered once.
+  Timer::Handle assignmentTimer;
+  Timer::Handle updateTimer;
+
+  //! Get the shared thread pool, and allocate the per-thread buffers if they
+  //! are not allocated yet.
+  void AllocateBuffers(const size_t dimensionality, const size_t clusters);
+
+  /**
+   * Decompress the points [begin, end) (at most SubBlockSize of them) into the
+   * point buffer of the calling thread, and find the closest centroid of each.
+   *
+   * @param centroids Cluster centroids.
+   * @param centroidNorms Squared norms of the centroids.
+   * @param maxCentroidNorm Largest squared norm of the centroids.
+   * @param begin First point.
+   * @param end One past the last point.
+   * @param closest Set to the closest centroid of each point.
+   * @param distances Set to the squared distance between each decompressed
+   *     point and its closest centroid.
+   * @return The number of points rechecked with the original data.
+   */
+  size_t AssignSubBlock(const arma::mat& centroids,
+                        const arma::vec& centroidNorms,
+                        const double maxCentroidNorm,
+                        const size_t begin,
+                        const size_t end,
+                        size_t* closest,
+                        double* distances);
+
+  //! Get the index of the calling thread in the pool, for the per-thread
+  //! buffers.
+  size_t Thread() const { return pool->ThreadIndex(); }
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+// Include implementation.
+#include "quantized_kmeans_impl.hpp"
+
+#endif
@@ -0,0 +1,370 @@
+/**
+ * @file quantized_kmeans_impl.hpp
+ *
+ * Implementation of the compressed-data Lloyd step for k-means clustering.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_QUANTIZED_KMEANS_IMPL_HPP
+#define __MLPACK_METHODS_KMEANS_QUANTIZED_KMEANS_IMPL_HPP
+
+// In case it hasn't been included yet.
+#include "quantized_kmeans.hpp"
+
+namespace mlpack {
+namespace kmeans {
+
+template<typename MetricType, typename MatType>
+QuantizedKMeans<MetricType, MatType>::QuantizedKMeans(
+    const MatType& dataset,
+    MetricType& metric,
+    LloydWorkspace& workspace,
+    const LloydStepOptions& options) :
+    dataset(dataset),
+    metric(metric),
+    workspace(workspace),
+    ownedData(options.quantizedData ? QuantizedMatrix() :
+        QuantizedMatrix(dataset, options.quantization)),
+    quantizedData(options.quantizedData ? options.quantizedData : &ownedData),
+    recheck(options.recheck),
+    pool(NULL),
+    distanceCalculations(0),
+    rechecks(0),
+    assignmentTimer(Timer::Register("clustering/assignment")),
+    updateTimer(Timer::Register("clustering/update"))
+{
+  if (quantizedData->Rows() != dataset.n_rows ||
+      quantizedData->Cols() != dataset.n_cols)
+  {
+    Log::Fatal << "QuantizedKMeans: the compressed dataset has size "
+        << quantizedData->Rows() << " x " << quantizedData->Cols() << ", but "
+        << "the dataset has size " << dataset.n_rows << " x " << dataset.n_cols
+        << "!" << std::endl;
+  }
+
+  if (!options.quantizedData)
+  {
+    Log::Info << "QuantizedKMeans: compressed " << dataset.n_cols << " points "
+        << "to " << ownedData.Size() << " bytes (" << ((options.quantization ==
+        QuantizedMatrix::INT8) ? "int8" : "fp16") << ")." << std::endl;
+  }
+}
+
+template<typename MetricType, typename MatType>
+int QuantizedKMeans<MetricType, MatType>::EmptyClusterAdjust(
+    const MatType& /* data */,
+    const size_t emptyCluster,
+    const arma::mat& /* oldCentroids */,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& clusterCounts,
+    MetricType& metric,
+    const size_t /* iteration */)
+{
+  // Find the cluster with maximum variance in the last iteration.  If its
+  // variance is 0, all the points are the same, and we can't continue.
+  if (variances.n_elem != newCentroids.n_cols)
+    return 0;
+
+  arma::uword maxVarCluster = 0;
+  variances.max(maxVarCluster);
+  if (variances[maxVarCluster] == 0.0)
+    return 0;
+
+  // Inside this cluster, find the decompressed point which is furthest away
+  // from the new centroid.
+  const size_t dimensionality = newCentroids.n_rows;
+  AllocateBuffers(dimensionality, newCentroids.n_cols);
+  arma::mat block(pointBuffers[Thread()].memptr(), dimensionality,
+      SubBlockSize, false, true);
+  arma::vec furthest(dimensionality);
+  size_t furthestPoint = quantizedData->Cols();
+  double maxDistance = -DBL_MAX;
+  for (size_t begin = 0; begin < quantizedData->Cols(); begin += SubBlockSize)
+  {
+    const size_t end = std::min(begin + SubBlockSize, quantizedData->Cols());
+    quantizedData->Dequantize(begin, end, block.memptr());
+    for (size_t i = begin; i < end; ++i)
+    {
+      if (assignments[i] != maxVarCluster)
+        continue;
+
+      const double distance = std::pow(metric.Evaluate(block.col(i - begin),
+          newCentroids.col(maxVarCluster)), 2.0);
+      if (distance > maxDistance)
+      {
+        maxDistance = distance;
+        furthestPoint = i;
+        furthest = block.col(i - begin);
+      }
+    }
+  }
+  distanceCalculations += clusterCounts[maxVarCluster];
+
+  // Take that point and add it to the empty cluster.
+  newCentroids.col(maxVarCluster) *= (double(clusterCounts[maxVarCluster]) /
+      double(clusterCounts[maxVarCluster] - 1));
+  newCentroids.col(maxVarCluster) -= (1.0 / (clusterCounts[maxVarCluster] -
+      1.0)) * furthest;
+  clusterCounts[maxVarCluster]--;
+  clusterCounts[emptyCluster]++;
+  newCentroids.col(emptyCluster) = furthest;
+  assignments[furthestPoint] = emptyCluster;
+
+  // Modify the variances, so that another empty cluster takes a different
+  // point.  A cluster with one point left can't give one away.
+  variances[emptyCluster] = 0;
+  if (clusterCounts[maxVarCluster] <= 1)
+    variances[maxVarCluster] = 0;
+  else
+    variances[maxVarCluster] = (1.0 / clusterCounts[maxVarCluster]) *
+        ((clusterCounts[maxVarCluster] + 1) * variances[maxVarCluster] -
+        maxDistance);
+
+  Log::Debug << "Point " << furthestPoint << " assigned to empty cluster "
+      << emptyCluster << ".\n";
+
+  return 1; // We only changed one point.
+}
+
+// Run a single iteration.
+template<typename MetricType, typename MatType>
+double QuantizedKMeans<MetricType, MatType>::Iterate(
+    const arma::mat& centroids,
+    arma::mat& newCentroids,
+    arma::Col<size_t>& counts)
+{
+  const size_t dimensionality = centroids.n_rows;
+  const size_t clusters = centroids.n_cols;
+  AllocateBuffers(dimensionality, clusters);
+
+  // Each phase has its own timer (and hardware counters, with
+  // --perf_counters), run once per iteration.
+  Timer::Start(assignmentTimer);
+
+  arma::vec& centroidNorms = workspace.CentroidNorms();
+  for (size_t c = 0; c < clusters; ++c)
+    centroidNorms[c] = arma::dot(centroids.col(c), centroids.col(c));
+  const double maxCentroidNorm = centroidNorms.max();
+
+  // The assignments are kept for EmptyClusterAdjust().
+  if (assignments.n_elem != dataset.n_cols)
+    assignments.set_size(dataset.n_cols);
+
+  std::atomic<size_t> iterationRechecks(0);
+
+  ClusterPartial& result = workspace.Result();
+  BlockReduction::Reduce(dataset.n_cols, BlockReduction::BlockSize,
+      workspace.Partials(),
+      [dimensionality, clusters](ClusterPartial& partial)
+      {
+        partial.Reset(dimensionality, clusters, true);
+      },
+      [&](ClusterPartial& partial, const size_t begin, const size_t end)
+      {
+        size_t closest[SubBlockSize];
+        double distances[SubBlockSize];
+        size_t blockRechecks = 0;
+        for (size_t subBegin = begin; subBegin < end; subBegin += SubBlockSize)
+        {
+          const size_t subEnd = std::min(subBegin + SubBlockSize, end);
+          const size_t points = subEnd - subBegin;
+          blockRechecks += AssignSubBlock(centroids, centroidNorms,
+              maxCentroidNorm, subBegin, subEnd, closest, distances);
+
+          // AssignSubBlock() left the decompressed points in the buffer.
+          const arma::mat block(pointBuffers[Thread()].memptr(),
+              dimensionality, points, false, true);
+          for (size_t j = 0; j < points; ++j)
+          {
+            partial.sums.col(closest[j]) += block.col(j);
+            ++partial.counts[closest[j]];
+            partial.variances[closest[j]] += distances[j];
+            assignments[subBegin + j] = closest[j];
+          }
+        }
+
+        iterationRechecks += blockRechecks;
+      }, result);
+  Timer::Stop(assignmentTimer);
+
+  Timer::Start(updateTimer);
+  newCentroids = result.sums;
+  counts = result.counts;
+
+  // Now normalize the centroids, and compute the variances of the clusters for
+  // EmptyClusterAdjust().
+  variances = result.variances;
+  for (size_t c = 0; c < clusters; ++c)
+  {
+    if (counts[c] != 0)
+      newCentroids.col(c) /= counts[c];
+    else
+      newCentroids.col(c).fill(DBL_MAX); // Invalid value.
+
+    if (counts[c] <= 1)
+      variances[c] = 0;
+    else
+      variances[c] /= counts[c];
+  }
+
+  distanceCalculations += (dataset.n_cols + iterationRechecks.load()) *
+      clusters;
+  rechecks += iterationRechecks.load();
+  Log::Debug << "QuantizedKMeans: " << iterationRechecks.load() << " points "
+      << "rechecked with the original data." << std::endl;
+
+  // Calculate cluster distortion for this iteration.
+  double cNorm = 0.0;
+  for (size_t c = 0; c < clusters; ++c)
+  {
+    const double distance = metric.Evaluate(centroids.col(c),
+        newCentroids.col(c));
+    cNorm += distance * distance;
+  }
+  distanceCalculations += clusters;
+  Timer::Stop(updateTimer);
+
+  return std::sqrt(cNorm);
+}
+
+template<typename MetricType, typename MatType>
+void QuantizedKMeans<MetricType, MatType>::Assign(
+    const arma::mat& centroids,
+    arma::Row<size_t>& pointAssignments)
+{
+  const size_t clusters = centroids.n_cols;
+  AllocateBuffers(centroids.n_rows, clusters);
+
+  arma::vec& centroidNorms = workspace.CentroidNorms();
+  for (size_t c = 0; c < clusters; ++c)
+    centroidNorms[c] = arma::dot(centroids.col(c), centroids.col(c));
+  const double maxCentroidNorm = centroidNorms.max();
+
+  pointAssignments.set_size(dataset.n_cols);
+  const size_t assignRechecks = pool->ParallelReduce(
+      (size_t) 0, (size_t) dataset.n_cols, (size_t) SubBlockSize, (size_t) 0,
+      [&](const size_t begin, const size_t end)
+      {
+        double distances[SubBlockSize];
+        return AssignSubBlock(centroids, centroidNorms, maxCentroidNorm, begin,
+            end, pointAssignments.memptr() + begin, distances);
+      },
+      [](const size_t a, const size_t b) { return a + b; });
+
+  distanceCalculations += (dataset.n_cols + assignRechecks) * clusters;
+  rechecks += assignRechecks;
+}
+
+template<typename MetricType, typename MatType>
+void QuantizedKMeans<MetricType, MatType>::AllocateBuffers(
+    const size_t dimensionality,
+    const size_t clusters)
+{
+  pool = &util::ThreadPool::Global();
+  const size_t threads = pool->Threads();
+  if (pointBuffers.size() < threads)
+  {
+    pointBuffers.resize(threads);
+    productBuffers.resize(threads);
+    for (size_t t = 0; t < threads; ++t)
+    {
+      pointBuffers[t].set_size(dimensionality, SubBlockSize);
+      productBuffers[t].set_size(clusters, SubBlockSize);
+    }
+  }
+}
+
+template<typename MetricType, typename MatType>
+size_t QuantizedKMeans<MetricType, MatType>::AssignSubBlock(
+    const arma::mat& centroids,
+    const arma::vec& centroidNorms,
+    const double maxCentroidNorm,
+    const size_t begin,
+    const size_t end,
+    size_t* closest,
+    double* distances)
+{
+  const size_t dimensionality = centroids.n_rows;
+  const size_t clusters = centroids.n_cols;
+  const size_t points = end - begin;
+  const size_t t = Thread();
+
+  // Decompress the sub-block and compute its inner products with the
+  // centroids; both buffers stay in cache.
+  arma::mat block(pointBuffers[t].memptr(), dimensionality, points, false,
+      true);
+  arma::mat products(productBuffers[t].memptr(), clusters, points, false,
+      true);
+  quantizedData->Dequantize(begin, end, block.memptr());
+  products = centroids.t() * block;
+
+  size_t subBlockRechecks = 0;
+  for (size_t j = 0; j < points; ++j)
+  {
+    const double pointNorm = arma::dot(block.col(j), block.col(j));
+    const double* product = products.colptr(j);
+
+    // Find the closest and second closest centroids.
+    size_t best = 0;
+    double minDistance = DBL_MAX;
+    double secondDistance = DBL_MAX;
+    for (size_t c = 0; c < clusters; ++c)
+    {
+      const double distance = centroidNorms[c] - 2.0 * product[c];
+      if (distance < minDistance)
+      {
+        secondDistance = minDistance;
+        minDistance = distance;
+        best = c;
+      }
+      else if (distance < secondDistance)
+      {
+        secondDistance = distance;
+      }
+    }
+
+    // The assignment can only differ from the assignment with the original
+    // point if the two distances are within twice the compression error (plus
+    // the rounding error of the expansion of the squared distances, converted
+    // to distances).
+    const size_t i = begin + j;
+    if (recheck && clusters > 1)
+    {
+      const double rounding = std::sqrt(2.0 * (dimensionality + 2) *
+          DBL_EPSILON * (pointNorm + maxCentroidNorm));
+      const double gap = std::sqrt(std::max(pointNorm + secondDistance, 0.0)) -
+          std::sqrt(std::max(pointNorm + minDistance, 0.0));
+      if (gap <= 2.0 * (quantizedData->ErrorBound(i) + rounding))
+      {
+        double exactDistance = DBL_MAX;
+        for (size_t c = 0; c < clusters; ++c)
+        {
+          const double distance = metric.Evaluate(dataset.col(i),
+              centroids.col(c));
+          if (distance < exactDistance)
+          {
+            exactDistance = distance;
+            best = c;
+          }
+        }
+        ++subBlockRechecks;
+      }
+    }
+
+    closest[j] = best;
+    distances[j] = std::max(pointNorm + centroidNorms[best] - 2.0 *
+        product[best], 0.0);
+  }
+
+  return subBlockRechecks;
+}
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
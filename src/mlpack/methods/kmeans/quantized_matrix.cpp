@@ -0,0 +1,249 @@
+/**
+ * @file quantized_matrix.cpp
+ *
+ * Implementation of QuantizedMatrix.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include "quantized_matrix.hpp"
+
+#include <cstring>
+
+using namespace mlpack;
+using namespace mlpack::kmeans;
+
+namespace {
+
+/**
+ * Compute the float value of every half-precision number.
+ */
+std::vector<float> MakeHalfTable()
+{
+  std::vector<float> table(65536);
+  for (size_t i = 0; i < 65536; ++i)
+    table[i] = QuantizedMatrix::HalfToFloat((uint16_t) i);
+  return table;
+}
+
+/**
+ * Table of the float value of every half-precision number, so that
+ * decompression is a single lookup per element.  The table is built by the
+ * first call; the initialization of a local static is thread-safe, so later
+ * calls only read it, without a lock.
+ */
+const std::vector<float>& HalfTable()
+{
+  static const std::vector<float> table = MakeHalfTable();
+  return table;
+}
+
+} // anonymous namespace
+
+QuantizedMatrix::QuantizedMatrix() :
+    rows(0),
+    cols(0),
+    type(INT8),
+    int8Error(0.0)
+{
+  // Nothing to do.
+}
+
+QuantizedMatrix::QuantizedMatrix(const arma::mat& data, const Type type) :
+    rows(data.n_rows),
+    cols(data.n_cols),
+    type(type),
+    int8Error(0.0)
+{
+  offsets.set_size(rows);
+  scales.set_size(rows);
+  if (cols == 0)
+    return;
+
+  const arma::vec minima = arma::min(data, 1);
+  const arma::vec maxima = arma::max(data, 1);
+
+  if (type == INT8)
+  {
+    // Map [min, max] of each dimension to [-127, 127]; the offset is the middle
+    // of the range.
+    for (size_t d = 0; d < rows; ++d)
+    {
+      offsets[d] = (minima[d] + maxima[d]) / 2.0;
+      scales[d] = (maxima[d] - minima[d]) / 254.0;
+      if (scales[d] == 0.0)
+        scales[d] = 1.0; // Every value in this dimension is the offset.
+    }
+
+    int8Data.resize(rows * cols);
+    util::ThreadPool::Global().ParallelFor(0, cols, 1024,
+        [&](const size_t begin, const size_t end)
+    {
+      for (size_t i = begin; i < end; ++i)
+      {
+        for (size_t d = 0; d < rows; ++d)
+        {
+          const double value = std::floor((data(d, i) - offsets[d]) /
+              scales[d] + 0.5);
+          int8Data[i * rows + d] = (int8_t) std::max(-127.0,
+              std::min(127.0, value));
+        }
+      }
+    });
+
+    // Each element is off by at most half a step (plus a little for the
+    // rounding of the scale and offset).
+    int8Error = 0.5 * std::sqrt(arma::accu(arma::square(scales))) *
+        (1.0 + 1e-6);
+  }
+  else
+  {
+    // Scale each dimension to [-1, 1], so that nothing overflows.
+    for (size_t d = 0; d < rows; ++d)
+    {
+      offsets[d] = (minima[d] + maxima[d]) / 2.0;
+      scales[d] = (maxima[d] - minima[d]) / 2.0;
+      if (scales[d] == 0.0)
+        scales[d] = 1.0;
+    }
+
+    fp16Data.resize(rows * cols);
+    fp16Errors.set_size(cols);
+    util::ThreadPool::Global().ParallelFor(0, cols, 1024,
+        [&](const size_t begin, const size_t end)
+    {
+      for (size_t i = begin; i < end; ++i)
+      {
+        double squaredError = 0.0;
+        for (size_t d = 0; d < rows; ++d)
+        {
+          const float value = (float) ((data(d, i) - offsets[d]) / scales[d]);
+          fp16Data[i * rows + d] = FloatToHalf(value);
+
+          // Half precision has 11 significant bits; below 2^-14, the spacing
+          // is 2^-24.  The rounding to float adds at most 2^-24 relative
+          // error.
+          const double error = scales[d] * (std::abs(value) *
+              (std::pow(2.0, -11.0) + std::pow(2.0, -24.0)) +
+              std::pow(2.0, -25.0));
+          squaredError += error * error;
+        }
+
+        fp16Errors[i] = (float) (std::sqrt(squaredError) * (1.0 + 1e-6));
+      }
+    });
+  }
+}
+
+void QuantizedMatrix::Dequantize(const size_t begin,
+                                 const size_t end,
+                                 double* output) const
+{
+  const double* offsetPtr = offsets.memptr();
+  const double* scalePtr = scales.memptr();
+
+  if (type == INT8)
+  {
+    const int8_t* input = &int8Data[begin * rows];
+    for (size_t i = 0; i < end - begin; ++i)
+    {
+      // This loop has no dependencies between iterations, so the compiler can
+      // vectorize it.
+      for (size_t d = 0; d < rows; ++d)
+        output[d] = offsetPtr[d] + scalePtr[d] * (double) input[d];
+
+      input += rows;
+      output += rows;
+    }
+  }
+  else
+  {
+    const float* table = &HalfTable()[0];
+    const uint16_t* input = &fp16Data[begin * rows];
+    for (size_t i = 0; i < end - begin; ++i)
+    {
+      for (size_t d = 0; d < rows; ++d)
+        output[d] = offsetPtr[d] + scalePtr[d] * (double) table[input[d]];
+
+      input += rows;
+      output += rows;
+    }
+  }
+}
+
+size_t QuantizedMatrix::Size() const
+{
+  return int8Data.size() * sizeof(int8_t) + fp16Data.size() * sizeof(uint16_t)
+      + fp16Errors.n_elem * sizeof(float) + (offsets.n_elem + scales.n_elem) *
+      sizeof(double);
+}
+
+uint16_t QuantizedMatrix::FloatToHalf(const float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(float));
+
+  const uint32_t sign = (bits >> 16) & 0x8000;
+  const uint32_t floatExponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  // Infinity and NaN.
+  if (floatExponent == 0xff)
+    return (uint16_t) (sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+  const int exponent = (int) floatExponent - 127 + 15;
+  if (exponent >= 31)
+    return (uint16_t) (sign | 0x7c00); // Too large; overflow to infinity.
+
+  if (exponent <= 0)
+  {
+    // The result is subnormal (or zero).
+    if (exponent < -10)
+      return (uint16_t) sign;
+
+    mantissa |= 0x800000;
+    const uint32_t shift = (uint32_t) (14 - exponent);
+    uint32_t half = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1)))
+      ++half;
+    return (uint16_t) (sign | half);
+  }
+
+  // Round to nearest even; a carry out of the mantissa correctly increments the
+  // exponent.
+  uint32_t half = ((uint32_t) exponent << 10) | (mantissa >> 13);
+  const uint32_t remainder = mantissa & 0x1fff;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    ++half;
+  return (uint16_t) (sign | half);
+}
+
+float QuantizedMatrix::HalfToFloat(const uint16_t value)
+{
+  const uint32_t sign = ((uint32_t) value & 0x8000) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1f;
+  const uint32_t mantissa = value & 0x3ff;
+
+  if (exponent == 0)
+  {
+    // Zero or subnormal.
+    const float result = std::ldexp((float) mantissa, -24);
+    return sign ? -result : result;
+  }
+
+  uint32_t bits;
+  if (exponent == 31)
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  else
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(float));
+  return result;
+}
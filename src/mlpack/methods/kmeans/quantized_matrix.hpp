@@ -0,0 +1,112 @@
+/**
+ * @file quantized_matrix.hpp
+ *
+ * A dense matrix stored with 8 or 16 bits per element, for algorithms which
+ * are limited by memory bandwidth and can tolerate a bounded error.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#ifndef __MLPACK_METHODS_KMEANS_QUANTIZED_MATRIX_HPP
+#define __MLPACK_METHODS_KMEANS_QUANTIZED_MATRIX_HPP
+
+#include <mlpack/core.hpp>
+#include <stdint.h>
+
+namespace mlpack {
+namespace kmeans {
+
+/**
+ * A QuantizedMatrix holds a column-major matrix (one point per column) in
+ * compressed form.  Each dimension is shifted and scaled separately, and then
+ * each element is stored either as an 8-bit integer (INT8; the range of each
+ * dimension is split into 255 equal steps) or as an IEEE half-precision float
+ * (FP16; each dimension is scaled to [-1, 1]).  This takes 1/8 (INT8) or 1/4
+ * (FP16) of the memory of a double matrix.
+ *
+ * Columns are decompressed in blocks with Dequantize(), which is meant to be
+ * called on blocks small enough to stay in cache, so that the compressed data
+ * is the only thing read from main memory.  For each column i, ErrorBound(i)
+ * bounds the Euclidean distance between the original and decompressed column.
+ */
+class QuantizedMatrix
+{
+ public:
+  //! The type of compression.
+  enum Type
+  {
+    INT8,
+    FP16
+  };
+
+  //! Create an empty matrix.
+  QuantizedMatrix();
+
+  /**
+   * Compress the given matrix.
+   *
+   * @param data Matrix to compress.
+   * @param type Type of compression.
+   */
+  QuantizedMatrix(const arma::mat& data, const Type type);
+
+  /**
+   * Decompress the columns [begin, end) into the given memory, which must have
+   * room for n_rows * (end - begin) elements; the result is column-major.
+   */
+  void Dequantize(const size_t begin, const size_t end, double* output) const;
+
+  //! Get an upper bound on the distance between the original column i and its
+  //! decompressed version.
+  double ErrorBound(const size_t i) const
+  {
+    return (type == INT8) ? int8Error : (double) fp16Errors[i];
+  }
+
+  //! Get the number of rows.
+  size_t Rows() const { return rows; }
+  //! Get the number of columns.
+  size_t Cols() const { return cols; }
+  //! Get the type of compression.
+  Type QuantizationType() const { return type; }
+
+  //! Get the memory used by the compressed matrix, in bytes.
+  size_t Size() const;
+
+  //! Convert a float to half precision (rounding to nearest even).
+  static uint16_t FloatToHalf(const float value);
+  //! Convert a half-precision number to float.
+  static float HalfToFloat(const uint16_t value);
+
+ private:
+  //! Number of rows.
+  size_t rows;
+  //! Number of columns.
+  size_t cols;
+  //! Type of compression.
+  Type type;
+
+  //! The compressed elements, if type is INT8.
+  std::vector<int8_t> int8Data;
+  //! The compressed elements, if type is FP16.
+  std::vector<uint16_t> fp16Data;
+
+  //! The offset of each dimension (subtracted before scaling).
+  arma::vec offsets;
+  //! The scale of each dimension.
+  arma::vec scales;
+
+  //! Error bound for every column, if type is INT8.
+  double int8Error;
+  //! Error bound for each column, if type is FP16.
+  arma::fvec fp16Errors;
+};
+
+} // namespace kmeans
+} // namespace mlpack
+
+#endif
@@ -17,6 +17,8 @@
 #define __MLPACK_METHODS_KMEANS_REFINED_START_HPP
 
 #include <mlpack/core.hpp>
+#include <random>
+#include <unordered_set>
 
 namespace mlpack {
 namespace kmeans {
@@ -35,6 +37,11 @@ namespace kmeans {
  *   volume={66},
  *   year={1998}
  * }
+ *
+ * The samplings are independent, so they are run in parallel on the shared
+ * util::ThreadPool.  Each sampling draws from its own random number generator, whose
+ * seed is derived from the global mlpack generator (see math::RandomSeed()),
+ * so the results depend only on the seed and not on the number of threads.
  */
 class RefinedStart
 {
@@ -82,6 +89,23 @@ class RefinedStart
   }
 
  private:
+  /**
+   * Select 'numSamples' distinct indices in [0, numPoints) uniformly at random
+   * with Floyd's algorithm, which takes O(numSamples) time.  The indices are
+   * returned in sorted order.
+   *
+   * @param numPoints Number of points to sample from.
+   * @param numSamples Number of distinct indices to select.
+   * @param rng Random number generator to use.
+   * @param used Scratch set used to track selected indices (reused).
+   * @param indices Vector to store the selected indices in.
+   */
+  static void Sample(const size_t numPoints,
+                     const size_t numSamples,
+                     math::RandomStream& rng,
+                     std::unordered_set<size_t>& used,
+                     std::vector<size_t>& indices);
+
   //! The number of samplings to perform.
   size_t samplings;
   //! The percentage of the data to use for each subsampling.
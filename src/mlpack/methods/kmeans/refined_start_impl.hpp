@@ -28,77 +28,127 @@ void RefinedStart::Cluster(const MatType& data,
                            const size_t clusters,
                            arma::Row<size_t>& assignments) const
 {
-  math::RandomSeed(std::time(NULL));
-
-  // This will hold the sampled datasets.
+  // This will hold the sampled centroids.
   const size_t numPoints = size_t(percentage * data.n_cols);
-  MatType sampledData(data.n_rows, numPoints);
-  // vector<bool> is packed so each bool is 1 bit.
-  std::vector<bool> pointsUsed(data.n_cols, false);
   arma::mat sampledCentroids(data.n_rows, samplings * clusters);
 
-  // We will use these objects repeatedly for clustering.
-  arma::Row<size_t> sampledAssignments;
-  arma::mat centroids;
-
-  for (size_t i = 0; i < samplings; ++i)
+  // Each sampling gets its own random stream, so that the samples depend only
+  // on the user's random seed and not on which thread takes each sampling.
+  const uint64_t baseSeed = math::NewStreamSeed();
+
+  // The samplings are run by one task per thread of the shared pool, each
+  // taking samplings until there are none left.  The scratch objects belong to
+  // the task and not to the thread, because KMeans::Cluster() waits for its
+  // own parallel loops, and a waiting thread may run another sampling task.
+  util::ThreadPool& pool = util::ThreadPool::Global();
+  const size_t tasks = std::max(std::min(samplings, pool.Threads()),
+      (size_t) 1);
+
+  // We will reuse these objects for every sampling done by a task.
+  std::vector<MatType> sampledData(tasks);
+  std::vector<std::unordered_set<size_t> > used(tasks);
+  std::vector<std::vector<size_t> > indices(tasks);
+  std::vector<arma::Row<size_t> > sampledAssignments(tasks);
+  std::vector<arma::mat> threadCentroids(tasks);
+
+  std::atomic<size_t> nextSampling(0);
+  util::TaskGroup group(pool);
+  for (size_t t = 0; t < tasks; ++t)
   {
-    // First, assemble the sampled dataset.
-    size_t curSample = 0;
-    while (curSample < numPoints)
+    group.Run([&, t]()
     {
-      // Pick a random point in [0, numPoints).
-      size_t sample = (size_t) math::RandInt(data.n_cols);
-
-      if (!pointsUsed[sample])
+      for (size_t i = nextSampling++; i < samplings; i = nextSampling++)
       {
-        // This point isn't used yet.  So we'll put it in our sample.
-        pointsUsed[sample] = true;
-        sampledData.col(curSample) = data.col(sample);
-        ++curSample;
+        math::RandomStream rng(baseSeed, i);
+
+        // First, assemble the sampled dataset.
+        Sample(data.n_cols, numPoints, rng, used[t], indices[t]);
+        sampledData[t].set_size(data.n_rows, numPoints);
+        for (size_t j = 0; j < numPoints; ++j)
+          sampledData[t].col(j) = data.col(indices[t][j]);
+
+        // Randomly partition the sample, like RandomPartition does, but with
+        // this sampling's generator.
+        sampledAssignments[t].set_size(numPoints);
+        for (size_t j = 0; j < numPoints; ++j)
+          sampledAssignments[t][j] = j % clusters;
+        std::shuffle(sampledAssignments[t].begin(),
+            sampledAssignments[t].end(), rng);
+
+        // Now, using the sampled dataset, run k-means.  In the case of an
+        // empty cluster, we re-initialize that cluster as the point furthest
+        // away from the cluster with maximum variance.  This is not *exactly*
+        // what the paper implements, but it is quite similar, and we'll call
+        // it "good enough".
+        KMeans<> kmeans;
+        kmeans.Cluster(sampledData[t], clusters, sampledAssignments[t],
+            threadCentroids[t], true);
+
+        // Store the sampled centroids.
+        sampledCentroids.cols(i * clusters, (i + 1) * clusters - 1) =
+            threadCentroids[t];
       }
-    }
-
-    // Now, using the sampled dataset, run k-means.  In the case of an empty
-    // cluster, we re-initialize that cluster as the point furthest away from
-    // the cluster with maximum variance.  This is not *exactly* what the paper
-    // implements, but it is quite similar, and we'll call it "good enough".
-    KMeans<> kmeans;
-    kmeans.Cluster(sampledData, clusters, sampledAssignments, centroids);
-
-    // Store the sampled centroids.
-    sampledCentroids.cols(i * clusters, (i + 1) * clusters - 1) = centroids;
-
-    pointsUsed.assign(data.n_cols, false);
+    });
   }
+  group.Wait();
 
   // Now, we run k-means on the sampled centroids to get our final clusters.
   KMeans<> kmeans;
-  kmeans.Cluster(sampledCentroids, clusters, sampledAssignments, centroids);
+  arma::Row<size_t> finalAssignments;
+  arma::mat centroids;
+  kmeans.Cluster(sampledCentroids, clusters, finalAssignments, centroids);
 
   // Turn the final centroids into assignments.
   assignments.set_size(data.n_cols);
-  for (size_t i = 0; i < data.n_cols; ++i)
+  pool.ParallelFor(0, data.n_cols, 1024, [&](const size_t begin,
+                                             const size_t end)
   {
-    // Find the closest centroid to this point.
-    double minDistance = std::numeric_limits<double>::infinity();
-    size_t closestCluster = clusters;
-
-    for (size_t j = 0; j < clusters; ++j)
+    for (size_t i = begin; i < end; ++i)
     {
-      const double distance = kmeans.Metric().Evaluate(data.col(i),
-          centroids.col(j));
+      // Find the closest centroid to this point.
+      double minDistance = std::numeric_limits<double>::infinity();
+      size_t closestCluster = clusters;
 
-      if (distance < minDistance)
+      for (size_t j = 0; j < clusters; ++j)
       {
-        minDistance = distance;
-        closestCluster = j;
+        const double distance = kmeans.Metric().Evaluate(data.col(i),
+            centroids.col(j));
+
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closestCluster = j;
+        }
       }
+
+      // Assign the point to its closest cluster.
+      assignments[i] = closestCluster;
     }
+  });
+}
 
-    // Assign the point to its closest cluster.
-    assignments[i] = closestCluster;
+inline void RefinedStart::Sample(const size_t numPoints,
+                                 const size_t numSamples,
+                                 math::RandomStream& rng,
+                                 std::unordered_set<size_t>& used,
+                                 std::vector<size_t>& indices)
+{
+  used.clear();
+  indices.clear();
+  for (size_t j = numPoints - numSamples; j < numPoints; ++j)
+  {
+    // Pick a random point in [0, j].  If it has already been taken, take j,
+    // which cannot have been taken yet.
+    std::uniform_int_distribution<size_t> dist(0, j);
+    const size_t sample = dist(rng);
+    const size_t chosen = used.insert(sample).second ? sample : j;
+    if (chosen == j)
+      used.insert(j);
+    indices.push_back(chosen);
   }
+
+  // Sorting the indices makes assembling the sample more cache-friendly.
+  std::sort(indices.begin(), indices.end());
 }
 
 } // namespace kmeans
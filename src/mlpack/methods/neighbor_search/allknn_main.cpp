@@ -245,9 +245,9 @@ int main(int argc, char *argv[])
 
     // Save output, if desired.
     if (CLI::HasParam("neighbors_file"))
-      data::Save(CLI::GetParam<string>("neighbors_file"), neighbors);
+      data::SaveResult(CLI::GetParam<string>("neighbors_file"), neighbors);
     if (CLI::HasParam("distances_file"))
-      data::Save(CLI::GetParam<string>("distances_file"), distances);
+      data::SaveResult(CLI::GetParam<string>("distances_file"), distances);
   }
 
   if (CLI::HasParam("output_model_file"))
@@ -31,7 +31,10 @@ TreeType* BuildTree(
         tree::TreeTraits<TreeType>::RearrangesDataset == true, TreeType*
     >::type = 0)
 {
-  return new TreeType(dataset, oldFromNew);
+  // The tree is compacted for faster traversals, if it can be.
+  TreeType* root = new TreeType(dataset, oldFromNew);
+  tree::CompactTree(*root);
+  return root;
 }
 
 //! Call the tree constructor that does not do mapping.
@@ -55,7 +58,10 @@ TreeType* BuildTree(
         tree::TreeTraits<TreeType>::RearrangesDataset == true, TreeType*
     >::type = 0)
 {
-  return new TreeType(std::move(dataset), oldFromNew);
+  // The tree is compacted for faster traversals, if it can be.
+  TreeType* root = new TreeType(std::move(dataset), oldFromNew);
+  tree::CompactTree(*root);
+  return root;
 }
 
 //! Call the tree constructor that does not do mapping.
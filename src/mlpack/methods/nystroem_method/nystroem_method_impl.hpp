@@ -44,7 +44,9 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
                                          selectedData->col(j));
 
   // Construct semi-kernel matrix with interactions between selected data and
-  // all points.
+  // all points.  This is the expensive part for large datasets, and each row is
+  // independent.
+  #pragma omp parallel for
   for (size_t i = 0; i < data.n_cols; ++i)
     for (size_t j = 0; j < rank; ++j)
       semiKernel(i, j) = kernel.Evaluate(data.col(i),
@@ -67,6 +69,7 @@ void NystroemMethod<KernelType, PointSelectionPolicy>::GetKernelMatrix(
 
   // Construct semi-kernel matrix with interactions between selected points and
   // all points.
+  #pragma omp parallel for
   for (size_t i = 0; i < data.n_cols; ++i)
     for (size_t j = 0; j < rank; ++j)
       semiKernel(i, j) = kernel.Evaluate(data.col(i),
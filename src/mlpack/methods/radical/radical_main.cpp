@@ -97,10 +97,9 @@ int main(int argc, char* argv[])
       valEst += rad.Vasicek(y);
     }
 
-    // Force output even if --verbose is not given.
-    const bool ignoring = Log::Info.ignoreInput;
-    Log::Info.ignoreInput = false;
-    Log::Info << "Objective (estimate): " << valEst << "." << endl;
-    Log::Info.ignoreInput = ignoring;
+    // Print it even if --verbose is not given (or Log::Info is compiled out
+    // with MLPACK_LOG_LEVEL).
+    Log::Flush();
+    cout << "Objective (estimate): " << valEst << "." << endl;
   }
 }
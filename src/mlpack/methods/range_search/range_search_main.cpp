@@ -93,6 +93,58 @@ typedef CoverTree<EuclideanDistance, RangeSearchStat> CoverTreeType;
 typedef RangeSearch<EuclideanDistance, arma::mat, StandardCoverTree>
     RSCoverType;
 
+// Save the results of each point as a line of the given file.  Each point may
+// have any number of results (including none), so this is not a matrix that
+// data::Save() could write.
+template<typename eT>
+void SaveResults(const string& filename,
+                 const vector<vector<eT>>& results,
+                 const string& description)
+{
+  // Text files are formatted in parallel by data::ResultWriter, in the same
+  // format as the loop below.
+  if (data::ResultWriter::Supports(filename) &&
+      data::Extension(filename) != "bin")
+  {
+    try
+    {
+      data::ResultWriter writer(filename);
+      writer.WriteLines(results);
+      writer.Close();
+    }
+    catch (std::exception& e)
+    {
+      Log::Warn << "Cannot save output " << description << " to '" << filename
+          << "': " << e.what() << endl;
+    }
+    return;
+  }
+
+  fstream resultsStr(filename.c_str(), fstream::out);
+  if (!resultsStr.is_open())
+  {
+    Log::Warn << "Cannot open file '" << filename << "' to save output "
+        << description << " to!" << endl;
+    return;
+  }
+
+  // Loop over each point.
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    // Store the results of each point.  We may have 0 results to store, so we
+    // must account for that possibility.
+    for (size_t j = 0; j + 1 < results[i].size(); ++j)
+      resultsStr << results[i][j] << ", ";
+
+    if (results[i].size() > 0)
+      resultsStr << results[i][results[i].size() - 1];
+
+    resultsStr << endl;
+  }
+
+  resultsStr.close();
+}
+
 int main(int argc, char *argv[])
 {
   // Give CLI the command line parameters the user passed in.
@@ -244,64 +296,13 @@ int main(int argc, char *argv[])
 
     Log::Info << "Search complete." << endl;
 
-    // Save output, if desired.  We have to do this by hand.
+    // Save output, if desired.
     if (CLI::HasParam("distances_file"))
-    {
-      const string distancesFile = CLI::GetParam<string>("distances_file");
-      fstream distancesStr(distancesFile.c_str(), fstream::out);
-      if (!distancesStr.is_open())
-      {
-        Log::Warn << "Cannot open file '" << distancesFile << "' to save output"
-            << " distances to!" << endl;
-      }
-      else
-      {
-        // Loop over each point.
-        for (size_t i = 0; i < distances.size(); ++i)
-        {
-          // Store the distances of each point.  We may have 0 points to store,
-          // so we must account for that possibility.
-          for (size_t j = 0; j + 1 < distances[i].size(); ++j)
-            distancesStr << distances[i][j] << ", ";
-
-          if (distances[i].size() > 0)
-            distancesStr << distances[i][distances[i].size() - 1];
-
-          distancesStr << endl;
-        }
-
-        distancesStr.close();
-      }
-    }
-
+      SaveResults(CLI::GetParam<string>("distances_file"), distances,
+          "distances");
     if (CLI::HasParam("neighbors_file"))
-    {
-      const string neighborsFile = CLI::GetParam<string>("neighbors_file");
-      fstream neighborsStr(neighborsFile.c_str(), fstream::out);
-      if (!neighborsStr.is_open())
-      {
-        Log::Warn << "Cannot open file '" << neighborsFile << "' to save output"
-            << " neighbor indices to!" << endl;
-      }
-      else
-      {
-        // Loop over each point.
-        for (size_t i = 0; i < neighbors.size(); ++i)
-        {
-          // Store the neighbors of each point.  We may have 0 points to store,
-          // so we must account for that possibility.
-          for (size_t j = 0; j + 1 < neighbors[i].size(); ++j)
-            neighborsStr << neighbors[i][j] << ", ";
-
-          if (neighbors[i].size() > 0)
-            neighborsStr << neighbors[i][neighbors[i].size() - 1];
-
-          neighborsStr << endl;
-        }
-
-        neighborsStr.close();
-      }
-    }
+      SaveResults(CLI::GetParam<string>("neighbors_file"), neighbors,
+          "neighbor indices");
   }
 
   // Save the output model, if desired.
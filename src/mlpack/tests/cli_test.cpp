@@ -14,6 +14,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <thread>
 #ifndef _WIN32
   #include <sys/time.h>
 #endif
@@ -290,4 +291,94 @@ BOOST_AUTO_TEST_CASE(TwiceStopTimerTest)
   BOOST_REQUIRE_THROW(Timer::Stop("test_timer"), std::runtime_error);
 }
 
+/**
+ * Scoped timers should be nested, and timers run by several threads should
+ * count the runs of every thread; all of it should be in the JSON output.
+ */
+BOOST_AUTO_TEST_CASE(NestedThreadedTimerTest)
+{
+  {
+    ScopedTimer outer("nested_outer");
+    for (size_t i = 0; i < 3; ++i)
+      ScopedTimer inner("nested_inner");
+  }
+
+  BOOST_REQUIRE_EQUAL(Timer::Runs("nested_outer"), 1);
+  BOOST_REQUIRE_EQUAL(Timer::Runs("nested_outer/nested_inner"), 3);
+  BOOST_REQUIRE_GE(Timer::Nanoseconds("nested_outer"),
+      Timer::Nanoseconds("nested_outer/nested_inner"));
+
+  // A handle refers to the same timer as its name.
+  const Timer::Handle handle = Timer::Register("threaded_timer");
+  BOOST_REQUIRE_EQUAL(handle, Timer::Register("threaded_timer"));
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t)
+  {
+    threads.push_back(std::thread([handle]()
+    {
+      for (size_t i = 0; i < 10; ++i)
+      {
+        Timer::Start(handle);
+        Timer::Stop(handle);
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+
+  BOOST_REQUIRE_EQUAL(Timer::Runs("threaded_timer"), 40);
+
+  std::ostringstream json;
+  Timer::SaveJSON(json);
+  const std::string output = json.str();
+  BOOST_REQUIRE_NE(output.find("\"nested_outer\""), std::string::npos);
+  BOOST_REQUIRE_NE(output.find("\"nested_inner\""), std::string::npos);
+  BOOST_REQUIRE_NE(output.find("\"children\""), std::string::npos);
+  BOOST_REQUIRE_NE(output.find("\"threaded_timer\""), std::string::npos);
+
+  // Each of the four threads should be listed with its ten runs.
+  size_t threadRuns = 0;
+  for (size_t pos = output.find("\"runs\": 10,"); pos != std::string::npos;
+      pos = output.find("\"runs\": 10,", pos + 1))
+    ++threadRuns;
+  BOOST_REQUIRE_EQUAL(threadRuns, 4);
+}
+
+/**
+ * When hardware counters are enabled, timers should count events, if the
+ * system allows it.
+ */
+BOOST_AUTO_TEST_CASE(PerfCountersTimerTest)
+{
+  util::PerfCounters::Enabled() = true;
+
+  double sum = 0.0;
+  {
+    ScopedTimer t("perf_counters_timer");
+    for (size_t i = 0; i < 1000000; ++i)
+      sum += std::sqrt((double) i);
+  }
+  BOOST_REQUIRE_GT(sum, 0.0);
+
+  util::PerfCounters::Enabled() = false;
+
+  // The counters may not be available (in virtual machines, for instance), in
+  // which case nothing is counted.
+  const util::PerfCounters counters;
+  if (counters.Available(util::PerfCounters::CYCLES))
+  {
+    BOOST_REQUIRE_GT(Timer::Counter("perf_counters_timer",
+        util::PerfCounters::CYCLES), 0);
+    std::ostringstream json;
+    Timer::SaveJSON(json);
+    BOOST_REQUIRE_NE(json.str().find("\"cycles\""), std::string::npos);
+  }
+  else
+  {
+    BOOST_REQUIRE_EQUAL(Timer::Counter("perf_counters_timer",
+        util::PerfCounters::CYCLES), 0);
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END();
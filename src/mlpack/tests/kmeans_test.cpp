@@ -18,6 +18,14 @@
 #include <mlpack/methods/kmeans/hamerly_kmeans.hpp>
 #include <mlpack/methods/kmeans/pelleg_moore_kmeans.hpp>
 #include <mlpack/methods/kmeans/dual_tree_kmeans.hpp>
+#include <mlpack/methods/kmeans/projected_kmeans.hpp>
+#include <mlpack/methods/kmeans/kmeans_sweep.hpp>
+#include <mlpack/methods/kmeans/kmeans_evaluation.hpp>
+#include <mlpack/methods/kmeans/kernel_kmeans.hpp>
+#include <mlpack/methods/kmeans/online_kmeans.hpp>
+#include <mlpack/methods/kmeans/block_reduction.hpp>
+#include <mlpack/methods/kmeans/quantized_kmeans.hpp>
+#include <mlpack/methods/nystroem_method/ordered_selection.hpp>
 
 #include <mlpack/core/tree/cover_tree/cover_tree.hpp>
 #include <mlpack/methods/neighbor_search/neighbor_search.hpp>
@@ -451,6 +459,30 @@ BOOST_AUTO_TEST_CASE(RefinedStartTest)
   BOOST_REQUIRE_LT(distortion, 14000.0);
 }
 
+/**
+ * Make sure the refined starting policy respects the random seed.
+ */
+BOOST_AUTO_TEST_CASE(RefinedStartSeedTest)
+{
+  arma::mat data(3, 1000);
+  data.randu();
+
+  RefinedStart rs(20, 0.1);
+  arma::Row<size_t> assignments;
+  arma::Row<size_t> otherAssignments;
+
+  math::RandomSeed(42);
+  rs.Cluster(data, 5, assignments);
+  math::RandomSeed(42);
+  rs.Cluster(data, 5, otherAssignments);
+
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, otherAssignments.n_elem);
+  for (size_t i = 0; i < assignments.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], otherAssignments[i]);
+
+  math::RandomSeed(std::time(NULL));
+}
+
 #ifdef ARMA_HAS_SPMAT
 // Can't do this test on Armadillo 3.4; var(SpBase) is not implemented.
 #if !((ARMA_VERSION_MAJOR == 3) && (ARMA_VERSION_MINOR == 4))
@@ -571,6 +603,72 @@ BOOST_AUTO_TEST_CASE(HamerlyTest)
   }
 }
 
+/**
+ * Run a Lloyd step whose first iteration leaves a cluster empty, fill the
+ * cluster, and make sure that the next iterations (which use bounds updated by
+ * EmptyClusterAdjust()) give the same counts as a brute-force assignment.
+ */
+template<template<class, class> class LloydStepType>
+void CheckEmptyClusterBounds()
+{
+  arma::mat dataset(2, 1000);
+  dataset.randu();
+
+  // The last centroid is far from every point, so its cluster is empty.
+  arma::mat centroids(dataset.cols(0, 5));
+  centroids.col(5).fill(100.0);
+
+  metric::EuclideanDistance metric;
+  LloydWorkspace workspace(dataset.n_cols, centroids.n_cols);
+  LloydStepType<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+      metric, workspace);
+
+  arma::mat newCentroids;
+  arma::Col<size_t> counts;
+  lloydStep.Iterate(centroids, newCentroids, counts);
+  BOOST_REQUIRE_EQUAL(counts[5], 0);
+  lloydStep.EmptyClusterAdjust(dataset, 5, centroids, newCentroids, counts,
+      metric, 0);
+  BOOST_REQUIRE_EQUAL(counts[5], 1);
+
+  for (size_t iteration = 1; iteration < 4; ++iteration)
+  {
+    arma::mat oldCentroids(newCentroids);
+    lloydStep.Iterate(oldCentroids, newCentroids, counts);
+
+    arma::Col<size_t> bruteCounts(centroids.n_cols, arma::fill::zeros);
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      double minDistance = DBL_MAX;
+      size_t closest = 0;
+      for (size_t c = 0; c < centroids.n_cols; ++c)
+      {
+        const double distance = metric.Evaluate(dataset.col(i),
+            oldCentroids.col(c));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closest = c;
+        }
+      }
+      ++bruteCounts[closest];
+    }
+
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+      BOOST_REQUIRE_EQUAL(counts[c], bruteCounts[c]);
+  }
+}
+
+/**
+ * Make sure the bounds of Elkan's and Hamerly's algorithms stay valid when an
+ * empty cluster is filled.
+ */
+BOOST_AUTO_TEST_CASE(EmptyClusterBoundsTest)
+{
+  CheckEmptyClusterBounds<ElkanKMeans>();
+  CheckEmptyClusterBounds<HamerlyKMeans>();
+}
+
 BOOST_AUTO_TEST_CASE(PellegMooreTest)
 {
   const size_t trials = 5;
@@ -605,6 +703,619 @@ BOOST_AUTO_TEST_CASE(PellegMooreTest)
   }
 }
 
+/**
+ * Make sure the Pelleg-Moore algorithm gives the same results as the naive
+ * method when there are more clusters than fit in a single blacklist word.
+ */
+BOOST_AUTO_TEST_CASE(PellegMooreManyClustersTest)
+{
+  arma::mat dataset(3, 2000);
+  dataset.randu();
+
+  const size_t k = 150;
+  arma::mat centroids(3, k);
+  centroids.randu();
+
+  arma::mat naiveCentroids(centroids);
+  KMeans<> km(20);
+  arma::Row<size_t> assignments;
+  km.Cluster(dataset, k, assignments, naiveCentroids, false, true);
+
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      PellegMooreKMeans> pellegMoore(20);
+  arma::Row<size_t> pmAssignments;
+  arma::mat pmCentroids(centroids);
+  pellegMoore.Cluster(dataset, k, pmAssignments, pmCentroids, false, true);
+
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], pmAssignments[i]);
+
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(naiveCentroids[i], pmCentroids[i], 1e-5);
+}
+
+/**
+ * Make sure the random projection Lloyd step returns the same clusters as the
+ * naive method on well-separated high-dimensional data.
+ */
+BOOST_AUTO_TEST_CASE(ProjectedKMeansTest)
+{
+  const size_t k = 10;
+  arma::mat trueCentroids(200, k);
+  trueCentroids.randu();
+  trueCentroids *= 50.0;
+
+  arma::mat dataset(200, 1000);
+  dataset.randn();
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    dataset.col(i) += trueCentroids.col(i % k);
+
+  // Start from points near the true centroids.
+  arma::mat centroids(dataset.cols(0, k - 1));
+
+  arma::mat naiveCentroids(centroids);
+  KMeans<> km;
+  arma::Row<size_t> assignments;
+  km.Cluster(dataset, k, assignments, naiveCentroids, false, true);
+
+  LloydStepOptions options;
+  options.projectionDim = 20;
+  KMeans<metric::EuclideanDistance, RandomPartition, MaxVarianceNewCluster,
+      ProjectedKMeans> projected(1000, metric::EuclideanDistance(),
+      RandomPartition(), MaxVarianceNewCluster(), options);
+  arma::Row<size_t> projectedAssignments;
+  arma::mat projectedCentroids(centroids);
+  projected.Cluster(dataset, k, projectedAssignments, projectedCentroids,
+      false, true);
+
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], projectedAssignments[i]);
+
+  for (size_t i = 0; i < naiveCentroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(naiveCentroids[i], projectedCentroids[i], 1e-5);
+}
+
+/**
+ * Make sure that sweeping over k returns one solution of the right size for
+ * each k, and that the inertia drops sharply once k reaches the number of
+ * well-separated clusters.
+ */
+BOOST_AUTO_TEST_CASE(KMeansSweepTest)
+{
+  arma::mat dataset(3, 900);
+  dataset.randn();
+  for (size_t i = 300; i < 600; ++i)
+    dataset.col(i) += 50.0;
+  for (size_t i = 600; i < 900; ++i)
+    dataset.col(i) -= 50.0;
+
+  arma::Col<size_t> clusters("1 2 3 4 5 6");
+  KMeansSweep sweep(dataset);
+  arma::vec inertia, bic;
+  std::vector<arma::mat> centroids;
+  sweep.Sweep(clusters, inertia, bic, centroids);
+
+  BOOST_REQUIRE_EQUAL(inertia.n_elem, clusters.n_elem);
+  BOOST_REQUIRE_EQUAL(bic.n_elem, clusters.n_elem);
+  BOOST_REQUIRE_EQUAL(centroids.size(), clusters.n_elem);
+  for (size_t i = 0; i < clusters.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(centroids[i].n_rows, dataset.n_rows);
+    BOOST_REQUIRE_EQUAL(centroids[i].n_cols, clusters[i]);
+  }
+
+  // Each point is about 3 away from its true centroid (in squared distance).
+  BOOST_REQUIRE_LT(inertia[2], 10000.0);
+  BOOST_REQUIRE_GT(inertia[0], 10.0 * inertia[2]);
+  BOOST_REQUIRE_GT(bic[2], bic[0]);
+}
+
+/**
+ * Make sure that the sweep gives identical results for any number of threads
+ * in deterministic mode, since every k is warm-started from the same solution.
+ */
+BOOST_AUTO_TEST_CASE(KMeansSweepThreadsTest)
+{
+  arma::mat dataset(3, 2 * BlockReduction::BlockSize + 100);
+  dataset.randu();
+  arma::Col<size_t> clusters("2 3 5 8 13");
+
+  BlockReduction::Deterministic() = true;
+  util::ThreadPool::Configure(1, false);
+  arma::vec serialInertia, serialBIC;
+  std::vector<arma::mat> serialCentroids;
+  math::RandomSeed(42);
+  KMeansSweep(dataset).Sweep(clusters, serialInertia, serialBIC,
+      serialCentroids);
+
+  util::ThreadPool::Configure(4, false);
+  arma::vec parallelInertia, parallelBIC;
+  std::vector<arma::mat> parallelCentroids;
+  math::RandomSeed(42);
+  KMeansSweep(dataset).Sweep(clusters, parallelInertia, parallelBIC,
+      parallelCentroids);
+
+  BlockReduction::Deterministic() = false;
+  util::ThreadPool::Configure(0, false);
+  math::RandomSeed(std::time(NULL));
+
+  for (size_t i = 0; i < clusters.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(serialInertia[i], parallelInertia[i]);
+    BOOST_REQUIRE_EQUAL(serialBIC[i], parallelBIC[i]);
+    for (size_t j = 0; j < serialCentroids[i].n_elem; ++j)
+      BOOST_REQUIRE_EQUAL(serialCentroids[i][j], parallelCentroids[i][j]);
+  }
+}
+
+/**
+ * Make sure the clustering quality measures agree with a direct computation,
+ * and that they prefer the true clustering of well-separated clusters to a
+ * random one.
+ */
+BOOST_AUTO_TEST_CASE(KMeansEvaluationTest)
+{
+  arma::mat dataset(3, 600);
+  dataset.randn();
+  arma::Row<size_t> assignments(600);
+  arma::mat centroids(3, 3, arma::fill::zeros);
+  for (size_t i = 0; i < 600; ++i)
+  {
+    assignments[i] = i / 200;
+    dataset.col(i) += 50.0 * assignments[i];
+    centroids.col(assignments[i]) += dataset.col(i) / 200.0;
+  }
+
+  double inertia = 0.0;
+  double silhouette = 0.0;
+  for (size_t i = 0; i < 600; ++i)
+  {
+    inertia += std::pow(arma::norm(dataset.col(i) -
+        centroids.col(assignments[i]), 2), 2.0);
+
+    // Compute the exact silhouette of every point.
+    arma::vec sums(3, arma::fill::zeros);
+    for (size_t j = 0; j < 600; ++j)
+      if (j != i)
+        sums[assignments[j]] += arma::norm(dataset.col(i) - dataset.col(j), 2);
+
+    const double a = sums[assignments[i]] / 199.0;
+    double b = DBL_MAX;
+    for (size_t c = 0; c < 3; ++c)
+      if (c != assignments[i])
+        b = std::min(b, sums[c] / 200.0);
+    silhouette += (b - a) / std::max(a, b);
+  }
+  silhouette /= 600;
+
+  BOOST_REQUIRE_CLOSE(KMeansEvaluation::Inertia(dataset, assignments,
+      centroids), inertia, 1e-5);
+  BOOST_REQUIRE_CLOSE(KMeansEvaluation::SampledSilhouette(dataset, assignments,
+      3, 600), silhouette, 1e-5);
+
+  const double simplified = KMeansEvaluation::SimplifiedSilhouette(dataset,
+      assignments, centroids);
+  const double sampled = KMeansEvaluation::SampledSilhouette(dataset,
+      assignments, 3, 100);
+  const double daviesBouldin = KMeansEvaluation::DaviesBouldin(dataset,
+      assignments, centroids);
+  BOOST_REQUIRE_GT(simplified, 0.9);
+  BOOST_REQUIRE_GT(sampled, 0.9);
+  BOOST_REQUIRE_LT(daviesBouldin, 0.2);
+
+  // A random clustering should be much worse.
+  arma::Row<size_t> randomAssignments(600);
+  arma::mat randomCentroids(3, 3, arma::fill::zeros);
+  arma::Col<size_t> counts(3, arma::fill::zeros);
+  for (size_t i = 0; i < 600; ++i)
+  {
+    randomAssignments[i] = i % 3;
+    randomCentroids.col(i % 3) += dataset.col(i);
+    ++counts[i % 3];
+  }
+  for (size_t c = 0; c < 3; ++c)
+    randomCentroids.col(c) /= counts[c];
+
+  BOOST_REQUIRE_GT(KMeansEvaluation::Inertia(dataset, randomAssignments,
+      randomCentroids), 10.0 * inertia);
+  BOOST_REQUIRE_LT(KMeansEvaluation::SimplifiedSilhouette(dataset,
+      randomAssignments, randomCentroids), simplified);
+  BOOST_REQUIRE_GT(KMeansEvaluation::DaviesBouldin(dataset, randomAssignments,
+      randomCentroids), daviesBouldin);
+}
+
+/**
+ * Make sure that the Lloyd step reuses the memory in the workspace instead of
+ * allocating new memory in each iteration, and that it gives the same result as
+ * a direct computation.
+ */
+BOOST_AUTO_TEST_CASE(LloydWorkspaceTest)
+{
+  arma::mat dataset(5, 2000);
+  dataset.randu();
+  arma::mat centroids(dataset.cols(0, 9));
+
+  metric::EuclideanDistance metric;
+  LloydWorkspace workspace(dataset.n_cols, centroids.n_cols);
+  NaiveKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset, metric,
+      workspace);
+
+  arma::mat newCentroids;
+  arma::Col<size_t> counts;
+  lloydStep.Iterate(centroids, newCentroids, counts);
+  const double* distancesMemory = workspace.Distances(centroids.n_cols,
+      dataset.n_cols).memptr();
+  const size_t size = workspace.Size();
+  BOOST_REQUIRE_GE(size, sizeof(double) * centroids.n_cols * dataset.n_cols);
+
+  for (size_t i = 0; i < 5; ++i)
+  {
+    arma::mat oldCentroids(newCentroids);
+    lloydStep.Iterate(oldCentroids, newCentroids, counts);
+    BOOST_REQUIRE_EQUAL(workspace.Distances(centroids.n_cols,
+        dataset.n_cols).memptr(), distancesMemory);
+    BOOST_REQUIRE_EQUAL(workspace.Size(), size);
+
+    // Check the counts against a brute-force assignment.
+    arma::Col<size_t> bruteCounts(centroids.n_cols, arma::fill::zeros);
+    for (size_t j = 0; j < dataset.n_cols; ++j)
+    {
+      double minDistance = DBL_MAX;
+      size_t closest = 0;
+      for (size_t c = 0; c < centroids.n_cols; ++c)
+      {
+        const double distance = metric.Evaluate(dataset.col(j),
+            oldCentroids.col(c));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closest = c;
+        }
+      }
+      ++bruteCounts[closest];
+    }
+
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+      BOOST_REQUIRE_EQUAL(counts[c], bruteCounts[c]);
+  }
+}
+
+/**
+ * Make sure that kernel k-means with a full-rank Nystroem approximation uses
+ * features whose inner products are the kernel values.
+ */
+BOOST_AUTO_TEST_CASE(KernelKMeansFeaturesTest)
+{
+  arma::mat dataset(3, 20);
+  dataset.randu();
+
+  kernel::GaussianKernel gk(0.25);
+  KernelKMeans<kernel::GaussianKernel, kernel::OrderedSelection> kkm(gk, 20);
+  arma::Row<size_t> assignments;
+  arma::mat centroids;
+  kkm.Cluster(dataset, 3, assignments, centroids);
+
+  BOOST_REQUIRE_EQUAL(kkm.Features().n_rows, 20);
+  BOOST_REQUIRE_EQUAL(kkm.Features().n_cols, 20);
+  BOOST_REQUIRE_EQUAL(centroids.n_rows, 20);
+  BOOST_REQUIRE_EQUAL(centroids.n_cols, 3);
+
+  const arma::mat gram = kkm.Features().t() * kkm.Features();
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    for (size_t j = 0; j < dataset.n_cols; ++j)
+      BOOST_REQUIRE_SMALL(gram(i, j) - gk.Evaluate(dataset.col(i),
+          dataset.col(j)), 1e-5);
+}
+
+/**
+ * Make sure that kernel k-means finds two well-separated clusters.
+ */
+BOOST_AUTO_TEST_CASE(KernelKMeansSeparatedTest)
+{
+  arma::mat dataset(2, 400);
+  dataset.randn();
+  dataset.cols(200, 399) += 20.0;
+
+  kernel::GaussianKernel gk(5.0);
+  KernelKMeans<kernel::GaussianKernel> kkm(gk, 20);
+  arma::Row<size_t> assignments;
+  arma::mat centroids;
+  kkm.Cluster(dataset, 2, assignments, centroids);
+
+  BOOST_REQUIRE_NE(assignments[0], assignments[200]);
+  for (size_t i = 0; i < 200; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(assignments[i], assignments[0]);
+    BOOST_REQUIRE_EQUAL(assignments[200 + i], assignments[200]);
+  }
+}
+
+/**
+ * Make sure that updating an online k-means model with a new batch decays the
+ * old weights, adds the new points, and keeps the centroids consistent with the
+ * sums and weights.
+ */
+BOOST_AUTO_TEST_CASE(OnlineKMeansUpdateTest)
+{
+  arma::mat dataset(2, 300);
+  dataset.randn();
+  dataset.cols(150, 299) += 30.0;
+
+  OnlineKMeans model;
+  arma::Row<size_t> assignments;
+  model.Train(dataset, 2, assignments);
+  BOOST_REQUIRE_CLOSE(arma::accu(model.Weights()), 300.0, 1e-5);
+
+  // A new batch around the second cluster, shifted a little.
+  arma::mat batch(2, 100);
+  batch.randn();
+  batch += 31.0;
+
+  const arma::vec oldWeights = model.Weights();
+  model.Update(batch, 0.5, assignments);
+
+  BOOST_REQUIRE_EQUAL(assignments.n_elem, 100);
+  const size_t newCluster = assignments[0];
+  for (size_t i = 0; i < 100; ++i)
+    BOOST_REQUIRE_EQUAL(assignments[i], newCluster);
+
+  for (size_t c = 0; c < 2; ++c)
+  {
+    const double expected = 0.5 * oldWeights[c] + ((c == newCluster) ? 100 : 0);
+    BOOST_REQUIRE_CLOSE(model.Weights()[c], expected, 1e-5);
+    for (size_t d = 0; d < 2; ++d)
+      BOOST_REQUIRE_CLOSE(model.Centroids()(d, c),
+          model.Sums()(d, c) / model.Weights()[c], 1e-5);
+  }
+
+  // The centroid of the updated cluster moved towards the new batch.
+  BOOST_REQUIRE_GT(model.Centroids()(0, newCluster), 30.2);
+}
+
+/**
+ * Make sure that in deterministic mode the naive Lloyd step gives bitwise
+ * identical results for any number of threads, and that it agrees with the
+ * fast mode up to rounding.
+ */
+BOOST_AUTO_TEST_CASE(DeterministicReductionTest)
+{
+  arma::mat dataset(4, 3 * BlockReduction::BlockSize + 17);
+  dataset.randu();
+  arma::mat initialCentroids(dataset.cols(0, 7));
+
+  metric::EuclideanDistance metric;
+  arma::Col<size_t> counts;
+
+  BlockReduction::Deterministic() = true;
+  util::ThreadPool::Configure(1, false);
+  arma::mat serialCentroids;
+  {
+    LloydWorkspace workspace(dataset.n_cols, initialCentroids.n_cols);
+    NaiveKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace);
+    lloydStep.Iterate(initialCentroids, serialCentroids, counts);
+  }
+
+  util::ThreadPool::Configure(4, false);
+  arma::mat parallelCentroids;
+  {
+    LloydWorkspace workspace(dataset.n_cols, initialCentroids.n_cols);
+    NaiveKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace);
+    lloydStep.Iterate(initialCentroids, parallelCentroids, counts);
+  }
+
+  BlockReduction::Deterministic() = false;
+  arma::mat fastCentroids;
+  {
+    LloydWorkspace workspace(dataset.n_cols, initialCentroids.n_cols);
+    NaiveKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace);
+    lloydStep.Iterate(initialCentroids, fastCentroids, counts);
+  }
+  util::ThreadPool::Configure(0, false);
+
+  for (size_t i = 0; i < serialCentroids.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(serialCentroids[i], parallelCentroids[i]);
+    BOOST_REQUIRE_CLOSE(serialCentroids[i], fastCentroids[i], 1e-8);
+  }
+
+  // The reduction of a sum of doubles must also be exact in deterministic mode.
+  BlockReduction::Deterministic() = true;
+  double serialInertia, parallelInertia;
+  util::ThreadPool::Configure(1, false);
+  arma::Row<size_t> assignments(dataset.n_cols);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+    assignments[i] = i % serialCentroids.n_cols;
+  serialInertia = KMeansEvaluation::Inertia(dataset, assignments,
+      serialCentroids);
+  util::ThreadPool::Configure(3, false);
+  parallelInertia = KMeansEvaluation::Inertia(dataset, assignments,
+      serialCentroids);
+  util::ThreadPool::Configure(0, false);
+  BlockReduction::Deterministic() = false;
+
+  BOOST_REQUIRE_EQUAL(serialInertia, parallelInertia);
+}
+
+/**
+ * Make sure that in deterministic mode the projected Lloyd step gives bitwise
+ * identical results for any number of threads.
+ */
+BOOST_AUTO_TEST_CASE(ProjectedDeterministicReductionTest)
+{
+  arma::mat dataset(20, 2 * BlockReduction::BlockSize + 31);
+  dataset.randu();
+  arma::mat initialCentroids(dataset.cols(0, 15));
+
+  metric::EuclideanDistance metric;
+  LloydStepOptions options;
+  options.projectionDim = 5;
+  arma::Col<size_t> serialCounts, parallelCounts;
+
+  BlockReduction::Deterministic() = true;
+  util::ThreadPool::Configure(1, false);
+  arma::mat serialCentroids;
+  {
+    math::RandomSeed(42);
+    LloydWorkspace workspace(dataset.n_cols, initialCentroids.n_cols);
+    ProjectedKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace, options);
+    lloydStep.Iterate(initialCentroids, serialCentroids, serialCounts);
+  }
+
+  util::ThreadPool::Configure(4, false);
+  arma::mat parallelCentroids;
+  {
+    math::RandomSeed(42);
+    LloydWorkspace workspace(dataset.n_cols, initialCentroids.n_cols);
+    ProjectedKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace, options);
+    lloydStep.Iterate(initialCentroids, parallelCentroids, parallelCounts);
+  }
+  util::ThreadPool::Configure(0, false);
+  BlockReduction::Deterministic() = false;
+  math::RandomSeed(std::time(NULL));
+
+  for (size_t c = 0; c < serialCounts.n_elem; ++c)
+    BOOST_REQUIRE_EQUAL(serialCounts[c], parallelCounts[c]);
+  for (size_t i = 0; i < serialCentroids.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(serialCentroids[i], parallelCentroids[i]);
+}
+
+/**
+ * Make sure that the compressed dataset is within the error bound of the
+ * original, and that with rechecks a quantized Lloyd step (and its final
+ * assignment) assigns the points exactly like the naive step.
+ */
+BOOST_AUTO_TEST_CASE(QuantizedKMeansTest)
+{
+  // Half precision conversion of exactly representable values.
+  const float values[] = { 0.0f, 1.0f, -2.5f, 0.099975586f, 65504.0f,
+      5.9604645e-8f };
+  for (size_t i = 0; i < 6; ++i)
+    BOOST_REQUIRE_EQUAL(QuantizedMatrix::HalfToFloat(
+        QuantizedMatrix::FloatToHalf(values[i])), values[i]);
+
+  arma::mat dataset(5, 2000);
+  dataset.randu();
+  dataset.row(2) *= 1000.0;
+
+  for (size_t type = 0; type < 2; ++type)
+  {
+    const QuantizedMatrix::Type quantization = (type == 0) ?
+        QuantizedMatrix::INT8 : QuantizedMatrix::FP16;
+    QuantizedMatrix quantized(dataset, quantization);
+    BOOST_REQUIRE_LE(quantized.Size(), dataset.n_elem * 2 + dataset.n_cols *
+        4 + 1000);
+
+    arma::mat decompressed(dataset.n_rows, dataset.n_cols);
+    quantized.Dequantize(0, dataset.n_cols, decompressed.memptr());
+    double maxError = 0.0;
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      BOOST_REQUIRE_LE(arma::norm(decompressed.col(i) - dataset.col(i), 2),
+          quantized.ErrorBound(i));
+      maxError = std::max(maxError, quantized.ErrorBound(i));
+    }
+
+    // One Lloyd iteration from the same centroids.
+    arma::mat centroids(dataset.cols(0, 19));
+    metric::EuclideanDistance metric;
+
+    arma::mat naiveCentroids;
+    arma::Col<size_t> naiveCounts;
+    LloydWorkspace naiveWorkspace(dataset.n_cols, centroids.n_cols);
+    NaiveKMeans<metric::EuclideanDistance, arma::mat> naive(dataset, metric,
+        naiveWorkspace);
+    naive.Iterate(centroids, naiveCentroids, naiveCounts);
+
+    // Give the step the matrix compressed above.
+    LloydStepOptions options;
+    options.quantization = quantization;
+    options.quantizedData = &quantized;
+    arma::mat quantizedCentroids;
+    arma::Col<size_t> quantizedCounts;
+    LloydWorkspace workspace(dataset.n_cols, centroids.n_cols);
+    QuantizedKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace, options);
+    lloydStep.Iterate(centroids, quantizedCentroids, quantizedCounts);
+
+    for (size_t c = 0; c < centroids.n_cols; ++c)
+    {
+      BOOST_REQUIRE_EQUAL(naiveCounts[c], quantizedCounts[c]);
+      if (naiveCounts[c] > 0)
+        BOOST_REQUIRE_LE(arma::norm(naiveCentroids.col(c) -
+            quantizedCentroids.col(c), 2), maxError);
+    }
+
+    // The final assignments from the compressed points must be exact too.
+    arma::Row<size_t> assignments;
+    lloydStep.Assign(centroids, assignments);
+    for (size_t i = 0; i < dataset.n_cols; ++i)
+    {
+      double minDistance = DBL_MAX;
+      size_t closest = 0;
+      for (size_t c = 0; c < centroids.n_cols; ++c)
+      {
+        const double distance = metric.Evaluate(dataset.col(i),
+            centroids.col(c));
+        if (distance < minDistance)
+        {
+          minDistance = distance;
+          closest = c;
+        }
+      }
+      BOOST_REQUIRE_EQUAL(assignments[i], closest);
+    }
+  }
+}
+
+/**
+ * Make sure that mixed-precision assignment gives the same clustering as
+ * double precision, even when single precision alone would be inaccurate.
+ */
+BOOST_AUTO_TEST_CASE(MixedPrecisionAssignmentTest)
+{
+  // The offset makes the inner products large compared to the differences
+  // between them, so many points need to be recomputed.
+  arma::mat dataset(10, 5000);
+  dataset.randu();
+  dataset += 100.0;
+  arma::mat centroids(dataset.cols(0, 29));
+  metric::EuclideanDistance metric;
+
+  arma::mat doubleCentroids;
+  arma::Col<size_t> doubleCounts;
+  {
+    LloydWorkspace workspace(dataset.n_cols, centroids.n_cols);
+    NaiveKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace);
+    lloydStep.Iterate(centroids, doubleCentroids, doubleCounts);
+  }
+
+  LloydStepOptions options;
+  options.mixedPrecision = true;
+  arma::mat mixedCentroids;
+  arma::Col<size_t> mixedCounts;
+  size_t rechecks;
+  {
+    LloydWorkspace workspace(dataset.n_cols, centroids.n_cols);
+    NaiveKMeans<metric::EuclideanDistance, arma::mat> lloydStep(dataset,
+        metric, workspace, options);
+    lloydStep.Iterate(centroids, mixedCentroids, mixedCounts);
+    rechecks = lloydStep.Rechecks();
+  }
+
+  BOOST_REQUIRE_GT(rechecks, 0);
+  BOOST_REQUIRE_LT(rechecks, dataset.n_cols);
+  for (size_t c = 0; c < centroids.n_cols; ++c)
+    BOOST_REQUIRE_EQUAL(doubleCounts[c], mixedCounts[c]);
+  for (size_t i = 0; i < doubleCentroids.n_elem; ++i)
+    BOOST_REQUIRE_CLOSE(doubleCentroids[i], mixedCentroids[i], 1e-8);
+}
+
 BOOST_AUTO_TEST_CASE(DTNNTest)
 {
   const size_t trials = 5;
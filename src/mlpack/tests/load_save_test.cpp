@@ -525,9 +525,9 @@ BOOST_AUTO_TEST_CASE(SavePGMBinaryTest)
   remove("test_file.pgm");
 }
 
-#if defined(ARMA_USE_HDF5) && (ARMA_VERSION_MAJOR == 3 \
-    || (ARMA_VERSION_MAJOR == 4 && (ARMA_VERSION_MINOR < 300 \
-    ||  ARMA_VERSION_MINOR > 400)))
+#ifdef ARMA_USE_HDF5
+#if (ARMA_VERSION_MAJOR == 3 || (ARMA_VERSION_MAJOR == 4 && \
+    (ARMA_VERSION_MINOR < 300 || ARMA_VERSION_MINOR > 400)))
 /**
  * Make sure load as HDF5 is successful.
  */
@@ -586,6 +586,7 @@ BOOST_AUTO_TEST_CASE(LoadHDF5Test)
   remove("test_file.hdf5");
   remove("test_file.he5");
 }
+#endif
 
 /**
  * Make sure save as HDF5 is successful.
@@ -640,6 +641,52 @@ BOOST_AUTO_TEST_CASE(SaveHDF5Test)
   remove("test_file.hdf5");
   remove("test_file.he5");
 }
+
+/**
+ * Load ranges of the points of a chunked HDF5 dataset, and make sure that the
+ * dataset is compressed.
+ */
+BOOST_AUTO_TEST_CASE(PartialHDF5Test)
+{
+  arma::mat dataset(7, 100000);
+  for (size_t i = 0; i < dataset.n_elem; ++i)
+    dataset[i] = (double) (i % 1000) / 2.0;
+
+  BOOST_REQUIRE(data::Save("test_file.h5", dataset) == true);
+
+  size_t dimensionality, points;
+  data::HDF5Size("test_file.h5", dimensionality, points);
+  BOOST_REQUIRE_EQUAL(dimensionality, 7);
+  BOOST_REQUIRE_EQUAL(points, 100000);
+
+  // The dataset repeats, so it compresses well.
+  fstream f("test_file.h5", fstream::in | fstream::binary | fstream::ate);
+  BOOST_REQUIRE_LT((size_t) f.tellg(), dataset.n_elem * sizeof(double) / 10);
+  f.close();
+
+  // Load a range which does not start or end at a chunk boundary.
+  arma::fmat slice;
+  data::LoadHDF5("test_file.h5", slice, true, 12345, 50000);
+  BOOST_REQUIRE_EQUAL(slice.n_rows, 7);
+  BOOST_REQUIRE_EQUAL(slice.n_cols, 50000);
+  for (size_t j = 0; j < slice.n_cols; ++j)
+    for (size_t i = 0; i < slice.n_rows; ++i)
+      BOOST_REQUIRE_EQUAL(slice(i, j), (float) dataset(i, 12345 + j));
+
+  // Load the last points, without transposing.
+  arma::mat last;
+  data::LoadHDF5("test_file.h5", last, false, 99990);
+  BOOST_REQUIRE_EQUAL(last.n_rows, 10);
+  BOOST_REQUIRE_EQUAL(last.n_cols, 7);
+  for (size_t i = 0; i < last.n_rows; ++i)
+    for (size_t j = 0; j < last.n_cols; ++j)
+      BOOST_REQUIRE_EQUAL(last(i, j), dataset(j, 99990 + i));
+
+  BOOST_REQUIRE_THROW(data::LoadHDF5("test_file.h5", last, true, 100001),
+      std::runtime_error);
+
+  remove("test_file.h5");
+}
 #else
 /**
  * Ensure saving as HDF5 fails.
@@ -1100,6 +1147,455 @@ BOOST_AUTO_TEST_CASE(CategoricalNontransposedCSVLoadTest)
   remove("test.csv");
 }
 
+/**
+ * Load a CSV large enough to be split into several chunks, with Windows line
+ * endings and blank lines, and make sure every value ends up in its place.
+ */
+BOOST_AUTO_TEST_CASE(LargeCSVLoadTest)
+{
+  fstream f;
+  f.open("test_file.csv", fstream::out | fstream::binary);
+  const size_t points = 200000;
+  for (size_t i = 0; i < points; ++i)
+  {
+    f << i << ", " << (i % 1000) << ".25," << -(double) (i % 4096) / 8.0
+        << ",1e-3";
+    f << ((i % 3 == 0) ? "\r\n" : "\n");
+    if (i % 5000 == 0)
+      f << "\n  \n";
+  }
+  f.close();
+
+  arma::mat test;
+  BOOST_REQUIRE(data::Load("test_file.csv", test) == true);
+  arma::mat nontransposed;
+  BOOST_REQUIRE(data::Load("test_file.csv", nontransposed, true, false) ==
+      true);
+
+  BOOST_REQUIRE_EQUAL(test.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(test.n_cols, points);
+  BOOST_REQUIRE_EQUAL(nontransposed.n_rows, points);
+  BOOST_REQUIRE_EQUAL(nontransposed.n_cols, 4);
+
+  for (size_t i = 0; i < points; ++i)
+  {
+    // These are all exact in double precision, except 1e-3, which should be
+    // the closest double.
+    BOOST_REQUIRE_EQUAL(test(0, i), (double) i);
+    BOOST_REQUIRE_EQUAL(test(1, i), (i % 1000) + 0.25);
+    BOOST_REQUIRE_EQUAL(test(2, i), -(double) (i % 4096) / 8.0);
+    BOOST_REQUIRE_EQUAL(test(3, i), 1e-3);
+
+    for (size_t j = 0; j < 4; ++j)
+      BOOST_REQUIRE_EQUAL(nontransposed(i, j), test(j, i));
+  }
+
+  remove("test_file.csv");
+}
+
+/**
+ * Quoted fields may contain separators, and categories are numbered in the
+ * order of the file.
+ */
+BOOST_AUTO_TEST_CASE(QuotedCategoricalCSVLoadTest)
+{
+  fstream f;
+  f.open("test.csv", fstream::out);
+  f << "1, \"2\", \"a, b\"" << endl;
+  f << endl;
+  f << "3, 4, c" << endl;
+  f << "5, 6, \"a, b\"" << endl;
+  f.close();
+
+  arma::mat matrix;
+  DatasetInfo info;
+  BOOST_REQUIRE(data::Load("test.csv", matrix, info) == true);
+
+  BOOST_REQUIRE_EQUAL(matrix.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(matrix.n_cols, 3);
+
+  BOOST_REQUIRE_EQUAL(matrix(0, 0), 1.0);
+  BOOST_REQUIRE_EQUAL(matrix(1, 0), 2.0);
+  BOOST_REQUIRE_EQUAL(matrix(2, 0), 0.0);
+  BOOST_REQUIRE_EQUAL(matrix(0, 1), 3.0);
+  BOOST_REQUIRE_EQUAL(matrix(1, 1), 4.0);
+  BOOST_REQUIRE_EQUAL(matrix(2, 1), 1.0);
+  BOOST_REQUIRE_EQUAL(matrix(0, 2), 5.0);
+  BOOST_REQUIRE_EQUAL(matrix(1, 2), 6.0);
+  BOOST_REQUIRE_EQUAL(matrix(2, 2), 0.0);
+
+  BOOST_REQUIRE(info.Type(0) == Datatype::numeric);
+  BOOST_REQUIRE(info.Type(1) == Datatype::numeric);
+  BOOST_REQUIRE(info.Type(2) == Datatype::categorical);
+  BOOST_REQUIRE_EQUAL(info.UnmapString(0, 2), "a, b");
+  BOOST_REQUIRE_EQUAL(info.UnmapString(1, 2), "c");
+
+  remove("test.csv");
+}
+
+/**
+ * Save a mapped matrix and load it back; the default load should use the
+ * mapping itself, and the other loads should copy.
+ */
+BOOST_AUTO_TEST_CASE(MappedMatrixLoadSaveTest)
+{
+  arma::mat matrix;
+  matrix.randu(7, 1000);
+
+  BOOST_REQUIRE(data::Save("test_file.mmat", matrix) == true);
+
+  arma::mat test;
+  BOOST_REQUIRE(data::Load("test_file.mmat", test) == true);
+  BOOST_REQUIRE_EQUAL(test.n_rows, 7);
+  BOOST_REQUIRE_EQUAL(test.n_cols, 1000);
+  for (size_t i = 0; i < matrix.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(test[i], matrix[i]);
+
+  // The matrix uses the mapping (aligned to a page), not its own memory, but
+  // it can still be modified.
+  BOOST_REQUIRE_EQUAL(test.mem_state, 1);
+  BOOST_REQUIRE_EQUAL(((size_t) test.memptr()) % 4096, 0);
+  test(3, 500) = -1.0;
+  BOOST_REQUIRE_EQUAL(test(3, 500), -1.0);
+
+  // The file itself is not modified.
+  arma::mat nontransposed;
+  BOOST_REQUIRE(data::Load("test_file.mmat", nontransposed, true, false) ==
+      true);
+  BOOST_REQUIRE_EQUAL(nontransposed.n_rows, 1000);
+  BOOST_REQUIRE_EQUAL(nontransposed.n_cols, 7);
+  for (size_t i = 0; i < matrix.n_rows; ++i)
+    for (size_t j = 0; j < matrix.n_cols; ++j)
+      BOOST_REQUIRE_EQUAL(nontransposed(j, i), matrix(i, j));
+
+  // Loading into a matrix of another type converts the elements.
+  arma::fmat converted;
+  Log::Warn.ignoreInput = true;
+  BOOST_REQUIRE(data::Load("test_file.mmat", converted) == true);
+  Log::Warn.ignoreInput = false;
+  BOOST_REQUIRE_EQUAL(converted.n_rows, 7);
+  BOOST_REQUIRE_EQUAL(converted.n_cols, 1000);
+  for (size_t i = 0; i < matrix.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(converted[i], (float) matrix[i]);
+
+  BOOST_REQUIRE(data::UnmapMatrix(test) == true);
+  BOOST_REQUIRE_EQUAL(test.n_elem, 0);
+  BOOST_REQUIRE(data::UnmapMatrix(nontransposed) == false);
+  BOOST_REQUIRE_EQUAL(nontransposed.n_elem, 7000);
+
+  // A matrix saved without transposing is loaded back transposed.
+  arma::Mat<size_t> labels(1, 50);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+    labels[i] = i * i;
+  BOOST_REQUIRE(data::Save("test_file.mmat", labels, true, false) == true);
+  arma::Mat<size_t> loadedLabels;
+  BOOST_REQUIRE(data::Load("test_file.mmat", loadedLabels) == true);
+  BOOST_REQUIRE_EQUAL(loadedLabels.n_rows, 50);
+  BOOST_REQUIRE_EQUAL(loadedLabels.n_cols, 1);
+  for (size_t i = 0; i < labels.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(loadedLabels[i], i * i);
+
+  // The mapping is not released when the matrix is destroyed.
+  BOOST_REQUIRE(data::UnmapMatrix(loadedLabels) == true);
+
+  remove("test_file.mmat");
+}
+
+/**
+ * Make sure a file that is not a mapped matrix is not loaded.
+ */
+BOOST_AUTO_TEST_CASE(BadMappedMatrixLoadTest)
+{
+  fstream f;
+  f.open("test_file.mmat", fstream::out);
+  f << "1, 2, 3" << endl;
+  f.close();
+
+  arma::mat test;
+  Log::Warn.ignoreInput = true;
+  BOOST_REQUIRE(data::Load("test_file.mmat", test) == false);
+  Log::Warn.ignoreInput = false;
+
+  remove("test_file.mmat");
+}
+
+/**
+ * Stream a dataset in blocks from each supported format, with and without
+ * prefetching, and make sure the blocks make up the dataset.
+ */
+BOOST_AUTO_TEST_CASE(BlockReaderTest)
+{
+  arma::mat dataset(5, 1003);
+  for (size_t i = 0; i < dataset.n_elem; ++i)
+    dataset[i] = (double) (i % 4096) / 8.0;
+
+  const char* files[] = { "test_file.csv", "test_file.txt", "test_file.bin",
+      "test_file.mmat" };
+  for (size_t f = 0; f < 4; ++f)
+  {
+    BOOST_REQUIRE(data::Save(files[f], dataset) == true);
+
+    for (size_t prefetch = 0; prefetch < 2; ++prefetch)
+    {
+      data::BlockReader<> reader(files[f], 100, prefetch == 1);
+      BOOST_REQUIRE_EQUAL(reader.Dimensionality(), 5);
+
+      // Make two passes over the dataset.
+      for (size_t pass = 0; pass < 2; ++pass)
+      {
+        arma::mat block;
+        size_t points = 0;
+        while (reader.Next(block))
+        {
+          BOOST_REQUIRE_EQUAL(block.n_rows, 5);
+          BOOST_REQUIRE_EQUAL(block.n_cols, std::min((size_t) 100,
+              dataset.n_cols - points));
+          for (size_t j = 0; j < block.n_cols; ++j)
+            for (size_t i = 0; i < block.n_rows; ++i)
+              BOOST_REQUIRE_EQUAL(block(i, j), dataset(i, points + j));
+
+          points += block.n_cols;
+        }
+
+        BOOST_REQUIRE_EQUAL(points, dataset.n_cols);
+        reader.Reset();
+      }
+    }
+
+    remove(files[f]);
+  }
+
+  // Raw binary data needs the dimensionality.
+  dataset.save("test_file.bin", arma::raw_binary);
+  BOOST_REQUIRE_THROW(data::BlockReader<>("test_file.bin", 100),
+      std::runtime_error);
+  data::BlockReader<> reader("test_file.bin", 1000, true, 5);
+  arma::mat block;
+  BOOST_REQUIRE(reader.Next(block) == true);
+  BOOST_REQUIRE_EQUAL(block.n_cols, 1000);
+  BOOST_REQUIRE(reader.Next(block) == true);
+  BOOST_REQUIRE_EQUAL(block.n_cols, 3);
+  BOOST_REQUIRE_EQUAL(block(4, 2), dataset(4, 1002));
+  BOOST_REQUIRE(reader.Next(block) == false);
+
+  remove("test_file.bin");
+}
+
+/**
+ * Results written by ResultWriter can be loaded back, in each format.
+ */
+BOOST_AUTO_TEST_CASE(ResultWriterTest)
+{
+  arma::Mat<size_t> neighbors(3, 2500);
+  arma::mat distances(3, 2500);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    neighbors[i] = (i * 7919) % 100003;
+    distances[i] = (double) i / 3.0 - 1000.0;
+  }
+
+  const char* files[] = { "test_file.csv", "test_file.txt", "test_file.bin" };
+  for (size_t f = 0; f < 3; ++f)
+  {
+    BOOST_REQUIRE(data::SaveResult(files[f], neighbors) == true);
+    arma::Mat<size_t> loadedNeighbors;
+    BOOST_REQUIRE(data::Load(files[f], loadedNeighbors) == true);
+    BOOST_REQUIRE_EQUAL(loadedNeighbors.n_rows, 3);
+    BOOST_REQUIRE_EQUAL(loadedNeighbors.n_cols, 2500);
+    for (size_t i = 0; i < neighbors.n_elem; ++i)
+      BOOST_REQUIRE_EQUAL(loadedNeighbors[i], neighbors[i]);
+
+    BOOST_REQUIRE(data::SaveResult(files[f], distances) == true);
+    arma::mat loadedDistances;
+    BOOST_REQUIRE(data::Load(files[f], loadedDistances) == true);
+    BOOST_REQUIRE_EQUAL(loadedDistances.n_rows, 3);
+    BOOST_REQUIRE_EQUAL(loadedDistances.n_cols, 2500);
+    for (size_t i = 0; i < distances.n_elem; ++i)
+      BOOST_REQUIRE_CLOSE(loadedDistances[i], distances[i], 1e-5);
+
+    remove(files[f]);
+  }
+
+  // Lines of different lengths can only be written to text files.
+  std::vector<std::vector<size_t> > lines(3);
+  lines[0].push_back(4);
+  lines[0].push_back(2);
+  lines[2].push_back(7);
+  {
+    data::ResultWriter writer("test_file.csv");
+    writer.WriteLines(lines);
+  }
+  fstream f("test_file.csv", fstream::in);
+  std::string line;
+  BOOST_REQUIRE(std::getline(f, line));
+  BOOST_REQUIRE_EQUAL(line, "4, 2");
+  BOOST_REQUIRE(std::getline(f, line));
+  BOOST_REQUIRE_EQUAL(line, "");
+  BOOST_REQUIRE(std::getline(f, line));
+  BOOST_REQUIRE_EQUAL(line, "7");
+  BOOST_REQUIRE(!std::getline(f, line));
+  f.close();
+
+  // Floating-point values are written as std::ostream writes them.
+  std::vector<std::vector<double> > distanceLines(1);
+  distanceLines[0].push_back(0.5);
+  distanceLines[0].push_back(1.0 / 3.0);
+  distanceLines[0].push_back(1e-7);
+  {
+    data::ResultWriter writer("test_file.csv");
+    writer.WriteLines(distanceLines);
+  }
+  f.open("test_file.csv", fstream::in);
+  BOOST_REQUIRE(std::getline(f, line));
+  BOOST_REQUIRE_EQUAL(line, "0.5, 0.333333, 1e-07");
+  f.close();
+  remove("test_file.csv");
+
+  data::ResultWriter writer("test_file.bin");
+  BOOST_REQUIRE_THROW(writer.WriteLines(lines), std::runtime_error);
+  writer.Close();
+  remove("test_file.bin");
+}
+
+/**
+ * Labels appended to a dataset file give the dataset with the labels as its
+ * last dimension, whether the file is replaced or not.
+ */
+BOOST_AUTO_TEST_CASE(AppendLabelsTest)
+{
+  arma::mat dataset(4, 1500);
+  arma::Row<size_t> labels(1500);
+  for (size_t i = 0; i < dataset.n_cols; ++i)
+  {
+    for (size_t d = 0; d < dataset.n_rows; ++d)
+      dataset(d, i) = (double) (i + d) / 4.0;
+    labels[i] = i % 13;
+  }
+
+  const char* files[] = { "test_file.csv", "test_file.txt", "test_file.bin" };
+  const char* outputFiles[] = { "test_labeled.csv", "test_labeled.txt",
+      "test_labeled.bin" };
+  for (size_t f = 0; f < 3; ++f)
+  {
+    BOOST_REQUIRE(data::Save(files[f], dataset) == true);
+    BOOST_REQUIRE(data::AppendLabels(files[f], outputFiles[f], labels) ==
+        true);
+    BOOST_REQUIRE(data::AppendLabels(files[f], files[f], labels) == true);
+
+    for (size_t o = 0; o < 2; ++o)
+    {
+      arma::mat labeled;
+      BOOST_REQUIRE(data::Load((o == 0) ? files[f] : outputFiles[f], labeled)
+          == true);
+      BOOST_REQUIRE_EQUAL(labeled.n_rows, 5);
+      BOOST_REQUIRE_EQUAL(labeled.n_cols, 1500);
+      for (size_t i = 0; i < labeled.n_cols; ++i)
+      {
+        for (size_t d = 0; d < dataset.n_rows; ++d)
+          BOOST_REQUIRE_CLOSE(labeled(d, i) + 1.0, dataset(d, i) + 1.0, 1e-5);
+        BOOST_REQUIRE_EQUAL(labeled(4, i), (double) labels[i]);
+      }
+    }
+
+    remove(files[f]);
+    remove(outputFiles[f]);
+  }
+
+  // Blank lines and line terminators are kept, and comma-separated values are
+  // labeled with commas, whatever the extension.
+  fstream f("test_file.txt", fstream::out | fstream::binary);
+  f << "1,2\r\n\r\n3,4";
+  f.close();
+  arma::Row<size_t> twoLabels("5 6");
+  BOOST_REQUIRE(data::AppendLabels("test_file.txt", "test_file.txt",
+      twoLabels) == true);
+  f.open("test_file.txt", fstream::in | fstream::binary);
+  std::stringstream contents;
+  contents << f.rdbuf();
+  f.close();
+  BOOST_REQUIRE_EQUAL(contents.str(), "1,2,5\r\n\r\n3,4,6\n");
+
+  // Nothing is written if the number of labels is wrong, or the formats
+  // differ.
+  BOOST_REQUIRE(data::AppendLabels("test_file.txt", "test_labeled.txt",
+      labels) == false);
+  BOOST_REQUIRE(data::AppendLabels("test_file.txt", "test_labeled.csv",
+      twoLabels) == false);
+  f.open("test_labeled.txt", fstream::in);
+  BOOST_REQUIRE(!f.is_open());
+  remove("test_file.txt");
+}
+
+/**
+ * A line may have more fields than the first one; every line is then padded
+ * to the longest, as Armadillo does.
+ */
+BOOST_AUTO_TEST_CASE(RaggedCSVLoadTest)
+{
+  fstream f;
+  f.open("test.csv", fstream::out);
+  f << "1, 2" << endl;
+  f << "3, 4, 5" << endl;
+  f << "6" << endl;
+  f << "7, 8, 9, 10" << endl;
+  f.close();
+
+  arma::mat matrix;
+  BOOST_REQUIRE(data::Load("test.csv", matrix) == true);
+
+  BOOST_REQUIRE_EQUAL(matrix.n_rows, 4);
+  BOOST_REQUIRE_EQUAL(matrix.n_cols, 4);
+  const double expected[] = { 1, 2, 0, 0, 3, 4, 5, 0, 6, 0, 0, 0, 7, 8, 9, 10 };
+  for (size_t i = 0; i < 16; ++i)
+    BOOST_REQUIRE_EQUAL(matrix[i], expected[i]);
+
+  remove("test.csv");
+}
+
+/**
+ * Categories are numbered in the order of the file even when the file is
+ * split into several chunks, and when the first non-numeric field of a
+ * dimension is far from the start of the file.
+ */
+BOOST_AUTO_TEST_CASE(LargeCategoricalCSVLoadTest)
+{
+  fstream f;
+  f.open("test.csv", fstream::out);
+  const size_t points = 200000;
+  for (size_t i = 0; i < points; ++i)
+  {
+    f << i << ", ";
+    if (i < 150000)
+      f << (i % 3);
+    else
+      f << "c" << (i % 5);
+    f << endl;
+  }
+  f.close();
+
+  arma::mat matrix;
+  DatasetInfo info;
+  BOOST_REQUIRE(data::Load("test.csv", matrix, info) == true);
+
+  BOOST_REQUIRE_EQUAL(matrix.n_rows, 2);
+  BOOST_REQUIRE_EQUAL(matrix.n_cols, points);
+  BOOST_REQUIRE(info.Type(0) == Datatype::numeric);
+  BOOST_REQUIRE(info.Type(1) == Datatype::categorical);
+  BOOST_REQUIRE_EQUAL(info.NumMappings(1), 8);
+
+  // "0", "1" and "2" come first, then "c0" to "c4" in the order they appear.
+  for (size_t i = 0; i < points; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(matrix(0, i), (double) i);
+    if (i < 150000)
+      BOOST_REQUIRE_EQUAL(matrix(1, i), (double) (i % 3));
+    else
+      BOOST_REQUIRE_EQUAL(matrix(1, i), 3.0 + (double) (i % 5));
+  }
+
+  remove("test.csv");
+}
+
 /**
  * A simple ARFF load test.  Two attributes, both numeric.
  */
@@ -1260,6 +1756,76 @@ BOOST_AUTO_TEST_CASE(HarderARFFTest)
   remove("test.arff");
 }
 
+/**
+ * Load an ARFF file without transposing, with comments and blank lines in the
+ * data section, and make sure it matches the transposed load.
+ */
+BOOST_AUTO_TEST_CASE(NontransposedARFFTest)
+{
+  fstream f;
+  f.open("test.arff", fstream::out);
+  f << "@relation test" << endl;
+  f << "@attribute one NUMERIC" << endl;
+  f << "@attribute two STRING" << endl;
+  f << "@attribute three NUMERIC" << endl;
+  f << "@data" << endl;
+  f << "1, a, 2" << endl;
+  f << "\% comment" << endl;
+  f << endl;
+  f << "3, \"b % c\", 4 \% comment" << endl;
+  f << "5, a, 6" << endl;
+  f.close();
+
+  arma::mat dataset;
+  DatasetInfo info;
+  BOOST_REQUIRE(data::Load("test.arff", dataset, info) == true);
+  arma::mat nontransposed;
+  DatasetInfo nontransposedInfo;
+  BOOST_REQUIRE(data::Load("test.arff", nontransposed, nontransposedInfo,
+      true, false) == true);
+
+  BOOST_REQUIRE_EQUAL(dataset.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(dataset.n_cols, 3);
+  BOOST_REQUIRE_EQUAL(nontransposed.n_rows, 3);
+  BOOST_REQUIRE_EQUAL(nontransposed.n_cols, 3);
+
+  BOOST_REQUIRE_EQUAL(dataset(0, 1), 3.0);
+  BOOST_REQUIRE_EQUAL(dataset(2, 2), 6.0);
+  BOOST_REQUIRE_EQUAL(dataset(1, 0), dataset(1, 2));
+  BOOST_REQUIRE_NE(dataset(1, 0), dataset(1, 1));
+  BOOST_REQUIRE_EQUAL(info.UnmapString(1, 1), "b % c");
+
+  for (size_t i = 0; i < 3; ++i)
+    for (size_t j = 0; j < 3; ++j)
+      BOOST_REQUIRE_EQUAL(nontransposed(j, i), dataset(i, j));
+
+  remove("test.arff");
+}
+
+/**
+ * A missing value is an error, and the load fails.
+ */
+BOOST_AUTO_TEST_CASE(MissingValueARFFTest)
+{
+  fstream f;
+  f.open("test.arff", fstream::out);
+  f << "@relation test" << endl;
+  f << "@attribute one NUMERIC" << endl;
+  f << "@attribute two NUMERIC" << endl;
+  f << "@data" << endl;
+  f << "1, 2" << endl;
+  f << "3, ?" << endl;
+  f.close();
+
+  arma::mat dataset;
+  DatasetInfo info;
+  Log::Warn.ignoreInput = true;
+  BOOST_REQUIRE(data::Load("test.arff", dataset, info) == false);
+  Log::Warn.ignoreInput = false;
+
+  remove("test.arff");
+}
+
 /**
  * If we pass a bad DatasetInfo, it should throw.
  */
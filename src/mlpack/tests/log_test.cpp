@@ -7,6 +7,9 @@
 
 #include <mlpack/core.hpp>
 
+#include <sstream>
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 #include "old_boost_test_definitions.hpp"
 
@@ -42,4 +45,51 @@ BOOST_AUTO_TEST_CASE(LogAssertConditionTest)
   #endif
 }
 
+/**
+ * Lines written by several threads through a LogSink are written whole, and
+ * the lines of each thread are written in order.
+ */
+BOOST_AUTO_TEST_CASE(LogSinkThreadsTest)
+{
+  std::stringstream ss;
+  util::LogSink sink;
+  sink.Start();
+  util::PrefixedOutStream stream(ss, "[TEST] ", false, false, &sink);
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t)
+  {
+    threads.push_back(std::thread([&stream, t]()
+    {
+      for (size_t i = 0; i < 1000; ++i)
+        stream << "thread " << t << " line " << i << "." << std::endl;
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t)
+    threads[t].join();
+  sink.Stop();
+
+  std::vector<size_t> lines(4, 0);
+  std::string line;
+  while (std::getline(ss, line))
+  {
+    std::istringstream fields(line);
+    std::string prefix, threadWord, lineWord;
+    size_t t, i;
+    fields >> prefix >> threadWord >> t >> lineWord >> i;
+    BOOST_REQUIRE_EQUAL(prefix, "[TEST]");
+    BOOST_REQUIRE_LT(t, 4);
+    BOOST_REQUIRE_EQUAL(i, lines[t]);
+    ++lines[t];
+  }
+  for (size_t t = 0; t < 4; ++t)
+    BOOST_REQUIRE_EQUAL(lines[t], 1000);
+
+  // Once the sink is stopped, lines are written directly.
+  ss.clear();
+  ss.str("");
+  stream << "a" << 1 << "\nb";
+  BOOST_REQUIRE_EQUAL(ss.str(), "[TEST] a1\n[TEST] b");
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -585,4 +585,59 @@ BOOST_AUTO_TEST_CASE(RangeContainsRange)
   BOOST_REQUIRE_EQUAL(b.Contains(a), true);
 }
 
+/**
+ * Make sure that random streams are reproducible, can be skipped ahead, and
+ * are restarted by RandomSeed().
+ */
+BOOST_AUTO_TEST_CASE(RandomStreamTest)
+{
+  RandomStream a(42, 3), b(42, 3), c(42, 4), d(43, 3);
+  std::vector<uint64_t> values(100);
+  for (size_t i = 0; i < 100; ++i)
+  {
+    values[i] = a();
+    BOOST_REQUIRE_EQUAL(values[i], b());
+  }
+
+  // Other streams and seeds give other numbers.
+  BOOST_REQUIRE_NE(values[0], c());
+  BOOST_REQUIRE_NE(values[0], d());
+
+  // Skipping ahead is the same as generating.
+  RandomStream e(42, 3);
+  e.Discard(50);
+  BOOST_REQUIRE_EQUAL(e.Position(), 50);
+  BOOST_REQUIRE_EQUAL(e(), values[50]);
+
+  // Uniform numbers are in [0, 1) and have the right mean.
+  double sum = 0.0;
+  for (size_t i = 0; i < 10000; ++i)
+  {
+    const double u = a.Uniform();
+    BOOST_REQUIRE_GE(u, 0.0);
+    BOOST_REQUIRE_LT(u, 1.0);
+    sum += u;
+  }
+  BOOST_REQUIRE_CLOSE(sum / 10000.0, 0.5, 3.0);
+
+  // The stream seeds and the thread stream depend only on the random seed.
+  RandomSeed(7);
+  const uint64_t seed1 = NewStreamSeed();
+  const uint64_t seed2 = NewStreamSeed();
+  const uint64_t stream1 = ThreadStream()();
+  RandomSeed(7);
+  BOOST_REQUIRE_EQUAL(NewStreamSeed(), seed1);
+  BOOST_REQUIRE_EQUAL(NewStreamSeed(), seed2);
+  BOOST_REQUIRE_NE(seed1, seed2);
+  BOOST_REQUIRE_EQUAL(ThreadStream()(), stream1);
+
+  // The serial functions still use the global generator, so the streams do
+  // not change their sequence.
+  RandomSeed(7);
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<> distribution(0.0, 1.0);
+  ThreadStream()();
+  BOOST_REQUIRE_EQUAL(Random(), distribution(generator));
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -814,6 +814,99 @@ BOOST_AUTO_TEST_CASE(AllkNNTest)
   CheckMatrices(neighbors, xmlNeighbors, textNeighbors, binaryNeighbors);
 }
 
+/**
+ * Save and load matrices in the mapped binary archive: the large matrix should
+ * use the mapped file, and the small one should be copied.
+ */
+BOOST_AUTO_TEST_CASE(MappedArchiveMatrixTest)
+{
+  arma::mat largeMat = arma::randu<arma::mat>(20, 1000);
+  arma::vec smallVec = arma::randu<arma::vec>(10);
+
+  {
+    std::ofstream ofs("test.mbin", std::ios::binary);
+    data::MappedOArchive o(ofs);
+    o << BOOST_SERIALIZATION_NVP(smallVec) << BOOST_SERIALIZATION_NVP(largeMat);
+  }
+
+  arma::mat newLargeMat(3, 3);
+  arma::vec newSmallVec;
+  {
+    data::MappedIArchive i("test.mbin");
+    i >> make_nvp("smallVec", newSmallVec) >> make_nvp("largeMat", newLargeMat);
+  }
+
+  BOOST_REQUIRE_EQUAL(newSmallVec.n_elem, 10);
+  BOOST_REQUIRE_EQUAL(newSmallVec.n_cols, 1);
+  for (size_t i = 0; i < smallVec.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(newSmallVec[i], smallVec[i]);
+
+  BOOST_REQUIRE_EQUAL(newLargeMat.n_rows, 20);
+  BOOST_REQUIRE_EQUAL(newLargeMat.n_cols, 1000);
+  for (size_t i = 0; i < largeMat.n_elem; ++i)
+    BOOST_REQUIRE_EQUAL(newLargeMat[i], largeMat[i]);
+
+  BOOST_REQUIRE_EQUAL(data::mapped::Kept(newSmallVec.memptr()), false);
+  BOOST_REQUIRE_EQUAL(data::mapped::Kept(newLargeMat.memptr()), true);
+  BOOST_REQUIRE_EQUAL((size_t) newLargeMat.memptr() % 64, 0);
+
+  // The mapping is private, so modifying the matrix does not change the file.
+  newLargeMat(0, 0) = -1.0;
+  BOOST_REQUIRE(data::UnmapMatrix(newLargeMat));
+  BOOST_REQUIRE_EQUAL(newLargeMat.n_elem, 0);
+
+  {
+    data::MappedIArchive i("test.mbin");
+    i >> make_nvp("smallVec", newSmallVec) >> make_nvp("largeMat", newLargeMat);
+  }
+  BOOST_REQUIRE_EQUAL(newLargeMat(0, 0), largeMat(0, 0));
+  BOOST_REQUIRE(data::UnmapMatrix(newLargeMat));
+
+  remove("test.mbin");
+}
+
+/**
+ * Save and load a model with data::Save() and data::Load() in the mapped binary
+ * format, and make sure it gives the same results.
+ */
+BOOST_AUTO_TEST_CASE(MappedArchiveModelTest)
+{
+  using neighbor::AllkNN;
+  arma::mat dataset = arma::randu<arma::mat>(5, 2000);
+
+  AllkNN allknn(dataset, false, false);
+  BOOST_REQUIRE(data::Save("test.mbin", "allknn", allknn));
+
+  AllkNN newAllknn;
+  BOOST_REQUIRE(data::Load("test.mbin", "allknn", newAllknn));
+  BOOST_REQUIRE_EQUAL(data::mapped::Kept(newAllknn.ReferenceSet().memptr()),
+      true);
+
+  arma::mat querySet = arma::randu<arma::mat>(5, 1000);
+
+  arma::mat distances, newDistances;
+  arma::Mat<size_t> neighbors, newNeighbors;
+
+  allknn.Search(querySet, 5, neighbors, distances);
+  newAllknn.Search(querySet, 5, newNeighbors, newDistances);
+
+  BOOST_REQUIRE_EQUAL(newNeighbors.n_rows, 5);
+  BOOST_REQUIRE_EQUAL(newNeighbors.n_cols, 1000);
+  for (size_t i = 0; i < neighbors.n_elem; ++i)
+  {
+    BOOST_REQUIRE_EQUAL(neighbors[i], newNeighbors[i]);
+    BOOST_REQUIRE_CLOSE(distances[i], newDistances[i], 1e-8);
+  }
+
+  // Files which are not archives are rejected.
+  std::ofstream ofs("test.mbin");
+  ofs << "This is not an archive." << std::endl;
+  ofs.close();
+  BOOST_REQUIRE(!data::Load("test.mbin", "allknn", newAllknn));
+
+  remove("test.mbin");
+}
+
 BOOST_AUTO_TEST_CASE(SoftmaxRegressionTest)
 {
   using regression::SoftmaxRegression;
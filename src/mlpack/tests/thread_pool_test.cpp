@@ -0,0 +1,138 @@
+/**
+ * @file thread_pool_test.cpp
+ *
+ * Tests for the ThreadPool and TaskGroup classes.
+ *
+ * This file is part of mlpack 2.0.1.
+ *
+ * mlpack is free software; you may redstribute it and/or modify it under the
+ * terms of the 3-clause BSD license.  You should have received a copy of the
+ * 3-clause BSD license along with mlpack.  If not, see
+ * http://www.opensource.org/licenses/BSD-3-Clause for more information.
+ */
+#include <mlpack/core.hpp>
+#include <mlpack/core/util/thread_pool.hpp>
+
+#ifdef __linux__
+  #include <sched.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+#include "old_boost_test_definitions.hpp"
+
+using namespace mlpack;
+using namespace mlpack::util;
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolTest);
+
+/**
+ * Make sure that ParallelFor() visits every index exactly once, for any grain.
+ */
+BOOST_AUTO_TEST_CASE(ParallelForTest)
+{
+  ThreadPool pool(4);
+  BOOST_REQUIRE_EQUAL(pool.Threads(), 4);
+
+  for (size_t grain = 1; grain < 200; grain *= 7)
+  {
+    std::vector<std::atomic<size_t> > visits(1000);
+    for (size_t i = 0; i < visits.size(); ++i)
+      visits[i] = 0;
+
+    std::atomic<size_t> largestChunk(0);
+    pool.ParallelFor(10, 1000, grain, [&](size_t begin, size_t end)
+    {
+      // Boost.Test assertions are not thread-safe, so only record here.
+      size_t largest = largestChunk;
+      while (end - begin > largest &&
+          !largestChunk.compare_exchange_weak(largest, end - begin)) { }
+      for (size_t i = begin; i < end; ++i)
+        ++visits[i];
+    });
+
+    BOOST_REQUIRE_LE(largestChunk.load(), grain);
+
+    for (size_t i = 0; i < visits.size(); ++i)
+      BOOST_REQUIRE_EQUAL(visits[i].load(), (i < 10) ? 0 : 1);
+  }
+}
+
+/**
+ * Make sure that ParallelReduce() gives the same result for any number of
+ * threads.
+ */
+BOOST_AUTO_TEST_CASE(ParallelReduceTest)
+{
+  arma::vec values(100000);
+  values.randu();
+  values -= 0.5;
+
+  std::vector<double> sums;
+  for (size_t threads = 1; threads <= 8; threads *= 2)
+  {
+    ThreadPool pool(threads);
+    sums.push_back(pool.ParallelReduce(0, values.n_elem, 1000, 0.0,
+        [&](size_t begin, size_t end)
+        {
+          return arma::accu(values.subvec(begin, end - 1));
+        },
+        [](double a, double b) { return a + b; }));
+  }
+
+  for (size_t i = 1; i < sums.size(); ++i)
+    BOOST_REQUIRE_EQUAL(sums[i], sums[0]);
+  BOOST_REQUIRE_CLOSE(sums[0], arma::accu(values), 1e-8);
+}
+
+/**
+ * Make sure that tasks can wait for their own tasks, and that exceptions are
+ * passed to Wait().
+ */
+BOOST_AUTO_TEST_CASE(TaskGroupTest)
+{
+  ThreadPool pool(3);
+  std::atomic<size_t> count(0);
+
+  TaskGroup outer(pool);
+  for (size_t i = 0; i < 10; ++i)
+  {
+    outer.Run([&]()
+    {
+      TaskGroup inner(pool);
+      for (size_t j = 0; j < 10; ++j)
+        inner.Run([&]() { ++count; });
+      inner.Wait();
+    });
+  }
+  outer.Wait();
+  BOOST_REQUIRE_EQUAL(count.load(), 100);
+
+  TaskGroup failing(pool);
+  failing.Run([]() { throw std::runtime_error("task failed"); });
+  failing.Run([&]() { ++count; });
+  BOOST_REQUIRE_THROW(failing.Wait(), std::runtime_error);
+  BOOST_REQUIRE_EQUAL(count.load(), 101);
+}
+
+/**
+ * Make sure that a pinned pool does not change the CPUs of the calling thread,
+ * which the OpenMP threads it starts would inherit.
+ */
+BOOST_AUTO_TEST_CASE(PinnedPoolAffinityTest)
+{
+#ifdef __linux__
+  cpu_set_t before, after;
+  BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(cpu_set_t), &before), 0);
+
+  ThreadPool pool(2, true);
+  std::atomic<size_t> count(0);
+  pool.ParallelFor(0, 100, 1, [&](size_t begin, size_t end)
+      { count += end - begin; });
+  BOOST_REQUIRE_EQUAL(count.load(), 100);
+
+  BOOST_REQUIRE_EQUAL(sched_getaffinity(0, sizeof(cpu_set_t), &after), 0);
+  BOOST_REQUIRE(CPU_EQUAL(&before, &after));
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END();
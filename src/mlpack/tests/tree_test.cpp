@@ -16,6 +16,7 @@
 #include <mlpack/core/metrics/lmetric.hpp>
 #include <mlpack/core/tree/cover_tree/cover_tree.hpp>
 #include <mlpack/core/tree/rectangle_tree.hpp>
+#include <mlpack/core/util/thread_pool.hpp>
 
 #include <queue>
 #include <stack>
@@ -1574,6 +1575,121 @@ BOOST_AUTO_TEST_CASE(BinarySpaceTreeMoveConstructorTest)
   BOOST_REQUIRE_EQUAL(tree2.NumChildren(), 2);
 }
 
+//! Check that two trees have the same nodes, with the same bounds.
+template<typename TreeType>
+void CheckSameTree(const TreeType& a, const TreeType& b)
+{
+  BOOST_REQUIRE_EQUAL(a.Begin(), b.Begin());
+  BOOST_REQUIRE_EQUAL(a.Count(), b.Count());
+  BOOST_REQUIRE_EQUAL(a.NumChildren(), b.NumChildren());
+  BOOST_REQUIRE_EQUAL(a.ParentDistance(), b.ParentDistance());
+  BOOST_REQUIRE_EQUAL(a.FurthestDescendantDistance(),
+      b.FurthestDescendantDistance());
+  for (size_t d = 0; d < a.Bound().Dim(); ++d)
+  {
+    BOOST_REQUIRE_EQUAL(a.Bound()[d].Lo(), b.Bound()[d].Lo());
+    BOOST_REQUIRE_EQUAL(a.Bound()[d].Hi(), b.Bound()[d].Hi());
+  }
+
+  for (size_t i = 0; i < a.NumChildren(); ++i)
+    CheckSameTree(a.Child(i), b.Child(i));
+}
+
+//! Build a tree with one thread and with several, and check that the trees are
+//! the same.
+template<typename TreeType>
+void CheckParallelBuild(const arma::mat& dataset)
+{
+  util::ThreadPool::Configure(1, false);
+  std::vector<size_t> serialOldFromNew;
+  TreeType serial(dataset, serialOldFromNew, 20);
+
+  util::ThreadPool::Configure(4, false);
+  std::vector<size_t> parallelOldFromNew;
+  TreeType parallel(dataset, parallelOldFromNew, 20);
+  util::ThreadPool::Configure(0, false);
+
+  BOOST_REQUIRE_EQUAL(serialOldFromNew.size(), parallelOldFromNew.size());
+  for (size_t i = 0; i < serialOldFromNew.size(); ++i)
+    BOOST_REQUIRE_EQUAL(serialOldFromNew[i], parallelOldFromNew[i]);
+  BOOST_REQUIRE(arma::all(arma::vectorise(serial.Dataset() ==
+      parallel.Dataset())));
+  CheckSameTree(serial, parallel);
+}
+
+/**
+ * Make sure that large trees, whose top levels are built in parallel, are the
+ * same as when they are built serially.
+ */
+BOOST_AUTO_TEST_CASE(ParallelBuildTest)
+{
+  // Many points are duplicated in the first dimension.
+  arma::mat dataset(3, 300000);
+  dataset.randu();
+  dataset.row(0) = arma::floor(100 * dataset.row(0));
+
+  CheckParallelBuild<KDTree<EuclideanDistance, EmptyStatistic, arma::mat> >(
+      dataset);
+  CheckParallelBuild<MeanSplitKDTree<EuclideanDistance, EmptyStatistic,
+      arma::mat> >(dataset);
+  CheckParallelBuild<BallTree<EuclideanDistance, EmptyStatistic, arma::mat> >(
+      dataset);
+}
+
+//! Check that the children of each node link back to it, and that each node
+//! (except the root) is followed in memory by its left child, if it has one.
+template<typename TreeType>
+void CheckDepthFirstLayout(const TreeType& node, const bool root)
+{
+  for (size_t i = 0; i < node.NumChildren(); ++i)
+  {
+    BOOST_REQUIRE_EQUAL(node.Child(i).Parent(), &node);
+    CheckDepthFirstLayout(node.Child(i), false);
+  }
+
+  if (!root && node.NumChildren() > 0)
+    BOOST_REQUIRE_EQUAL(&node.Child(0), &node + 1);
+}
+
+/**
+ * Make sure that a compact tree is the same as the tree it was made from, in
+ * either order, and that the nodes are stored in depth-first order.
+ */
+BOOST_AUTO_TEST_CASE(CompactTreeTest)
+{
+  typedef KDTree<EuclideanDistance, EmptyStatistic, arma::mat> TreeType;
+
+  arma::mat dataset(4, 2000);
+  dataset.randu();
+
+  TreeType tree(dataset, 5);
+  TreeType original(tree);
+
+  tree.Compact();
+  CheckSameTree(original, tree);
+  CheckDepthFirstLayout(tree, true);
+
+  // A compact tree can be compacted again, in another order.
+  tree.Compact(TreeType::VAN_EMDE_BOAS);
+  CheckSameTree(original, tree);
+
+  tree.Compact(TreeType::DEPTH_FIRST);
+  CheckSameTree(original, tree);
+  CheckDepthFirstLayout(tree, true);
+
+  // A moved compact tree is still valid.
+  TreeType moved(std::move(tree));
+  CheckSameTree(original, moved);
+
+  // Ball trees keep their bounds, but are compacted too.
+  BallTree<EuclideanDistance, EmptyStatistic, arma::mat> ballTree(dataset, 5);
+  BallTree<EuclideanDistance, EmptyStatistic, arma::mat> ballOriginal(
+      ballTree);
+  ballTree.Compact(BallTree<EuclideanDistance, EmptyStatistic,
+      arma::mat>::VAN_EMDE_BOAS);
+  CheckSameTree(ballOriginal, ballTree);
+}
+
 template<typename TreeType>
 void RecurseTreeCountLeaves(const TreeType& node, arma::vec& counts)
 {